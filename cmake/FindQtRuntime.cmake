@@ -1,5 +1,5 @@
 # Find a compatible Qt version
-# Inputs: WITH_SERVER, WITH_CLIENT, WITH_ORACLE, WITH_DBCONVERTER, FORCE_USE_QT5
+# Inputs: WITH_SERVER, WITH_CLIENT, WITH_ORACLE, WITH_DBCONVERTER, TEST, BENCHMARK, FORCE_USE_QT5
 # Optional Input: QT6_DIR -- Hint as to where Qt6 lives on the system
 # Optional Input: QT5_DIR -- Hint as to where Qt5 lives on the system
 # Output: COCKATRICE_QT_VERSION_NAME -- Example values: Qt5, Qt6
@@ -31,8 +31,8 @@ endif()
 if(WITH_DBCONVERTER)
   set(_DBCONVERTER_NEEDED Network Widgets)
 endif()
-if(TEST)
-  set(_TEST_NEEDED Widgets)
+if(TEST OR BENCHMARK)
+  set(_TEST_NEEDED Network Widgets)
 endif()
 
 set(REQUIRED_QT_COMPONENTS ${REQUIRED_QT_COMPONENTS} ${_SERVATRICE_NEEDED} ${_COCKATRICE_NEEDED} ${_ORACLE_NEEDED}
@@ -62,7 +62,7 @@ if(Qt6_FOUND)
   endif()
 else()
   find_package(
-    Qt5 5.8.0
+    Qt5 5.9.0
     COMPONENTS ${REQUIRED_QT_COMPONENTS}
     QUIET HINTS ${Qt5_DIR}
   )
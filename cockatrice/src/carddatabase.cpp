@@ -1,5 +1,6 @@
 #include "carddatabase.h"
 
+#include "carddatabasecache.h"
 #include "carddbparser/cockatricexml3.h"
 #include "carddbparser/cockatricexml4.h"
 #include "game_specific_terms.h"
@@ -11,14 +12,25 @@
 #include <QDebug>
 #include <QDir>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QMessageBox>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
 #include <algorithm>
 #include <utility>
 
 const char *CardDatabase::TOKENS_SETNAME = "TK";
 
+static QVector<ICardDatabaseParser *> newParsers()
+{
+    // add new parsers here
+    return QVector<ICardDatabaseParser *>() << new CockatriceXml4Parser << new CockatriceXml3Parser;
+}
+
 CardSet::CardSet(const QString &_shortName,
                  const QString &_longName,
                  const QString &_setType,
@@ -70,6 +82,10 @@ QString CardSet::getCorrectedShortName() const
 
 void CardSet::loadSetOptions()
 {
+    // sets are created by several file loaders at once, and reading a setting moves the shared settings group
+    static QMutex settingsMutex;
+    QMutexLocker locker(&settingsMutex);
+
     sortKey = SettingsCache::instance().cardDatabase().getSortKey(shortName);
     enabled = SettingsCache::instance().cardDatabase().isEnabled(shortName);
     isknown = SettingsCache::instance().cardDatabase().isKnown(shortName);
@@ -227,7 +243,7 @@ CardInfo::CardInfo(const QString &_name,
                    bool _cipt,
                    int _tableRow,
                    bool _upsideDownArt)
-    : name(_name), text(_text), isToken(_isToken), properties(std::move(_properties)), relatedCards(_relatedCards),
+    : name(_name), text(_text), isToken(_isToken), properties(_properties), relatedCards(_relatedCards),
       reverseRelatedCards(_reverseRelatedCards), sets(std::move(_sets)), cipt(_cipt), tableRow(_tableRow),
       upsideDownArt(_upsideDownArt)
 {
@@ -279,6 +295,26 @@ void CardInfo::addToSet(const CardSetPtr &_set, const CardInfoPerSet _info)
     refreshCachedSetNames();
 }
 
+void CardInfo::rebindSets(const SetNameMap &knownSets)
+{
+    bool changed = false;
+    for (auto it = sets.begin(); it != sets.end(); ++it) {
+        const CardSetPtr known = knownSets.value(it.key());
+        if (!known || known == it.value().getPtr())
+            continue;
+
+        CardInfoPerSet rebound(known);
+        for (const QString &property : it.value().getProperties())
+            rebound.setProperty(property, it.value().getProperty(property));
+        it.value() = rebound;
+        known->append(smartThis);
+        changed = true;
+    }
+
+    if (changed)
+        refreshCachedSetNames();
+}
+
 void CardInfo::refreshCachedSetNames()
 {
     QStringList setList;
@@ -326,19 +362,68 @@ const QChar CardInfo::getColorChar() const
     }
 }
 
+CardDatabaseFileLoader::CardDatabaseFileLoader(const QString &_path)
+    : path(_path), resultThread(QThread::currentThread()), status(NotLoaded), msecs(0)
+{
+    setAutoDelete(false);
+}
+
+void CardDatabaseFileLoader::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        status = FileError;
+        msecs = timer.elapsed();
+        return;
+    }
+
+    status = Invalid;
+    QVector<ICardDatabaseParser *> parsers = newParsers();
+    for (auto parser : parsers) {
+        file.reset();
+        if (parser->getCanParseFile(path, file)) {
+            connect(parser, SIGNAL(addCard(CardInfoPtr)), this, SLOT(addCard(CardInfoPtr)), Qt::DirectConnection);
+            connect(parser, SIGNAL(addSet(CardSetPtr)), this, SLOT(addSet(CardSetPtr)), Qt::DirectConnection);
+            file.reset();
+            parser->parseFile(file);
+            status = Ok;
+            break;
+        }
+    }
+    qDeleteAll(parsers);
+
+    // objects can only be pushed to another thread from their own
+    for (const CardInfoPtr &card : loadedCards) {
+        card->moveToThread(resultThread);
+        for (CardRelation *relation : card->getRelatedCards())
+            relation->moveToThread(resultThread);
+        for (CardRelation *relation : card->getReverseRelatedCards())
+            relation->moveToThread(resultThread);
+    }
+
+    msecs = timer.elapsed();
+}
+
+void CardDatabaseFileLoader::addCard(CardInfoPtr card)
+{
+    loadedCards << card;
+}
+
+void CardDatabaseFileLoader::addSet(CardSetPtr set)
+{
+    loadedSets << set;
+}
+
 CardDatabase::CardDatabase(QObject *parent) : QObject(parent), loadStatus(NotLoaded)
 {
     qRegisterMetaType<CardInfoPtr>("CardInfoPtr");
     qRegisterMetaType<CardInfoPtr>("CardSetPtr");
 
-    // add new parsers here
-    availableParsers << new CockatriceXml4Parser;
-    availableParsers << new CockatriceXml3Parser;
-
-    for (auto &parser : availableParsers) {
-        connect(parser, SIGNAL(addCard(CardInfoPtr)), this, SLOT(addCard(CardInfoPtr)), Qt::DirectConnection);
-        connect(parser, SIGNAL(addSet(CardSetPtr)), this, SLOT(addSet(CardSetPtr)), Qt::DirectConnection);
-    }
+    // files are parsed by CardDatabaseFileLoader, these are used for saving
+    availableParsers = newParsers();
 
     connect(&SettingsCache::instance(), SIGNAL(cardDatabasePathChanged()), this, SLOT(loadCardDatabases()));
 }
@@ -365,7 +450,6 @@ void CardDatabase::clear()
     simpleNameCards.clear();
 
     sets.clear();
-    ICardDatabaseParser::clearSetlist();
 
     loadStatus = NotLoaded;
 
@@ -490,22 +574,29 @@ CardInfoPtr CardDatabase::getCardFromMap(const CardNameMap &cardMap, const QStri
 
 LoadStatus CardDatabase::loadFromFile(const QString &fileName)
 {
-    QFile file(fileName);
-    file.open(QIODevice::ReadOnly);
-    if (!file.isOpen()) {
-        return FileError;
-    }
+    CardDatabaseFileLoader loader(fileName);
+    loader.run();
+    mergeLoadedFile(loader);
+    return loader.getStatus();
+}
 
-    for (auto parser : availableParsers) {
-        file.reset();
-        if (parser->getCanParseFile(fileName, file)) {
-            file.reset();
-            parser->parseFile(file);
-            return Ok;
-        }
+void CardDatabase::mergeLoadedFile(const CardDatabaseFileLoader &loader)
+{
+    // the first file to bring a set keeps it, the cards of later files are moved over to that one
+    bool rebind = false;
+    for (const CardSetPtr &set : loader.getSets()) {
+        const CardSetPtr known = sets.value(set->getShortName());
+        if (!known)
+            addSet(set);
+        else if (known != set)
+            rebind = true;
     }
 
-    return Invalid;
+    for (const CardInfoPtr &card : loader.getCards()) {
+        if (rebind)
+            card->rebindSets(sets);
+        addCard(card);
+    }
 }
 
 LoadStatus CardDatabase::loadCardDatabase(const QString &path)
@@ -533,9 +624,9 @@ LoadStatus CardDatabase::loadCardDatabases()
 
     clear(); // remove old db
 
-    loadStatus = loadCardDatabase(SettingsCache::instance().getCardDatabasePath()); // load main card database
-    loadCardDatabase(SettingsCache::instance().getTokenDatabasePath());             // load tokens database
-    loadCardDatabase(SettingsCache::instance().getSpoilerCardDatabasePath());       // load spoilers database
+    const QString cardDatabasePath = SettingsCache::instance().getCardDatabasePath();
+    const QString tokenDatabasePath = SettingsCache::instance().getTokenDatabasePath();
+    const QString spoilerDatabasePath = SettingsCache::instance().getSpoilerCardDatabasePath();
 
     // find all custom card databases, recursively & following symlinks
     // then load them alphabetically
@@ -548,10 +639,56 @@ LoadStatus CardDatabase::loadCardDatabases()
     }
     databasePaths.sort();
 
-    for (auto i = 0; i < databasePaths.size(); ++i) {
-        const auto &databasePath = databasePaths.at(i);
-        qDebug() << "Loading Custom Set" << i << "(" << databasePath << ")";
-        loadCardDatabase(databasePath);
+    const QStringList sourcePaths = QStringList() << cardDatabasePath << tokenDatabasePath << spoilerDatabasePath
+                                                  << databasePaths;
+
+    if (loadCardDatabaseCache(sourcePaths)) {
+        loadStatus = Ok;
+    } else {
+        // take the state of the files before parsing them, a file that changes meanwhile leaves a stale cache
+        QList<CardDatabaseCache::SourceFile> sourceFiles;
+        if (!cacheFilePath.isEmpty())
+            sourceFiles = CardDatabaseCache::inspectSources(sourcePaths);
+
+        // parse all the files at once, each into its own sets and cards
+        QElapsedTimer timer;
+        timer.start();
+        QList<CardDatabaseFileLoader *> loaders;
+        QThreadPool pool;
+        for (const QString &path : sourcePaths) {
+            auto *loader = new CardDatabaseFileLoader(path);
+            loaders << loader;
+            if (!path.isEmpty())
+                pool.start(loader);
+        }
+        pool.waitForDone();
+        const qint64 parseMsecs = timer.elapsed();
+
+        // then merge them in the order they used to be loaded one after the other: main card database, tokens,
+        // spoilers and the custom databases alphabetically. The first file bringing a card or a set keeps it, the
+        // later ones only add their printings.
+        loadFromFileMutex->lock();
+        for (const CardDatabaseFileLoader *loader : loaders) {
+            timer.restart();
+            mergeLoadedFile(*loader);
+            qDebug() << "[CardDatabase] loadCardDatabases(): Path =" << loader->getPath()
+                     << "Status =" << loader->getStatus() << "Cards =" << loader->getCards().size()
+                     << "Sets =" << loader->getSets().size()
+                     << QString("parsed in %1ms, merged in %2ms").arg(loader->getMsecs()).arg(timer.elapsed());
+        }
+        loadFromFileMutex->unlock();
+        qDebug() << "[CardDatabase] loadCardDatabases(): parsed" << loaders.size() << "files in"
+                 << QString("%1ms").arg(parseMsecs) << "using" << pool.maxThreadCount() << "threads";
+
+        loadStatus = loaders.first()->getStatus(); // the main card database decides
+        qDeleteAll(loaders);
+
+        if (loadStatus == Ok && !cacheFilePath.isEmpty()) {
+            auto startTime = QTime::currentTime();
+            bool saved = CardDatabaseCache(cacheFilePath).save(sourceFiles, getSetList(), getCardList());
+            qDebug() << "[CardDatabase] Saved cache" << cacheFilePath << "Ok =" << saved
+                     << QString("%1ms").arg(startTime.msecsTo(QTime::currentTime()));
+        }
     }
 
     // AFTER all the cards have been loaded
@@ -571,6 +708,33 @@ LoadStatus CardDatabase::loadCardDatabases()
     return loadStatus;
 }
 
+bool CardDatabase::loadCardDatabaseCache(const QStringList &sourcePaths)
+{
+    if (cacheFilePath.isEmpty())
+        return false;
+
+    auto startTime = QTime::currentTime();
+    QList<CardSetPtr> cachedSets;
+    QList<CardInfoPtr> cachedCards;
+    loadFromFileMutex->lock();
+    bool loaded = CardDatabaseCache(cacheFilePath).load(sourcePaths, cachedSets, cachedCards);
+    loadFromFileMutex->unlock();
+    if (!loaded) {
+        qDebug() << "[CardDatabase] Cache" << cacheFilePath << "missing or out of date, parsing the databases";
+        return false;
+    }
+
+    for (const CardSetPtr &set : cachedSets)
+        addSet(set);
+    for (const CardInfoPtr &card : cachedCards)
+        addCard(card);
+
+    int msecs = startTime.msecsTo(QTime::currentTime());
+    qDebug() << "[CardDatabase] Loaded cache" << cacheFilePath << "Cards =" << cards.size() << "Sets =" << sets.size()
+             << QString("%1ms").arg(msecs);
+    return true;
+}
+
 void CardDatabase::refreshCachedReverseRelatedCards()
 {
     for (const CardInfoPtr &card : cards)
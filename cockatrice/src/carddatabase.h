@@ -1,12 +1,15 @@
 #ifndef CARDDATABASE_H
 #define CARDDATABASE_H
 
+#include "cardproperties.h"
+
 #include <QBasicMutex>
 #include <QDate>
 #include <QHash>
 #include <QList>
 #include <QMap>
 #include <QMetaType>
+#include <QRunnable>
 #include <QSharedPointer>
 #include <QStringList>
 #include <QVariant>
@@ -19,11 +22,14 @@ class CardInfoPerSet;
 class CardSet;
 class CardRelation;
 class ICardDatabaseParser;
+class QThread;
 
 typedef QMap<QString, QString> QStringMap;
 typedef QSharedPointer<CardInfo> CardInfoPtr;
 typedef QSharedPointer<CardSet> CardSetPtr;
 typedef QMap<QString, CardInfoPerSet> CardInfoPerSetMap;
+typedef QHash<QString, CardInfoPtr> CardNameMap;
+typedef QHash<QString, CardSetPtr> SetNameMap;
 
 Q_DECLARE_METATYPE(CardInfoPtr)
 
@@ -124,7 +130,7 @@ public:
 private:
     CardSetPtr set;
     // per-set card properties;
-    QVariantHash properties;
+    CardProperties properties;
 
 public:
     const CardSetPtr getPtr() const
@@ -137,7 +143,7 @@ public:
     }
     const QString getProperty(const QString &propertyName) const
     {
-        return properties.value(propertyName).toString();
+        return properties.value(propertyName);
     }
     void setProperty(const QString &_name, const QString &_value)
     {
@@ -161,7 +167,7 @@ private:
     // whether this is not a "real" card but a token
     bool isToken;
     // basic card properties; common for all the sets
-    QVariantHash properties;
+    CardProperties properties;
     // the cards i'm related to
     QList<CardRelation *> relatedCards;
     // the card i'm reverse-related to
@@ -240,7 +246,7 @@ public:
     }
     const QString getProperty(const QString &propertyName) const
     {
-        return properties.value(propertyName).toString();
+        return properties.value(propertyName);
     }
     void setProperty(const QString &_name, const QString &_value)
     {
@@ -343,6 +349,7 @@ public:
         emit pixmapUpdated();
     }
     void refreshCachedSetNames();
+    void rebindSets(const SetNameMap &knownSets);
 
     /**
      * Simplify a name to have no punctuation and lowercase all letters, for
@@ -365,8 +372,51 @@ enum LoadStatus
     NoCards
 };
 
-typedef QHash<QString, CardInfoPtr> CardNameMap;
-typedef QHash<QString, CardSetPtr> SetNameMap;
+/**
+ * Parses a single card database file into sets and cards of its own, so that several files can be parsed on a thread
+ * pool at the same time. CardDatabase merges the results afterwards, in a fixed order.
+ */
+class CardDatabaseFileLoader : public QObject, public QRunnable
+{
+    Q_OBJECT
+private:
+    QString path;
+    // the thread the sets and cards are handed over to
+    QThread *resultThread;
+    LoadStatus status;
+    qint64 msecs;
+    QList<CardSetPtr> loadedSets;
+    QList<CardInfoPtr> loadedCards;
+
+private slots:
+    void addCard(CardInfoPtr card);
+    void addSet(CardSetPtr set);
+
+public:
+    explicit CardDatabaseFileLoader(const QString &_path);
+    void run() override;
+
+    const QString &getPath() const
+    {
+        return path;
+    }
+    LoadStatus getStatus() const
+    {
+        return status;
+    }
+    qint64 getMsecs() const
+    {
+        return msecs;
+    }
+    const QList<CardSetPtr> &getSets() const
+    {
+        return loadedSets;
+    }
+    const QList<CardInfoPtr> &getCards() const
+    {
+        return loadedCards;
+    }
+};
 
 class CardDatabase : public QObject
 {
@@ -391,10 +441,17 @@ protected:
 
     QVector<ICardDatabaseParser *> availableParsers;
 
+    /*
+     * Where the compiled copy of the loaded databases is kept; empty to always parse the xml files.
+     */
+    QString cacheFilePath;
+
 private:
     CardInfoPtr getCardFromMap(const CardNameMap &cardMap, const QString &cardName) const;
     void checkUnknownSets();
     void refreshCachedReverseRelatedCards();
+    bool loadCardDatabaseCache(const QStringList &sourcePaths);
+    void mergeLoadedFile(const CardDatabaseFileLoader &loader);
 
     QBasicMutex *reloadDatabaseMutex = new QBasicMutex(), *clearDatabaseMutex = new QBasicMutex(),
                 *loadFromFileMutex = new QBasicMutex(), *addCardMutex = new QBasicMutex(),
@@ -430,6 +487,10 @@ public:
     {
         return loadStatus;
     }
+    void setCacheFilePath(const QString &_cacheFilePath)
+    {
+        cacheFilePath = _cacheFilePath;
+    }
     void enableAllUnknownSets();
     void markAllSetsAsKnown();
     void notifyEnabledSetsChanged();
@@ -0,0 +1,589 @@
+#include "carddatabasecache.h"
+
+#include "version_string.h"
+
+#include <QCryptographicHash>
+#include <QDate>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+const quint32 CACHE_MAGIC = 0x4244434b; // "KCDB" in a little endian file
+const quint32 CACHE_FORMAT_VERSION = 1;
+
+/*
+ * The file layout. Everything is written in the byte order of the machine writing it, a file from a machine with the
+ * other byte order fails the magic check. Strings are referenced by their index in the string records, which point
+ * into one block of utf-16 data; ranges of records are given as first index and count.
+ */
+struct Header
+{
+    quint32 magic;
+    quint32 formatVersion;
+    quint32 clientVersion;
+    quint32 sourceCount;
+    quint32 setCount;
+    quint32 cardCount;
+    quint32 propertyCount;
+    quint32 cardSetCount;
+    quint32 relationCount;
+    quint32 stringCount;
+    quint64 sourceOffset;
+    quint64 setOffset;
+    quint64 cardOffset;
+    quint64 propertyOffset;
+    quint64 cardSetOffset;
+    quint64 relationOffset;
+    quint64 stringOffset;
+    quint64 stringDataOffset;
+    quint64 stringDataLength;
+};
+
+const quint32 SourceExists = 1;
+
+struct SourceRecord
+{
+    quint32 path;
+    quint32 flags;
+    qint64 size;
+    qint64 lastModified;
+    quint8 hash[20];
+    quint32 reserved;
+};
+
+const quint32 SetEnabled = 1;
+
+struct SetRecord
+{
+    quint32 shortName;
+    quint32 longName;
+    quint32 setType;
+    quint32 flags;
+    qint64 releaseDate;
+};
+
+const quint32 CardIsToken = 1;
+const quint32 CardCipt = 2;
+const quint32 CardUpsideDownArt = 4;
+
+struct CardRecord
+{
+    quint32 name;
+    quint32 text;
+    quint32 firstProperty;
+    quint32 propertyCount;
+    quint32 firstSet;
+    quint32 setCount;
+    quint32 firstRelation;
+    quint32 relationCount;
+    quint32 reverseRelationCount;
+    qint32 tableRow;
+    quint32 flags;
+    quint32 reserved;
+};
+
+struct PropertyRecord
+{
+    quint32 key;
+    quint32 value;
+};
+
+struct CardSetRecord
+{
+    quint32 set;
+    quint32 firstProperty;
+    quint32 propertyCount;
+};
+
+const quint32 RelationCreateAllExclusion = 1;
+const quint32 RelationVariableCount = 2;
+const quint32 RelationPersistent = 4;
+
+struct RelationRecord
+{
+    quint32 name;
+    quint32 attachType;
+    quint32 flags;
+    qint32 defaultCount;
+};
+
+struct StringRecord
+{
+    quint32 offset;
+    quint32 length;
+};
+
+static_assert(sizeof(Header) == 112, "unexpected padding in the cache header");
+static_assert(sizeof(SourceRecord) == 48, "unexpected padding in the cache source record");
+static_assert(sizeof(SetRecord) == 24, "unexpected padding in the cache set record");
+static_assert(sizeof(CardRecord) == 48, "unexpected padding in the cache card record");
+static_assert(sizeof(CardSetRecord) == 12, "unexpected padding in the cache card set record");
+static_assert(sizeof(RelationRecord) == 16, "unexpected padding in the cache relation record");
+
+QString clientVersionString()
+{
+    return QString("%1 %2").arg(VERSION_STRING, VERSION_COMMIT);
+}
+
+QByteArray hashFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    return hash.result();
+}
+
+bool isRange(quint32 first, quint32 count, quint32 total)
+{
+    return static_cast<quint64>(first) + count <= total;
+}
+
+class StringTableWriter
+{
+private:
+    QHash<QString, quint32> indexes;
+    QVector<StringRecord> records;
+    QString data;
+
+public:
+    quint32 add(const QString &string)
+    {
+        auto it = indexes.constFind(string);
+        if (it != indexes.constEnd())
+            return it.value();
+
+        const auto index = static_cast<quint32>(records.size());
+        records.append({static_cast<quint32>(data.size()), static_cast<quint32>(string.size())});
+        data.append(string);
+        indexes.insert(string, index);
+        return index;
+    }
+    const QVector<StringRecord> &getRecords() const
+    {
+        return records;
+    }
+    const QString &getData() const
+    {
+        return data;
+    }
+};
+
+void appendSection(QByteArray &out, quint64 &offset, const char *data, qint64 size)
+{
+    // keep every section aligned so that the mapped records can be read in place
+    while (out.size() % 8 != 0)
+        out.append('\0');
+    offset = static_cast<quint64>(out.size());
+    out.append(data, static_cast<int>(size));
+}
+
+template <typename T> void appendSection(QByteArray &out, quint64 &offset, const QVector<T> &records)
+{
+    appendSection(out, offset, reinterpret_cast<const char *>(records.constData()), records.size() * sizeof(T));
+}
+
+class CacheReader
+{
+private:
+    const uchar *data;
+    quint64 size;
+    const Header *header;
+    const SourceRecord *sourceRecords;
+    const SetRecord *setRecords;
+    const CardRecord *cardRecords;
+    const PropertyRecord *propertyRecords;
+    const CardSetRecord *cardSetRecords;
+    const RelationRecord *relationRecords;
+    const StringRecord *stringRecords;
+    const QChar *stringData;
+    QVector<QString> strings;
+    QVector<bool> decoded;
+
+    template <typename T> const T *section(quint64 offset, quint64 count) const
+    {
+        if (offset % alignof(T) != 0 || offset > size || count > (size - offset) / sizeof(T))
+            return nullptr;
+        return reinterpret_cast<const T *>(data + offset);
+    }
+
+    bool isString(quint32 index) const
+    {
+        return index < header->stringCount;
+    }
+
+    bool checkStructure() const;
+    bool checkSource(const SourceRecord &record, const QString &path);
+    CardRelation *buildRelation(const RelationRecord &record);
+
+public:
+    CacheReader(const uchar *_data, qint64 _size)
+        : data(_data), size(static_cast<quint64>(_size)), header(nullptr), sourceRecords(nullptr),
+          setRecords(nullptr), cardRecords(nullptr), propertyRecords(nullptr), cardSetRecords(nullptr),
+          relationRecords(nullptr), stringRecords(nullptr), stringData(nullptr)
+    {
+    }
+
+    bool open(const QStringList &sourcePaths);
+    bool buildSets(QList<CardSetPtr> &sets);
+    void buildCards(const QList<CardSetPtr> &sets, QList<CardInfoPtr> &cards);
+
+    const QString &string(quint32 index)
+    {
+        if (!decoded[index]) {
+            const StringRecord &record = stringRecords[index];
+            strings[index] = QString(stringData + record.offset, static_cast<int>(record.length));
+            decoded[index] = true;
+        }
+        return strings[index];
+    }
+};
+
+bool CacheReader::open(const QStringList &sourcePaths)
+{
+    header = section<Header>(0, 1);
+    if (header == nullptr || header->magic != CACHE_MAGIC || header->formatVersion != CACHE_FORMAT_VERSION)
+        return false;
+
+    sourceRecords = section<SourceRecord>(header->sourceOffset, header->sourceCount);
+    setRecords = section<SetRecord>(header->setOffset, header->setCount);
+    cardRecords = section<CardRecord>(header->cardOffset, header->cardCount);
+    propertyRecords = section<PropertyRecord>(header->propertyOffset, header->propertyCount);
+    cardSetRecords = section<CardSetRecord>(header->cardSetOffset, header->cardSetCount);
+    relationRecords = section<RelationRecord>(header->relationOffset, header->relationCount);
+    stringRecords = section<StringRecord>(header->stringOffset, header->stringCount);
+    stringData = section<QChar>(header->stringDataOffset, header->stringDataLength);
+    if (!checkStructure())
+        return false;
+
+    strings.resize(static_cast<int>(header->stringCount));
+    decoded.fill(false, static_cast<int>(header->stringCount));
+
+    if (string(header->clientVersion) != clientVersionString())
+        return false;
+
+    // compare the sources last, that may need to hash them
+    if (header->sourceCount != static_cast<quint32>(sourcePaths.size()))
+        return false;
+    for (int i = 0; i < sourcePaths.size(); ++i)
+        if (!checkSource(sourceRecords[i], sourcePaths.at(i)))
+            return false;
+
+    return true;
+}
+
+bool CacheReader::checkStructure() const
+{
+    if (sourceRecords == nullptr || setRecords == nullptr || cardRecords == nullptr || propertyRecords == nullptr ||
+        cardSetRecords == nullptr || relationRecords == nullptr || stringRecords == nullptr || stringData == nullptr)
+        return false;
+
+    // check every index once here, so that building the cards cannot fail half way
+    for (quint32 i = 0; i < header->stringCount; ++i)
+        if (static_cast<quint64>(stringRecords[i].offset) + stringRecords[i].length > header->stringDataLength)
+            return false;
+    if (!isString(header->clientVersion))
+        return false;
+    for (quint32 i = 0; i < header->sourceCount; ++i)
+        if (!isString(sourceRecords[i].path))
+            return false;
+    for (quint32 i = 0; i < header->setCount; ++i) {
+        const SetRecord &set = setRecords[i];
+        if (!isString(set.shortName) || !isString(set.longName) || !isString(set.setType))
+            return false;
+    }
+    for (quint32 i = 0; i < header->propertyCount; ++i)
+        if (!isString(propertyRecords[i].key) || !isString(propertyRecords[i].value))
+            return false;
+    for (quint32 i = 0; i < header->cardSetCount; ++i) {
+        const CardSetRecord &cardSet = cardSetRecords[i];
+        if (cardSet.set >= header->setCount ||
+            !isRange(cardSet.firstProperty, cardSet.propertyCount, header->propertyCount))
+            return false;
+    }
+    const auto lastAttachType = static_cast<quint32>(CardRelation::TransformInto);
+    for (quint32 i = 0; i < header->relationCount; ++i)
+        if (!isString(relationRecords[i].name) || relationRecords[i].attachType > lastAttachType)
+            return false;
+    for (quint32 i = 0; i < header->cardCount; ++i) {
+        const CardRecord &card = cardRecords[i];
+        if (!isString(card.name) || !isString(card.text) ||
+            !isRange(card.firstProperty, card.propertyCount, header->propertyCount) ||
+            !isRange(card.firstSet, card.setCount, header->cardSetCount) ||
+            !isRange(card.firstRelation, card.relationCount, header->relationCount) ||
+            !isRange(card.firstRelation + card.relationCount, card.reverseRelationCount, header->relationCount))
+            return false;
+    }
+    return true;
+}
+
+bool CacheReader::checkSource(const SourceRecord &record, const QString &path)
+{
+    if (string(record.path) != path)
+        return false;
+
+    const QFileInfo info(path);
+    const bool exists = !path.isEmpty() && info.isFile();
+    if (exists != ((record.flags & SourceExists) != 0))
+        return false;
+    if (!exists)
+        return true;
+    if (info.size() != record.size)
+        return false;
+    if (info.lastModified().toMSecsSinceEpoch() == record.lastModified)
+        return true;
+
+    // touched, copied or downloaded again; still good if the content is the same
+    const QByteArray hash = hashFile(path);
+    return hash.size() == static_cast<int>(sizeof(record.hash)) &&
+           std::memcmp(hash.constData(), record.hash, sizeof(record.hash)) == 0;
+}
+
+bool CacheReader::buildSets(QList<CardSetPtr> &sets)
+{
+    sets.reserve(static_cast<int>(header->setCount));
+    for (quint32 i = 0; i < header->setCount; ++i) {
+        const SetRecord &record = setRecords[i];
+        CardSetPtr set = CardSet::newInstance(string(record.shortName), string(record.longName),
+                                              string(record.setType), QDate::fromJulianDay(record.releaseDate));
+
+        // the parsers leave out the printings in disabled sets, so the cards differ once a set is toggled
+        if (set->getEnabled() != ((record.flags & SetEnabled) != 0))
+            return false;
+        sets << set;
+    }
+    return true;
+}
+
+CardRelation *CacheReader::buildRelation(const RelationRecord &record)
+{
+    return new CardRelation(string(record.name), static_cast<CardRelation::AttachType>(record.attachType),
+                            (record.flags & RelationCreateAllExclusion) != 0,
+                            (record.flags & RelationVariableCount) != 0, record.defaultCount,
+                            (record.flags & RelationPersistent) != 0);
+}
+
+void CacheReader::buildCards(const QList<CardSetPtr> &sets, QList<CardInfoPtr> &cards)
+{
+    cards.reserve(static_cast<int>(header->cardCount));
+    for (quint32 i = 0; i < header->cardCount; ++i) {
+        const CardRecord &record = cardRecords[i];
+
+        QVariantHash properties;
+        properties.reserve(static_cast<int>(record.propertyCount));
+        for (quint32 p = record.firstProperty; p < record.firstProperty + record.propertyCount; ++p)
+            properties.insert(string(propertyRecords[p].key), string(propertyRecords[p].value));
+
+        QList<CardRelation *> relatedCards, reverseRelatedCards;
+        const quint32 firstReverse = record.firstRelation + record.relationCount;
+        for (quint32 r = record.firstRelation; r < firstReverse; ++r)
+            relatedCards << buildRelation(relationRecords[r]);
+        for (quint32 r = firstReverse; r < firstReverse + record.reverseRelationCount; ++r)
+            reverseRelatedCards << buildRelation(relationRecords[r]);
+
+        CardInfoPerSetMap cardSets;
+        for (quint32 s = record.firstSet; s < record.firstSet + record.setCount; ++s) {
+            const CardSetRecord &cardSet = cardSetRecords[s];
+            const CardSetPtr &set = sets.at(static_cast<int>(cardSet.set));
+            CardInfoPerSet setInfo(set);
+            for (quint32 p = cardSet.firstProperty; p < cardSet.firstProperty + cardSet.propertyCount; ++p)
+                setInfo.setProperty(string(propertyRecords[p].key), string(propertyRecords[p].value));
+            cardSets.insert(set->getShortName(), setInfo);
+        }
+
+        cards << CardInfo::newInstance(string(record.name), string(record.text), (record.flags & CardIsToken) != 0,
+                                       properties, relatedCards, reverseRelatedCards, cardSets,
+                                       (record.flags & CardCipt) != 0, record.tableRow,
+                                       (record.flags & CardUpsideDownArt) != 0);
+    }
+}
+} // namespace
+
+CardDatabaseCache::CardDatabaseCache(const QString &_fileName) : fileName(_fileName)
+{
+}
+
+QList<CardDatabaseCache::SourceFile> CardDatabaseCache::inspectSources(const QStringList &paths)
+{
+    QList<SourceFile> sources;
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        SourceFile source{path, !path.isEmpty() && info.isFile(), 0, 0, QByteArray()};
+        if (source.exists) {
+            source.size = info.size();
+            source.lastModified = info.lastModified().toMSecsSinceEpoch();
+            source.hash = hashFile(path);
+        }
+        sources << source;
+    }
+    return sources;
+}
+
+bool CardDatabaseCache::load(const QStringList &sourcePaths, QList<CardSetPtr> &sets, QList<CardInfoPtr> &cards) const
+{
+    sets.clear();
+    cards.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const qint64 fileSize = file.size();
+    uchar *mapped = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    if (mapped == nullptr)
+        return false;
+
+    // the cards copy what they need, the mapping is only kept while they are being built
+    CacheReader reader(mapped, fileSize);
+    bool ok = reader.open(sourcePaths) && reader.buildSets(sets);
+    if (ok)
+        reader.buildCards(sets, cards);
+    else
+        sets.clear();
+
+    file.unmap(mapped);
+    return ok;
+}
+
+bool CardDatabaseCache::save(const QList<SourceFile> &sources,
+                             const QList<CardSetPtr> &sets,
+                             const QList<CardInfoPtr> &cards) const
+{
+    StringTableWriter strings;
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = CACHE_MAGIC;
+    header.formatVersion = CACHE_FORMAT_VERSION;
+    header.clientVersion = strings.add(clientVersionString());
+
+    QVector<SourceRecord> sourceRecords;
+    for (const SourceFile &source : sources) {
+        SourceRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.path = strings.add(source.path);
+        record.flags = source.exists ? SourceExists : 0u;
+        record.size = source.size;
+        record.lastModified = source.lastModified;
+        std::memcpy(record.hash, source.hash.constData(),
+                    qMin(static_cast<size_t>(source.hash.size()), sizeof(record.hash)));
+        sourceRecords << record;
+    }
+
+    // sorted, so that the same databases always give the same file
+    QList<CardSetPtr> sortedSets = sets;
+    std::sort(sortedSets.begin(), sortedSets.end(), [](const CardSetPtr &a, const CardSetPtr &b) {
+        return a->getShortName() < b->getShortName();
+    });
+    QList<CardInfoPtr> sortedCards = cards;
+    std::sort(sortedCards.begin(), sortedCards.end(),
+              [](const CardInfoPtr &a, const CardInfoPtr &b) { return a->getName() < b->getName(); });
+
+    QHash<QString, quint32> setIndexes;
+    QVector<SetRecord> setRecords;
+    for (const CardSetPtr &set : sortedSets) {
+        setIndexes.insert(set->getShortName(), static_cast<quint32>(setRecords.size()));
+        SetRecord record{strings.add(set->getShortName()), strings.add(set->getLongName()),
+                         strings.add(set->getSetType()), set->getEnabled() ? SetEnabled : 0u,
+                         set->getReleaseDate().toJulianDay()};
+        setRecords << record;
+    }
+
+    QVector<CardRecord> cardRecords;
+    QVector<PropertyRecord> propertyRecords;
+    QVector<CardSetRecord> cardSetRecords;
+    QVector<RelationRecord> relationRecords;
+    auto addRelation = [&](const CardRelation *relation) {
+        quint32 flags = (relation->getIsCreateAllExclusion() ? RelationCreateAllExclusion : 0u) |
+                        (relation->getIsVariable() ? RelationVariableCount : 0u) |
+                        (relation->getIsPersistent() ? RelationPersistent : 0u);
+        relationRecords << RelationRecord{strings.add(relation->getName()),
+                                          static_cast<quint32>(relation->getAttachType()), flags,
+                                          relation->getDefaultCount()};
+    };
+
+    for (const CardInfoPtr &card : sortedCards) {
+        CardRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.name = strings.add(card->getName());
+        record.text = strings.add(card->getText());
+        record.tableRow = card->getTableRow();
+        record.flags = (card->getIsToken() ? CardIsToken : 0u) | (card->getCipt() ? CardCipt : 0u) |
+                       (card->getUpsideDownArt() ? CardUpsideDownArt : 0u);
+
+        QStringList keys = card->getProperties();
+        keys.sort();
+        record.firstProperty = static_cast<quint32>(propertyRecords.size());
+        record.propertyCount = static_cast<quint32>(keys.size());
+        for (const QString &key : keys)
+            propertyRecords << PropertyRecord{strings.add(key), strings.add(card->getProperty(key))};
+
+        record.firstSet = static_cast<quint32>(cardSetRecords.size());
+        for (const CardInfoPerSet &setInfo : card->getSets()) {
+            auto setIndex = setIndexes.constFind(setInfo.getPtr()->getShortName());
+            if (setIndex == setIndexes.constEnd())
+                continue;
+
+            QStringList setKeys = setInfo.getProperties();
+            setKeys.sort();
+            cardSetRecords << CardSetRecord{setIndex.value(), static_cast<quint32>(propertyRecords.size()),
+                                            static_cast<quint32>(setKeys.size())};
+            for (const QString &key : setKeys)
+                propertyRecords << PropertyRecord{strings.add(key), strings.add(setInfo.getProperty(key))};
+        }
+        record.setCount = static_cast<quint32>(cardSetRecords.size()) - record.firstSet;
+
+        record.firstRelation = static_cast<quint32>(relationRecords.size());
+        record.relationCount = static_cast<quint32>(card->getRelatedCards().size());
+        record.reverseRelationCount = static_cast<quint32>(card->getReverseRelatedCards().size());
+        for (const CardRelation *relation : card->getRelatedCards())
+            addRelation(relation);
+        for (const CardRelation *relation : card->getReverseRelatedCards())
+            addRelation(relation);
+
+        cardRecords << record;
+    }
+
+    header.sourceCount = static_cast<quint32>(sourceRecords.size());
+    header.setCount = static_cast<quint32>(setRecords.size());
+    header.cardCount = static_cast<quint32>(cardRecords.size());
+    header.propertyCount = static_cast<quint32>(propertyRecords.size());
+    header.cardSetCount = static_cast<quint32>(cardSetRecords.size());
+    header.relationCount = static_cast<quint32>(relationRecords.size());
+    header.stringCount = static_cast<quint32>(strings.getRecords().size());
+    header.stringDataLength = static_cast<quint64>(strings.getData().size());
+
+    QByteArray out(sizeof(Header), '\0');
+    appendSection(out, header.sourceOffset, sourceRecords);
+    appendSection(out, header.setOffset, setRecords);
+    appendSection(out, header.cardOffset, cardRecords);
+    appendSection(out, header.propertyOffset, propertyRecords);
+    appendSection(out, header.cardSetOffset, cardSetRecords);
+    appendSection(out, header.relationOffset, relationRecords);
+    appendSection(out, header.stringOffset, strings.getRecords());
+    appendSection(out, header.stringDataOffset, reinterpret_cast<const char *>(strings.getData().constData()),
+                  strings.getData().size() * static_cast<qint64>(sizeof(QChar)));
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "[CardDatabaseCache] Could not open" << fileName << "for writing:" << file.errorString();
+        return false;
+    }
+    if (file.write(out) != out.size()) {
+        qDebug() << "[CardDatabaseCache] Could not write" << fileName << ":" << file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
@@ -0,0 +1,57 @@
+#ifndef CARDDATABASECACHE_H
+#define CARDDATABASECACHE_H
+
+#include "carddatabase.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/**
+ * A compiled copy of the loaded card databases, so the client does not have to parse all the xml files again on every
+ * start. The file holds a table of unique strings followed by fixed size records for the sets, the cards, their
+ * properties, their per-set entries and their relations, all referring to each other by index.
+ *
+ * The cache remembers size, modification time and hash of every source file it was built from, the enabled state of
+ * every set (the parsers skip disabled sets) and the client version, and it is only used while all of those are
+ * unchanged. Loading maps the file and builds the cards straight from the records; each unique string is decoded
+ * once and then shared by all the cards using it.
+ */
+class CardDatabaseCache
+{
+public:
+    struct SourceFile
+    {
+        QString path;
+        bool exists;
+        qint64 size;
+        qint64 lastModified;
+        QByteArray hash;
+    };
+
+    explicit CardDatabaseCache(const QString &_fileName);
+
+    const QString &getFileName() const
+    {
+        return fileName;
+    }
+
+    /**
+     * Records the current state of the given files. Call it before parsing them, so that a file changing while it is
+     * being parsed leaves behind a cache that is already stale.
+     */
+    static QList<SourceFile> inspectSources(const QStringList &paths);
+
+    /**
+     * Fills sets and cards from the cache if it was built from exactly these source files and they did not change
+     * since. Returns false, with both lists left empty, if the cache is missing, stale or damaged.
+     */
+    bool load(const QStringList &sourcePaths, QList<CardSetPtr> &sets, QList<CardInfoPtr> &cards) const;
+    bool save(const QList<SourceFile> &sources, const QList<CardSetPtr> &sets, const QList<CardInfoPtr> &cards) const;
+
+private:
+    QString fileName;
+};
+
+#endif
@@ -7,7 +7,8 @@
 #define CARDDBMODEL_COLUMNS 6
 
 CardDatabaseModel::CardDatabaseModel(CardDatabase *_db, bool _showOnlyCardsFromEnabledSets, QObject *parent)
-    : QAbstractListModel(parent), db(_db), showOnlyCardsFromEnabledSets(_showOnlyCardsFromEnabledSets)
+    : QAbstractListModel(parent), db(_db), showOnlyCardsFromEnabledSets(_showOnlyCardsFromEnabledSets),
+      columnsGeneration(0)
 {
     connect(db, SIGNAL(cardAdded(CardInfoPtr)), this, SLOT(cardAdded(CardInfoPtr)));
     connect(db, SIGNAL(cardRemoved(CardInfoPtr)), this, SLOT(cardRemoved(CardInfoPtr)));
@@ -83,12 +84,91 @@ QVariant CardDatabaseModel::headerData(int section, Qt::Orientation orientation,
     }
 }
 
+CardColumns &CardDatabaseModel::getColumns()
+{
+    if (columns.isNull())
+        columns.reset(new CardColumns(cardList));
+    return *columns;
+}
+
+const CardDatabaseModel::SortColumn &CardDatabaseModel::getSortColumn(int column) const
+{
+    auto it = sortColumns.constFind(column);
+    if (it != sortColumns.constEnd())
+        return it.value();
+
+    SortColumn keys;
+    keys.values.reserve(cardList.size());
+    keys.collated.reserve(static_cast<size_t>(cardList.size()));
+    for (int row = 0; row < cardList.size(); ++row)
+        storeSortKeys(keys, column, row, true);
+    return sortColumns.insert(column, keys).value();
+}
+
+void CardDatabaseModel::storeSortKeys(SortColumn &keys, int column, int row, bool append) const
+{
+    const QString value = data(index(row, column), SortRole).toString();
+    PowToughSortKey powTough{false, NumericSortKey(), NumericSortKey()};
+    if (column == PTColumn) {
+        const QStringList parts = value.split("/");
+        if (parts.size() == 2)
+            powTough = {true, numericSortKey(parts.at(0)), numericSortKey(parts.at(1))};
+    }
+
+    if (append) {
+        keys.values.append(value);
+        keys.collated.push_back(collator.sortKey(value));
+        if (column == PTColumn)
+            keys.powTough.append(powTough);
+    } else {
+        keys.values[row] = value;
+        keys.collated[static_cast<size_t>(row)] = collator.sortKey(value);
+        if (column == PTColumn)
+            keys.powTough[row] = powTough;
+    }
+}
+
+void CardDatabaseModel::updateSortKeys(int row, bool inserted)
+{
+    for (auto it = sortColumns.begin(); it != sortColumns.end(); ++it)
+        storeSortKeys(it.value(), it.key(), row, inserted);
+}
+
+CardDatabaseModel::NumericSortKey CardDatabaseModel::numericSortKey(const QString &value)
+{
+    NumericSortKey key{value, false, 0, QString()};
+    key.number = value.toFloat(&key.ok);
+    if (key.ok)
+        return key;
+
+    // try and parsing again, for weird ones like "1+*"
+    int numIndex = 0;
+    for (; numIndex < value.length(); numIndex++) {
+        if (!value.at(numIndex).isDigit()) {
+            break;
+        }
+    }
+    if (numIndex != 0) {
+        key.number = value.left(numIndex).toFloat(&key.ok);
+        key.afterNumber = value.right(numIndex);
+    }
+    return key;
+}
+
+void CardDatabaseModel::invalidateColumns()
+{
+    columns.reset();
+    ++columnsGeneration;
+}
+
 void CardDatabaseModel::cardInfoChanged(CardInfoPtr card)
 {
     const int row = cardList.indexOf(card);
     if (row == -1)
         return;
 
+    invalidateColumns();
+    updateSortKeys(row, false);
     emit dataChanged(index(row, 0), index(row, CARDDBMODEL_COLUMNS - 1));
 }
 
@@ -126,6 +206,8 @@ void CardDatabaseModel::cardAdded(CardInfoPtr card)
         // add the card if it's present in at least one enabled set
         beginInsertRows(QModelIndex(), cardList.size(), cardList.size());
         cardList.append(card);
+        invalidateColumns();
+        updateSortKeys(cardList.size() - 1, true);
         connect(card.data(), SIGNAL(cardInfoChanged(CardInfoPtr)), this, SLOT(cardInfoChanged(CardInfoPtr)));
         endInsertRows();
     }
@@ -142,18 +224,25 @@ void CardDatabaseModel::cardRemoved(CardInfoPtr card)
     disconnect(card.data(), nullptr, this, nullptr);
     card.clear();
     cardList.removeAt(row);
+    invalidateColumns();
+    for (auto it = sortColumns.begin(); it != sortColumns.end(); ++it) {
+        it->values.removeAt(row);
+        it->collated.erase(it->collated.begin() + row);
+        if (it.key() == PTColumn)
+            it->powTough.removeAt(row);
+    }
     endRemoveRows();
 }
 
 CardDatabaseDisplayModel::CardDatabaseDisplayModel(QObject *parent)
-    : QSortFilterProxyModel(parent), isToken(ShowAll), filterString(nullptr)
+    : QSortFilterProxyModel(parent), isToken(ShowAll), filterString(nullptr), searchGeneration(-1)
 {
     filterTree = nullptr;
     setFilterCaseSensitivity(Qt::CaseInsensitive);
     setSortCaseSensitivity(Qt::CaseInsensitive);
 
     dirtyTimer.setSingleShot(true);
-    connect(&dirtyTimer, &QTimer::timeout, this, &CardDatabaseDisplayModel::invalidate);
+    connect(&dirtyTimer, &QTimer::timeout, this, &CardDatabaseDisplayModel::refresh);
 
     loadedRowCount = 0;
 }
@@ -181,11 +270,13 @@ int CardDatabaseDisplayModel::rowCount(const QModelIndex &parent) const
 
 bool CardDatabaseDisplayModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
-
-    QString leftString = sourceModel()->data(left, CardDatabaseModel::SortRole).toString();
-    QString rightString = sourceModel()->data(right, CardDatabaseModel::SortRole).toString();
+    const CardDatabaseModel::SortColumn &keys =
+        static_cast<CardDatabaseModel *>(sourceModel())->getSortColumn(left.column());
+    const int leftRow = left.row(), rightRow = right.row();
 
     if (!cardName.isEmpty() && left.column() == CardDatabaseModel::NameColumn) {
+        const QString &leftString = keys.values.at(leftRow);
+        const QString &rightString = keys.values.at(rightRow);
         bool isLeftType = leftString.startsWith(cardName, Qt::CaseInsensitive);
         bool isRightType = rightString.startsWith(cardName, Qt::CaseInsensitive);
 
@@ -197,76 +288,37 @@ bool CardDatabaseDisplayModel::lessThan(const QModelIndex &left, const QModelInd
         // same checks for the right string
         if (isRightType && (!isLeftType || rightString.size() == cardName.size()))
             return false;
-    } else if (right.column() == CardDatabaseModel::PTColumn && left.column() == CardDatabaseModel::PTColumn) {
-        QStringList leftList = leftString.split("/");
-        QStringList rightList = rightString.split("/");
+    } else if (left.column() == CardDatabaseModel::PTColumn) {
+        const CardDatabaseModel::PowToughSortKey &leftPT = keys.powTough.at(leftRow);
+        const CardDatabaseModel::PowToughSortKey &rightPT = keys.powTough.at(rightRow);
 
-        if (leftList.size() == 2 && rightList.size() == 2) {
+        if (leftPT.valid && rightPT.valid) {
 
             // cool, have both P/T in list now
-            int lessThanNum = lessThanNumerically(leftList.at(0), rightList.at(0));
+            int lessThanNum = lessThanNumerically(leftPT.power, rightPT.power);
             if (lessThanNum != 0) {
                 return lessThanNum < 0;
             } else {
                 // power equal, check toughness
-                return lessThanNumerically(leftList.at(1), rightList.at(1)) < 0;
+                return lessThanNumerically(leftPT.toughness, rightPT.toughness) < 0;
             }
         }
     }
-    return QString::localeAwareCompare(leftString, rightString) < 0;
+    return keys.collated.at(static_cast<size_t>(leftRow)).compare(keys.collated.at(static_cast<size_t>(rightRow))) < 0;
 }
 
-int CardDatabaseDisplayModel::lessThanNumerically(const QString &left, const QString &right)
+int CardDatabaseDisplayModel::lessThanNumerically(const CardDatabaseModel::NumericSortKey &left,
+                                                  const CardDatabaseModel::NumericSortKey &right)
 {
-    if (left == right) {
+    if (left.text == right.text) {
         return 0;
     }
 
-    bool okLeft, okRight;
-    float leftNum = left.toFloat(&okLeft);
-    float rightNum = right.toFloat(&okRight);
+    if (left.ok && right.ok) {
 
-    if (okLeft && okRight) {
-        if (leftNum < rightNum) {
-            return -1;
-        } else if (leftNum > rightNum) {
-            return 1;
-        } else {
-            return 0;
-        }
-    }
-    // try and parsing again, for weird ones like "1+*"
-    QString leftAfterNum = "";
-    QString rightAfterNum = "";
-    if (!okLeft) {
-        int leftNumIndex = 0;
-        for (; leftNumIndex < left.length(); leftNumIndex++) {
-            if (!left.at(leftNumIndex).isDigit()) {
-                break;
-            }
-        }
-        if (leftNumIndex != 0) {
-            leftNum = left.left(leftNumIndex).toFloat(&okLeft);
-            leftAfterNum = left.right(leftNumIndex);
-        }
-    }
-    if (!okRight) {
-        int rightNumIndex = 0;
-        for (; rightNumIndex < right.length(); rightNumIndex++) {
-            if (!right.at(rightNumIndex).isDigit()) {
-                break;
-            }
-        }
-        if (rightNumIndex != 0) {
-            rightNum = right.left(rightNumIndex).toFloat(&okRight);
-            rightAfterNum = right.right(rightNumIndex);
-        }
-    }
-    if (okLeft && okRight) {
-
-        if (leftNum != rightNum) {
+        if (left.number != right.number) {
             // both parsed as numbers, but different number
-            if (leftNum < rightNum) {
+            if (left.number < right.number) {
                 return -1;
             } else {
                 return 1;
@@ -274,15 +326,15 @@ int CardDatabaseDisplayModel::lessThanNumerically(const QString &left, const QSt
         } else {
             // both parsed, same number, but at least one has something else
             // so compare the part after the number - prefer nothing
-            return QString::localeAwareCompare(leftAfterNum, rightAfterNum);
+            return QString::localeAwareCompare(left.afterNumber, right.afterNumber);
         }
-    } else if (okLeft) {
+    } else if (left.ok) {
         return -1;
-    } else if (okRight) {
+    } else if (right.ok) {
         return 1;
     }
     // couldn't parse it, just return String comparison
-    return QString::localeAwareCompare(left, right);
+    return QString::localeAwareCompare(left.text, right.text);
 }
 bool CardDatabaseDisplayModel::filterAcceptsRow(int sourceRow, const QModelIndex & /*sourceParent*/) const
 {
@@ -295,16 +347,21 @@ bool CardDatabaseDisplayModel::filterAcceptsRow(int sourceRow, const QModelIndex
         if (filterTree != nullptr && !filterTree->acceptsCard(info)) {
             return false;
         }
+        if (hasSearchMatch(sourceRow))
+            return searchMatches.at(sourceRow) != 0;
         return filterString->check(info);
     }
 
-    return rowMatchesCardName(info);
+    return rowMatchesCardName(sourceRow, info);
 }
 
-bool CardDatabaseDisplayModel::rowMatchesCardName(CardInfoPtr info) const
+bool CardDatabaseDisplayModel::rowMatchesCardName(int sourceRow, CardInfoPtr info) const
 {
-    if (!cardName.isEmpty() && !info->getName().contains(cardName, Qt::CaseInsensitive))
-        return false;
+    if (!cardName.isEmpty()) {
+        if (hasSearchMatch(sourceRow) ? searchMatches.at(sourceRow) == 0
+                                      : !info->getName().contains(cardName, Qt::CaseInsensitive))
+            return false;
+    }
 
     if (!cardNameSet.isEmpty() && !cardNameSet.contains(info->getName()))
         return false;
@@ -341,6 +398,37 @@ void CardDatabaseDisplayModel::filterTreeChanged()
     invalidate();
 }
 
+bool CardDatabaseDisplayModel::hasSearchMatch(int sourceRow) const
+{
+    return searchGeneration == static_cast<CardDatabaseModel *>(sourceModel())->getColumnsGeneration() &&
+           sourceRow < searchMatches.size();
+}
+
+void CardDatabaseDisplayModel::clearSearchMatches()
+{
+    searchMatches.clear();
+    searchGeneration = -1;
+}
+
+void CardDatabaseDisplayModel::refresh()
+{
+    // match the search against all the cards at once, instead of card by card while filtering; the name search goes
+    // through the trigram index of the names
+    clearSearchMatches();
+    auto *model = qobject_cast<CardDatabaseModel *>(sourceModel());
+    if (model != nullptr) {
+        if (filterString != nullptr) {
+            searchMatches = filterString->match(model->getColumns());
+            searchGeneration = model->getColumnsGeneration();
+        } else if (!cardName.isEmpty()) {
+            searchMatches = FilterProgram::substringLeaf(FilterColumn(FilterColumn::Name), cardName)
+                                .match(model->getColumns());
+            searchGeneration = model->getColumnsGeneration();
+        }
+    }
+    invalidate();
+}
+
 const QString CardDatabaseDisplayModel::sanitizeCardName(const QString &dirtyName, const QMap<wchar_t, wchar_t> &table)
 {
     std::wstring toReturn = dirtyName.toStdWString();
@@ -359,7 +447,7 @@ TokenDisplayModel::TokenDisplayModel(QObject *parent) : CardDatabaseDisplayModel
 bool TokenDisplayModel::filterAcceptsRow(int sourceRow, const QModelIndex & /*sourceParent*/) const
 {
     CardInfoPtr info = static_cast<CardDatabaseModel *>(sourceModel())->getCard(sourceRow);
-    return info->getIsToken() && rowMatchesCardName(info);
+    return info->getIsToken() && rowMatchesCardName(sourceRow, info);
 }
 
 int TokenDisplayModel::rowCount(const QModelIndex &parent) const
@@ -375,7 +463,8 @@ TokenEditModel::TokenEditModel(QObject *parent) : CardDatabaseDisplayModel(paren
 bool TokenEditModel::filterAcceptsRow(int sourceRow, const QModelIndex & /*sourceParent*/) const
 {
     CardInfoPtr info = static_cast<CardDatabaseModel *>(sourceModel())->getCard(sourceRow);
-    return info->getIsToken() && info->getSets().contains(CardDatabase::TOKENS_SETNAME) && rowMatchesCardName(info);
+    return info->getIsToken() && info->getSets().contains(CardDatabase::TOKENS_SETNAME) &&
+           rowMatchesCardName(sourceRow, info);
 }
 
 int TokenEditModel::rowCount(const QModelIndex &parent) const
@@ -5,10 +5,14 @@
 #include "filter_string.h"
 
 #include <QAbstractListModel>
+#include <QCollator>
 #include <QList>
+#include <QMap>
+#include <QScopedPointer>
 #include <QSet>
 #include <QSortFilterProxyModel>
 #include <QTimer>
+#include <vector>
 
 class FilterTree;
 
@@ -29,6 +33,33 @@ public:
     {
         SortRole = Qt::UserRole
     };
+
+    // a P/T part, parsed for sorting numerically
+    struct NumericSortKey
+    {
+        QString text;
+        bool ok;
+        float number;
+        // what follows a leading number that is not all of text
+        QString afterNumber;
+    };
+
+    struct PowToughSortKey
+    {
+        bool valid;
+        NumericSortKey power, toughness;
+    };
+
+    // the SortRole data of one column for every row, with what sorting derives from it
+    struct SortColumn
+    {
+        QStringList values;
+        // collated like QString::localeAwareCompare
+        std::vector<QCollatorSortKey> collated;
+        // only filled for the P/T column
+        QVector<PowToughSortKey> powTough;
+    };
+
     CardDatabaseModel(CardDatabase *_db, bool _showOnlyCardsFromEnabledSets, QObject *parent = nullptr);
     ~CardDatabaseModel() override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -44,10 +75,36 @@ public:
         return cardList[index];
     }
 
+    /**
+     * The search columns of the rows, extracted on first use after every change to them. The generation counts the
+     * changes, so results computed from the columns can tell they went stale.
+     */
+    CardColumns &getColumns();
+    int getColumnsGeneration() const
+    {
+        return columnsGeneration;
+    }
+
+    /**
+     * The sort keys of a column, so sorting does not fetch, convert and collate both strings again on every
+     * comparison. Built on first use, then kept up to date as rows come, go and change.
+     */
+    const SortColumn &getSortColumn(int column) const;
+
 private:
     QList<CardInfoPtr> cardList;
     CardDatabase *db;
     bool showOnlyCardsFromEnabledSets;
+    QScopedPointer<CardColumns> columns;
+    int columnsGeneration;
+    mutable QMap<int, SortColumn> sortColumns;
+    QCollator collator;
+
+    void invalidateColumns();
+    // stores the sort keys of a row in keys, appended or replacing the ones there
+    void storeSortKeys(SortColumn &keys, int column, int row, bool append) const;
+    void updateSortKeys(int row, bool inserted);
+    static NumericSortKey numericSortKey(const QString &value);
 
     inline bool checkCardHasAtLeastOneEnabledSet(CardInfoPtr card);
 private slots:
@@ -74,6 +131,10 @@ private:
     QSet<QString> cardNameSet, cardTypes, cardColors;
     FilterTree *filterTree;
     FilterString *filterString;
+    // the result of filterString, or of the card name search without one, for every source row, as of this
+    // generation of the source columns
+    QVector<char> searchMatches;
+    int searchGeneration;
     int loadedRowCount;
     QTimer dirtyTimer;
 
@@ -96,12 +157,14 @@ public:
             filterString = nullptr;
         }
         cardName = sanitizeCardName(_cardName, characterTranslation);
+        clearSearchMatches();
         dirty();
     }
     void setStringFilter(const QString &_src)
     {
         delete filterString;
         filterString = new FilterString(_src);
+        clearSearchMatches();
         dirty();
     }
     void setCardNameSet(const QSet<QString> &_cardNameSet)
@@ -119,13 +182,18 @@ public:
 
 protected:
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
-    static int lessThanNumerically(const QString &left, const QString &right);
+    static int lessThanNumerically(const CardDatabaseModel::NumericSortKey &left,
+                                   const CardDatabaseModel::NumericSortKey &right);
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
-    bool rowMatchesCardName(CardInfoPtr info) const;
+    bool rowMatchesCardName(int sourceRow, CardInfoPtr info) const;
+    // whether searchMatches holds the search result of sourceRow
+    bool hasSearchMatch(int sourceRow) const;
+    void clearSearchMatches();
     bool canFetchMore(const QModelIndex &parent) const override;
     void fetchMore(const QModelIndex &parent) override;
 private slots:
     void filterTreeChanged();
+    void refresh();
     /** Will translate all undesirable characters in DIRTYNAME according to the TABLE. */
     const QString sanitizeCardName(const QString &dirtyName, const QMap<wchar_t, wchar_t> &table);
 };
@@ -1,7 +1,5 @@
 #include "carddatabaseparser.h"
 
-SetNameMap ICardDatabaseParser::sets;
-
 void ICardDatabaseParser::clearSetlist()
 {
     sets.clear();
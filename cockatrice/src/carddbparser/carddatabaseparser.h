@@ -20,14 +20,14 @@ public:
                             const QString &fileName,
                             const QString &sourceUrl = "unknown",
                             const QString &sourceVersion = "unknown") = 0;
-    static void clearSetlist();
+    void clearSetlist();
 
 protected:
     /*
      * A cached list of the available sets, needed to cross-reference sets from cards.
-     * Shared between all parsers
+     * Every parser keeps its own, CardDatabase merges the sets of the files it loads.
      */
-    static SetNameMap sets;
+    SetNameMap sets;
 
     CardSetPtr internalAddSet(const QString &setName,
                               const QString &longName = "",
@@ -0,0 +1,197 @@
+#include "cardproperties.h"
+
+#include "game_specific_terms.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace
+{
+/*
+ * The names of all properties seen so far. Cards are created by several file loaders at once and read by the GUI and
+ * the search threads, while new names stop showing up after the first few cards. Registering a name therefore
+ * publishes a new copy of the table through one atomic pointer, and lookups take no lock at all.
+ */
+class PropertyKeyTable
+{
+private:
+    struct Keys
+    {
+        QHash<QString, quint32> ids;
+        QVector<QString> names;
+        QVector<bool> internValues;
+
+        quint32 add(const QString &name, bool lowCardinality)
+        {
+            const auto id = static_cast<quint32>(names.size());
+            ids.insert(name, id);
+            names.append(name);
+            internValues.append(lowCardinality);
+            return id;
+        }
+    };
+
+    std::atomic<const Keys *> current;
+    // every published copy, as readers may still be looking at an older one; there are only a few dozen names
+    std::vector<std::unique_ptr<Keys>> versions;
+    QMutex keyLock;
+
+    QMutex valueLock;
+    QSet<QString> values;
+
+    const Keys &keys() const
+    {
+        return *current.load(std::memory_order_acquire);
+    }
+
+public:
+    PropertyKeyTable()
+    {
+        auto initial = std::make_unique<Keys>();
+        for (const QString &name : {Mtg::CardType, Mtg::MainCardType, Mtg::ManaCost, Mtg::ConvertedManaCost,
+                                    Mtg::Colors, Mtg::ColorIdentity, Mtg::PowTough, Mtg::Loyalty, Mtg::Side,
+                                    Mtg::Layout, QString("rarity")})
+            initial->add(name, true);
+        for (const QString &name : QStringList{"picurl", "num", "muid", "uuid"})
+            initial->add(name, false);
+        current.store(initial.get(), std::memory_order_release);
+        versions.push_back(std::move(initial));
+    }
+
+    int find(const QString &name) const
+    {
+        const Keys &table = keys();
+        auto it = table.ids.constFind(name);
+        return it == table.ids.constEnd() ? -1 : static_cast<int>(it.value());
+    }
+
+    quint32 intern(const QString &name)
+    {
+        const int known = find(name);
+        if (known != -1)
+            return static_cast<quint32>(known);
+
+        QMutexLocker locker(&keyLock);
+        const Keys &table = keys();
+        auto it = table.ids.constFind(name);
+        if (it != table.ids.constEnd())
+            return it.value();
+
+        auto next = std::make_unique<Keys>(table);
+        // legalities only take a handful of values
+        const quint32 id = next->add(name, name.startsWith("format-"));
+        current.store(next.get(), std::memory_order_release);
+        versions.push_back(std::move(next));
+        return id;
+    }
+
+    QString name(quint32 id) const
+    {
+        return keys().names.at(static_cast<int>(id));
+    }
+
+    QString internValue(quint32 id, const QString &value)
+    {
+        if (!keys().internValues.at(static_cast<int>(id)))
+            return value;
+
+        QMutexLocker locker(&valueLock);
+        auto it = values.constFind(value);
+        if (it != values.constEnd())
+            return *it;
+        values.insert(value);
+        return value;
+    }
+
+    int keyCount() const
+    {
+        return keys().names.size();
+    }
+
+    int valueCount()
+    {
+        QMutexLocker locker(&valueLock);
+        return values.size();
+    }
+};
+
+PropertyKeyTable &keyTable()
+{
+    static PropertyKeyTable table;
+    return table;
+}
+} // namespace
+
+CardProperties::CardProperties(const QVariantHash &properties)
+{
+    entries.reserve(properties.size());
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it)
+        insert(it.key(), it.value().toString());
+}
+
+int CardProperties::lowerBound(quint32 key) const
+{
+    auto it = std::lower_bound(entries.constBegin(), entries.constEnd(), key,
+                               [](const Entry &entry, quint32 value) { return entry.key < value; });
+    return static_cast<int>(it - entries.constBegin());
+}
+
+const CardProperties::Entry *CardProperties::find(const QString &name) const
+{
+    const int key = keyTable().find(name);
+    if (key == -1)
+        return nullptr;
+
+    const int index = lowerBound(static_cast<quint32>(key));
+    if (index == entries.size() || entries.at(index).key != static_cast<quint32>(key))
+        return nullptr;
+    return &entries.at(index);
+}
+
+QStringList CardProperties::keys() const
+{
+    QStringList result;
+    result.reserve(entries.size());
+    for (const Entry &entry : entries)
+        result << keyTable().name(entry.key);
+    return result;
+}
+
+QString CardProperties::value(const QString &name) const
+{
+    const Entry *entry = find(name);
+    return entry == nullptr ? QString() : entry->value;
+}
+
+bool CardProperties::contains(const QString &name) const
+{
+    return find(name) != nullptr;
+}
+
+void CardProperties::insert(const QString &name, const QString &value)
+{
+    const quint32 key = keyTable().intern(name);
+    const QString stored = keyTable().internValue(key, value);
+
+    const int index = lowerBound(key);
+    if (index < entries.size() && entries.at(index).key == key)
+        entries[index].value = stored;
+    else
+        entries.insert(index, Entry{key, stored});
+}
+
+int CardProperties::internedKeyCount()
+{
+    return keyTable().keyCount();
+}
+
+int CardProperties::internedValueCount()
+{
+    return keyTable().valueCount();
+}
@@ -0,0 +1,53 @@
+#ifndef CARDPROPERTIES_H
+#define CARDPROPERTIES_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariantHash>
+#include <QVector>
+
+/**
+ * The generic properties of a card, or of one of its printings.
+ *
+ * Property names are interned in one table shared by all cards, so a card only keeps a small id per property, and
+ * the entries live sorted by id in one short array instead of a hash. The well known properties of the game are
+ * registered first and get the lowest ids. Values of the properties that only take a few distinct values (types,
+ * colors, rarities, legalities, ...) are interned as well, so the thousands of cards sharing one refer to the same
+ * string.
+ */
+class CardProperties
+{
+private:
+    struct Entry
+    {
+        quint32 key;
+        QString value;
+    };
+
+    QVector<Entry> entries;
+
+    // index of the entry with this key, or of the first entry with a larger one
+    int lowerBound(quint32 key) const;
+    const Entry *find(const QString &name) const;
+
+public:
+    CardProperties() = default;
+    explicit CardProperties(const QVariantHash &properties);
+
+    QStringList keys() const;
+    QString value(const QString &name) const;
+    bool contains(const QString &name) const;
+    void insert(const QString &name, const QString &value);
+    int size() const
+    {
+        return entries.size();
+    }
+
+    /**
+     * Number of distinct property names and of interned values seen so far, for memory reports.
+     */
+    static int internedKeyCount();
+    static int internedValueCount();
+};
+
+#endif
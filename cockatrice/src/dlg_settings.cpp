@@ -604,14 +604,45 @@ DeckEditorSettingsPage::DeckEditorSettingsPage()
     pixmapCacheLayout->addWidget(&pixmapCacheLabel);
     pixmapCacheLayout->addWidget(&pixmapCacheEdit);
 
+    // memory for the pictures at each size they are kept in
+    for (QSpinBox *edit : {&thumbnailCacheEdit, &tablePictureCacheEdit, &fullPictureCacheEdit}) {
+        edit->setMinimum(PICTURE_CACHE_SIZE_MIN);
+        edit->setMaximum(PICTURE_CACHE_SIZE_MAX);
+        edit->setSingleStep(32);
+        edit->setSuffix(" MB");
+    }
+    thumbnailCacheEdit.setValue(SettingsCache::instance().getThumbnailCacheSize());
+    tablePictureCacheEdit.setValue(SettingsCache::instance().getTablePictureCacheSize());
+    fullPictureCacheEdit.setValue(SettingsCache::instance().getFullPictureCacheSize());
+
+    auto pictureCacheLayout = new QHBoxLayout;
+    pictureCacheLayout->addStretch();
+    pictureCacheLayout->addWidget(&pictureCacheLabel);
+    pictureCacheLayout->addWidget(&thumbnailCacheEdit);
+    pictureCacheLayout->addWidget(&tablePictureCacheEdit);
+    pictureCacheLayout->addWidget(&fullPictureCacheEdit);
+
+    pictureDiskCacheEdit.setMinimum(PICTURE_DISK_CACHE_SIZE_MIN);
+    pictureDiskCacheEdit.setMaximum(PICTURE_DISK_CACHE_SIZE_MAX);
+    pictureDiskCacheEdit.setSingleStep(64);
+    pictureDiskCacheEdit.setValue(SettingsCache::instance().getPictureDiskCacheSize());
+    pictureDiskCacheEdit.setSuffix(tr(" MB"));
+
+    auto pictureDiskCacheLayout = new QHBoxLayout;
+    pictureDiskCacheLayout->addStretch();
+    pictureDiskCacheLayout->addWidget(&pictureDiskCacheLabel);
+    pictureDiskCacheLayout->addWidget(&pictureDiskCacheEdit);
+
     // Top Layout
     lpGeneralGrid->addWidget(&picDownloadCheckBox, 0, 0);
     lpGeneralGrid->addWidget(&resetDownloadURLs, 0, 1);
     lpGeneralGrid->addLayout(messageListLayout, 1, 0, 1, 2);
     lpGeneralGrid->addLayout(networkCacheLayout, 2, 0, 1, 2);
     lpGeneralGrid->addLayout(pixmapCacheLayout, 3, 0, 1, 2);
-    lpGeneralGrid->addWidget(&urlLinkLabel, 4, 0);
-    lpGeneralGrid->addWidget(&clearDownloadedPicsButton, 4, 1);
+    lpGeneralGrid->addLayout(pictureCacheLayout, 4, 0, 1, 2);
+    lpGeneralGrid->addLayout(pictureDiskCacheLayout, 5, 0, 1, 2);
+    lpGeneralGrid->addWidget(&urlLinkLabel, 6, 0);
+    lpGeneralGrid->addWidget(&clearDownloadedPicsButton, 6, 1);
 
     // Spoiler Layout
     lpSpoilerGrid->addWidget(&mcDownloadSpoilersCheckBox, 0, 0);
@@ -629,6 +660,14 @@ DeckEditorSettingsPage::DeckEditorSettingsPage()
     connect(&pixmapCacheEdit, SIGNAL(valueChanged(int)), &SettingsCache::instance(), SLOT(setPixmapCacheSize(int)));
     connect(&networkCacheEdit, SIGNAL(valueChanged(int)), &SettingsCache::instance(),
             SLOT(setNetworkCacheSizeInMB(int)));
+    connect(&thumbnailCacheEdit, SIGNAL(valueChanged(int)), &SettingsCache::instance(),
+            SLOT(setThumbnailCacheSize(int)));
+    connect(&tablePictureCacheEdit, SIGNAL(valueChanged(int)), &SettingsCache::instance(),
+            SLOT(setTablePictureCacheSize(int)));
+    connect(&fullPictureCacheEdit, SIGNAL(valueChanged(int)), &SettingsCache::instance(),
+            SLOT(setFullPictureCacheSize(int)));
+    connect(&pictureDiskCacheEdit, SIGNAL(valueChanged(int)), &SettingsCache::instance(),
+            SLOT(setPictureDiskCacheSize(int)));
 
     mpGeneralGroupBox = new QGroupBox;
     mpGeneralGroupBox->setLayout(lpGeneralGrid);
@@ -812,6 +851,9 @@ void DeckEditorSettingsPage::retranslateUi()
     networkCacheLabel.setText(tr("Downloaded images directory size:"));
     networkCacheEdit.setToolTip(tr("On-disk cache for downloaded pictures"));
     pixmapCacheLabel.setText(tr("Picture cache size:"));
+    pictureCacheLabel.setText(tr("Picture memory for small, table and full size pictures:"));
+    pictureDiskCacheLabel.setText(tr("Scaled pictures directory size:"));
+    pictureDiskCacheEdit.setToolTip(tr("On-disk cache for the small and table size pictures"));
     pixmapCacheEdit.setToolTip(tr("In-memory cache for pictures not currently on screen"));
 }
 
@@ -170,6 +170,12 @@ private:
     QSpinBox networkCacheEdit;
     QSpinBox pixmapCacheEdit;
     QLabel pixmapCacheLabel;
+    QSpinBox thumbnailCacheEdit;
+    QSpinBox tablePictureCacheEdit;
+    QSpinBox fullPictureCacheEdit;
+    QLabel pictureCacheLabel;
+    QSpinBox pictureDiskCacheEdit;
+    QLabel pictureDiskCacheLabel;
 };
 
 class MessagesSettingsPage : public AbstractSettingsPage
@@ -0,0 +1,310 @@
+#include "filter_program.h"
+
+#include <QHash>
+#include <QVarLengthArray>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+namespace
+{
+// runs work over [0, count) in chunks, spread over the global thread pool when there is more than one
+void forEachChunk(int count, const std::function<void(int, int)> &work)
+{
+    const int chunkSize = 4096;
+    if (count <= chunkSize) {
+        work(0, count);
+        return;
+    }
+
+    QVector<int> begins;
+    for (int begin = 0; begin < count; begin += chunkSize)
+        begins.append(begin);
+    QtConcurrent::blockingMap(begins, [&](int begin) { work(begin, qMin(begin + chunkSize, count)); });
+}
+
+// the distinct trigrams of a case folded string, each packed from its three utf-16 units
+QVector<quint64> trigramsOf(const QString &folded)
+{
+    QVector<quint64> trigrams;
+    for (int i = 0; i + 2 < folded.size(); ++i)
+        trigrams.append(quint64(folded.at(i).unicode()) << 32 | quint64(folded.at(i + 1).unicode()) << 16 |
+                        folded.at(i + 2).unicode());
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+} // namespace
+
+QStringList FilterColumn::valuesOf(const CardData &card) const
+{
+    switch (kind) {
+        case Name:
+            return {card->getName()};
+        case Text:
+            return {card->getText()};
+        case CardType:
+            return {card->getCardType()};
+        case Colors:
+            return {card->getColors()};
+        case PowTough:
+            return {card->getPowTough()};
+        case SetNames:
+            return card->getSets().keys();
+        case Rarities: {
+            QStringList rarities;
+            for (const auto &set : card->getSets())
+                rarities.append(set.getProperty("rarity"));
+            return rarities;
+        }
+        case Property:
+            return {card->getProperty(property)};
+        case PresentProperty:
+            return card->hasProperty(property) ? QStringList{card->getProperty(property)} : QStringList();
+    }
+    return QStringList();
+}
+
+QString FilterColumn::key() const
+{
+    return QString("%1:%2").arg(static_cast<int>(kind)).arg(property);
+}
+
+const CardColumns::Column &CardColumns::column(const FilterColumn &filterColumn)
+{
+    const QString key = filterColumn.key();
+    auto it = columns.constFind(key);
+    if (it != columns.constEnd())
+        return it.value();
+
+    Column column;
+    QHash<QString, int> valueIds;
+    column.offsets.reserve(cards.size() + 1);
+    column.offsets.append(0);
+    for (const CardInfoPtr &card : cards) {
+        for (const QString &value : filterColumn.valuesOf(card)) {
+            auto id = valueIds.constFind(value);
+            if (id == valueIds.constEnd()) {
+                id = valueIds.insert(value, column.values.size());
+                column.values.append(value);
+            }
+            column.ids.append(id.value());
+        }
+        column.offsets.append(column.ids.size());
+    }
+    return columns.insert(key, column).value();
+}
+
+QVector<int> CardColumns::candidates(const FilterColumn &filterColumn, const QString &substring)
+{
+    const Column &values = column(filterColumn);
+    const QVector<quint64> wanted = trigramsOf(substring.toCaseFolded());
+    if (wanted.isEmpty()) {
+        QVector<int> all(values.values.size());
+        std::iota(all.begin(), all.end(), 0);
+        return all;
+    }
+
+    const QString key = filterColumn.key();
+    auto index = trigramIndexes.constFind(key);
+    if (index == trigramIndexes.constEnd()) {
+        TrigramIndex built;
+        for (int id = 0; id < values.values.size(); ++id)
+            for (quint64 trigram : trigramsOf(values.values.at(id).toCaseFolded()))
+                built[trigram].append(id);
+        index = trigramIndexes.insert(key, built);
+    }
+
+    // intersect the posting lists, shortest first
+    QVector<const QVector<int> *> postings;
+    for (quint64 trigram : wanted) {
+        auto posting = index->constFind(trigram);
+        if (posting == index->constEnd())
+            return QVector<int>();
+        postings.append(&posting.value());
+    }
+    std::sort(postings.begin(), postings.end(),
+              [](const QVector<int> *a, const QVector<int> *b) { return a->size() < b->size(); });
+
+    QVector<int> result = *postings.first();
+    for (int i = 1; i < postings.size() && !result.isEmpty(); ++i) {
+        QVector<int> narrowed;
+        std::set_intersection(result.constBegin(), result.constEnd(), postings.at(i)->constBegin(),
+                              postings.at(i)->constEnd(), std::back_inserter(narrowed));
+        result = narrowed;
+    }
+    return result;
+}
+
+FilterProgram::FilterProgram() : instructions({{And, 0}})
+{
+}
+
+FilterProgram FilterProgram::leaf(const FilterColumn &column, const StringMatcher &matcher)
+{
+    FilterProgram program;
+    program.leaves.append({column, matcher, QString()});
+    program.instructions = {{Leaf, 0}};
+    return program;
+}
+
+FilterProgram FilterProgram::substringLeaf(const FilterColumn &column, const QString &substring)
+{
+    FilterProgram program = leaf(column, [=](const QString &s) { return s.contains(substring, Qt::CaseInsensitive); });
+    program.leaves.first().substring = substring;
+    return program;
+}
+
+FilterProgram FilterProgram::constant(bool value)
+{
+    FilterProgram program;
+    program.instructions = {{value ? And : Or, 0}};
+    return program;
+}
+
+FilterProgram FilterProgram::all(const QVector<FilterProgram> &operands)
+{
+    return combine(operands, And);
+}
+
+FilterProgram FilterProgram::any(const QVector<FilterProgram> &operands)
+{
+    return combine(operands, Or);
+}
+
+FilterProgram FilterProgram::negate(const FilterProgram &operand)
+{
+    FilterProgram program = operand;
+    program.instructions.append({Not, 0});
+    return program;
+}
+
+FilterProgram FilterProgram::combine(const QVector<FilterProgram> &operands, Operation operation)
+{
+    if (operands.size() == 1)
+        return operands.first();
+
+    FilterProgram program;
+    program.instructions.clear();
+    for (const FilterProgram &operand : operands) {
+        const int firstLeaf = program.leaves.size();
+        program.leaves += operand.leaves;
+        for (Instruction instruction : operand.instructions) {
+            if (instruction.operation == Leaf)
+                instruction.arg += firstLeaf;
+            program.instructions.append(instruction);
+        }
+    }
+    program.instructions.append({operation, static_cast<int>(operands.size())});
+    return program;
+}
+
+int FilterProgram::stackDepth() const
+{
+    int depth = 0, maxDepth = 0;
+    for (const Instruction &instruction : instructions) {
+        if (instruction.operation == Leaf)
+            ++depth;
+        else if (instruction.operation != Not)
+            depth += 1 - instruction.arg;
+        maxDepth = qMax(maxDepth, depth);
+    }
+    return maxDepth;
+}
+
+template <typename LeafResult> bool FilterProgram::run(LeafResult leafResult, char *stack) const
+{
+    int top = 0;
+    for (const Instruction &instruction : instructions) {
+        switch (instruction.operation) {
+            case Leaf:
+                stack[top++] = leafResult(instruction.arg) ? 1 : 0;
+                break;
+            case And: {
+                char value = 1;
+                for (int i = 0; i < instruction.arg; ++i)
+                    if (!stack[--top])
+                        value = 0;
+                stack[top++] = value;
+                break;
+            }
+            case Or: {
+                char value = 0;
+                for (int i = 0; i < instruction.arg; ++i)
+                    if (stack[--top])
+                        value = 1;
+                stack[top++] = value;
+                break;
+            }
+            case Not:
+                stack[top - 1] = stack[top - 1] ? 0 : 1;
+                break;
+        }
+    }
+    return stack[0] != 0;
+}
+
+bool FilterProgram::check(const CardData &card) const
+{
+    QVarLengthArray<char, 32> stack(stackDepth());
+    return run(
+        [&](int leaf) {
+            const LeafMatcher &leafMatcher = leaves.at(leaf);
+            for (const QString &value : leafMatcher.column.valuesOf(card))
+                if (leafMatcher.matcher(value))
+                    return true;
+            return false;
+        },
+        stack.data());
+}
+
+QVector<char> FilterProgram::match(CardColumns &columns) const
+{
+    // extract all the columns first, from here on they are only read
+    QVector<const CardColumns::Column *> leafColumns;
+    for (const LeafMatcher &leafMatcher : leaves)
+        leafColumns.append(&columns.column(leafMatcher.column));
+
+    // match every distinct value of a column once, for substrings only the ones the trigram index leaves
+    QVector<QVector<char>> leafValues(leaves.size());
+    for (int leaf = 0; leaf < leaves.size(); ++leaf) {
+        const QStringList &values = leafColumns.at(leaf)->values;
+        const StringMatcher &matcher = leaves.at(leaf).matcher;
+        leafValues[leaf].resize(values.size());
+        char *matches = leafValues[leaf].data();
+        if (leaves.at(leaf).substring.isEmpty()) {
+            forEachChunk(values.size(), [&](int begin, int end) {
+                for (int value = begin; value < end; ++value)
+                    matches[value] = matcher(values.at(value)) ? 1 : 0;
+            });
+        } else {
+            const QVector<int> candidates = columns.candidates(leaves.at(leaf).column, leaves.at(leaf).substring);
+            forEachChunk(candidates.size(), [&](int begin, int end) {
+                for (int i = begin; i < end; ++i)
+                    matches[candidates.at(i)] = matcher(values.at(candidates.at(i))) ? 1 : 0;
+            });
+        }
+    }
+
+    QVector<char> result(columns.size());
+    char *accepted = result.data();
+    const int depth = stackDepth();
+    forEachChunk(columns.size(), [&](int begin, int end) {
+        QVarLengthArray<char, 32> stack(depth);
+        for (int row = begin; row < end; ++row) {
+            const bool rowAccepted = run(
+                [&](int leaf) {
+                    const CardColumns::Column &column = *leafColumns.at(leaf);
+                    const char *matches = leafValues.at(leaf).constData();
+                    for (int i = column.offsets.at(row); i < column.offsets.at(row + 1); ++i)
+                        if (matches[column.ids.at(i)])
+                            return true;
+                    return false;
+                },
+                stack.data());
+            accepted[row] = rowAccepted ? 1 : 0;
+        }
+    });
+    return result;
+}
@@ -0,0 +1,157 @@
+#ifndef FILTER_PROGRAM_H
+#define FILTER_PROGRAM_H
+
+#include "carddatabase.h"
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+typedef CardInfoPtr CardData;
+typedef std::function<bool(const QString &)> StringMatcher;
+
+/**
+ * One piece of card data a search can look at. Most give one value per card; the set and rarity columns give one
+ * per printing, and a property that only counts when present gives none for cards without it.
+ */
+class FilterColumn
+{
+public:
+    enum Kind
+    {
+        Name,
+        Text,
+        CardType,
+        Colors,
+        PowTough,
+        SetNames,
+        Rarities,
+        // the value of a property, empty for cards without it
+        Property,
+        // the value of a property, no value at all for cards without it
+        PresentProperty
+    };
+
+    explicit FilterColumn(Kind _kind = Name, const QString &_property = QString()) : kind(_kind), property(_property)
+    {
+    }
+
+    QStringList valuesOf(const CardData &card) const;
+    QString key() const;
+
+private:
+    Kind kind;
+    QString property;
+};
+
+/**
+ * The search columns of a list of cards, extracted once so searches do not go through the cards at all. Every column
+ * is dictionary encoded: it keeps each distinct value once, and for every card the indexes of its values in there.
+ * Cards share few types, colors, sets or costs, so matching a value once and reusing the result for every card with
+ * it is most of what makes searching fast.
+ *
+ * Columns are extracted on first use, which must not happen from several threads at once.
+ */
+class CardColumns
+{
+public:
+    struct Column
+    {
+        QStringList values;
+        // the values of card i are ids[offsets[i]] to ids[offsets[i + 1]] (exclusive)
+        QVector<int> offsets;
+        QVector<int> ids;
+    };
+
+    explicit CardColumns(const QList<CardInfoPtr> &_cards) : cards(_cards)
+    {
+    }
+
+    int size() const
+    {
+        return cards.size();
+    }
+    const Column &column(const FilterColumn &filterColumn);
+
+    /**
+     * The ids of the values of a column containing all the three character pieces of substring, ignoring case: a
+     * superset of the values containing substring itself, usually a small one. Substrings shorter than three
+     * characters do not narrow anything down and return all ids. The trigram index of a column is built on first use
+     * and kept with it.
+     */
+    QVector<int> candidates(const FilterColumn &filterColumn, const QString &substring);
+
+private:
+    // value ids by the trigrams in them, each list sorted
+    typedef QHash<quint64, QVector<int>> TrigramIndex;
+
+    QList<CardInfoPtr> cards;
+    QMap<QString, Column> columns;
+    QMap<QString, TrigramIndex> trigramIndexes;
+};
+
+/**
+ * A search compiled to a flat program: a list of leaves, each matching one column of a card against a string
+ * matcher, and a postfix sequence of instructions combining their results.
+ *
+ * Against CardColumns the program first runs every leaf matcher over the distinct values of its column (only over
+ * the trigram candidates for substring leaves), then runs the instructions for each card, in chunks spread over the
+ * global thread pool, looking the leaf results up by value id.
+ */
+class FilterProgram
+{
+public:
+    // accepts every card
+    FilterProgram();
+
+    static FilterProgram leaf(const FilterColumn &column, const StringMatcher &matcher);
+    // accepts cards with a value of column containing substring, ignoring case
+    static FilterProgram substringLeaf(const FilterColumn &column, const QString &substring);
+    static FilterProgram constant(bool value);
+    static FilterProgram all(const QVector<FilterProgram> &operands);
+    static FilterProgram any(const QVector<FilterProgram> &operands);
+    static FilterProgram negate(const FilterProgram &operand);
+
+    bool check(const CardData &card) const;
+    // one entry per card of the columns, non-zero for the accepted ones
+    QVector<char> match(CardColumns &columns) const;
+
+private:
+    enum Operation
+    {
+        // pushes the result of leaf arg
+        Leaf,
+        // replace the top arg results by whether all (none for arg 0) are true
+        And,
+        // replace the top arg results by whether any is true
+        Or,
+        Not
+    };
+
+    struct Instruction
+    {
+        Operation operation;
+        int arg;
+    };
+
+    struct LeafMatcher
+    {
+        FilterColumn column;
+        StringMatcher matcher;
+        // set when the matcher only accepts values containing it, to look them up in the trigram index
+        QString substring;
+    };
+
+    QVector<Instruction> instructions;
+    QVector<LeafMatcher> leaves;
+
+    static FilterProgram combine(const QVector<FilterProgram> &operands, Operation operation);
+    template <typename LeafResult> bool run(LeafResult leafResult, char *stack) const;
+    int stackDepth() const;
+};
+
+#endif
@@ -63,66 +63,42 @@ std::once_flag init;
 
 static void setupParserRules()
 {
-    auto passthru = [](const peg::SemanticValues &sv) -> Filter { return !sv.empty() ? sv[0].get<Filter>() : nullptr; };
+    auto passthru = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return !sv.empty() ? sv[0].get<FilterProgram>() : FilterProgram();
+    };
+    auto operands = [](const peg::SemanticValues &sv) {
+        QVector<FilterProgram> programs;
+        for (int i = 0; i < static_cast<int>(sv.size()); ++i)
+            programs.append(sv[i].get<FilterProgram>());
+        return programs;
+    };
 
     search["Start"] = passthru;
-    search["QueryPartList"] = [](const peg::SemanticValues &sv) -> Filter {
-        return [=](CardData x) {
-            for (int i = 0; i < static_cast<int>(sv.size()); ++i) {
-                if (!sv[i].get<Filter>()(x))
-                    return false;
-            }
-            return true;
-        };
+    search["QueryPartList"] = [=](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::all(operands(sv));
     };
-    search["ComplexQueryPart"] = [](const peg::SemanticValues &sv) -> Filter {
-        return [=](CardData x) {
-            for (int i = 0; i < static_cast<int>(sv.size()); ++i) {
-                if (sv[i].get<Filter>()(x))
-                    return true;
-            }
-            return false;
-        };
+    search["ComplexQueryPart"] = [=](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::any(operands(sv));
     };
     search["SomewhatComplexQueryPart"] = passthru;
     search["QueryPart"] = passthru;
-    search["NotQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        Filter dependent = sv[0].get<Filter>();
-        return [=](CardData x) -> bool { return !dependent(x); };
+    search["NotQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::negate(sv[0].get<FilterProgram>());
     };
-    search["TypeQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        StringMatcher matcher = sv[0].get<StringMatcher>();
-        return [=](CardData x) -> bool { return matcher(x->getCardType()); };
+    search["TypeQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::leaf(FilterColumn(FilterColumn::CardType), sv[0].get<StringMatcher>());
     };
-    search["SetQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        StringMatcher matcher = sv[0].get<StringMatcher>();
-        return [=](CardData x) -> bool {
-            for (const auto &set : x->getSets().keys()) {
-                if (matcher(set))
-                    return true;
-            }
-            return false;
-        };
+    search["SetQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::leaf(FilterColumn(FilterColumn::SetNames), sv[0].get<StringMatcher>());
     };
-    search["RarityQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        StringMatcher matcher = sv[0].get<StringMatcher>();
-        return [=](CardData x) -> bool {
-            for (const auto &set : x->getSets().values()) {
-                if (matcher(set.getProperty("rarity")))
-                    return true;
-            }
-            return false;
-        };
+    search["RarityQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::substringLeaf(FilterColumn(FilterColumn::Rarities), sv[0].get<QString>());
     };
-    search["FormatQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        if (sv.choice() == 0) {
-            QString format = sv[0].get<QString>();
-            return [=](CardData x) -> bool { return x->getProperty(QString("format-%1").arg(format)) == "legal"; };
-        } else {
-            QString format = sv[1].get<QString>();
-            QString legality = sv[0].get<QString>();
-            return [=](CardData x) -> bool { return x->getProperty(QString("format-%1").arg(format)) == legality; };
-        }
+    search["FormatQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        QString format = sv[sv.choice() == 0 ? 0 : 1].get<QString>();
+        QString legality = sv.choice() == 0 ? QString("legal") : sv[0].get<QString>();
+        return FilterProgram::leaf(FilterColumn(FilterColumn::Property, QString("format-%1").arg(format)),
+                                   [=](const QString &s) { return s == legality; });
     };
     search["Legality"] = [](const peg::SemanticValues &sv) -> QString {
         switch (tolower(sv.str()[0])) {
@@ -239,25 +215,22 @@ static void setupParserRules()
         return QString::fromStdString(sv.str());
     };
 
-    search["RegexString"] = [](const peg::SemanticValues &sv) -> StringMatcher {
-        auto target = sv[0].get<QString>();
-        return [=](const QString &s) { return s.QString::contains(target, Qt::CaseInsensitive); };
-    };
+    search["RegexString"] = [](const peg::SemanticValues &sv) -> QString { return sv[0].get<QString>(); };
 
-    search["OracleQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        StringMatcher matcher = sv[0].get<StringMatcher>();
-        return [=](CardData x) { return matcher(x->getText()); };
+    search["OracleQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::substringLeaf(FilterColumn(FilterColumn::Text), sv[0].get<QString>());
     };
 
-    search["ColorQuery"] = [](const peg::SemanticValues &sv) -> Filter {
+    search["ColorQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
         QString parts;
         for (int i = 0; i < static_cast<int>(sv.size()); ++i) {
             parts += sv[i].get<char>();
         }
         bool idenity = sv.tokens[0].first[0] != 'i';
         if (sv.tokens[1].first[0] == ':') {
-            return [=](CardData x) {
-                QString match = idenity ? x->getColors() : x->getProperty("coloridentity");
+            FilterColumn column = idenity ? FilterColumn(FilterColumn::Colors)
+                                          : FilterColumn(FilterColumn::Property, "coloridentity");
+            return FilterProgram::leaf(column, [=](const QString &match) {
                 if (parts.contains("m") && match.length() < 2) {
                     return false;
                 } else if (parts == "m") {
@@ -272,10 +245,11 @@ static void setupParserRules()
                         return true;
                 }
                 return false;
-            };
+            });
         } else {
-            return [=](CardData x) {
-                QString match = idenity ? x->getColors() : x->getProperty("colorIdentity");
+            FilterColumn column = idenity ? FilterColumn(FilterColumn::Colors)
+                                          : FilterColumn(FilterColumn::Property, "colorIdentity");
+            return FilterProgram::leaf(column, [=](const QString &match) {
                 if (parts.contains("m") && match.length() < 2)
                     return false;
 
@@ -292,40 +266,38 @@ static void setupParserRules()
                         return false;
                 }
                 return true;
-            };
+            });
         }
     };
 
-    search["CMCQuery"] = [](const peg::SemanticValues &sv) -> Filter {
+    search["CMCQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
         NumberMatcher matcher = sv[0].get<NumberMatcher>();
-        return [=](CardData x) -> bool { return matcher(x->getProperty("cmc").toInt()); };
+        return FilterProgram::leaf(FilterColumn(FilterColumn::Property, "cmc"),
+                                   [=](const QString &s) { return matcher(s.toInt()); });
     };
-    search["PowerQuery"] = [](const peg::SemanticValues &sv) -> Filter {
+    search["PowerQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
         NumberMatcher matcher = sv[0].get<NumberMatcher>();
-        return [=](CardData x) -> bool { return matcher(x->getPowTough().split("/")[0].toInt()); };
+        return FilterProgram::leaf(FilterColumn(FilterColumn::PowTough),
+                                   [=](const QString &s) { return matcher(s.split("/")[0].toInt()); });
     };
-    search["ToughnessQuery"] = [](const peg::SemanticValues &sv) -> Filter {
+    search["ToughnessQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
         NumberMatcher matcher = sv[0].get<NumberMatcher>();
-        return [=](CardData x) -> bool {
-            auto parts = x->getPowTough().split("/");
+        return FilterProgram::leaf(FilterColumn(FilterColumn::PowTough), [=](const QString &s) {
+            auto parts = s.split("/");
             return matcher(parts.length() == 2 ? parts[1].toInt() : 0);
-        };
+        });
     };
-    search["FieldQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        QString field = sv[0].get<QString>();
+    search["FieldQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        FilterColumn column(FilterColumn::PresentProperty, sv[0].get<QString>());
         if (sv.choice() == 0) {
-            StringMatcher matcher = sv[1].get<StringMatcher>();
-            return [=](CardData x) -> bool { return x->hasProperty(field) ? matcher(x->getProperty(field)) : false; };
+            return FilterProgram::substringLeaf(column, sv[1].get<QString>());
         } else {
             NumberMatcher matcher = sv[1].get<NumberMatcher>();
-            return [=](CardData x) -> bool {
-                return x->hasProperty(field) ? matcher(x->getProperty(field).toInt()) : false;
-            };
+            return FilterProgram::leaf(column, [=](const QString &s) { return matcher(s.toInt()); });
         }
     };
-    search["GenericQuery"] = [](const peg::SemanticValues &sv) -> Filter {
-        StringMatcher matcher = sv[0].get<StringMatcher>();
-        return [=](CardData x) { return matcher(x->getName()); };
+    search["GenericQuery"] = [](const peg::SemanticValues &sv) -> FilterProgram {
+        return FilterProgram::substringLeaf(FilterColumn(FilterColumn::Name), sv[0].get<QString>());
     };
 
     search["Color"] = [](const peg::SemanticValues &sv) -> char { return "WUBRGU"[sv.choice()]; };
@@ -343,7 +315,7 @@ FilterString::FilterString(const QString &expr)
     _error = QString();
 
     if (ba.isEmpty()) {
-        result = [](CardData) -> bool { return true; };
+        result = FilterProgram::constant(true);
         return;
     }
 
@@ -353,6 +325,6 @@ FilterString::FilterString(const QString &expr)
 
     if (!search.parse(ba.data(), result)) {
         std::cout << "Error!" << _error.toStdString() << std::endl;
-        result = [](CardData) -> bool { return false; };
+        result = FilterProgram::constant(false);
     }
 }
@@ -2,6 +2,7 @@
 #define FILTER_STRING_H
 
 #include "carddatabase.h"
+#include "filter_program.h"
 #include "filtertree.h"
 
 #include <QMap>
@@ -9,9 +10,6 @@
 #include <functional>
 #include <utility>
 
-typedef CardInfoPtr CardData;
-typedef std::function<bool(const CardData &)> Filter;
-typedef std::function<bool(const QString &)> StringMatcher;
 typedef std::function<bool(int)> NumberMatcher;
 
 namespace peg
@@ -25,9 +23,17 @@ class FilterString
 {
 public:
     explicit FilterString(const QString &exp);
-    bool check(const CardData &card)
+    bool check(const CardData &card) const
     {
-        return result(card);
+        return result.check(card);
+    }
+
+    /**
+     * Checks all the cards of the columns at once, see FilterProgram::match.
+     */
+    QVector<char> match(CardColumns &columns) const
+    {
+        return result.match(columns);
     }
 
     bool valid()
@@ -42,7 +48,7 @@ public:
 
 private:
     QString _error;
-    Filter result;
+    FilterProgram result;
 };
 
 #endif
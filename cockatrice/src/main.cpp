@@ -152,6 +152,7 @@ int main(int argc, char *argv[])
     themeManager = new ThemeManager;
     soundEngine = new SoundEngine;
     db = new CardDatabase;
+    db->setCacheFilePath(SettingsCache::instance().getCachePath() + "/cards.cache");
 
     qtTranslator = new QTranslator;
     translator = new QTranslator;
@@ -0,0 +1,124 @@
+#include "picturefileindex.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+
+// the file systems of Windows and macOS ignore case by default, so lookups there must too, like probing did
+static QString indexKey(const QString &name)
+{
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+    return name.toCaseFolded();
+#else
+    return name;
+#endif
+}
+
+PictureFileIndex::PictureFileIndex(QObject *parent)
+    : QObject(parent), watcher(new QFileSystemWatcher(this)), customIndexed(false)
+{
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &PictureFileIndex::directoryChanged);
+}
+
+void PictureFileIndex::setCustomPicsPath(const QString &_customPicsPath)
+{
+    customPicsPath = _customPicsPath;
+    if (!watchedFolders.isEmpty())
+        watcher->removePaths(watchedFolders.values());
+    watchedFolders.clear();
+    customEntries.clear();
+    customFolders.clear();
+    customIndexed = false;
+    folders.clear();
+}
+
+void PictureFileIndex::watch(const QString &dir)
+{
+    if (!watchedFolders.contains(dir) && QFileInfo::exists(dir) && watcher->addPath(dir))
+        watchedFolders.insert(dir);
+}
+
+void PictureFileIndex::indexCustomFolder()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    customEntries.clear();
+    customFolders = {customPicsPath};
+    watch(customPicsPath);
+
+    int fileCount = 0;
+    QDirIterator it(customPicsPath, QDir::Files | QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            customFolders.insert(path);
+            watch(path);
+        } else if (info.isFile()) {
+            const QSet<QString> names = {info.fileName(), info.completeBaseName(), info.baseName()};
+            for (const QString &name : names)
+                customEntries[indexKey(name)].append(path);
+            ++fileCount;
+        }
+    }
+    customIndexed = true;
+
+    qDebug().nospace() << "PictureFileIndex: indexed " << fileCount << " custom pictures in " << customFolders.size()
+                       << " folders in " << timer.elapsed() << " ms";
+}
+
+QStringList PictureFileIndex::customPictures(const QString &name)
+{
+    if (!customIndexed)
+        indexCustomFolder();
+    return customEntries.value(indexKey(name));
+}
+
+const PictureFileIndex::Entries &PictureFileIndex::folder(const QString &dir)
+{
+    auto it = folders.constFind(dir);
+    if (it != folders.constEnd())
+        return it.value();
+
+    Entries entries;
+    for (const QFileInfo &info : QDir(dir).entryInfoList(QDir::Files | QDir::Hidden)) {
+        const QString path = dir + "/" + info.fileName();
+        entries[indexKey(info.fileName())].append(path);
+        if (info.completeBaseName() != info.fileName())
+            entries[indexKey(info.completeBaseName())].append(path);
+    }
+
+    // a folder that does not exist yet shows up as a change of its parent
+    watch(QFileInfo::exists(dir) ? dir : QFileInfo(dir).path());
+    return folders.insert(dir, entries).value();
+}
+
+QStringList PictureFileIndex::folderPictures(const QString &dir, const QString &base)
+{
+    return folder(dir).value(indexKey(base));
+}
+
+void PictureFileIndex::directoryChanged(const QString &dir)
+{
+    // the watcher stops watching folders that went away
+    if (!QFileInfo::exists(dir))
+        watchedFolders.remove(dir);
+
+    if (customFolders.contains(dir)) {
+        customEntries.clear();
+        customIndexed = false;
+    }
+
+    folders.remove(dir);
+    for (auto it = folders.begin(); it != folders.end();) {
+        if (QFileInfo(it.key()).path() == dir)
+            it = folders.erase(it);
+        else
+            ++it;
+    }
+}
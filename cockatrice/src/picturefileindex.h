@@ -0,0 +1,60 @@
+#ifndef PICTUREFILEINDEX_H
+#define PICTUREFILEINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QFileSystemWatcher;
+
+/**
+ * Knows which picture files are on disk, so the picture loader can find the ones of a card without walking the
+ * custom pictures folder or probing file names for every card.
+ *
+ * The custom folder is indexed as a whole with all its subfolders; other folders, like the ones of the sets in the
+ * pictures folder, are listed the first time a picture is looked up in them. A file system watcher drops whatever
+ * changed on disk, to be indexed again on the next lookup. Not thread safe: use it from the thread it lives in.
+ */
+class PictureFileIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PictureFileIndex(QObject *parent = nullptr);
+
+    // forgets everything indexed so far
+    void setCustomPicsPath(const QString &_customPicsPath);
+
+    /**
+     * Files anywhere below the custom folder named name, or name followed by one or more extensions, in the order
+     * a recursive walk of the folder finds them.
+     */
+    QStringList customPictures(const QString &name);
+
+    /**
+     * Files in the folder dir that the image reader would find for the file name base: base itself, or base with an
+     * image extension appended.
+     */
+    QStringList folderPictures(const QString &dir, const QString &base);
+
+private:
+    // file paths by the names they can be looked up with, case folded where the file system ignores case
+    typedef QHash<QString, QStringList> Entries;
+
+    QFileSystemWatcher *watcher;
+    QSet<QString> watchedFolders;
+    QString customPicsPath;
+    Entries customEntries;
+    bool customIndexed;
+    QSet<QString> customFolders;
+    QHash<QString, Entries> folders;
+
+    void indexCustomFolder();
+    const Entries &folder(const QString &dir);
+    void watch(const QString &dir);
+private slots:
+    void directoryChanged(const QString &dir);
+};
+
+#endif
@@ -2,15 +2,20 @@
 
 #include "carddatabase.h"
 #include "main.h"
+#include "picturefileindex.h"
 #include "settingscache.h"
 #include "thememanager.h"
 
 #include <QApplication>
+#include <QBuffer>
 #include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
-#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
 #include <QImageReader>
 #include <QNetworkAccessManager>
 #include <QNetworkDiskCache>
@@ -19,19 +24,69 @@
 #include <QPainter>
 #include <QPixmapCache>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QScreen>
 #include <QSet>
 #include <QSvgRenderer>
 #include <QThread>
 #include <QUrl>
+#include <QtConcurrent>
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <utility>
 
 // never cache more than 300 cards at once for a single deck
 #define CACHED_CARD_PER_DECK_MAX 300
 
-PictureToLoad::PictureToLoad(CardInfoPtr _card)
-    : card(std::move(_card)), urlTemplates(SettingsCache::instance().downloads().getAllURLs())
+// bytes written to the disk cache of the smaller sizes since it was last checked against its limit
+static std::atomic<qint64> diskCacheBytesWritten(0);
+
+// prefetched pictures take at most half of the decoding threads and downloads, so cards on screen never wait long
+static int prefetchShare(int total)
+{
+    return qMax(1, total / 2);
+}
+
+int PictureBucket::maxHeight(Bucket bucket)
+{
+    switch (bucket) {
+        case Thumbnail:
+            return 160;
+        case Table:
+            return 400;
+        case Full:
+            break;
+    }
+    return std::numeric_limits<int>::max();
+}
+
+PictureBucket::Bucket PictureBucket::forHeight(int height)
+{
+    if (height <= maxHeight(Thumbnail)) {
+        return Thumbnail;
+    }
+    if (height <= maxHeight(Table)) {
+        return Table;
+    }
+    return Full;
+}
+
+QString PictureBucket::name(Bucket bucket)
+{
+    switch (bucket) {
+        case Thumbnail:
+            return "thumbnail";
+        case Table:
+            return "table";
+        case Full:
+            break;
+    }
+    return "full";
+}
+
+PictureToLoad::PictureToLoad(CardInfoPtr _card, Priority _priority)
+    : card(std::move(_card)), urlTemplates(SettingsCache::instance().downloads().getAllURLs()), priority(_priority)
 {
     if (card) {
         for (const auto &set : card->getSets()) {
@@ -41,6 +96,12 @@ PictureToLoad::PictureToLoad(CardInfoPtr _card)
             sortedSets << CardSet::newInstance("", "", "", QDate());
         }
         std::sort(sortedSets.begin(), sortedSets.end(), SetDownloadPriorityComparator());
+        const QString preferredSet = sortedSets.first()->getShortName();
+        // with the download urls in the key, pictures from a source no longer used are not served from the cache
+        const QString printing = card->getName() + "\n" + preferredSet + "\n" +
+                                 card->getSetProperty(preferredSet, "uuid") + "\n" +
+                                 card->getCustomPicURL(preferredSet) + "\n" + QStringList(urlTemplates).join("\n");
+        cacheKey = QCryptographicHash::hash(printing.toUtf8(), QCryptographicHash::Sha1).toHex();
         // The first time called, nextSet will also populate the Urls for the first set.
         nextSet();
     }
@@ -110,11 +171,24 @@ QStringList PictureLoaderWorker::md5Blacklist = QStringList() << "db0c48db407a90
 PictureLoaderWorker::PictureLoaderWorker()
     : QObject(nullptr), picsPath(SettingsCache::instance().getPicsPath()),
       customPicsPath(SettingsCache::instance().getCustomPicsPath()),
-      picDownload(SettingsCache::instance().getPicDownload()), downloadRunning(false), loadQueueRunning(false)
+      cachePath(SettingsCache::instance().getPictureCachePath()), diskLookupsRunning(0), prefetchLookupsRunning(0),
+      diskCacheLimit(SettingsCache::instance().getPictureDiskCacheSize() * 1024LL * 1024LL), diskCacheChecked(false),
+      diskCachePruning(false),
+      maxDownloads(SettingsCache::instance().getPictureDownloadsMax()),
+      maxDownloadsPerHost(SettingsCache::instance().getPictureDownloadsPerHost()),
+      picDownload(SettingsCache::instance().getPicDownload())
 {
+    fileIndex = new PictureFileIndex(this);
+    fileIndex->setCustomPicsPath(customPicsPath);
+    decodePool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    for (PictureBucket::Bucket bucket : {PictureBucket::Thumbnail, PictureBucket::Table}) {
+        QDir().mkpath(cachePath + PictureBucket::name(bucket));
+    }
+
     connect(this, SIGNAL(startLoadQueue()), this, SLOT(processLoadQueue()), Qt::QueuedConnection);
     connect(&SettingsCache::instance(), SIGNAL(picsPathChanged()), this, SLOT(picsPathChanged()));
     connect(&SettingsCache::instance(), SIGNAL(picDownloadChanged()), this, SLOT(picDownloadChanged()));
+    connect(&SettingsCache::instance(), SIGNAL(pictureCacheSizesChanged()), this, SLOT(pictureCacheSizesChanged()));
 
     networkManager = new QNetworkAccessManager(this);
     // We need a timeout to ensure requests don't hang indefinitely in case of
@@ -144,99 +218,337 @@ PictureLoaderWorker::~PictureLoaderWorker()
     pictureLoaderThread->deleteLater();
 }
 
-void PictureLoaderWorker::processLoadQueue()
+void PictureLoaderWorker::queueByPriority(QList<PictureToLoad> &queue, const PictureToLoad &pic, bool first)
 {
-    if (loadQueueRunning) {
-        return;
+    // after the pictures of a higher priority, and before or after the ones of the same
+    int index = 0;
+    while (index < queue.size() && (queue.at(index).getPriority() > pic.getPriority() ||
+                                    (!first && queue.at(index).getPriority() == pic.getPriority()))) {
+        ++index;
     }
+    queue.insert(index, pic);
+}
 
-    loadQueueRunning = true;
-    while (true) {
+void PictureLoaderWorker::makeVisible(QList<PictureToLoad> &queue, const CardInfoPtr &card)
+{
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue.at(i).getCard() == card) {
+            if (queue.at(i).getPriority() != PictureToLoad::Visible) {
+                PictureToLoad pic = queue.takeAt(i);
+                pic.setPriority(PictureToLoad::Visible);
+                queueByPriority(queue, pic, false);
+            }
+            return;
+        }
+    }
+}
+
+void PictureLoaderWorker::processLoadQueue()
+{
+    // keep every decoding thread busy, but leave the rest queued so cards coming on screen can still go first
+    while (diskLookupsRunning < decodePool.maxThreadCount()) {
         mutex.lock();
-        if (loadQueue.isEmpty()) {
+        if (loadQueue.isEmpty() || (loadQueue.first().getPriority() == PictureToLoad::Prefetch &&
+                                    prefetchLookupsRunning >= prefetchShare(decodePool.maxThreadCount()))) {
             mutex.unlock();
-            loadQueueRunning = false;
             return;
         }
-        cardBeingLoaded = loadQueue.takeFirst();
+        PictureToLoad pic = loadQueue.takeFirst();
         mutex.unlock();
 
-        QString setName = cardBeingLoaded.getSetName();
-        QString cardName = cardBeingLoaded.getCard()->getName();
-        QString correctedCardName = cardBeingLoaded.getCard()->getCorrectedName();
-
-        qDebug().nospace() << "PictureLoader: [card: " << cardName << " set: " << setName
+        qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
                            << "]: Trying to load picture";
 
-        if (cardImageExistsOnDisk(setName, correctedCardName)) {
+        QStringList paths = picturesOnDisk(pic);
+        const DecodeJob job = decodeJob(pic, paths.isEmpty() ? QString() : paths.first());
+        const QString cached = cachedPicture(job, paths);
+        if (!cached.isEmpty()) {
+            paths.prepend(cached);
+        }
+        if (paths.isEmpty()) {
+            diskLookupFinished(pic, QVector<QImage>());
             continue;
         }
 
-        qDebug().nospace() << "PictureLoader: [card: " << cardName << " set: " << setName
-                           << "]: No custom picture, trying to download";
-        cardsToDownload.append(cardBeingLoaded);
-        cardBeingLoaded.clear();
-        if (!downloadRunning) {
-            startNextPicDownload();
+        const bool prefetch = pic.getPriority() == PictureToLoad::Prefetch;
+        ++diskLookupsRunning;
+        prefetchLookupsRunning += prefetch ? 1 : 0;
+        auto *watcher = new QFutureWatcher<QVector<QImage>>(this);
+        connect(watcher, &QFutureWatcher<QVector<QImage>>::finished, this, [this, watcher, pic, prefetch]() {
+            --diskLookupsRunning;
+            prefetchLookupsRunning -= prefetch ? 1 : 0;
+            diskLookupFinished(pic, watcher->result());
+            watcher->deleteLater();
+            processLoadQueue();
+        });
+        watcher->setFuture(QtConcurrent::run(&decodePool, &PictureLoaderWorker::readFirstImage, paths, job));
+    }
+}
+
+QStringList PictureLoaderWorker::picturesOnDisk(const PictureToLoad &pic)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString setName = pic.getSetName();
+    const QString correctedCardName = pic.getCard()->getCorrectedName();
+
+    // Card found in the CUSTOM directory, somewhere
+    QStringList picsPaths = fileIndex->customPictures(correctedCardName);
+
+    if (!setName.isEmpty()) {
+        const QStringList setDirs = {picsPath + "/" + setName,
+                                     // We no longer store downloaded images there, but don't just ignore
+                                     // stuff that old versions have put there.
+                                     picsPath + "/downloadedPics/" + setName};
+        // the files with the desired name and any extension, then the same for the .full and .xlhq names
+        for (const QString &setDir : setDirs) {
+            for (const QString &suffix : {QString(), QString(".full"), QString(".xlhq")}) {
+                picsPaths << fileIndex->folderPictures(setDir, correctedCardName + suffix);
+            }
         }
     }
+
+    qDebug().nospace() << "PictureLoader: [card: " << correctedCardName << " set: " << setName << "]: "
+                       << picsPaths.size() << " candidate files on disk (lookup " << timer.nsecsElapsed() / 1000
+                       << " us)";
+    return picsPaths;
 }
 
-bool PictureLoaderWorker::cardImageExistsOnDisk(QString &setName, QString &correctedCardname)
+QString PictureLoaderWorker::cacheFile(const QString &cacheDir, PictureBucket::Bucket bucket, const QString &cacheKey)
 {
+    return cacheDir + PictureBucket::name(bucket) + "/" + cacheKey + ".png";
+}
+
+PictureLoaderWorker::DecodeJob PictureLoaderWorker::decodeJob(const PictureToLoad &pic, const QString &foundPath)
+{
+    mutex.lock();
+    const int buckets = cardsInProgress.value(pic.getCard());
+    mutex.unlock();
+
+    // decode up to the largest size asked for, the smaller ones get scaled from that
+    auto largest = PictureBucket::Thumbnail;
+    for (int bucket = PictureBucket::Thumbnail; bucket < PictureBucket::Count; ++bucket) {
+        if (buckets & (1 << bucket)) {
+            largest = static_cast<PictureBucket::Bucket>(bucket);
+        }
+    }
+
+    // pictures on disk are cached under their path, so after removing or replacing the file the old one is not used
+    QString cacheKey = pic.getCacheKey();
+    if (!cacheKey.isEmpty() && !foundPath.isEmpty()) {
+        cacheKey = QCryptographicHash::hash((cacheKey + "\n" + foundPath).toUtf8(), QCryptographicHash::Sha1).toHex();
+    }
+    return {largest, cachePath, cacheKey, pic.getCard()->getUpsideDownArt()};
+}
+
+QString PictureLoaderWorker::cachedPicture(const DecodeJob &job, const QStringList &paths)
+{
+    if (job.largest == PictureBucket::Full || job.cacheKey.isEmpty()) {
+        return QString();
+    }
+
+    // a picture put on disk after the cached copy was made replaces it
+    const QFileInfo cached(cacheFile(job.cacheDir, job.largest, job.cacheKey));
+    if (!cached.exists() || (!paths.isEmpty() && QFileInfo(paths.first()).lastModified() > cached.lastModified())) {
+        return QString();
+    }
+
+    // the cache is pruned by modification time, so a picture used again counts as new
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+    QFile file(cached.filePath());
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+#endif
+    return cached.filePath();
+}
+
+bool PictureLoaderWorker::decodeBuckets(QImageReader &reader, const DecodeJob &job, QVector<QImage> &buckets)
+{
+    // let the reader decode right at the size needed, for jpeg pictures that skips most of the work
+    const int maxHeight = PictureBucket::maxHeight(job.largest);
+    const QSize size = reader.size();
+    if (size.isValid() && size.height() > maxHeight) {
+        reader.setScaledSize(size.scaled(size.width(), maxHeight, Qt::KeepAspectRatio));
+    }
+
     QImage image;
+    if (!reader.read(&image)) {
+        return false;
+    }
+    // not every format knows its size up front or can decode at another one
+    if (image.height() > maxHeight) {
+        image = image.scaledToHeight(maxHeight, Qt::SmoothTransformation);
+    }
+
+    buckets = QVector<QImage>(PictureBucket::Count);
+    buckets[job.largest] = image;
+    for (int bucket = job.largest - 1; bucket >= PictureBucket::Thumbnail; --bucket) {
+        const QImage &larger = buckets.at(bucket + 1);
+        const int height = PictureBucket::maxHeight(static_cast<PictureBucket::Bucket>(bucket));
+        buckets[bucket] = larger.height() > height ? larger.scaledToHeight(height, Qt::SmoothTransformation) : larger;
+    }
+    return true;
+}
+
+void PictureLoaderWorker::finishBuckets(QVector<QImage> &buckets, const DecodeJob &job)
+{
+    if (!job.cacheKey.isEmpty()) {
+        for (PictureBucket::Bucket bucket : {PictureBucket::Thumbnail, PictureBucket::Table}) {
+            if (bucket > job.largest) {
+                continue;
+            }
+            // written next to the cached file and renamed over it, so a reader never sees half a picture
+            QSaveFile file(cacheFile(job.cacheDir, bucket, job.cacheKey));
+            if (file.open(QIODevice::WriteOnly) && buckets.at(bucket).save(&file, "PNG")) {
+                const qint64 size = file.size();
+                if (file.commit()) {
+                    diskCacheBytesWritten += size;
+                }
+            }
+        }
+    }
+
+    // the cache keeps the pictures the way they are on disk
+    if (job.mirrored) {
+        for (QImage &image : buckets) {
+            image = image.mirrored(true, true);
+        }
+    }
+}
+
+QVector<QImage> PictureLoaderWorker::readFirstImage(const QStringList &paths, const DecodeJob &job)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QImage> buckets;
+    for (const QString &path : paths) {
+        QImageReader imgReader(path);
+        imgReader.setDecideFormatFromContent(true);
+        if (decodeBuckets(imgReader, job, buckets)) {
+            qDebug().nospace() << "PictureLoader: Picture found on disk at " << path << " (decoded up to the "
+                               << PictureBucket::name(job.largest) << " size in " << timer.nsecsElapsed() / 1000
+                               << " us)";
+            DecodeJob finishing = job;
+            if (path == cacheFile(job.cacheDir, job.largest, job.cacheKey)) {
+                finishing.cacheKey.clear();
+            }
+            finishBuckets(buckets, finishing);
+            return buckets;
+        }
+    }
+    return QVector<QImage>();
+}
+
+QVector<QImage> PictureLoaderWorker::decodeImage(const QByteArray &data, const DecodeJob &job)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QVector<QImage> buckets;
     QImageReader imgReader;
     imgReader.setDecideFormatFromContent(true);
-    QList<QString> picsPaths = QList<QString>();
-    QDirIterator it(customPicsPath, QDirIterator::Subdirectories);
+    imgReader.setDevice(&buffer);
+    if (!decodeBuckets(imgReader, job, buckets)) {
+        return QVector<QImage>();
+    }
+    finishBuckets(buckets, job);
+    return buckets;
+}
 
-    // Recursively check all subdirectories of the CUSTOM folder
-    while (it.hasNext()) {
-        QString thisPath(it.next());
-        QFileInfo thisFileInfo(thisPath);
+void PictureLoaderWorker::pruneDiskCache(const QString &cacheDir, qint64 maxBytes)
+{
+    QFileInfoList files;
+    for (PictureBucket::Bucket bucket : {PictureBucket::Thumbnail, PictureBucket::Table}) {
+        files << QDir(cacheDir + PictureBucket::name(bucket)).entryInfoList(QDir::Files);
+    }
+    qint64 total = 0;
+    for (const QFileInfo &file : files) {
+        total += file.size();
+    }
+    if (total <= maxBytes) {
+        return;
+    }
 
-        if (thisFileInfo.isFile() &&
-            (thisFileInfo.fileName() == correctedCardname || thisFileInfo.completeBaseName() == correctedCardname ||
-             thisFileInfo.baseName() == correctedCardname)) {
-            picsPaths << thisPath; // Card found in the CUSTOM directory, somewhere
+    // the least recently used first, down to a tenth below the limit so this does not run again right away
+    std::sort(files.begin(), files.end(),
+              [](const QFileInfo &a, const QFileInfo &b) { return a.lastModified() < b.lastModified(); });
+    const qint64 target = maxBytes - maxBytes / 10;
+    int removed = 0;
+    for (const QFileInfo &file : files) {
+        if (total <= target) {
+            break;
+        }
+        if (QFile::remove(file.filePath())) {
+            total -= file.size();
+            ++removed;
         }
     }
+    qDebug().nospace() << "PictureLoader: Removed " << removed << " scaled pictures from the disk cache, "
+                       << total / (1024 * 1024) << " MB left";
+}
 
-    if (!setName.isEmpty()) {
-        picsPaths << picsPath + "/" + setName + "/" + correctedCardname
-                  // We no longer store downloaded images there, but don't just ignore
-                  // stuff that old versions have put there.
-                  << picsPath + "/downloadedPics/" + setName + "/" + correctedCardname;
-    }
-
-    // Iterates through the list of paths, searching for images with the desired
-    // name with any QImageReader-supported
-    // extension
-    for (const auto &picsPath : picsPaths) {
-        imgReader.setFileName(picsPath);
-        if (imgReader.read(&image)) {
-            qDebug().nospace() << "PictureLoader: [card: " << correctedCardname << " set: " << setName
-                               << "]: Picture found on disk.";
-            imageLoaded(cardBeingLoaded.getCard(), image);
-            return true;
-        }
-        imgReader.setFileName(picsPath + ".full");
-        if (imgReader.read(&image)) {
-            qDebug().nospace() << "PictureLoader: [card: " << correctedCardname << " set: " << setName
-                               << "]: Picture.full found on disk.";
-            imageLoaded(cardBeingLoaded.getCard(), image);
-            return true;
-        }
-        imgReader.setFileName(picsPath + ".xlhq");
-        if (imgReader.read(&image)) {
-            qDebug().nospace() << "PictureLoader: [card: " << correctedCardname << " set: " << setName
-                               << "]: Picture.xlhq found on disk.";
-            imageLoaded(cardBeingLoaded.getCard(), image);
-            return true;
+void PictureLoaderWorker::checkDiskCache()
+{
+    if (diskCachePruning || (diskCacheChecked && diskCacheBytesWritten < diskCacheLimit / 20)) {
+        return;
+    }
+    diskCacheChecked = true;
+    diskCachePruning = true;
+    diskCacheBytesWritten = 0;
+
+    auto *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher]() {
+        diskCachePruning = false;
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&PictureLoaderWorker::pruneDiskCache, cachePath, diskCacheLimit));
+}
+
+void PictureLoaderWorker::diskLookupFinished(PictureToLoad pic, const QVector<QImage> &buckets)
+{
+    if (!buckets.isEmpty()) {
+        finishLoad(pic, buckets);
+        return;
+    }
+
+    qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
+                       << "]: No custom picture, trying to download";
+    mutex.lock();
+    queueByPriority(cardsToDownload, pic, false);
+    mutex.unlock();
+    startPicDownloads();
+}
+
+void PictureLoaderWorker::finishLoad(const PictureToLoad &pic, const QVector<QImage> &buckets)
+{
+    const CardInfoPtr card = pic.getCard();
+    int loaded = 0;
+    for (int bucket = 0; bucket < buckets.size(); ++bucket) {
+        if (!buckets.at(bucket).isNull()) {
+            loaded |= 1 << bucket;
         }
     }
 
-    return false;
+    // larger sizes asked for while this one was decoding get loaded again, from where the picture was found
+    mutex.lock();
+    const int missing = loaded ? cardsInProgress.value(card) & ~loaded : 0;
+    if (missing) {
+        cardsInProgress.insert(card, missing);
+        queueByPriority(loadQueue, pic, true);
+    } else {
+        cardsInProgress.remove(card);
+    }
+    mutex.unlock();
+
+    imageLoaded(card, loaded ? buckets : QVector<QImage>(PictureBucket::Count));
+    if (missing) {
+        emit startLoadQueue();
+    }
+    checkDiskCache();
 }
 
 QString PictureToLoad::transformUrl(const QString &urlTemplate) const
@@ -366,49 +678,81 @@ QString PictureToLoad::transformUrl(const QString &urlTemplate) const
     return transformedUrl;
 }
 
-void PictureLoaderWorker::startNextPicDownload()
+void PictureLoaderWorker::startPicDownloads()
 {
-    if (cardsToDownload.isEmpty()) {
-        cardBeingDownloaded.clear();
-        downloadRunning = false;
-        return;
+    QList<PictureToLoad> withoutUrl;
+    int prefetchDownloads = 0;
+    for (const PictureToLoad &pic : runningDownloads) {
+        prefetchDownloads += pic.getPriority() == PictureToLoad::Prefetch ? 1 : 0;
     }
 
-    downloadRunning = true;
-
-    cardBeingDownloaded = cardsToDownload.takeFirst();
+    mutex.lock();
+    for (int i = 0; i < cardsToDownload.size() && runningDownloads.size() < maxDownloads;) {
+        // the visible cards come first, what is left is only prefetched
+        if (cardsToDownload.at(i).getPriority() == PictureToLoad::Prefetch &&
+            prefetchDownloads >= prefetchShare(maxDownloads)) {
+            break;
+        }
 
-    QString picUrl = cardBeingDownloaded.getCurrentUrl();
+        QString picUrl = cardsToDownload.at(i).getCurrentUrl();
+        if (picUrl.isEmpty()) {
+            withoutUrl.append(cardsToDownload.takeAt(i));
+            continue;
+        }
 
-    if (picUrl.isEmpty()) {
-        downloadRunning = false;
-        picDownloadFailed();
-    } else {
+        // leave the card queued while its host is busy, the ones after it may be elsewhere
         QUrl url(picUrl);
-        qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getCorrectedName()
-                           << " set: " << cardBeingDownloaded.getSetName() << "]: Trying to fetch picture from url "
+        if (runningDownloadsPerHost.value(url.host()) >= maxDownloadsPerHost) {
+            ++i;
+            continue;
+        }
+
+        PictureToLoad pic = cardsToDownload.takeAt(i);
+        prefetchDownloads += pic.getPriority() == PictureToLoad::Prefetch ? 1 : 0;
+        qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getCorrectedName()
+                           << " set: " << pic.getSetName() << "]: Trying to fetch picture from url "
                            << url.toDisplayString();
-        makeRequest(url);
+        startDownload(pic, url);
     }
+    mutex.unlock();
+
+    for (const PictureToLoad &pic : withoutUrl) {
+        picDownloadFailed(pic);
+    }
+}
+
+void PictureLoaderWorker::startDownload(const PictureToLoad &pic, const QUrl &url)
+{
+    QNetworkReply *reply = makeRequest(url);
+    runningDownloads.insert(reply, pic);
+    ++runningDownloadsPerHost[url.host()];
 }
 
-void PictureLoaderWorker::picDownloadFailed()
+PictureToLoad PictureLoaderWorker::takeDownload(QNetworkReply *reply)
+{
+    const QString host = reply->request().url().host();
+    if (--runningDownloadsPerHost[host] <= 0) {
+        runningDownloadsPerHost.remove(host);
+    }
+    return runningDownloads.take(reply);
+}
+
+void PictureLoaderWorker::picDownloadFailed(PictureToLoad pic)
 {
     /* Take advantage of short circuiting here to call the nextUrl until one
        is not available.  Only once nextUrl evaluates to false will this move
        on to nextSet.  If the Urls for a particular card are empty, this will
        effectively go through the sets for that card. */
-    if (cardBeingDownloaded.nextUrl() || cardBeingDownloaded.nextSet()) {
+    if (pic.nextUrl() || pic.nextSet()) {
         mutex.lock();
-        loadQueue.prepend(cardBeingDownloaded);
+        queueByPriority(loadQueue, pic, true);
         mutex.unlock();
     } else {
-        qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getCorrectedName()
-                           << " set: " << cardBeingDownloaded.getSetName() << "]: Picture NOT found, "
+        qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getCorrectedName()
+                           << " set: " << pic.getSetName() << "]: Picture NOT found, "
                            << (picDownload ? "download failed" : "downloads disabled")
                            << ", no more url combinations to try: BAILING OUT";
-        imageLoaded(cardBeingDownloaded.getCard(), QImage());
-        cardBeingDownloaded.clear();
+        finishLoad(pic, QVector<QImage>());
     }
     emit startLoadQueue();
 }
@@ -430,29 +774,27 @@ QNetworkReply *PictureLoaderWorker::makeRequest(const QUrl &url)
 
 void PictureLoaderWorker::picDownloadFinished(QNetworkReply *reply)
 {
+    PictureToLoad pic = takeDownload(reply);
+    reply->deleteLater();
     bool isFromCache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
 
     if (reply->error()) {
         if (isFromCache) {
-            qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getName()
-                               << " set: " << cardBeingDownloaded.getSetName()
+            qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
                                << "]: Removing corrupted cache file for url " << reply->url().toDisplayString()
                                << " and retrying (" << reply->errorString() << ")";
 
             networkManager->cache()->remove(reply->url());
 
-            makeRequest(reply->url());
+            startDownload(pic, reply->url());
         } else {
-            qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getName()
-                               << " set: " << cardBeingDownloaded.getSetName()
+            qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
                                << "]: " << (picDownload ? "Download" : "Cache search") << " failed for url "
                                << reply->url().toDisplayString() << " (" << reply->errorString() << ")";
 
-            picDownloadFailed();
-            startNextPicDownload();
+            picDownloadFailed(pic);
+            startPicDownloads();
         }
-
-        reply->deleteLater();
         return;
     }
 
@@ -461,73 +803,71 @@ void PictureLoaderWorker::picDownloadFinished(QNetworkReply *reply)
     if (statusCode == 301 || statusCode == 302 || statusCode == 303 || statusCode == 305 || statusCode == 307 ||
         statusCode == 308) {
         QUrl redirectUrl = reply->header(QNetworkRequest::LocationHeader).toUrl();
-        qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getName()
-                           << " set: " << cardBeingDownloaded.getSetName() << "]: following "
-                           << (isFromCache ? "cached redirect" : "redirect") << " to " << redirectUrl.toDisplayString();
-        makeRequest(redirectUrl);
-        reply->deleteLater();
+        qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
+                           << "]: following " << (isFromCache ? "cached redirect" : "redirect") << " to "
+                           << redirectUrl.toDisplayString();
+        startDownload(pic, redirectUrl);
         return;
     }
 
-    // peek is used to keep the data in the buffer for use by QImageReader
-    const QByteArray &picData = reply->peek(reply->size());
+    const QByteArray picData = reply->readAll();
 
     if (imageIsBlackListed(picData)) {
-        qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getName()
-                           << " set: " << cardBeingDownloaded.getSetName()
+        qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
                            << "]: Picture found, but blacklisted, will consider it as not found";
 
-        picDownloadFailed();
-        reply->deleteLater();
-        startNextPicDownload();
+        picDownloadFailed(pic);
+        startPicDownloads();
         return;
     }
 
-    QImage testImage;
-
-    QImageReader imgReader;
-    imgReader.setDecideFormatFromContent(true);
-    imgReader.setDevice(reply);
-
-    if (imgReader.read(&testImage)) {
-        imageLoaded(cardBeingDownloaded.getCard(), testImage);
-        qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getName()
-                           << " set: " << cardBeingDownloaded.getSetName() << "]: Image successfully "
-                           << (isFromCache ? "loaded from cached" : "downloaded from") << " url "
-                           << reply->url().toDisplayString();
-    } else {
-        qDebug().nospace() << "PictureLoader: [card: " << cardBeingDownloaded.getCard()->getName()
-                           << " set: " << cardBeingDownloaded.getSetName() << "]: Possible "
-                           << (isFromCache ? "cached" : "downloaded") << " picture at "
-                           << reply->url().toDisplayString() << " could not be loaded";
-
-        picDownloadFailed();
-    }
-
-    reply->deleteLater();
-    startNextPicDownload();
+    // decode on the pool, the next downloads need not wait for it
+    const QString source = QString("%1 url %2")
+                               .arg(isFromCache ? "loaded from cached" : "downloaded from")
+                               .arg(reply->url().toDisplayString());
+    auto *watcher = new QFutureWatcher<QVector<QImage>>(this);
+    connect(watcher, &QFutureWatcher<QVector<QImage>>::finished, this, [this, watcher, pic, source]() {
+        const QVector<QImage> buckets = watcher->result();
+        watcher->deleteLater();
+        if (buckets.isEmpty()) {
+            qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
+                               << "]: Possible picture " << source << " could not be loaded";
+            picDownloadFailed(pic);
+            return;
+        }
+        qDebug().nospace() << "PictureLoader: [card: " << pic.getCard()->getName() << " set: " << pic.getSetName()
+                           << "]: Image successfully " << source;
+        finishLoad(pic, buckets);
+    });
+    watcher->setFuture(
+        QtConcurrent::run(&decodePool, &PictureLoaderWorker::decodeImage, picData, decodeJob(pic, QString())));
+
+    startPicDownloads();
 }
 
-void PictureLoaderWorker::enqueueImageLoad(CardInfoPtr card)
+void PictureLoaderWorker::enqueueImageLoad(CardInfoPtr card,
+                                           PictureToLoad::Priority priority,
+                                           PictureBucket::Bucket bucket)
 {
     QMutexLocker locker(&mutex);
 
-    // avoid queueing the same card more than once
-    if (!card || card == cardBeingLoaded.getCard() || card == cardBeingDownloaded.getCard()) {
+    if (!card) {
         return;
     }
 
-    for (const PictureToLoad &pic : loadQueue) {
-        if (pic.getCard() == card)
-            return;
-    }
-
-    for (const PictureToLoad &pic : cardsToDownload) {
-        if (pic.getCard() == card)
-            return;
+    // avoid queueing the same card more than once, but do not leave a card now on screen behind prefetched ones
+    auto inProgress = cardsInProgress.find(card);
+    if (inProgress != cardsInProgress.end()) {
+        *inProgress |= 1 << bucket;
+        if (priority == PictureToLoad::Visible) {
+            makeVisible(loadQueue, card);
+            makeVisible(cardsToDownload, card);
+        }
+        return;
     }
 
-    loadQueue.append(PictureToLoad(card));
+    cardsInProgress.insert(card, 1 << bucket);
+    queueByPriority(loadQueue, PictureToLoad(card, priority), false);
     emit startLoadQueue();
 }
 
@@ -542,11 +882,26 @@ void PictureLoaderWorker::picsPathChanged()
     QMutexLocker locker(&mutex);
     picsPath = SettingsCache::instance().getPicsPath();
     customPicsPath = SettingsCache::instance().getCustomPicsPath();
+    fileIndex->setCustomPicsPath(customPicsPath);
+}
+
+void PictureLoaderWorker::pictureCacheSizesChanged()
+{
+    diskCacheLimit = SettingsCache::instance().getPictureDiskCacheSize() * 1024LL * 1024LL;
+    diskCacheChecked = false;
+    checkDiskCache();
 }
 
 void PictureLoaderWorker::clearNetworkCache()
 {
     networkManager->cache()->clear();
+
+    // the smaller sizes cached of the downloaded pictures would outlive them
+    QDir(cachePath).removeRecursively();
+    for (PictureBucket::Bucket bucket : {PictureBucket::Thumbnail, PictureBucket::Table}) {
+        QDir().mkpath(cachePath + PictureBucket::name(bucket));
+    }
+    diskCacheBytesWritten = 0;
 }
 
 PictureLoader::PictureLoader() : QObject(nullptr)
@@ -554,9 +909,11 @@ PictureLoader::PictureLoader() : QObject(nullptr)
     worker = new PictureLoaderWorker;
     connect(&SettingsCache::instance(), SIGNAL(picsPathChanged()), this, SLOT(picsPathChanged()));
     connect(&SettingsCache::instance(), SIGNAL(picDownloadChanged()), this, SLOT(picDownloadChanged()));
+    connect(&SettingsCache::instance(), &SettingsCache::pictureCacheSizesChanged, this,
+            &PictureLoader::pictureCacheSizesChanged);
+    pictureCacheSizesChanged();
 
-    connect(worker, SIGNAL(imageLoaded(CardInfoPtr, const QImage &)), this,
-            SLOT(imageLoaded(CardInfoPtr, const QImage &)));
+    connect(worker, &PictureLoaderWorker::imageLoaded, this, &PictureLoader::imageLoaded);
 }
 
 PictureLoader::~PictureLoader()
@@ -586,32 +943,52 @@ void PictureLoader::getPixmap(QPixmap &pixmap, CardInfoPtr card, QSize size)
     if (QPixmapCache::find(sizeKey, &pixmap))
         return;
 
-    // load the image and create a copy of the correct size
-    QPixmap bigPixmap;
-    if (QPixmapCache::find(key, &bigPixmap)) {
-        QScreen *screen = qApp->primaryScreen();
-        int dpr = screen->devicePixelRatio();
-        pixmap = bigPixmap.scaled(size * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        pixmap.setDevicePixelRatio(dpr);
-        QPixmapCache::insert(sizeKey, pixmap);
-        return;
+    // create a copy of the correct size from the smallest picture kept that is large enough
+    PictureLoader &loader = getInstance();
+    QScreen *screen = qApp->primaryScreen();
+    int dpr = screen->devicePixelRatio();
+    const PictureBucket::Bucket wanted = PictureBucket::forHeight(size.height() * dpr);
+    for (int bucket = wanted; bucket < PictureBucket::Count; ++bucket) {
+        const QPixmap *bucketPixmap = loader.bucketPixmaps[bucket].object(key);
+        if (bucketPixmap) {
+            if (!bucketPixmap->isNull()) {
+                pixmap = bucketPixmap->scaled(size * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                pixmap.setDevicePixelRatio(dpr);
+                QPixmapCache::insert(sizeKey, pixmap);
+            }
+            return;
+        }
+    }
+
+    // until then, show a smaller one if there is
+    for (int bucket = wanted - 1; bucket >= PictureBucket::Thumbnail; --bucket) {
+        const QPixmap *bucketPixmap = loader.bucketPixmaps[bucket].object(key);
+        if (bucketPixmap && !bucketPixmap->isNull()) {
+            pixmap = bucketPixmap->scaled(size * dpr, Qt::KeepAspectRatio, Qt::FastTransformation);
+            pixmap.setDevicePixelRatio(dpr);
+            break;
+        }
     }
 
     // add the card to the load queue
-    getInstance().worker->enqueueImageLoad(card);
+    loader.worker->enqueueImageLoad(card, PictureToLoad::Visible, wanted);
 }
 
-void PictureLoader::imageLoaded(CardInfoPtr card, const QImage &image)
+void PictureLoader::imageLoaded(CardInfoPtr card, const QVector<QImage> &buckets)
 {
-    if (image.isNull()) {
-        QPixmapCache::insert(card->getPixmapCacheKey(), QPixmap());
-    } else {
-        if (card->getUpsideDownArt()) {
-            QImage mirrorImage = image.mirrored(true, true);
-            QPixmapCache::insert(card->getPixmapCacheKey(), QPixmap::fromImage(mirrorImage));
-        } else {
-            QPixmapCache::insert(card->getPixmapCacheKey(), QPixmap::fromImage(image));
+    const bool found =
+        std::any_of(buckets.constBegin(), buckets.constEnd(), [](const QImage &image) { return !image.isNull(); });
+    const QString &key = card->getPixmapCacheKey();
+    for (int bucket = 0; bucket < qMin(static_cast<int>(buckets.size()), PictureBucket::Count); ++bucket) {
+        // only mark the sizes not loaded before as missing, a larger one may just have failed to load again
+        if (buckets.at(bucket).isNull() && (found || bucketPixmaps[bucket].contains(key))) {
+            continue;
         }
+
+        // the cost is in kB, the marker of a card without picture costs the least
+        auto *pixmap = new QPixmap(QPixmap::fromImage(buckets.at(bucket)));
+        const qint64 cost = static_cast<qint64>(pixmap->width()) * pixmap->height() * pixmap->depth() / 8 / 1024;
+        bucketPixmaps[bucket].insert(key, pixmap, static_cast<int>(qMax<qint64>(1, cost)));
     }
 
     card->emitPixmapUpdated();
@@ -620,12 +997,17 @@ void PictureLoader::imageLoaded(CardInfoPtr card, const QImage &image)
 void PictureLoader::clearPixmapCache(CardInfoPtr card)
 {
     if (card) {
-        QPixmapCache::remove(card->getPixmapCacheKey());
+        for (auto &pixmaps : getInstance().bucketPixmaps) {
+            pixmaps.remove(card->getPixmapCacheKey());
+        }
     }
 }
 
 void PictureLoader::clearPixmapCache()
 {
+    for (auto &pixmaps : getInstance().bucketPixmaps) {
+        pixmaps.clear();
+    }
     QPixmapCache::clear();
 }
 
@@ -636,7 +1018,27 @@ void PictureLoader::clearNetworkCache()
 
 void PictureLoader::cacheCardPixmaps(QList<CardInfoPtr> cards)
 {
-    QPixmap tmp;
+    // then the tokens and other cards these make or turn into, each card once
+    QSet<QString> names;
+    for (const CardInfoPtr &card : cards) {
+        if (card) {
+            names.insert(card->getName());
+        }
+    }
+    const int cardCount = cards.size();
+    for (int i = 0; i < cardCount; ++i) {
+        if (!cards.at(i)) {
+            continue;
+        }
+        for (const CardRelation *relation : cards.at(i)->getAllRelatedCards()) {
+            CardInfoPtr related = db->getCard(relation->getName());
+            if (related && !names.contains(related->getName())) {
+                names.insert(related->getName());
+                cards.append(related);
+            }
+        }
+    }
+
     int max = qMin(cards.size(), CACHED_CARD_PER_DECK_MAX);
     for (int i = 0; i < max; ++i) {
         const CardInfoPtr &card = cards.at(i);
@@ -644,21 +1046,28 @@ void PictureLoader::cacheCardPixmaps(QList<CardInfoPtr> cards)
             continue;
         }
 
-        QString key = card->getPixmapCacheKey();
-        if (QPixmapCache::find(key, &tmp)) {
+        if (getInstance().bucketPixmaps[PictureBucket::Table].contains(card->getPixmapCacheKey())) {
             continue;
         }
 
-        getInstance().worker->enqueueImageLoad(card);
+        getInstance().worker->enqueueImageLoad(card, PictureToLoad::Prefetch, PictureBucket::Table);
     }
 }
 
 void PictureLoader::picDownloadChanged()
 {
-    QPixmapCache::clear();
+    clearPixmapCache();
 }
 
 void PictureLoader::picsPathChanged()
 {
-    QPixmapCache::clear();
+    clearPixmapCache();
+}
+
+void PictureLoader::pictureCacheSizesChanged()
+{
+    // translate MBs to kBs
+    bucketPixmaps[PictureBucket::Thumbnail].setMaxCost(SettingsCache::instance().getThumbnailCacheSize() * 1024);
+    bucketPixmaps[PictureBucket::Table].setMaxCost(SettingsCache::instance().getTablePictureCacheSize() * 1024);
+    bucketPixmaps[PictureBucket::Full].setMaxCost(SettingsCache::instance().getFullPictureCacheSize() * 1024);
 }
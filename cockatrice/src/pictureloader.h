@@ -3,16 +3,53 @@
 
 #include "carddatabase.h"
 
+#include <QCache>
+#include <QHash>
+#include <QImage>
 #include <QList>
 #include <QMap>
 #include <QMutex>
 #include <QNetworkRequest>
+#include <QPixmap>
+#include <QThreadPool>
+#include <QVector>
+class PictureFileIndex;
+class QImageReader;
 class QNetworkAccessManager;
 class QNetworkReply;
 class QThread;
 
+/**
+ * The sizes card pictures are kept in. All but Full, the picture as loaded, hold it scaled down to a fixed height, so
+ * cards are painted from the smallest size at least as tall as them instead of from the full picture. The smaller
+ * ones are decoded at that size right away, and also cached on disk.
+ */
+class PictureBucket
+{
+public:
+    enum Bucket
+    {
+        Thumbnail,
+        Table,
+        Full
+    };
+    static constexpr int Count = Full + 1;
+
+    static int maxHeight(Bucket bucket);
+    static Bucket forHeight(int height);
+    static QString name(Bucket bucket);
+};
+
 class PictureToLoad
 {
+public:
+    // pictures of cards on screen are loaded before the ones only fetched ahead of time
+    enum Priority
+    {
+        Prefetch,
+        Visible
+    };
+
 private:
     class SetDownloadPriorityComparator
     {
@@ -38,14 +75,30 @@ private:
     QList<QString> currentSetUrls;
     QString currentUrl;
     CardSetPtr currentSet;
+    Priority priority;
+    QString cacheKey;
 
 public:
-    explicit PictureToLoad(CardInfoPtr _card = CardInfoPtr());
+    explicit PictureToLoad(CardInfoPtr _card = CardInfoPtr(), Priority _priority = Visible);
 
     CardInfoPtr getCard() const
     {
         return card;
     }
+    Priority getPriority() const
+    {
+        return priority;
+    }
+    void setPriority(Priority _priority)
+    {
+        priority = _priority;
+    }
+    // names the cached smaller sizes of the downloaded picture, after the card, its preferred set, the id of its
+    // printing and the urls it is downloaded from
+    QString getCacheKey() const
+    {
+        return cacheKey;
+    }
     void clear()
     {
         card.clear();
@@ -72,37 +125,80 @@ public:
     explicit PictureLoaderWorker();
     ~PictureLoaderWorker() override;
 
-    void enqueueImageLoad(CardInfoPtr card);
+    void enqueueImageLoad(CardInfoPtr card,
+                          PictureToLoad::Priority priority = PictureToLoad::Visible,
+                          PictureBucket::Bucket bucket = PictureBucket::Full);
     void clearNetworkCache();
 
 private:
+    // how to decode a picture: up to which size, where its smaller sizes are cached and whether it is upside down
+    struct DecodeJob
+    {
+        PictureBucket::Bucket largest;
+        QString cacheDir;
+        // empty to not write the smaller sizes to the cache
+        QString cacheKey;
+        bool mirrored;
+    };
+
     static QStringList md5Blacklist;
 
     QThread *pictureLoaderThread;
-    QString picsPath, customPicsPath;
-    QList<PictureToLoad> loadQueue;
-    QMutex mutex;
+    QString picsPath, customPicsPath, cachePath;
+    PictureFileIndex *fileIndex;
+    // reads and decodes the pictures found on disk or downloaded, so several are decoded at once
+    QThreadPool decodePool;
+    int diskLookupsRunning, prefetchLookupsRunning;
+    // the space the cached smaller sizes may take on disk, checked again once enough has been written
+    qint64 diskCacheLimit;
+    bool diskCacheChecked, diskCachePruning;
     QNetworkAccessManager *networkManager;
+    int maxDownloads, maxDownloadsPerHost;
+    QHash<QNetworkReply *, PictureToLoad> runningDownloads;
+    QHash<QString, int> runningDownloadsPerHost;
+    bool picDownload;
+
+    // guards the queues below, which cards get added to from the gui thread
+    QMutex mutex;
+    // waiting for a look on disk, and for a download: visible cards first, each group in order
+    QList<PictureToLoad> loadQueue;
     QList<PictureToLoad> cardsToDownload;
-    PictureToLoad cardBeingLoaded;
-    PictureToLoad cardBeingDownloaded;
-    bool picDownload, downloadRunning, loadQueueRunning;
-    void startNextPicDownload();
-    bool cardImageExistsOnDisk(QString &setName, QString &correctedCardName);
+    // every card from being queued until its picture is delivered, to queue it only once, with the sizes asked for
+    QHash<CardInfoPtr, int> cardsInProgress;
+
+    static void queueByPriority(QList<PictureToLoad> &queue, const PictureToLoad &pic, bool first);
+    static void makeVisible(QList<PictureToLoad> &queue, const CardInfoPtr &card);
+    static QString cacheFile(const QString &cacheDir, PictureBucket::Bucket bucket, const QString &cacheKey);
+    QStringList picturesOnDisk(const PictureToLoad &pic);
+    DecodeJob decodeJob(const PictureToLoad &pic, const QString &foundPath);
+    QString cachedPicture(const DecodeJob &job, const QStringList &paths);
+    static bool decodeBuckets(QImageReader &reader, const DecodeJob &job, QVector<QImage> &buckets);
+    static void finishBuckets(QVector<QImage> &buckets, const DecodeJob &job);
+    static QVector<QImage> readFirstImage(const QStringList &paths, const DecodeJob &job);
+    static QVector<QImage> decodeImage(const QByteArray &data, const DecodeJob &job);
+    static void pruneDiskCache(const QString &cacheDir, qint64 maxBytes);
+    void checkDiskCache();
+    void diskLookupFinished(PictureToLoad pic, const QVector<QImage> &buckets);
+    void startPicDownloads();
+    void startDownload(const PictureToLoad &pic, const QUrl &url);
+    PictureToLoad takeDownload(QNetworkReply *reply);
+    void picDownloadFailed(PictureToLoad pic);
+    void finishLoad(const PictureToLoad &pic, const QVector<QImage> &buckets);
     bool imageIsBlackListed(const QByteArray &);
     QNetworkReply *makeRequest(const QUrl &url);
 private slots:
     void picDownloadFinished(QNetworkReply *reply);
-    void picDownloadFailed();
 
     void picDownloadChanged();
     void picsPathChanged();
+    void pictureCacheSizesChanged();
 public slots:
     void processLoadQueue();
 
 signals:
     void startLoadQueue();
-    void imageLoaded(CardInfoPtr card, const QImage &image);
+    // one picture per bucket, the ones not loaded null; all of them null when the card has no picture at all
+    void imageLoaded(CardInfoPtr card, const QVector<QImage> &buckets);
 };
 
 class PictureLoader : public QObject
@@ -123,12 +219,16 @@ private:
     void operator=(PictureLoader const &);
 
     PictureLoaderWorker *worker;
+    // the pictures of each bucket by card, the least recently used dropped beyond the memory set for the bucket;
+    // a null pixmap marks a card without picture
+    QCache<QString, QPixmap> bucketPixmaps[PictureBucket::Count];
 
 public:
     static void getPixmap(QPixmap &pixmap, CardInfoPtr card, QSize size);
     static void getCardBackPixmap(QPixmap &pixmap, QSize size);
     static void clearPixmapCache(CardInfoPtr card);
     static void clearPixmapCache();
+    // loads the pictures of cards likely to be shown soon, and of their related cards, behind the ones on screen
     static void cacheCardPixmaps(QList<CardInfoPtr> cards);
 
 public slots:
@@ -137,8 +237,9 @@ public slots:
 private slots:
     void picDownloadChanged();
     void picsPathChanged();
+    void pictureCacheSizesChanged();
 
 public slots:
-    void imageLoaded(CardInfoPtr card, const QImage &image);
+    void imageLoaded(CardInfoPtr card, const QVector<QImage> &buckets);
 };
 #endif
@@ -13,6 +13,7 @@
 #include "pb/session_commands.pb.h"
 #include "pending_command.h"
 #include "settingscache.h"
+#include "stream_compression.h"
 #include "version_string.h"
 
 #include <QCryptographicHash>
@@ -27,8 +28,9 @@
 static const unsigned int protocolVersion = 14;
 
 RemoteClient::RemoteClient(QObject *parent)
-    : AbstractClient(parent), timeRunning(0), lastDataReceived(0), messageInProgress(false), handshakeStarted(false),
-      usingWebSocket(false), messageLength(0), hashedPassword()
+    : AbstractClient(parent), timeRunning(0), lastDataReceived(0), messageInProgress(false), messageCompressed(false),
+      handshakeStarted(false), usingWebSocket(false), serverSupportsStreamCompression(false), messageLength(0),
+      inputDecompressor(nullptr), hashedPassword()
 {
 
     clearNewClientFeatures();
@@ -117,6 +119,10 @@ void RemoteClient::processServerIdentificationEvent(const Event_ServerIdentifica
         return;
     }
     serverSupportsPasswordHash = event.server_options() & Event_ServerIdentification::SupportsPasswordHash;
+    // compressed frames are only defined for the tcp stream
+    serverSupportsStreamCompression =
+        !usingWebSocket && StreamCompressor::isAvailable() &&
+        event.stream_compression() == Event_ServerIdentification::DeflateStreamCompression;
 
     if (getStatus() == StatusRequestingForgotPassword) {
         Command_ForgotPasswordRequest cmdForgotPasswordRequest;
@@ -219,8 +225,12 @@ Command_Login RemoteClient::generateCommandLogin()
 
     if (!clientFeatures.isEmpty()) {
         QMap<QString, bool>::iterator i;
-        for (i = clientFeatures.begin(); i != clientFeatures.end(); ++i)
+        for (i = clientFeatures.begin(); i != clientFeatures.end(); ++i) {
+            // asking for compression makes the server start compressing, so only do it when it was offered
+            if (i.key() == "stream_compression" && !serverSupportsStreamCompression)
+                continue;
             cmdLogin.add_clientfeatures(i.key().toStdString().c_str());
+        }
     }
 
     return cmdLogin;
@@ -377,10 +387,12 @@ void RemoteClient::readData()
                     }
                 } else {
                     // end of hack
-                    messageLength = (((quint32)(unsigned char)inputBuffer[0]) << 24) +
-                                    (((quint32)(unsigned char)inputBuffer[1]) << 16) +
-                                    (((quint32)(unsigned char)inputBuffer[2]) << 8) +
-                                    ((quint32)(unsigned char)inputBuffer[3]);
+                    const quint32 frameHeader = (((quint32)(unsigned char)inputBuffer[0]) << 24) +
+                                                (((quint32)(unsigned char)inputBuffer[1]) << 16) +
+                                                (((quint32)(unsigned char)inputBuffer[2]) << 8) +
+                                                ((quint32)(unsigned char)inputBuffer[3]);
+                    messageCompressed = frameHeader & StreamCompressedFrameFlag;
+                    messageLength = static_cast<int>(frameHeader & ~StreamCompressedFrameFlag);
                     inputBuffer.remove(0, 4);
                     messageInProgress = true;
                 }
@@ -391,7 +403,20 @@ void RemoteClient::readData()
             return;
 
         ServerMessage newServerMessage;
-        newServerMessage.ParseFromArray(inputBuffer.data(), messageLength);
+        if (messageCompressed) {
+            if (!inputDecompressor)
+                inputDecompressor = new StreamDecompressor;
+            QByteArray message;
+            if (!inputDecompressor->decompress(inputBuffer.constData(), messageLength, message)) {
+                qWarning() << "Corrupt compressed message received, disconnecting";
+                inputBuffer.clear();
+                doDisconnectFromServer();
+                return;
+            }
+            newServerMessage.ParseFromArray(message.constData(), message.size());
+        } else {
+            newServerMessage.ParseFromArray(inputBuffer.data(), messageLength);
+        }
 #ifdef QT_DEBUG
         qDebug().noquote() << "IN" << getSafeDebugString(newServerMessage);
 #endif
@@ -510,8 +535,12 @@ void RemoteClient::doDisconnectFromServer()
     timer->stop();
 
     messageInProgress = false;
+    messageCompressed = false;
     handshakeStarted = false;
     messageLength = 0;
+    // the next connection starts a new compressed stream
+    delete inputDecompressor;
+    inputDecompressor = nullptr;
 
     QList<PendingCommand *> pc = pendingCommands.values();
     for (const auto &i : pc) {
@@ -8,6 +8,7 @@
 #include <QWebSocket>
 
 class QTimer;
+class StreamDecompressor;
 
 class RemoteClient : public AbstractClient
 {
@@ -93,9 +94,12 @@ private:
     int timeRunning, lastDataReceived;
     QByteArray inputBuffer;
     bool messageInProgress;
+    bool messageCompressed;
     bool handshakeStarted;
     bool usingWebSocket;
+    bool serverSupportsStreamCompression;
     int messageLength;
+    StreamDecompressor *inputDecompressor;
     QTimer *timer;
     QTcpSocket *socket;
     QWebSocket *websocket;
@@ -39,6 +39,11 @@ QString SettingsCache::getNetworkCachePath() const
     return getCachePath() + "/downloaded/";
 }
 
+QString SettingsCache::getPictureCachePath() const
+{
+    return getCachePath() + "/pictures/";
+}
+
 void SettingsCache::translateLegacySettings()
 {
     if (isPortableBuild)
@@ -221,6 +226,30 @@ SettingsCache::SettingsCache()
 
     networkCacheSize = settings->value("personal/networkCacheSize", NETWORK_CACHE_SIZE_DEFAULT).toInt();
 
+    thumbnailCacheSize = settings->value("personal/thumbnailCacheSize", THUMBNAIL_CACHE_SIZE_DEFAULT).toInt();
+    tablePictureCacheSize =
+        settings->value("personal/tablePictureCacheSize", TABLE_PICTURE_CACHE_SIZE_DEFAULT).toInt();
+    fullPictureCacheSize = settings->value("personal/fullPictureCacheSize", FULL_PICTURE_CACHE_SIZE_DEFAULT).toInt();
+    // sanity check
+    if (thumbnailCacheSize < PICTURE_CACHE_SIZE_MIN || thumbnailCacheSize > PICTURE_CACHE_SIZE_MAX)
+        thumbnailCacheSize = THUMBNAIL_CACHE_SIZE_DEFAULT;
+    if (tablePictureCacheSize < PICTURE_CACHE_SIZE_MIN || tablePictureCacheSize > PICTURE_CACHE_SIZE_MAX)
+        tablePictureCacheSize = TABLE_PICTURE_CACHE_SIZE_DEFAULT;
+    if (fullPictureCacheSize < PICTURE_CACHE_SIZE_MIN || fullPictureCacheSize > PICTURE_CACHE_SIZE_MAX)
+        fullPictureCacheSize = FULL_PICTURE_CACHE_SIZE_DEFAULT;
+    pictureDiskCacheSize = settings->value("personal/pictureDiskCacheSize", PICTURE_DISK_CACHE_SIZE_DEFAULT).toInt();
+    if (pictureDiskCacheSize < PICTURE_DISK_CACHE_SIZE_MIN || pictureDiskCacheSize > PICTURE_DISK_CACHE_SIZE_MAX)
+        pictureDiskCacheSize = PICTURE_DISK_CACHE_SIZE_DEFAULT;
+
+    pictureDownloadsMax = settings->value("personal/pictureDownloadsMax", PICTURE_DOWNLOADS_MAX_DEFAULT).toInt();
+    pictureDownloadsPerHost =
+        settings->value("personal/pictureDownloadsPerHost", PICTURE_DOWNLOADS_PER_HOST_DEFAULT).toInt();
+    // sanity check
+    if (pictureDownloadsMax < 1)
+        pictureDownloadsMax = PICTURE_DOWNLOADS_MAX_DEFAULT;
+    if (pictureDownloadsPerHost < 1)
+        pictureDownloadsPerHost = PICTURE_DOWNLOADS_PER_HOST_DEFAULT;
+
     picDownload = settings->value("personal/picturedownload", true).toBool();
 
     mainWindowGeometry = settings->value("interface/main_window_geometry").toByteArray();
@@ -631,6 +660,34 @@ void SettingsCache::setNetworkCacheSizeInMB(const int _networkCacheSize)
     emit networkCacheSizeChanged(networkCacheSize);
 }
 
+void SettingsCache::setThumbnailCacheSize(const int _thumbnailCacheSize)
+{
+    thumbnailCacheSize = _thumbnailCacheSize;
+    settings->setValue("personal/thumbnailCacheSize", thumbnailCacheSize);
+    emit pictureCacheSizesChanged();
+}
+
+void SettingsCache::setTablePictureCacheSize(const int _tablePictureCacheSize)
+{
+    tablePictureCacheSize = _tablePictureCacheSize;
+    settings->setValue("personal/tablePictureCacheSize", tablePictureCacheSize);
+    emit pictureCacheSizesChanged();
+}
+
+void SettingsCache::setFullPictureCacheSize(const int _fullPictureCacheSize)
+{
+    fullPictureCacheSize = _fullPictureCacheSize;
+    settings->setValue("personal/fullPictureCacheSize", fullPictureCacheSize);
+    emit pictureCacheSizesChanged();
+}
+
+void SettingsCache::setPictureDiskCacheSize(const int _pictureDiskCacheSize)
+{
+    pictureDiskCacheSize = _pictureDiskCacheSize;
+    settings->setValue("personal/pictureDiskCacheSize", pictureDiskCacheSize);
+    emit pictureCacheSizesChanged();
+}
+
 void SettingsCache::setClientID(const QString &_clientID)
 {
     clientID = _clientID;
@@ -25,6 +25,22 @@ constexpr int NETWORK_CACHE_SIZE_DEFAULT = 1024 * 4; // 4 GB
 constexpr int NETWORK_CACHE_SIZE_MIN = 1;            // 1 MB
 constexpr int NETWORK_CACHE_SIZE_MAX = 1024 * 1024;  // 1 TB
 
+// In MB, the memory kept for the pictures of each size
+constexpr int THUMBNAIL_CACHE_SIZE_DEFAULT = 64;
+constexpr int TABLE_PICTURE_CACHE_SIZE_DEFAULT = 256;
+constexpr int FULL_PICTURE_CACHE_SIZE_DEFAULT = 512;
+constexpr int PICTURE_CACHE_SIZE_MIN = 8;
+constexpr int PICTURE_CACHE_SIZE_MAX = 2047;
+
+// In MB, the disk space for the smaller sizes of the pictures, saved so they need not be scaled down again
+constexpr int PICTURE_DISK_CACHE_SIZE_DEFAULT = 1024;
+constexpr int PICTURE_DISK_CACHE_SIZE_MIN = 16;
+constexpr int PICTURE_DISK_CACHE_SIZE_MAX = 1024 * 1024;
+
+// picture downloads running at once, in total and from a single host
+constexpr int PICTURE_DOWNLOADS_MAX_DEFAULT = 6;
+constexpr int PICTURE_DOWNLOADS_PER_HOST_DEFAULT = 2;
+
 #define DEFAULT_LANG_NAME "English"
 #define CLIENT_INFO_NOT_SET "notset"
 
@@ -52,6 +68,7 @@ signals:
     void ignoreUnregisteredUserMessagesChanged();
     void pixmapCacheSizeChanged(int newSizeInMBs);
     void networkCacheSizeChanged(int newSizeInMBs);
+    void pictureCacheSizesChanged();
     void masterVolumeChanged(int value);
     void chatMentionCompleterChanged();
     void downloadSpoilerTimeIndexChanged();
@@ -113,6 +130,12 @@ private:
     bool useTearOffMenus;
     int pixmapCacheSize;
     int networkCacheSize;
+    int thumbnailCacheSize;
+    int tablePictureCacheSize;
+    int fullPictureCacheSize;
+    int pictureDiskCacheSize;
+    int pictureDownloadsMax;
+    int pictureDownloadsPerHost;
     bool scaleCards;
     bool showMessagePopups;
     bool showMentionPopups;
@@ -146,6 +169,7 @@ public:
     QString getSettingsPath();
     QString getCachePath() const;
     QString getNetworkCachePath() const;
+    QString getPictureCachePath() const;
     const QByteArray &getMainWindowGeometry() const
     {
         return mainWindowGeometry;
@@ -343,6 +367,30 @@ public:
     {
         return networkCacheSize;
     }
+    int getThumbnailCacheSize() const
+    {
+        return thumbnailCacheSize;
+    }
+    int getTablePictureCacheSize() const
+    {
+        return tablePictureCacheSize;
+    }
+    int getFullPictureCacheSize() const
+    {
+        return fullPictureCacheSize;
+    }
+    int getPictureDiskCacheSize() const
+    {
+        return pictureDiskCacheSize;
+    }
+    int getPictureDownloadsMax() const
+    {
+        return pictureDownloadsMax;
+    }
+    int getPictureDownloadsPerHost() const
+    {
+        return pictureDownloadsPerHost;
+    }
     bool getScaleCards() const
     {
         return scaleCards;
@@ -534,6 +582,10 @@ public slots:
     void setIgnoreUnregisteredUserMessages(int _ignoreUnregisteredUserMessages);
     void setPixmapCacheSize(const int _pixmapCacheSize);
     void setNetworkCacheSizeInMB(const int _networkCacheSize);
+    void setThumbnailCacheSize(const int _thumbnailCacheSize);
+    void setTablePictureCacheSize(const int _tablePictureCacheSize);
+    void setFullPictureCacheSize(const int _fullPictureCacheSize);
+    void setPictureDiskCacheSize(const int _pictureDiskCacheSize);
     void setCardScaling(const int _scaleCards);
     void setShowMessagePopups(const int _showMessagePopups);
     void setShowMentionPopups(const int _showMentionPopups);
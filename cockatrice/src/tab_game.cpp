@@ -30,6 +30,7 @@
 #include "pb/context_connection_state_changed.pb.h"
 #include "pb/context_deck_select.pb.h"
 #include "pb/context_ping_changed.pb.h"
+#include "pb/event_create_token.pb.h"
 #include "pb/event_game_closed.pb.h"
 #include "pb/event_game_host_changed.pb.h"
 #include "pb/event_game_joined.pb.h"
@@ -38,6 +39,7 @@
 #include "pb/event_join.pb.h"
 #include "pb/event_kicked.pb.h"
 #include "pb/event_leave.pb.h"
+#include "pb/event_move_card.pb.h"
 #include "pb/event_player_properties_changed.pb.h"
 #include "pb/event_reverse_turn.pb.h"
 #include "pb/event_set_active_phase.pb.h"
@@ -74,6 +76,20 @@
 #include <QWidget>
 #include <google/protobuf/descriptor.h>
 
+// the cards of a player known from a game state, the ones in play and in the other zones, and the ones in the deck
+// when it is sent along
+static void addPlayerCardNames(const ServerInfo_Player &playerInfo, QStringList &zoneCards, QStringList &deckCards)
+{
+    for (const ServerInfo_Zone &zone : playerInfo.zone_list()) {
+        for (const ServerInfo_Card &card : zone.card_list()) {
+            if (!card.name().empty())
+                zoneCards.append(QString::fromStdString(card.name()));
+        }
+    }
+    if (playerInfo.has_deck_list())
+        deckCards.append(DeckLoader(QString::fromStdString(playerInfo.deck_list())).getCardList());
+}
+
 ToggleButton::ToggleButton(QWidget *parent) : QPushButton(parent), state(false)
 {
 }
@@ -387,6 +403,25 @@ TabGame::TabGame(TabSupervisor *_tabSupervisor, GameReplay *_replay)
         i += numberEventsThisSecond - 1;
     }
 
+    // every card that shows up in the replay, so jumping around in it finds their pictures loaded
+    QStringList zoneCards, deckCards;
+    for (const GameEventContainer &container : replay->event_list()) {
+        for (const GameEvent &event : container.event_list()) {
+            if (event.HasExtension(Event_GameStateChanged::ext)) {
+                const Event_GameStateChanged &state = event.GetExtension(Event_GameStateChanged::ext);
+                for (const ServerInfo_Player &playerInfo : state.player_list())
+                    addPlayerCardNames(playerInfo, zoneCards, deckCards);
+            } else if (event.HasExtension(Event_MoveCard::ext)) {
+                zoneCards.append(QString::fromStdString(event.GetExtension(Event_MoveCard::ext).card_name()));
+            } else if (event.HasExtension(Event_CreateToken::ext)) {
+                zoneCards.append(QString::fromStdString(event.GetExtension(Event_CreateToken::ext).card_name()));
+            }
+        }
+    }
+    zoneCards.append(deckCards);
+    zoneCards.removeDuplicates();
+    PictureLoader::cacheCardPixmaps(db->getCards(zoneCards));
+
     createCardInfoDock(true);
     createPlayerListDock(true);
     createMessageDock(true);
@@ -1087,7 +1122,6 @@ void TabGame::eventGameStateChanged(const Event_GameStateChanged &event,
                 DeckViewContainer *deckViewContainer = deckViewContainers.value(playerId);
                 if (playerInfo.has_deck_list()) {
                     DeckLoader newDeck(QString::fromStdString(playerInfo.deck_list()));
-                    PictureLoader::cacheCardPixmaps(db->getCards(newDeck.getCardList()));
                     deckViewContainer->setDeck(newDeck);
                     player->setDeck(newDeck);
                 }
@@ -1107,6 +1141,14 @@ void TabGame::eventGameStateChanged(const Event_GameStateChanged &event,
         }
     }
 
+    // the cards already out when joining or resuming the game first, then the ones of our deck
+    QStringList zoneCards, deckCards;
+    for (const ServerInfo_Player &playerInfo : event.player_list())
+        addPlayerCardNames(playerInfo, zoneCards, deckCards);
+    zoneCards.append(deckCards);
+    zoneCards.removeDuplicates();
+    PictureLoader::cacheCardPixmaps(db->getCards(zoneCards));
+
     secondsElapsed = event.seconds_elapsed();
 
     if (event.game_started() && !gameInfo.started()) {
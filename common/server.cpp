@@ -37,10 +37,13 @@
 #include "server_room.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
 #include <QThread>
 
-Server::Server(QObject *parent) : QObject(parent), nextLocalGameId(0), tcpUserCount(0), webSocketUserCount(0)
+Server::Server(QObject *parent)
+    : QObject(parent), nextLocalGameId(0), tcpUserCount(0), webSocketUserCount(0), usersCount(0), gamesCount(0),
+      userListVersion(static_cast<quint64>(QDateTime::currentSecsSinceEpoch()) << 24)
 {
     qRegisterMetaType<ServerInfo_Ban>("ServerInfo_Ban");
     qRegisterMetaType<ServerInfo_Game>("ServerInfo_Game");
@@ -51,6 +54,7 @@ Server::Server(QObject *parent) : QObject(parent), nextLocalGameId(0), tcpUserCo
     qRegisterMetaType<GameEventContainer>("GameEventContainer");
     qRegisterMetaType<IslMessage>("IslMessage");
     qRegisterMetaType<Command_JoinGame>("Command_JoinGame");
+    qRegisterMetaType<Event_ServerCompleteList>("Event_ServerCompleteList");
 
     connect(this, SIGNAL(sigSendIslMessage(IslMessage, int)), this, SLOT(doSendIslMessage(IslMessage, int)),
             Qt::QueuedConnection);
@@ -153,6 +157,8 @@ AuthenticationResult Server::loginUser(Server_ProtocolHandler *session,
     QWriteLocker locker(&clientsLock);
     databaseInterface->lockSessionTables();
     users.insert(name, session);
+    usersCount.store(users.size(), std::memory_order_relaxed);
+    userListChanged(name);
     qDebug() << "Server::loginUser:" << session << "name=" << name;
 
     data.set_session_id(static_cast<google::protobuf::uint64>(
@@ -165,11 +171,16 @@ AuthenticationResult Server::loginUser(Server_ProtocolHandler *session,
     session->setUserInfo(data);
 
     Event_UserJoined event;
-    event.mutable_user_info()->CopyFrom(session->copyUserInfo(false));
+    session->copyUserInfo(*event.mutable_user_info(), false);
     SessionEvent *se = Server_ProtocolHandler::prepareSessionEvent(event);
-    for (auto &client : clients)
-        if (client->getAcceptsUserListChanges())
+    int recipients = 0;
+    for (auto &client : clients) {
+        if (client->getAcceptsUserListChanges()) {
             client->sendProtocolItem(*se);
+            ++recipients;
+        }
+    }
+    metrics.broadcastSent(ServerMetrics::SessionBroadcast, recipients);
     delete se;
 
     event.mutable_user_info()->CopyFrom(session->copyUserInfo(true, true, true));
@@ -216,6 +227,34 @@ Server_AbstractUserInterface *Server::findUser(const QString &userName) const
         return externalUsers.value(userName);
 }
 
+void Server::userListChanged(const QString &userName)
+{
+    userListChanges.append({++userListVersion, userName});
+    if (userListChanges.size() > maxUserListChanges)
+        userListChanges.removeFirst();
+}
+
+void Server::userInfoChanged(const QString &userName)
+{
+    QWriteLocker locker(&clientsLock);
+    if (users.contains(userName))
+        userListChanged(userName);
+}
+
+bool Server::getUserListChanges(quint64 sinceVersion, QSet<QString> &result) const
+{
+    // Call this only with clientsLock set.
+    if (sinceVersion > userListVersion)
+        return false;
+    if (sinceVersion < userListVersion &&
+        (userListChanges.isEmpty() || userListChanges.first().version > sinceVersion + 1))
+        return false;
+
+    for (auto it = userListChanges.crbegin(); it != userListChanges.crend() && it->version > sinceVersion; ++it)
+        result.insert(it->userName);
+    return true;
+}
+
 void Server::addClient(Server_ProtocolHandler *client)
 {
     if (client->getConnectionType() == "tcp")
@@ -244,18 +283,25 @@ void Server::removeClient(Server_ProtocolHandler *client)
 
     QWriteLocker locker(&clientsLock);
     clients.removeAt(clientIndex);
-    ServerInfo_User *data = client->getUserInfo();
+    const ServerInfo_User_Ptr data = client->getUserInfo();
     if (data) {
         Event_UserLeft event;
         event.set_name(data->name());
         SessionEvent *se = Server_ProtocolHandler::prepareSessionEvent(event);
-        for (auto &client : clients)
-            if (client->getAcceptsUserListChanges())
+        int recipients = 0;
+        for (auto &client : clients) {
+            if (client->getAcceptsUserListChanges()) {
                 client->sendProtocolItem(*se);
+                ++recipients;
+            }
+        }
+        metrics.broadcastSent(ServerMetrics::SessionBroadcast, recipients);
         sendIsl_SessionEvent(*se);
         delete se;
 
         users.remove(QString::fromStdString(data->name()));
+        usersCount.store(users.size(), std::memory_order_relaxed);
+        userListChanged(QString::fromStdString(data->name()));
         qDebug() << "Server::removeClient: name=" << QString::fromStdString(data->name());
 
         if (data->has_session_id()) {
@@ -274,7 +320,7 @@ QList<QString> Server::getOnlineModeratorList() const
     // clients list should be locked by calling function prior to iteration otherwise sigfaults may occur
     QList<QString> results;
     for (auto &client : clients) {
-        ServerInfo_User *data = client->getUserInfo();
+        const ServerInfo_User_Ptr data = client->getUserInfo();
 
         // TODO: this line should be updated in the event there is any type of new user level created
         if (data &&
@@ -289,17 +335,29 @@ void Server::externalUserJoined(const ServerInfo_User &userInfo)
     // This function is always called from the main thread via signal/slot.
     clientsLock.lockForWrite();
 
+    // the user may already be known from the complete list the peer sent when the link came up
+    if (externalUsers.contains(QString::fromStdString(userInfo.name()))) {
+        clientsLock.unlock();
+        return;
+    }
+
     Server_RemoteUserInterface *newUser = new Server_RemoteUserInterface(this, ServerInfo_User_Container(userInfo));
     externalUsers.insert(QString::fromStdString(userInfo.name()), newUser);
     externalUsersBySessionId.insert(userInfo.session_id(), newUser);
+    userListChanged(QString::fromStdString(userInfo.name()));
 
     Event_UserJoined event;
     event.mutable_user_info()->CopyFrom(userInfo);
 
     SessionEvent *se = Server_ProtocolHandler::prepareSessionEvent(event);
-    for (auto &client : clients)
-        if (client->getAcceptsUserListChanges())
+    int recipients = 0;
+    for (auto &client : clients) {
+        if (client->getAcceptsUserListChanges()) {
             client->sendProtocolItem(*se);
+            ++recipients;
+        }
+    }
+    metrics.broadcastSent(ServerMetrics::SessionBroadcast, recipients);
     delete se;
     clientsLock.unlock();
 
@@ -314,7 +372,12 @@ void Server::externalUserLeft(const QString &userName)
 
     clientsLock.lockForWrite();
     Server_AbstractUserInterface *user = externalUsers.take(userName);
+    if (!user) {
+        clientsLock.unlock();
+        return;
+    }
     externalUsersBySessionId.remove(user->getUserInfo()->session_id());
+    userListChanged(userName);
     clientsLock.unlock();
 
     QMap<int, QPair<int, int>> userGames(user->getGames());
@@ -347,13 +410,74 @@ void Server::externalUserLeft(const QString &userName)
 
     SessionEvent *se = Server_ProtocolHandler::prepareSessionEvent(event);
     clientsLock.lockForRead();
-    for (auto &client : clients)
-        if (client->getAcceptsUserListChanges())
+    int recipients = 0;
+    for (auto &client : clients) {
+        if (client->getAcceptsUserListChanges()) {
             client->sendProtocolItem(*se);
+            ++recipients;
+        }
+    }
+    metrics.broadcastSent(ServerMetrics::SessionBroadcast, recipients);
     clientsLock.unlock();
     delete se;
 }
 
+void Server::externalServerCompleteList(const Event_ServerCompleteList &event)
+{
+    // This function is always called from the main thread via signal/slot.
+    // A peer reports all of its users, rooms and games when the link comes up; they are added here in one pass
+    // instead of one queued call per user and game.
+    QList<Server_RemoteUserInterface *> newUsers;
+    QList<SessionEvent *> joinEvents;
+
+    clientsLock.lockForWrite();
+    for (int i = 0; i < event.user_list_size(); ++i) {
+        const ServerInfo_User &userInfo = event.user_list(i);
+        const QString userName = QString::fromStdString(userInfo.name());
+        if (externalUsers.contains(userName))
+            continue;
+
+        Server_RemoteUserInterface *newUser = new Server_RemoteUserInterface(this, ServerInfo_User_Container(userInfo));
+        externalUsers.insert(userName, newUser);
+        externalUsersBySessionId.insert(userInfo.session_id(), newUser);
+        userListChanged(userName);
+        newUsers.append(newUser);
+
+        Event_UserJoined userJoined;
+        userJoined.mutable_user_info()->CopyFrom(userInfo);
+        joinEvents.append(Server_ProtocolHandler::prepareSessionEvent(userJoined));
+    }
+    for (SessionEvent *se : joinEvents) {
+        int recipients = 0;
+        for (auto &client : clients) {
+            if (client->getAcceptsUserListChanges()) {
+                client->sendProtocolItem(*se);
+                ++recipients;
+            }
+        }
+        metrics.broadcastSent(ServerMetrics::SessionBroadcast, recipients);
+        delete se;
+    }
+    clientsLock.unlock();
+
+    for (Server_RemoteUserInterface *newUser : newUsers) {
+        ResponseContainer rc(-1);
+        newUser->joinPersistentGames(rc);
+        newUser->sendResponseContainer(rc, Response::RespNothing);
+    }
+
+    QReadLocker locker(&roomsLock);
+    for (int i = 0; i < event.room_list_size(); ++i) {
+        const ServerInfo_Room &roomInfo = event.room_list(i);
+        Server_Room *room = rooms.value(roomInfo.room_id());
+        if (!room) {
+            qDebug() << "externalServerCompleteList: room id=" << roomInfo.room_id() << "not found";
+            continue;
+        }
+        room->addExternalContents(roomInfo);
+    }
+}
+
 void Server::externalRoomUserJoined(int roomId, const ServerInfo_User &userInfo)
 {
     // This function is always called from the main thread via signal/slot.
@@ -553,9 +677,14 @@ void Server::broadcastRoomUpdate(const ServerInfo_Room &roomInfo, bool sendToIsl
     SessionEvent *se = Server_ProtocolHandler::prepareSessionEvent(event);
 
     clientsLock.lockForRead();
-    for (auto &client : clients)
-        if (client->getAcceptsRoomListChanges())
+    int recipients = 0;
+    for (auto &client : clients) {
+        if (client->getAcceptsRoomListChanges()) {
             client->sendProtocolItem(*se);
+            ++recipients;
+        }
+    }
+    metrics.broadcastSent(ServerMetrics::SessionBroadcast, recipients);
     clientsLock.unlock();
 
     if (sendToIsl)
@@ -573,25 +702,6 @@ void Server::addRoom(Server_Room *newRoom)
             Qt::QueuedConnection);
 }
 
-int Server::getUsersCount() const
-{
-    QReadLocker locker(&clientsLock);
-    return users.size();
-}
-
-int Server::getGamesCount() const
-{
-    int result = 0;
-    QReadLocker locker(&roomsLock);
-    QMapIterator<int, Server_Room *> roomIterator(rooms);
-    while (roomIterator.hasNext()) {
-        Server_Room *room = roomIterator.next().value();
-        QReadLocker roomLocker(&room->gamesLock);
-        result += room->getGames().size();
-    }
-    return result;
-}
-
 void Server::sendIsl_Response(const Response &item, int serverId, qint64 sessionId)
 {
     IslMessage msg;
@@ -6,6 +6,7 @@
 #include "pb/serverinfo_chat_message.pb.h"
 #include "pb/serverinfo_user.pb.h"
 #include "pb/serverinfo_warning.pb.h"
+#include "server_metrics.h"
 #include "server_player_reference.h"
 
 #include <QMap>
@@ -13,7 +14,9 @@
 #include <QMutex>
 #include <QObject>
 #include <QReadWriteLock>
+#include <QSet>
 #include <QStringList>
+#include <atomic>
 
 class Server_DatabaseInterface;
 class Server_Game;
@@ -31,6 +34,7 @@ class Response;
 class GameEventContainer;
 class CommandContainer;
 class Command_JoinGame;
+class Event_ServerCompleteList;
 
 enum AuthenticationResult
 {
@@ -83,6 +87,19 @@ public:
     {
         return usersBySessionId;
     }
+    /// How many user list changes are remembered for Command_ListUsers::since_version.
+    static const int maxUserListChanges = 10000;
+    // The user list version grows by one with every local or external user that joins or leaves, and with every
+    // change of a local user's info. Call these only with clientsLock set.
+    quint64 getUserListVersion() const
+    {
+        return userListVersion;
+    }
+    /// Collects the names of the users that joined, left or changed after sinceVersion. Returns false if the changes
+    /// go back further than the server remembers.
+    bool getUserListChanges(quint64 sinceVersion, QSet<QString> &result) const;
+    /// Records that the info of a logged in local user changed. Takes clientsLock.
+    void userInfoChanged(const QString &userName);
     virtual QMap<QString, bool> getServerRequiredFeatureList() const
     {
         return QMap<QString, bool>();
@@ -201,26 +218,57 @@ public:
     void addPersistentPlayer(const QString &userName, int roomId, int gameId, int playerId);
     void removePersistentPlayer(const QString &userName, int roomId, int gameId, int playerId);
     QList<PlayerReference> getPersistentPlayerReferences(const QString &userName) const;
-    int getUsersCount() const;
-    int getGamesCount() const;
+    // The counters below are maintained as users and games come and go, so reading them does not need any lock.
+    int getUsersCount() const
+    {
+        return usersCount.load(std::memory_order_relaxed);
+    }
+    int getGamesCount() const
+    {
+        return gamesCount.load(std::memory_order_relaxed);
+    }
     int getTCPUserCount() const
     {
-        return tcpUserCount;
+        return tcpUserCount.load(std::memory_order_relaxed);
     }
     int getWebSocketUserCount() const
     {
-        return webSocketUserCount;
+        return webSocketUserCount.load(std::memory_order_relaxed);
+    }
+    void gameAdded()
+    {
+        gamesCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void gameRemoved()
+    {
+        gamesCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+    ServerMetrics *getMetrics()
+    {
+        return &metrics;
     }
 
 private:
+    struct UserListChange
+    {
+        quint64 version;
+        QString userName;
+    };
+
     QMultiMap<QString, PlayerReference> persistentPlayers;
     mutable QReadWriteLock persistentPlayersLock;
-    int nextLocalGameId, tcpUserCount, webSocketUserCount;
+    int nextLocalGameId;
+    std::atomic<int> tcpUserCount, webSocketUserCount, usersCount, gamesCount;
     QMutex nextLocalGameIdMutex;
+    ServerMetrics metrics;
+    // counts up from the startup time, so that a version of a previous run is never mistaken for one of this run
+    quint64 userListVersion;
+    QList<UserListChange> userListChanges;
 
 protected slots:
     void externalUserJoined(const ServerInfo_User &userInfo);
     void externalUserLeft(const QString &userName);
+    void externalServerCompleteList(const Event_ServerCompleteList &event);
     void externalRoomUserJoined(int roomId, const ServerInfo_User &userInfo);
     void externalRoomUserLeft(int roomId, const QString &userName);
     void externalRoomSay(int roomId, const QString &userName, const QString &message);
@@ -239,6 +287,8 @@ protected slots:
 
 protected:
     void prepareDestroy();
+    // Call this only with clientsLock locked for writing.
+    void userListChanged(const QString &userName);
     void setDatabaseInterface(Server_DatabaseInterface *_databaseInterface);
     QList<Server_ProtocolHandler *> clients;
     QMap<qint64, Server_ProtocolHandler *> usersBySessionId;
@@ -33,6 +33,24 @@ void Server_AbstractUserInterface::sendProtocolItemByType(ServerMessage::Message
     }
 }
 
+void Server_AbstractUserInterface::sendServerMessageItem(const ServerMessage &item)
+{
+    switch (item.message_type()) {
+        case ServerMessage::RESPONSE:
+            sendProtocolItem(item.response());
+            break;
+        case ServerMessage::SESSION_EVENT:
+            sendProtocolItem(item.session_event());
+            break;
+        case ServerMessage::GAME_EVENT_CONTAINER:
+            sendProtocolItem(item.game_event_container());
+            break;
+        case ServerMessage::ROOM_EVENT:
+            sendProtocolItem(item.room_event());
+            break;
+    }
+}
+
 SessionEvent *Server_AbstractUserInterface::prepareSessionEvent(const ::google::protobuf::Message &sessionEvent)
 {
     SessionEvent *event = new SessionEvent;
@@ -51,15 +69,20 @@ void Server_AbstractUserInterface::sendResponseContainer(const ResponseContainer
         sendProtocolItemByType(preResponseQueue[i].first, *preResponseQueue[i].second);
 
     if (responseCode != Response::RespNothing) {
-        Response response;
-        response.set_cmd_id(responseContainer.getCmdId());
-        response.set_response_code(responseCode);
+        // built in place, on the arena of the command if there is one
+        ServerMessage *message = responseContainer.createItem<ServerMessage>();
+        message->set_message_type(ServerMessage::RESPONSE);
+        Response *response = message->mutable_response();
+        response->set_cmd_id(responseContainer.getCmdId());
+        response->set_response_code(responseCode);
         ::google::protobuf::Message *responseExtension = responseContainer.getResponseExtension();
         if (responseExtension)
-            response.GetReflection()
-                ->MutableMessage(&response, responseExtension->GetDescriptor()->FindExtensionByName("ext"))
+            response->GetReflection()
+                ->MutableMessage(response, responseExtension->GetDescriptor()->FindExtensionByName("ext"))
                 ->CopyFrom(*responseExtension);
-        sendProtocolItem(response);
+        sendServerMessageItem(*message);
+        if (!message->GetArena())
+            delete message;
     }
 
     const QList<QPair<ServerMessage::MessageType, ::google::protobuf::Message *>> &postResponseQueue =
@@ -55,6 +55,8 @@ public:
     virtual void sendProtocolItem(const GameEventContainer &item) = 0;
     virtual void sendProtocolItem(const RoomEvent &item) = 0;
     void sendProtocolItemByType(ServerMessage::MessageType type, const ::google::protobuf::Message &item);
+    /// Sends an item that is already wrapped for the client, so that one message can be shared by many recipients.
+    virtual void sendServerMessageItem(const ServerMessage &item);
 
     static SessionEvent *prepareSessionEvent(const ::google::protobuf::Message &sessionEvent);
     void sendResponseContainer(const ResponseContainer &responseContainer, Response::ResponseCode responseCode);
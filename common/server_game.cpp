@@ -49,7 +49,7 @@
 #include <QTimer>
 #include <google/protobuf/descriptor.h>
 
-Server_Game::Server_Game(const ServerInfo_User &_creatorInfo,
+Server_Game::Server_Game(const ServerInfo_User_Handle &_creatorRecord,
                          int _gameId,
                          const QString &_description,
                          const QString &_password,
@@ -62,14 +62,13 @@ Server_Game::Server_Game(const ServerInfo_User &_creatorInfo,
                          bool _spectatorsCanTalk,
                          bool _spectatorsSeeEverything,
                          Server_Room *_room)
-    : QObject(), room(_room), nextPlayerId(0), hostId(0), creatorInfo(new ServerInfo_User(_creatorInfo)),
-      gameStarted(false), gameClosed(false), gameId(_gameId), password(_password), maxPlayers(_maxPlayers),
-      gameTypes(_gameTypes), activePlayer(-1), activePhase(-1), onlyBuddies(_onlyBuddies),
-      onlyRegistered(_onlyRegistered), spectatorsAllowed(_spectatorsAllowed),
-      spectatorsNeedPassword(_spectatorsNeedPassword), spectatorsCanTalk(_spectatorsCanTalk),
-      spectatorsSeeEverything(_spectatorsSeeEverything), inactivityCounter(0), startTimeOfThisGame(0),
-      secondsElapsed(0), firstGameStarted(false), turnOrderReversed(false), startTime(QDateTime::currentDateTime()),
-      pingClock(nullptr),
+    : QObject(), room(_room), nextPlayerId(0), hostId(0), creatorRecord(_creatorRecord), gameStarted(false),
+      gameClosed(false), gameId(_gameId), password(_password), maxPlayers(_maxPlayers), gameTypes(_gameTypes),
+      activePlayer(-1), activePhase(-1), onlyBuddies(_onlyBuddies), onlyRegistered(_onlyRegistered),
+      spectatorsAllowed(_spectatorsAllowed), spectatorsNeedPassword(_spectatorsNeedPassword),
+      spectatorsCanTalk(_spectatorsCanTalk), spectatorsSeeEverything(_spectatorsSeeEverything), inactivityCounter(0),
+      startTimeOfThisGame(0), secondsElapsed(0), firstGameStarted(false), turnOrderReversed(false),
+      startTime(QDateTime::currentDateTime()), pingClock(nullptr),
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
       gameMutex()
 #else
@@ -104,8 +103,6 @@ Server_Game::~Server_Game()
     players.clear();
 
     room->removeGame(this);
-    delete creatorInfo;
-    creatorInfo = 0;
 
     gameMutex.unlock();
     room->gamesLock.unlock();
@@ -120,7 +117,7 @@ Server_Game::~Server_Game()
 
     room = nullptr;
     currentReplay = nullptr;
-    creatorInfo = nullptr;
+    creatorRecord.clear();
 
     if (pingClock) {
         delete pingClock;
@@ -402,7 +399,7 @@ void Server_Game::stopGameIfFinished()
     emit gameInfoChanged(gameInfo);
 }
 
-Response::ResponseCode Server_Game::checkJoin(ServerInfo_User *user,
+Response::ResponseCode Server_Game::checkJoin(const ServerInfo_User *user,
                                               const QString &_password,
                                               bool spectator,
                                               bool overrideRestrictions,
@@ -410,7 +407,7 @@ Response::ResponseCode Server_Game::checkJoin(ServerInfo_User *user,
 {
     Server_DatabaseInterface *databaseInterface = room->getServer()->getDatabaseInterface();
     for (Server_Player *player : players.values()) {
-        if (player->getUserInfo()->name() == user->name())
+        if (player->getUserInfoUnlocked()->name() == user->name())
             return Response::RespContextError;
     }
 
@@ -422,11 +419,11 @@ Response::ResponseCode Server_Game::checkJoin(ServerInfo_User *user,
             return Response::RespWrongPassword;
         if (!(user->user_level() & ServerInfo_User::IsRegistered) && onlyRegistered)
             return Response::RespUserLevelTooLow;
-        if (onlyBuddies && (user->name() != creatorInfo->name()))
-            if (!databaseInterface->isInBuddyList(QString::fromStdString(creatorInfo->name()),
+        if (onlyBuddies && (user->name() != getCreatorInfo()->name()))
+            if (!databaseInterface->isInBuddyList(QString::fromStdString(getCreatorInfo()->name()),
                                                   QString::fromStdString(user->name())))
                 return Response::RespOnlyBuddies;
-        if (databaseInterface->isInIgnoreList(QString::fromStdString(creatorInfo->name()),
+        if (databaseInterface->isInIgnoreList(QString::fromStdString(getCreatorInfo()->name()),
                                               QString::fromStdString(user->name())))
             return Response::RespInIgnoreList;
         if (spectator) {
@@ -445,7 +442,7 @@ bool Server_Game::containsUser(const QString &userName) const
     QMutexLocker locker(&gameMutex);
 
     for (Server_Player *player : players.values()) {
-        if (player->getUserInfo()->name() == userName.toStdString())
+        if (player->getUserInfoUnlocked()->name() == userName.toStdString())
             return true;
     }
     return false;
@@ -468,7 +465,7 @@ void Server_Game::addPlayer(Server_AbstractUserInterface *userInterface,
     newPlayer->getProperties(*joinEvent.mutable_player_properties(), true);
     sendGameEventContainer(prepareGameEvent(joinEvent, -1));
 
-    const QString playerName = QString::fromStdString(newPlayer->getUserInfo()->name());
+    const QString playerName = QString::fromStdString(newPlayer->getUserInfoUnlocked()->name());
     players.insert(newPlayer->getPlayerId(), newPlayer);
     if (spectator) {
         allSpectatorsEver.insert(playerName);
@@ -477,7 +474,7 @@ void Server_Game::addPlayer(Server_AbstractUserInterface *userInterface,
 
         // if the original creator of the game joins, give them host status back
         // FIXME: transferring host to spectators has side effects
-        if (newPlayer->getUserInfo()->name() == creatorInfo->name()) {
+        if (newPlayer->getUserInfoUnlocked()->name() == getCreatorInfo()->name()) {
             hostId = newPlayer->getPlayerId();
             sendGameEventContainer(prepareGameEvent(Event_GameHostChanged(), hostId));
         }
@@ -492,7 +489,7 @@ void Server_Game::addPlayer(Server_AbstractUserInterface *userInterface,
         emit gameInfoChanged(gameInfo);
     }
 
-    if ((newPlayer->getUserInfo()->user_level() & ServerInfo_User::IsRegistered) && !spectator)
+    if ((newPlayer->getUserInfoUnlocked()->user_level() & ServerInfo_User::IsRegistered) && !spectator)
         room->getServer()->addPersistentPlayer(playerName, room->getId(), gameId, newPlayer->getPlayerId());
 
     userInterface->playerAddedToGame(gameId, room->getId(), newPlayer->getPlayerId());
@@ -502,8 +499,8 @@ void Server_Game::addPlayer(Server_AbstractUserInterface *userInterface,
 
 void Server_Game::removePlayer(Server_Player *player, Event_Leave::LeaveReason reason)
 {
-    room->getServer()->removePersistentPlayer(QString::fromStdString(player->getUserInfo()->name()), room->getId(),
-                                              gameId, player->getPlayerId());
+    room->getServer()->removePersistentPlayer(QString::fromStdString(player->getUserInfoUnlocked()->name()),
+                                              room->getId(), gameId, player->getPlayerId());
     players.remove(player->getPlayerId());
 
     GameEventStorage ges;
@@ -714,7 +711,7 @@ void Server_Game::createGameJoinedEvent(Server_Player *player, ResponseContainer
         player->getInfo(event2.add_player_list(), player, player->getSpectator() && spectatorsSeeEverything, true);
     }
 
-    rc.enqueuePostResponseItem(ServerMessage::GAME_EVENT_CONTAINER, prepareGameEvent(event2, -1));
+    rc.enqueuePostResponseItem(ServerMessage::GAME_EVENT_CONTAINER, prepareGameEvent(event2, -1, 0, rc.getArena()));
 }
 
 void Server_Game::sendGameEventContainer(GameEventContainer *cont,
@@ -723,27 +720,39 @@ void Server_Game::sendGameEventContainer(GameEventContainer *cont,
 {
     QMutexLocker locker(&gameMutex);
 
+    // every recipient is sent the same message, instead of each wrapping its own copy of the container
+    ServerMessage *message = ::google::protobuf::Arena::CreateMessage<ServerMessage>(cont->GetArena());
+    message->set_message_type(ServerMessage::GAME_EVENT_CONTAINER);
+    message->set_allocated_game_event_container(cont);
+
     cont->set_game_id(gameId);
+    int recipientCount = 0;
     for (Server_Player *player : players.values()) {
         const bool playerPrivate =
             (player->getPlayerId() == privatePlayerId) || (player->getSpectator() && spectatorsSeeEverything);
         if ((recipients.testFlag(GameEventStorageItem::SendToPrivate) && playerPrivate) ||
-            (recipients.testFlag(GameEventStorageItem::SendToOthers) && !playerPrivate))
-            player->sendGameEvent(*cont);
+            (recipients.testFlag(GameEventStorageItem::SendToOthers) && !playerPrivate)) {
+            player->sendServerMessageItem(*message);
+            ++recipientCount;
+        }
     }
+    room->getServer()->getMetrics()->broadcastSent(ServerMetrics::GameBroadcast, recipientCount);
     if (recipients.testFlag(GameEventStorageItem::SendToPrivate)) {
         cont->set_seconds_elapsed(secondsElapsed - startTimeOfThisGame);
         cont->clear_game_id();
         currentReplay->add_event_list()->CopyFrom(*cont);
     }
 
-    delete cont;
+    if (!message->GetArena())
+        delete message;
 }
 
-GameEventContainer *
-Server_Game::prepareGameEvent(const ::google::protobuf::Message &gameEvent, int playerId, GameEventContext *context)
+GameEventContainer *Server_Game::prepareGameEvent(const ::google::protobuf::Message &gameEvent,
+                                                  int playerId,
+                                                  GameEventContext *context,
+                                                  ::google::protobuf::Arena *arena)
 {
-    GameEventContainer *cont = new GameEventContainer;
+    GameEventContainer *cont = ::google::protobuf::Arena::CreateMessage<GameEventContainer>(arena);
     cont->set_game_id(gameId);
     if (context)
         cont->mutable_context()->CopyFrom(*context);
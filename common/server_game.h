@@ -24,6 +24,7 @@
 #include "pb/response.pb.h"
 #include "pb/serverinfo_game.pb.h"
 #include "server_response_containers.h"
+#include "serverinfo_user_registry.h"
 
 #include <QDateTime>
 #include <QMap>
@@ -50,7 +51,8 @@ private:
     Server_Room *room;
     int nextPlayerId;
     int hostId;
-    ServerInfo_User *creatorInfo;
+    /// The creator as the game listing shows them.
+    ServerInfo_User_Handle creatorRecord;
     QMap<int, Server_Player *> players;
     QSet<QString> allPlayersEver, allSpectatorsEver;
     bool gameStarted;
@@ -93,7 +95,7 @@ public:
 #else
     mutable QMutex gameMutex;
 #endif
-    Server_Game(const ServerInfo_User &_creatorInfo,
+    Server_Game(const ServerInfo_User_Handle &_creatorRecord,
                 int _gameId,
                 const QString &_description,
                 const QString &_password,
@@ -116,9 +118,9 @@ public:
     {
         return hostId;
     }
-    ServerInfo_User *getCreatorInfo() const
+    const ServerInfo_User *getCreatorInfo() const
     {
-        return creatorInfo;
+        return &creatorRecord->getPublicInfo();
     }
     bool getGameStarted() const
     {
@@ -162,8 +164,11 @@ public:
     {
         return spectatorsSeeEverything;
     }
-    Response::ResponseCode
-    checkJoin(ServerInfo_User *user, const QString &_password, bool spectator, bool overrideRestrictions, bool asJudge);
+    Response::ResponseCode checkJoin(const ServerInfo_User *user,
+                                     const QString &_password,
+                                     bool spectator,
+                                     bool overrideRestrictions,
+                                     bool asJudge);
     bool containsUser(const QString &userName) const;
     void addPlayer(Server_AbstractUserInterface *userInterface,
                    ResponseContainer &rc,
@@ -198,11 +203,14 @@ public:
 
     void createGameJoinedEvent(Server_Player *player, ResponseContainer &rc, bool resuming);
 
-    GameEventContainer *
-    prepareGameEvent(const ::google::protobuf::Message &gameEvent, int playerId, GameEventContext *context = 0);
+    GameEventContainer *prepareGameEvent(const ::google::protobuf::Message &gameEvent,
+                                         int playerId,
+                                         GameEventContext *context = 0,
+                                         ::google::protobuf::Arena *arena = nullptr);
     GameEventContext prepareGameEventContext(const ::google::protobuf::Message &gameEventContext);
 
     void sendGameStateToPlayers();
+    /// Sends cont to the players and spectators it is meant for and takes ownership of it.
     void sendGameEventContainer(GameEventContainer *cont,
                                 GameEventStorageItem::EventRecipients recipients = GameEventStorageItem::SendToPrivate |
                                                                                    GameEventStorageItem::SendToOthers,
@@ -2,6 +2,7 @@
 #define SERVER_METATYPES_H
 
 #include "pb/commands.pb.h"
+#include "pb/event_server_complete_list.pb.h"
 #include "pb/game_event_container.pb.h"
 #include "pb/isl_message.pb.h"
 #include "pb/response.pb.h"
@@ -22,5 +23,6 @@ Q_DECLARE_METATYPE(Response)
 Q_DECLARE_METATYPE(GameEventContainer)
 Q_DECLARE_METATYPE(IslMessage)
 Q_DECLARE_METATYPE(Command_JoinGame)
+Q_DECLARE_METATYPE(Event_ServerCompleteList)
 
 #endif
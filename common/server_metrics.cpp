@@ -0,0 +1,162 @@
+#include "server_metrics.h"
+
+#include "pb/admin_commands.pb.h"
+#include "pb/game_commands.pb.h"
+#include "pb/moderator_commands.pb.h"
+#include "pb/room_commands.pb.h"
+#include "pb/session_commands.pb.h"
+
+#include <google/protobuf/descriptor.h>
+
+namespace
+{
+// microseconds
+const quint64 latencyBounds[MetricsHistogram::MaxBuckets] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000};
+const quint64 sizeBounds[MetricsHistogram::MaxBuckets] = {0,   1,    2,    5,    10,    25,    50,    100,
+                                                          250, 500, 1000, 2500, 5000, 10000, 25000, 50000};
+
+QByteArray formatBound(MetricsHistogram::BucketKind kind, quint64 value)
+{
+    if (kind == MetricsHistogram::LatencyBuckets)
+        return QByteArray::number(static_cast<double>(value) / 1000000.0, 'g', 6);
+    return QByteArray::number(value);
+}
+
+QByteArray withLabel(const QByteArray &labels, const QByteArray &label)
+{
+    if (labels.isEmpty())
+        return "{" + label + "}";
+    return "{" + labels + "," + label + "}";
+}
+
+const char *categoryName(ServerMetrics::CommandCategory category)
+{
+    switch (category) {
+        case ServerMetrics::SessionCommandCategory:
+            return "session";
+        case ServerMetrics::RoomCommandCategory:
+            return "room";
+        case ServerMetrics::GameCommandCategory:
+            return "game";
+        case ServerMetrics::ModeratorCommandCategory:
+            return "moderator";
+        case ServerMetrics::AdminCommandCategory:
+            return "admin";
+        default:
+            return "unknown";
+    }
+}
+
+QByteArray commandTypeName(ServerMetrics::CommandCategory category, int slot)
+{
+    if (slot == ServerMetrics::CommandTypeSlots)
+        return "other";
+
+    const google::protobuf::EnumDescriptor *descriptor = nullptr;
+    switch (category) {
+        case ServerMetrics::SessionCommandCategory:
+            descriptor = SessionCommand::SessionCommandType_descriptor();
+            break;
+        case ServerMetrics::RoomCommandCategory:
+            descriptor = RoomCommand::RoomCommandType_descriptor();
+            break;
+        case ServerMetrics::GameCommandCategory:
+            descriptor = GameCommand::GameCommandType_descriptor();
+            break;
+        case ServerMetrics::ModeratorCommandCategory:
+            descriptor = ModeratorCommand::ModeratorCommandType_descriptor();
+            break;
+        case ServerMetrics::AdminCommandCategory:
+            descriptor = AdminCommand::AdminCommandType_descriptor();
+            break;
+        default:
+            break;
+    }
+    const int commandType = ServerMetrics::FirstCommandType + slot;
+    const google::protobuf::EnumValueDescriptor *value =
+        descriptor ? descriptor->FindValueByNumber(commandType) : nullptr;
+    if (!value)
+        return QByteArray::number(commandType);
+    return QByteArray::fromStdString(value->name()).toLower();
+}
+} // namespace
+
+MetricsHistogram::MetricsHistogram(BucketKind _kind) : kind(_kind), count(0), sum(0)
+{
+    for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+void MetricsHistogram::observe(quint64 value)
+{
+    const quint64 *bounds = kind == LatencyBuckets ? latencyBounds : sizeBounds;
+    int bucket = 0;
+    while (bucket < MaxBuckets && value > bounds[bucket])
+        ++bucket;
+
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsHistogram::write(QByteArray &out, const QByteArray &name, const QByteArray &labels) const
+{
+    const quint64 *bounds = kind == LatencyBuckets ? latencyBounds : sizeBounds;
+
+    // the buckets are read one by one while other threads keep counting, so the total is derived from what was read
+    // to keep every exported histogram consistent in itself
+    quint64 cumulative = 0;
+    for (int i = 0; i < MaxBuckets; ++i) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        out += name + "_bucket" + withLabel(labels, "le=\"" + formatBound(kind, bounds[i]) + "\"") + " " +
+               QByteArray::number(cumulative) + "\n";
+    }
+    cumulative += buckets[MaxBuckets].load(std::memory_order_relaxed);
+    out += name + "_bucket" + withLabel(labels, "le=\"+Inf\"") + " " + QByteArray::number(cumulative) + "\n";
+
+    const QByteArray labelSet = labels.isEmpty() ? QByteArray() : "{" + labels + "}";
+    const quint64 total = sum.load(std::memory_order_relaxed);
+    if (kind == LatencyBuckets)
+        out += name + "_sum" + labelSet + " " + QByteArray::number(static_cast<double>(total) / 1000000.0, 'f', 6) +
+               "\n";
+    else
+        out += name + "_sum" + labelSet + " " + QByteArray::number(total) + "\n";
+    out += name + "_count" + labelSet + " " + QByteArray::number(cumulative) + "\n";
+}
+
+void ServerMetrics::commandProcessed(CommandCategory category, int commandType, qint64 nsecs)
+{
+    int slot = commandType - FirstCommandType;
+    if (slot < 0 || slot >= CommandTypeSlots)
+        slot = CommandTypeSlots;
+    commandLatency[category][slot].observe(static_cast<quint64>(nsecs / 1000));
+}
+
+void ServerMetrics::write(QByteArray &out) const
+{
+    out += "# HELP servatrice_command_duration_seconds Time spent processing a single client command.\n"
+           "# TYPE servatrice_command_duration_seconds histogram\n";
+    for (int category = 0; category < CommandCategoryCount; ++category) {
+        for (int slot = 0; slot <= CommandTypeSlots; ++slot) {
+            const MetricsHistogram &histogram = commandLatency[category][slot];
+            if (histogram.getCount() == 0)
+                continue;
+            const QByteArray labels =
+                QByteArray("category=\"") + categoryName(static_cast<CommandCategory>(category)) + "\",type=\"" +
+                commandTypeName(static_cast<CommandCategory>(category), slot) + "\"";
+            histogram.write(out, "servatrice_command_duration_seconds", labels);
+        }
+    }
+
+    out += "# HELP servatrice_broadcast_recipients Number of recipients of each broadcast event.\n"
+           "# TYPE servatrice_broadcast_recipients histogram\n";
+    const char *scopeNames[BroadcastScopeCount] = {"session", "room", "game"};
+    for (int scope = 0; scope < BroadcastScopeCount; ++scope)
+        broadcastFanOut[scope].write(out, "servatrice_broadcast_recipients",
+                                     QByteArray("scope=\"") + scopeNames[scope] + "\"");
+
+    out += "# HELP servatrice_output_queue_depth Length of a client's output queue when a message is queued.\n"
+           "# TYPE servatrice_output_queue_depth histogram\n";
+    outputQueueDepth.write(out, "servatrice_output_queue_depth", QByteArray());
+}
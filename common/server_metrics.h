@@ -0,0 +1,94 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include <QByteArray>
+#include <atomic>
+
+/**
+ * Histogram with fixed buckets that can be updated from any thread without taking a lock.
+ * Latency histograms take microseconds and are exported in seconds, size histograms are exported as they are.
+ */
+class MetricsHistogram
+{
+public:
+    enum BucketKind
+    {
+        LatencyBuckets,
+        SizeBuckets
+    };
+    static const int MaxBuckets = 16;
+
+private:
+    BucketKind kind;
+    std::atomic<quint64> buckets[MaxBuckets + 1]; // not cumulative, the last one is +Inf
+    std::atomic<quint64> count;
+    std::atomic<quint64> sum;
+
+public:
+    explicit MetricsHistogram(BucketKind _kind = LatencyBuckets);
+    MetricsHistogram(const MetricsHistogram &) = delete;
+    MetricsHistogram &operator=(const MetricsHistogram &) = delete;
+
+    void observe(quint64 value);
+    quint64 getCount() const
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    /** Appends the histogram in the prometheus text format; labels is eg. 'type="login"' or empty. */
+    void write(QByteArray &out, const QByteArray &name, const QByteArray &labels) const;
+};
+
+/**
+ * Counters for the protocol hot paths of the server core (command processing and event broadcasting).
+ * Recording only touches atomics, so it is safe from every pool thread; exporting walks all of them.
+ */
+class ServerMetrics
+{
+public:
+    enum CommandCategory
+    {
+        SessionCommandCategory,
+        RoomCommandCategory,
+        GameCommandCategory,
+        ModeratorCommandCategory,
+        AdminCommandCategory,
+        CommandCategoryCount
+    };
+    enum BroadcastScope
+    {
+        SessionBroadcast,
+        RoomBroadcast,
+        GameBroadcast,
+        BroadcastScopeCount
+    };
+    // command extension numbers start at 1000; anything outside of the slots is counted as "other"
+    static const int FirstCommandType = 1000;
+    static const int CommandTypeSlots = 128;
+
+private:
+    MetricsHistogram commandLatency[CommandCategoryCount][CommandTypeSlots + 1];
+    MetricsHistogram broadcastFanOut[BroadcastScopeCount] = {MetricsHistogram(MetricsHistogram::SizeBuckets),
+                                                             MetricsHistogram(MetricsHistogram::SizeBuckets),
+                                                             MetricsHistogram(MetricsHistogram::SizeBuckets)};
+    MetricsHistogram outputQueueDepth{MetricsHistogram::SizeBuckets};
+
+public:
+    ServerMetrics() = default;
+    ServerMetrics(const ServerMetrics &) = delete;
+    ServerMetrics &operator=(const ServerMetrics &) = delete;
+
+    void commandProcessed(CommandCategory category, int commandType, qint64 nsecs);
+    void broadcastSent(BroadcastScope scope, int recipients)
+    {
+        broadcastFanOut[scope].observe(static_cast<quint64>(recipients));
+    }
+    void outputQueued(int queueDepth)
+    {
+        outputQueueDepth.observe(static_cast<quint64>(queueDepth));
+    }
+
+    void write(QByteArray &out) const;
+};
+
+#endif
@@ -780,7 +780,7 @@ Server_Player::cmdDeckSelect(const Command_DeckSelect &cmd, ResponseContainer &r
     context.set_sideboard_size(deck->getSideboardSize());
     ges.setGameEventContext(context);
 
-    auto *re = new Response_DeckDownload;
+    auto *re = rc.createItem<Response_DeckDownload>();
     re->set_deck(deck->writeToString_Native().toStdString());
 
     rc.setResponseExtension(re);
@@ -1871,7 +1871,7 @@ Server_Player::cmdDumpZone(const Command_DumpZone &cmd, ResponseContainer &rc, G
     int numberCards = cmd.number_cards();
     const QList<Server_Card *> &cards = zone->getCards();
 
-    auto *re = new Response_DumpZone;
+    auto *re = rc.createItem<Response_DumpZone>();
     ServerInfo_Zone *zoneInfo = re->mutable_zone_info();
     zoneInfo->set_name(zone->getName().toStdString());
     zoneInfo->set_type(zone->getType());
@@ -2230,6 +2230,15 @@ void Server_Player::sendGameEvent(const GameEventContainer &cont)
     }
 }
 
+void Server_Player::sendServerMessageItem(const ServerMessage &message)
+{
+    QMutexLocker locker(&playerMutex);
+
+    if (userInterface) {
+        userInterface->sendServerMessageItem(message);
+    }
+}
+
 void Server_Player::setUserInterface(Server_AbstractUserInterface *_userInterface)
 {
     playerMutex.lock();
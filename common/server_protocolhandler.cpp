@@ -25,6 +25,7 @@
 
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QtMath>
 #include <google/protobuf/descriptor.h>
 
@@ -128,6 +129,17 @@ void Server_ProtocolHandler::sendProtocolItem(const RoomEvent &item)
     transmitProtocolItem(msg);
 }
 
+void Server_ProtocolHandler::updateUserInfo(const ServerInfo_User &_userInfo)
+{
+    setUserInfo(_userInfo);
+    server->userInfoChanged(QString::fromStdString(_userInfo.name()));
+}
+
+void Server_ProtocolHandler::sendServerMessageItem(const ServerMessage &item)
+{
+    transmitProtocolItem(item);
+}
+
 Response::ResponseCode Server_ProtocolHandler::processSessionCommandContainer(const CommandContainer &cont,
                                                                               ResponseContainer &rc)
 {
@@ -139,6 +151,8 @@ Response::ResponseCode Server_ProtocolHandler::processSessionCommandContainer(co
         if (num != SessionCommand::PING) { // don't log ping commands
             logDebugMessage(getSafeDebugString(sc));
         }
+        QElapsedTimer commandTimer;
+        commandTimer.start();
         switch ((SessionCommand::SessionCommandType)num) {
             case SessionCommand::PING:
                 resp = cmdPing(sc.GetExtension(Command_Ping::ext), rc);
@@ -167,6 +181,7 @@ Response::ResponseCode Server_ProtocolHandler::processSessionCommandContainer(co
             default:
                 resp = processExtendedSessionCommand(num, sc, rc);
         }
+        server->getMetrics()->commandProcessed(ServerMetrics::SessionCommandCategory, num, commandTimer.nsecsElapsed());
         if (resp != Response::RespOk)
             finalResponseCode = resp;
     }
@@ -192,6 +207,8 @@ Response::ResponseCode Server_ProtocolHandler::processRoomCommandContainer(const
         const RoomCommand &sc = cont.room_command(i);
         const int num = getPbExtension(sc);
         logDebugMessage(getSafeDebugString(sc));
+        QElapsedTimer commandTimer;
+        commandTimer.start();
         switch ((RoomCommand::RoomCommandType)num) {
             case RoomCommand::LEAVE_ROOM:
                 resp = cmdLeaveRoom(sc.GetExtension(Command_LeaveRoom::ext), room, rc);
@@ -206,6 +223,7 @@ Response::ResponseCode Server_ProtocolHandler::processRoomCommandContainer(const
                 resp = cmdJoinGame(sc.GetExtension(Command_JoinGame::ext), room, rc);
                 break;
         }
+        server->getMetrics()->commandProcessed(ServerMetrics::RoomCommandCategory, num, commandTimer.nsecsElapsed());
         if (resp != Response::RespOk)
             finalResponseCode = resp;
     }
@@ -265,10 +283,11 @@ Response::ResponseCode Server_ProtocolHandler::processGameCommandContainer(const
 
     int commandCountingInterval = server->getCommandCountingInterval();
     int maxCommandCountPerInterval = server->getMaxCommandCountPerInterval();
-    GameEventStorage ges;
+    GameEventStorage ges(rc.getArena());
     Response::ResponseCode finalResponseCode = Response::RespOk;
     for (int i = cont.game_command_size() - 1; i >= 0; --i) {
         const GameCommand &sc = cont.game_command(i);
+        const int num = getPbExtension(sc);
         logDebugMessage(QString("game %1 player %2: ").arg(cont.game_id()).arg(roomIdAndPlayerId.second) +
                         getSafeDebugString(sc));
 
@@ -277,7 +296,7 @@ Response::ResponseCode Server_ProtocolHandler::processGameCommandContainer(const
             if (commandCountOverTime.isEmpty())
                 commandCountOverTime.prepend(0);
 
-            if (!antifloodCommandsWhiteList.contains((GameCommand::GameCommandType)getPbExtension(sc)))
+            if (!antifloodCommandsWhiteList.contains((GameCommand::GameCommandType)num))
                 ++commandCountOverTime[0];
 
             for (int i = 0; i < commandCountOverTime.size(); ++i) {
@@ -289,7 +308,10 @@ Response::ResponseCode Server_ProtocolHandler::processGameCommandContainer(const
             }
         }
 
+        QElapsedTimer commandTimer;
+        commandTimer.start();
         Response::ResponseCode resp = player->processGameCommand(sc, rc, ges);
+        server->getMetrics()->commandProcessed(ServerMetrics::GameCommandCategory, num, commandTimer.nsecsElapsed());
 
         if (resp != Response::RespOk)
             finalResponseCode = resp;
@@ -316,7 +338,11 @@ Response::ResponseCode Server_ProtocolHandler::processModeratorCommandContainer(
         const int num = getPbExtension(sc);
         logDebugMessage(getSafeDebugString(sc));
 
+        QElapsedTimer commandTimer;
+        commandTimer.start();
         resp = processExtendedModeratorCommand(num, sc, rc);
+        server->getMetrics()->commandProcessed(ServerMetrics::ModeratorCommandCategory, num,
+                                               commandTimer.nsecsElapsed());
         if (resp != Response::RespOk)
             finalResponseCode = resp;
     }
@@ -340,7 +366,10 @@ Response::ResponseCode Server_ProtocolHandler::processAdminCommandContainer(cons
         const int num = getPbExtension(sc);
         logDebugMessage(getSafeDebugString(sc));
 
+        QElapsedTimer commandTimer;
+        commandTimer.start();
         resp = processExtendedAdminCommand(num, sc, rc);
+        server->getMetrics()->commandProcessed(ServerMetrics::AdminCommandCategory, num, commandTimer.nsecsElapsed());
         if (resp != Response::RespOk)
             finalResponseCode = resp;
     }
@@ -355,7 +384,8 @@ void Server_ProtocolHandler::processCommandContainer(const CommandContainer &con
 
     lastDataReceived = timeRunning;
 
-    ResponseContainer responseContainer(cont.has_cmd_id() ? cont.cmd_id() : -1);
+    CommandArena arena;
+    ResponseContainer responseContainer(cont.has_cmd_id() ? cont.cmd_id() : -1, arena.get());
     Response::ResponseCode finalResponseCode;
 
     if (cont.game_command_size())
@@ -529,6 +559,7 @@ Response::ResponseCode Server_ProtocolHandler::cmdLogin(const Command_Login &cmd
     Event_ServerMessage event;
     event.set_message(server->getLoginMessage().toStdString());
     rc.enqueuePostResponseItem(ServerMessage::SESSION_EVENT, prepareSessionEvent(event));
+    clientFeaturesNegotiated(receivedClientFeatures);
 
     Response_Login *re = new Response_Login;
     re->mutable_user_info()->CopyFrom(copyUserInfo(true));
@@ -705,19 +736,57 @@ Response::ResponseCode Server_ProtocolHandler::cmdJoinRoom(const Command_JoinRoo
     return Response::RespOk;
 }
 
-Response::ResponseCode Server_ProtocolHandler::cmdListUsers(const Command_ListUsers & /*cmd*/, ResponseContainer &rc)
+Response::ResponseCode Server_ProtocolHandler::cmdListUsers(const Command_ListUsers &cmd, ResponseContainer &rc)
 {
     if (authState == NotLoggedIn)
         return Response::RespLoginNeeded;
 
     Response_ListUsers *re = new Response_ListUsers;
     server->clientsLock.lockForRead();
-    QMapIterator<QString, Server_ProtocolHandler *> userIterator = server->getUsers();
-    while (userIterator.hasNext())
-        re->add_user_list()->CopyFrom(userIterator.next().value()->copyUserInfo(false));
-    QMapIterator<QString, Server_AbstractUserInterface *> extIterator = server->getExternalUsers();
-    while (extIterator.hasNext())
-        re->add_user_list()->CopyFrom(extIterator.next().value()->copyUserInfo(false));
+    re->set_version(server->getUserListVersion());
+
+    QSet<QString> changedUsers;
+    if (cmd.has_since_version() && server->getUserListChanges(cmd.since_version(), changedUsers)) {
+        re->set_is_diff(true);
+        for (const QString &userName : changedUsers) {
+            Server_AbstractUserInterface *user = server->findUser(userName);
+            if (user)
+                user->copyUserInfo(*re->add_user_list(), false);
+            else
+                re->add_removed_user_list(userName.toStdString());
+        }
+    } else if (cmd.has_page_size()) {
+        // local and external users are both sorted by name; the page is merged from the two
+        const QMap<QString, Server_ProtocolHandler *> &users = server->getUsers();
+        const QMap<QString, Server_AbstractUserInterface *> &externalUsers = server->getExternalUsers();
+        const QString cursor = QString::fromStdString(cmd.cursor());
+        auto user = cmd.has_cursor() ? users.upperBound(cursor) : users.constBegin();
+        auto externalUser = cmd.has_cursor() ? externalUsers.upperBound(cursor) : externalUsers.constBegin();
+        const int pageSize = qBound(1, static_cast<int>(cmd.page_size()), maxUserListPageSize);
+        QString lastName;
+        while (re->user_list_size() < pageSize &&
+               (user != users.constEnd() || externalUser != externalUsers.constEnd())) {
+            if (externalUser == externalUsers.constEnd() ||
+                (user != users.constEnd() && user.key() < externalUser.key())) {
+                lastName = user.key();
+                user.value()->copyUserInfo(*re->add_user_list(), false);
+                ++user;
+            } else {
+                lastName = externalUser.key();
+                externalUser.value()->copyUserInfo(*re->add_user_list(), false);
+                ++externalUser;
+            }
+        }
+        if (user != users.constEnd() || externalUser != externalUsers.constEnd())
+            re->set_next_cursor(lastName.toStdString());
+    } else {
+        QMapIterator<QString, Server_ProtocolHandler *> userIterator = server->getUsers();
+        while (userIterator.hasNext())
+            userIterator.next().value()->copyUserInfo(*re->add_user_list(), false);
+        QMapIterator<QString, Server_AbstractUserInterface *> extIterator = server->getExternalUsers();
+        while (extIterator.hasNext())
+            extIterator.next().value()->copyUserInfo(*re->add_user_list(), false);
+    }
 
     acceptsUserListChanges = true;
     server->clientsLock.unlock();
@@ -819,7 +888,7 @@ Server_ProtocolHandler::cmdCreateGame(const Command_CreateGame &cmd, Server_Room
     // When server doesn't permit registered users to exist, do not honor only-reg setting
     bool onlyRegisteredUsers = cmd.only_registered() && (server->permitUnregisteredUsers());
     Server_Game *game = new Server_Game(
-        copyUserInfo(false), gameId, description, QString::fromStdString(cmd.password()), cmd.max_players(), gameTypes,
+        getUserInfoRecord(), gameId, description, QString::fromStdString(cmd.password()), cmd.max_players(), gameTypes,
         cmd.only_buddies(), onlyRegisteredUsers, cmd.spectators_allowed(), cmd.spectators_need_password(),
         cmd.spectators_can_talk(), cmd.spectators_see_everything(), room);
 
@@ -64,6 +64,8 @@ private:
     QList<int> messageSizeOverTime, messageCountOverTime, commandCountOverTime;
     int timeRunning, lastDataReceived, lastActionReceived;
 
+    static const int maxUserListPageSize = 1000;
+
     virtual void transmitProtocolItem(const ServerMessage &item) = 0;
 
     Response::ResponseCode cmdPing(const Command_Ping &cmd, ResponseContainer &rc);
@@ -99,6 +101,10 @@ private:
     {
         return Response::RespFunctionNotAllowed;
     }
+    // called after a successful login with the features announced by the client
+    virtual void clientFeaturesNegotiated(const QMap<QString, bool> & /* clientFeatures */)
+    {
+    }
 
     void resetIdleTimer();
 private slots:
@@ -110,6 +116,8 @@ public:
     Server_ProtocolHandler(Server *_server, Server_DatabaseInterface *_databaseInterface, QObject *parent = 0);
     ~Server_ProtocolHandler();
 
+    /// Replaces the info of the logged in user, so that clients asking for user list changes get the new info.
+    void updateUserInfo(const ServerInfo_User &_userInfo);
     bool getAcceptsUserListChanges() const
     {
         return acceptsUserListChanges;
@@ -125,17 +133,18 @@ public:
         return databaseInterface;
     }
 
-    int getLastCommandTime() const
+    int getLastCommandTime() const override
     {
         return timeRunning - lastDataReceived;
     }
-    bool addSaidMessageSize(int size);
+    bool addSaidMessageSize(int size) override;
     void processCommandContainer(const CommandContainer &cont);
 
-    void sendProtocolItem(const Response &item);
-    void sendProtocolItem(const SessionEvent &item);
-    void sendProtocolItem(const GameEventContainer &item);
-    void sendProtocolItem(const RoomEvent &item);
+    void sendProtocolItem(const Response &item) override;
+    void sendProtocolItem(const SessionEvent &item) override;
+    void sendProtocolItem(const GameEventContainer &item) override;
+    void sendProtocolItem(const RoomEvent &item) override;
+    void sendServerMessageItem(const ServerMessage &item) override;
 };
 
 #endif
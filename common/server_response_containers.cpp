@@ -4,10 +4,47 @@
 
 #include <google/protobuf/descriptor.h>
 
+namespace
+{
+alignas(8) thread_local char threadBlock[CommandArena::threadBlockSize];
+thread_local bool threadBlockInUse = false;
+} // namespace
+
+CommandArena::CommandArena() : ownsThreadBlock(claimThreadBlock()), arena(arenaOptions(ownsThreadBlock))
+{
+}
+
+CommandArena::~CommandArena()
+{
+    // the arena itself is destroyed after this body, but it never frees the block it was given
+    if (ownsThreadBlock)
+        threadBlockInUse = false;
+}
+
+bool CommandArena::claimThreadBlock()
+{
+    // a container processed while another one is still in progress on this thread gets a block of its own
+    if (threadBlockInUse)
+        return false;
+    threadBlockInUse = true;
+    return true;
+}
+
+::google::protobuf::ArenaOptions CommandArena::arenaOptions(bool useThreadBlock)
+{
+    ::google::protobuf::ArenaOptions options;
+    if (useThreadBlock) {
+        options.initial_block = threadBlock;
+        options.initial_block_size = sizeof(threadBlock);
+    }
+    return options;
+}
+
 GameEventStorageItem::GameEventStorageItem(const ::google::protobuf::Message &_event,
                                            int _playerId,
-                                           EventRecipients _recipients)
-    : event(new GameEvent), recipients(_recipients)
+                                           EventRecipients _recipients,
+                                           ::google::protobuf::Arena *arena)
+    : event(::google::protobuf::Arena::CreateMessage<GameEvent>(arena)), recipients(_recipients)
 {
     event->GetReflection()->MutableMessage(event, _event.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(_event);
     event->set_player_id(_playerId);
@@ -15,15 +52,19 @@ GameEventStorageItem::GameEventStorageItem(const ::google::protobuf::Message &_e
 
 GameEventStorageItem::~GameEventStorageItem()
 {
-    delete event;
+    if (!event->GetArena())
+        delete event;
 }
 
-GameEventStorage::GameEventStorage() : gameEventContext(0), privatePlayerId(0)
+GameEventStorage::GameEventStorage(::google::protobuf::Arena *_arena)
+    : arena(_arena), gameEventContext(nullptr), privatePlayerId(0)
 {
 }
 
 GameEventStorage::~GameEventStorage()
 {
+    if (arena)
+        return;
     delete gameEventContext;
     for (int i = 0; i < gameEventList.size(); ++i)
         delete gameEventList[i];
@@ -31,8 +72,9 @@ GameEventStorage::~GameEventStorage()
 
 void GameEventStorage::setGameEventContext(const ::google::protobuf::Message &_gameEventContext)
 {
-    delete gameEventContext;
-    gameEventContext = new GameEventContext;
+    if (!arena)
+        delete gameEventContext;
+    gameEventContext = ::google::protobuf::Arena::CreateMessage<GameEventContext>(arena);
     gameEventContext->GetReflection()
         ->MutableMessage(gameEventContext, _gameEventContext.GetDescriptor()->FindExtensionByName("ext"))
         ->CopyFrom(_gameEventContext);
@@ -43,49 +85,76 @@ void GameEventStorage::enqueueGameEvent(const ::google::protobuf::Message &event
                                         GameEventStorageItem::EventRecipients recipients,
                                         int _privatePlayerId)
 {
-    gameEventList.append(new GameEventStorageItem(event, playerId, recipients));
+    gameEventList.append(
+        ::google::protobuf::Arena::Create<GameEventStorageItem>(arena, event, playerId, recipients, arena));
     if (_privatePlayerId != -1)
         privatePlayerId = _privatePlayerId;
 }
 
-void GameEventStorage::sendToGame(Server_Game *game)
+bool GameEventStorage::takeGameEventContainers(GameEventContainer *&contPrivate,
+                                               GameEventContainer *&contOthers,
+                                               int &privateId)
 {
     if (gameEventList.isEmpty())
-        return;
+        return false;
 
-    GameEventContainer *contPrivate = new GameEventContainer;
-    GameEventContainer *contOthers = new GameEventContainer;
-    int id = privatePlayerId;
+    contPrivate = ::google::protobuf::Arena::CreateMessage<GameEventContainer>(arena);
+    contOthers = ::google::protobuf::Arena::CreateMessage<GameEventContainer>(arena);
+    privateId = privatePlayerId;
     if (forcedByJudge != -1) {
         contPrivate->set_forced_by_judge(forcedByJudge);
         contOthers->set_forced_by_judge(forcedByJudge);
-        id = forcedByJudge;
+        privateId = forcedByJudge;
     }
-    for (int i = 0; i < gameEventList.size(); ++i) {
-        const GameEvent &event = gameEventList[i]->getGameEvent();
-        const GameEventStorageItem::EventRecipients recipients = gameEventList[i]->getRecipients();
-        if (recipients.testFlag(GameEventStorageItem::SendToPrivate))
-            contPrivate->add_event_list()->CopyFrom(event);
-        if (recipients.testFlag(GameEventStorageItem::SendToOthers))
-            contOthers->add_event_list()->CopyFrom(event);
+    for (GameEventStorageItem *item : gameEventList) {
+        const GameEventStorageItem::EventRecipients recipients = item->getRecipients();
+        if (recipients.testFlag(GameEventStorageItem::SendToOthers)) {
+            if (recipients.testFlag(GameEventStorageItem::SendToPrivate))
+                contPrivate->add_event_list()->CopyFrom(item->getGameEvent());
+            contOthers->add_event_list()->Swap(item->mutableGameEvent());
+        } else if (recipients.testFlag(GameEventStorageItem::SendToPrivate)) {
+            contPrivate->add_event_list()->Swap(item->mutableGameEvent());
+        }
+        if (!arena)
+            delete item;
     }
+    gameEventList.clear();
+
     if (gameEventContext) {
         contPrivate->mutable_context()->CopyFrom(*gameEventContext);
-        contOthers->mutable_context()->CopyFrom(*gameEventContext);
+        contOthers->mutable_context()->Swap(gameEventContext);
+        if (!arena)
+            delete gameEventContext;
+        gameEventContext = nullptr;
     }
+    return true;
+}
+
+void GameEventStorage::sendToGame(Server_Game *game)
+{
+    GameEventContainer *contPrivate, *contOthers;
+    int id;
+    if (!takeGameEventContainers(contPrivate, contOthers, id))
+        return;
+
     game->sendGameEventContainer(contPrivate, GameEventStorageItem::SendToPrivate, id);
     game->sendGameEventContainer(contOthers, GameEventStorageItem::SendToOthers, id);
 }
 
-ResponseContainer::ResponseContainer(int _cmdId) : cmdId(_cmdId), responseExtension(0)
+ResponseContainer::ResponseContainer(int _cmdId, ::google::protobuf::Arena *_arena)
+    : cmdId(_cmdId), arena(_arena), responseExtension(nullptr)
 {
 }
 
 ResponseContainer::~ResponseContainer()
 {
-    delete responseExtension;
+    // items made with createItem() go away with the arena; the ones enqueued with new are deleted here
+    if (responseExtension && !responseExtension->GetArena())
+        delete responseExtension;
     for (int i = 0; i < preResponseQueue.size(); ++i)
-        delete preResponseQueue[i].second;
+        if (!preResponseQueue[i].second->GetArena())
+            delete preResponseQueue[i].second;
     for (int i = 0; i < postResponseQueue.size(); ++i)
-        delete postResponseQueue[i].second;
+        if (!postResponseQueue[i].second->GetArena())
+            delete postResponseQueue[i].second;
 }
@@ -5,6 +5,7 @@
 
 #include <QList>
 #include <QPair>
+#include <google/protobuf/arena.h>
 
 namespace google
 {
@@ -15,6 +16,32 @@ class Message;
 } // namespace google
 class Server_Game;
 
+/**
+ * Arena for the messages built while one command container is processed, freed in one go when the container is
+ * done. The first block of memory is kept per thread and reused by the next container, so that a typical command
+ * does not allocate its events and response from the heap at all.
+ */
+class CommandArena
+{
+private:
+    bool ownsThreadBlock;
+    ::google::protobuf::Arena arena;
+
+    static ::google::protobuf::ArenaOptions arenaOptions(bool useThreadBlock);
+    static bool claimThreadBlock();
+
+public:
+    static const int threadBlockSize = 16384;
+
+    CommandArena();
+    ~CommandArena();
+
+    ::google::protobuf::Arena *get()
+    {
+        return &arena;
+    }
+};
+
 class GameEventStorageItem
 {
 public:
@@ -29,13 +56,20 @@ private:
     EventRecipients recipients;
 
 public:
-    GameEventStorageItem(const ::google::protobuf::Message &_event, int _playerId, EventRecipients _recipients);
+    GameEventStorageItem(const ::google::protobuf::Message &_event,
+                         int _playerId,
+                         EventRecipients _recipients,
+                         ::google::protobuf::Arena *arena = nullptr);
     ~GameEventStorageItem();
 
     const GameEvent &getGameEvent() const
     {
         return *event;
     }
+    GameEvent *mutableGameEvent()
+    {
+        return event;
+    }
     EventRecipients getRecipients() const
     {
         return recipients;
@@ -46,13 +80,15 @@ Q_DECLARE_OPERATORS_FOR_FLAGS(GameEventStorageItem::EventRecipients)
 class GameEventStorage
 {
 private:
-    ::google::protobuf::Message *gameEventContext;
+    ::google::protobuf::Arena *arena;
+    GameEventContext *gameEventContext;
     QList<GameEventStorageItem *> gameEventList;
     int privatePlayerId;
     int forcedByJudge = -1;
 
 public:
-    GameEventStorage();
+    /// Events and containers are allocated on arena if one is given; it must outlive the storage.
+    explicit GameEventStorage(::google::protobuf::Arena *_arena = nullptr);
     ~GameEventStorage();
 
     void setGameEventContext(const ::google::protobuf::Message &_gameEventContext);
@@ -78,6 +114,12 @@ public:
                           GameEventStorageItem::EventRecipients recipients = GameEventStorageItem::SendToPrivate |
                                                                              GameEventStorageItem::SendToOthers,
                           int _privatePlayerId = -1);
+    /**
+     * Moves the queued events into a container for the player with id privateId and one for everybody else. Events
+     * that go to both are copied once, all others are moved. The containers belong to the caller unless the storage
+     * has an arena. Returns false if no events are queued.
+     */
+    bool takeGameEventContainers(GameEventContainer *&contPrivate, GameEventContainer *&contOthers, int &privateId);
     void sendToGame(Server_Game *game);
 };
 
@@ -85,17 +127,28 @@ class ResponseContainer
 {
 private:
     int cmdId;
+    ::google::protobuf::Arena *arena;
     ::google::protobuf::Message *responseExtension;
     QList<QPair<ServerMessage::MessageType, ::google::protobuf::Message *>> preResponseQueue, postResponseQueue;
 
 public:
-    ResponseContainer(int _cmdId);
+    ResponseContainer(int _cmdId, ::google::protobuf::Arena *_arena = nullptr);
     ~ResponseContainer();
 
     int getCmdId() const
     {
         return cmdId;
     }
+    /// The arena of the command container this responds to, or nullptr.
+    ::google::protobuf::Arena *getArena() const
+    {
+        return arena;
+    }
+    /// Creates a message that lives as long as the container, for the response extension or the queues.
+    template <typename T> T *createItem() const
+    {
+        return ::google::protobuf::Arena::CreateMessage<T>(arena);
+    }
     void setResponseExtension(::google::protobuf::Message *_responseExtension)
     {
         responseExtension = _responseExtension;
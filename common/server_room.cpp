@@ -106,11 +106,11 @@ Server_Room::getInfo(ServerInfo_Room &result, bool complete, bool showGameTypes,
     if (complete) {
         QMapIterator<QString, Server_ProtocolHandler *> userIterator(users);
         while (userIterator.hasNext())
-            result.add_user_list()->CopyFrom(userIterator.next().value()->copyUserInfo(false));
+            userIterator.next().value()->copyUserInfo(*result.add_user_list(), false);
         if (includeExternalData) {
             QMapIterator<QString, ServerInfo_User_Container> externalUserIterator(externalUsers);
             while (externalUserIterator.hasNext())
-                result.add_user_list()->CopyFrom(externalUserIterator.next().value().copyUserInfo(false));
+                externalUserIterator.next().value().copyUserInfo(*result.add_user_list(), false);
         }
     }
     usersLock.unlock();
@@ -135,17 +135,18 @@ RoomEvent *Server_Room::prepareRoomEvent(const ::google::protobuf::Message &room
     return event;
 }
 
+// addClient() and removeClient() run on the client's own thread, so its user info is read without locking
 void Server_Room::addClient(Server_ProtocolHandler *client)
 {
     Event_JoinRoom event;
-    event.mutable_user_info()->CopyFrom(client->copyUserInfo(false));
+    client->copyUserInfo(*event.mutable_user_info(), false);
     sendRoomEvent(prepareRoomEvent(event));
 
     ServerInfo_Room roomInfo;
     roomInfo.set_room_id(id);
 
     usersLock.lockForWrite();
-    users.insert(QString::fromStdString(client->getUserInfo()->name()), client);
+    users.insert(QString::fromStdString(client->getUserInfoUnlocked()->name()), client);
     roomInfo.set_player_count(users.size() + externalUsers.size());
     usersLock.unlock();
 
@@ -161,7 +162,7 @@ void Server_Room::addClient(Server_ProtocolHandler *client)
 void Server_Room::removeClient(Server_ProtocolHandler *client)
 {
     usersLock.lockForWrite();
-    users.remove(QString::fromStdString(client->getUserInfo()->name()));
+    users.remove(QString::fromStdString(client->getUserInfoUnlocked()->name()));
 
     ServerInfo_Room roomInfo;
     roomInfo.set_room_id(id);
@@ -169,7 +170,7 @@ void Server_Room::removeClient(Server_ProtocolHandler *client)
     usersLock.unlock();
 
     Event_LeaveRoom event;
-    event.set_name(client->getUserInfo()->name());
+    event.set_name(client->getUserInfoUnlocked()->name());
     sendRoomEvent(prepareRoomEvent(event));
 
     // XXX This can be removed during the next client update.
@@ -184,19 +185,25 @@ void Server_Room::removeClient(Server_ProtocolHandler *client)
 void Server_Room::addExternalUser(const ServerInfo_User &userInfo)
 {
     // This function is always called from the Server thread with server->roomsMutex locked.
-    ServerInfo_User_Container userInfoContainer(userInfo);
-    Event_JoinRoom event;
-    event.mutable_user_info()->CopyFrom(userInfoContainer.copyUserInfo(false));
-    sendRoomEvent(prepareRoomEvent(event), false);
-
+    // A peer that resyncs reports users again that have joined already; they are not announced a second time.
+    const QString name = QString::fromStdString(userInfo.name());
     ServerInfo_Room roomInfo;
     roomInfo.set_room_id(id);
 
     usersLock.lockForWrite();
-    externalUsers.insert(QString::fromStdString(userInfo.name()), userInfoContainer);
+    if (externalUsers.contains(name)) {
+        usersLock.unlock();
+        return;
+    }
+    ServerInfo_User_Container userInfoContainer(userInfo);
+    externalUsers.insert(name, userInfoContainer);
     roomInfo.set_player_count(users.size() + externalUsers.size());
     usersLock.unlock();
 
+    Event_JoinRoom event;
+    userInfoContainer.copyUserInfo(*event.mutable_user_info(), false);
+    sendRoomEvent(prepareRoomEvent(event), false);
+
     emit roomInfoChanged(roomInfo);
 }
 
@@ -237,6 +244,55 @@ void Server_Room::updateExternalGameList(const ServerInfo_Game &gameInfo)
     emit roomInfoChanged(roomInfo);
 }
 
+void Server_Room::addExternalContents(const ServerInfo_Room &externalRoom)
+{
+    // This function is always called from the Server thread with server->roomsMutex locked.
+    // Adds everything a peer reported for this room at once, so that syncing a busy peer takes each lock only once
+    // instead of once per user and game. Only users that are new to the room are announced.
+    ServerInfo_Room roomInfo;
+    roomInfo.set_room_id(id);
+
+    QList<RoomEvent *> joinEvents;
+    usersLock.lockForWrite();
+    for (int i = 0; i < externalRoom.user_list_size(); ++i) {
+        const QString name = QString::fromStdString(externalRoom.user_list(i).name());
+        if (externalUsers.contains(name))
+            continue;
+        ServerInfo_User_Container userInfoContainer(externalRoom.user_list(i));
+        Event_JoinRoom event;
+        userInfoContainer.copyUserInfo(*event.mutable_user_info(), false);
+        joinEvents.append(prepareRoomEvent(event));
+        externalUsers.insert(name, userInfoContainer);
+    }
+    roomInfo.set_player_count(users.size() + externalUsers.size());
+    usersLock.unlock();
+
+    Event_ListGames gamesEvent;
+    gamesLock.lockForWrite();
+    for (int i = 0; i < externalRoom.game_list_size(); ++i) {
+        const ServerInfo_Game &gameInfo = externalRoom.game_list(i);
+        externalGames.insert(gameInfo.game_id(), gameInfo);
+        gamesEvent.add_game_list()->CopyFrom(gameInfo);
+    }
+    roomInfo.set_game_count(games.size() + externalGames.size());
+    gamesLock.unlock();
+
+    usersLock.lockForRead();
+    for (RoomEvent *event : joinEvents) {
+        QMapIterator<QString, Server_ProtocolHandler *> userIterator(users);
+        while (userIterator.hasNext())
+            userIterator.next().value()->sendProtocolItem(*event);
+        getServer()->getMetrics()->broadcastSent(ServerMetrics::RoomBroadcast, users.size());
+        delete event;
+    }
+    usersLock.unlock();
+
+    if (gamesEvent.game_list_size() > 0)
+        sendRoomEvent(prepareRoomEvent(gamesEvent), false);
+
+    emit roomInfoChanged(roomInfo);
+}
+
 Response::ResponseCode Server_Room::processJoinGameCommand(const Command_JoinGame &cmd,
                                                            ResponseContainer &rc,
                                                            Server_AbstractUserInterface *userInterface)
@@ -268,7 +324,7 @@ Response::ResponseCode Server_Room::processJoinGameCommand(const Command_JoinGam
     QMutexLocker gameLocker(&game->gameMutex);
 
     Response::ResponseCode result =
-        game->checkJoin(userInterface->getUserInfo(), QString::fromStdString(cmd.password()), cmd.spectator(),
+        game->checkJoin(userInterface->getUserInfo().get(), QString::fromStdString(cmd.password()), cmd.spectator(),
                         cmd.override_restrictions(), cmd.join_as_judge());
     if (result == Response::RespOk)
         game->addPlayer(userInterface, rc, cmd.spectator(), cmd.join_as_judge());
@@ -331,6 +387,7 @@ void Server_Room::sendRoomEvent(RoomEvent *event, bool sendToIsl)
         while (userIterator.hasNext())
             userIterator.next().value()->sendProtocolItem(*event);
     }
+    getServer()->getMetrics()->broadcastSent(ServerMetrics::RoomBroadcast, users.size());
     usersLock.unlock();
 
     if (sendToIsl)
@@ -356,6 +413,7 @@ void Server_Room::addGame(Server_Game *game)
 
     game->gameMutex.lock();
     games.insert(game->getGameId(), game);
+    getServer()->gameAdded();
     ServerInfo_Game gameInfo;
     game->getInfo(gameInfo);
     roomInfo.set_game_count(games.size() + externalGames.size());
@@ -383,7 +441,8 @@ void Server_Room::removeGame(Server_Game *game)
     game->getInfo(gameInfo);
     emit gameListChanged(gameInfo);
 
-    games.remove(game->getGameId());
+    if (games.remove(game->getGameId()))
+        getServer()->gameRemoved();
 
     ServerInfo_Room roomInfo;
     roomInfo.set_room_id(id);
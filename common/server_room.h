@@ -126,6 +126,7 @@ public:
         return externalUsers;
     }
     void updateExternalGameList(const ServerInfo_Game &gameInfo);
+    void addExternalContents(const ServerInfo_Room &externalRoom);
 
     Response::ResponseCode processJoinGameCommand(const Command_JoinGame &cmd,
                                                   ResponseContainer &rc,
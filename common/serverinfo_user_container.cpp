@@ -2,31 +2,39 @@
 
 #include "pb/serverinfo_user.pb.h"
 
-ServerInfo_User_Container::ServerInfo_User_Container(ServerInfo_User *_userInfo) : userInfo(_userInfo)
+ServerInfo_User_Container::ServerInfo_User_Container() : userInfo(nullptr)
 {
 }
 
 ServerInfo_User_Container::ServerInfo_User_Container(const ServerInfo_User &_userInfo)
-    : userInfo(new ServerInfo_User(_userInfo))
+    : record(ServerInfo_User_Registry::instance().intern(_userInfo)), userInfo(&record->getInfo())
 {
 }
 
 ServerInfo_User_Container::ServerInfo_User_Container(const ServerInfo_User_Container &other)
+    : record(other.getUserInfoRecord()), userInfo(record ? &record->getInfo() : nullptr)
 {
-    if (other.userInfo)
-        userInfo = new ServerInfo_User(*other.userInfo);
-    else
-        userInfo = nullptr;
 }
 
-ServerInfo_User_Container::~ServerInfo_User_Container()
+ServerInfo_User_Container &ServerInfo_User_Container::operator=(const ServerInfo_User_Container &other)
 {
-    delete userInfo;
+    if (this != &other) {
+        // never hold both locks, so two containers assigned to each other cannot deadlock
+        ServerInfo_User_Handle newRecord = other.getUserInfoRecord();
+        QMutexLocker locker(&recordMutex);
+        record.swap(newRecord);
+        userInfo = record ? &record->getInfo() : nullptr;
+    }
+    return *this;
 }
 
 void ServerInfo_User_Container::setUserInfo(const ServerInfo_User &_userInfo)
 {
-    userInfo = new ServerInfo_User(_userInfo);
+    ServerInfo_User_Handle newRecord = ServerInfo_User_Registry::instance().intern(_userInfo);
+    QMutexLocker locker(&recordMutex);
+    record.swap(newRecord);
+    userInfo = &record->getInfo();
+    // the previous record is released here; readers on other threads hold their own reference to it
 }
 
 ServerInfo_User &ServerInfo_User_Container::copyUserInfo(ServerInfo_User &result,
@@ -34,20 +42,27 @@ ServerInfo_User &ServerInfo_User_Container::copyUserInfo(ServerInfo_User &result
                                                          bool internalInfo,
                                                          bool sessionInfo) const
 {
-    if (userInfo) {
-        result.CopyFrom(*userInfo);
-        if (!sessionInfo) {
-            result.clear_session_id();
-            result.clear_address();
-            result.clear_clientid();
-        }
-        if (!internalInfo) {
-            result.clear_id();
-            result.clear_email();
-        }
-        if (!complete)
-            result.clear_avatar_bmp();
+    const ServerInfo_User_Handle current = getUserInfoRecord();
+    if (!current)
+        return result;
+
+    if (!complete && !internalInfo && !sessionInfo) {
+        result.CopyFrom(current->getPublicInfo());
+        return result;
+    }
+
+    result.CopyFrom(current->getInfo());
+    if (!sessionInfo) {
+        result.clear_session_id();
+        result.clear_address();
+        result.clear_clientid();
+    }
+    if (!internalInfo) {
+        result.clear_id();
+        result.clear_email();
     }
+    if (!complete)
+        result.clear_avatar_bmp();
     return result;
 }
 
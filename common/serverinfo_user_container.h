@@ -1,24 +1,78 @@
 #ifndef SERVERINFO_USER_CONTAINER
 #define SERVERINFO_USER_CONTAINER
 
-class ServerInfo_User;
+#include "serverinfo_user_registry.h"
+
+#include <QMutex>
+#include <utility>
+
+/**
+ * Points to the user info of a record and keeps that record alive, so the info stays valid while the owner of the
+ * container replaces it from another thread.
+ */
+class ServerInfo_User_Ptr
+{
+private:
+    ServerInfo_User_Handle record;
+
+public:
+    ServerInfo_User_Ptr() = default;
+    explicit ServerInfo_User_Ptr(ServerInfo_User_Handle _record) : record(std::move(_record))
+    {
+    }
+    const ServerInfo_User *get() const
+    {
+        return record ? &record->getInfo() : nullptr;
+    }
+    const ServerInfo_User *operator->() const
+    {
+        return get();
+    }
+    const ServerInfo_User &operator*() const
+    {
+        return record->getInfo();
+    }
+    explicit operator bool() const
+    {
+        return !record.isNull();
+    }
+};
 
 class ServerInfo_User_Container
 {
+private:
+    // guards record and userInfo against readers on other threads while setUserInfo() replaces them
+    mutable QMutex recordMutex;
+
 protected:
-    ServerInfo_User *userInfo;
+    ServerInfo_User_Handle record;
+    /// Points into record, or nullptr before the user info is known. Only for the thread that calls setUserInfo();
+    /// other threads use the accessors below, which hand out a reference to the whole record.
+    const ServerInfo_User *userInfo;
 
 public:
-    ServerInfo_User_Container(ServerInfo_User *_userInfo = nullptr);
+    ServerInfo_User_Container();
     ServerInfo_User_Container(const ServerInfo_User &_userInfo);
     ServerInfo_User_Container(const ServerInfo_User_Container &other);
-    ServerInfo_User_Container &operator=(const ServerInfo_User_Container &other) = default;
-    virtual ~ServerInfo_User_Container();
-    ServerInfo_User *getUserInfo() const
+    ServerInfo_User_Container &operator=(const ServerInfo_User_Container &other);
+    virtual ~ServerInfo_User_Container() = default;
+    ServerInfo_User_Ptr getUserInfo() const
+    {
+        return ServerInfo_User_Ptr(getUserInfoRecord());
+    }
+    /// Reads without locking. Only for the thread that calls setUserInfo(), or for containers whose info is never
+    /// replaced after construction, such as players.
+    const ServerInfo_User *getUserInfoUnlocked() const
     {
         return userInfo;
     }
+    ServerInfo_User_Handle getUserInfoRecord() const
+    {
+        QMutexLocker locker(&recordMutex);
+        return record;
+    }
     void setUserInfo(const ServerInfo_User &_userInfo);
+    /// With only complete set to false, this copies the public info kept in the record as it is.
     ServerInfo_User &
     copyUserInfo(ServerInfo_User &result, bool complete, bool internalInfo = false, bool sessionInfo = false) const;
     ServerInfo_User copyUserInfo(bool complete, bool internalInfo = false, bool sessionInfo = false) const;
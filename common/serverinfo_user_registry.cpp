@@ -0,0 +1,78 @@
+#include "serverinfo_user_registry.h"
+
+#include <QMutexLocker>
+#include <google/protobuf/util/message_differencer.h>
+
+using google::protobuf::util::MessageDifferencer;
+
+ServerInfo_User_Record::ServerInfo_User_Record(const ServerInfo_User &_info) : info(_info), publicInfo(_info)
+{
+    publicInfo.clear_session_id();
+    publicInfo.clear_address();
+    publicInfo.clear_clientid();
+    publicInfo.clear_id();
+    publicInfo.clear_email();
+    publicInfo.clear_avatar_bmp();
+}
+
+ServerInfo_User_Registry::ServerInfo_User_Registry() : sweepThreshold(1024)
+{
+}
+
+ServerInfo_User_Registry &ServerInfo_User_Registry::instance()
+{
+    static ServerInfo_User_Registry registry;
+    return registry;
+}
+
+ServerInfo_User_Handle ServerInfo_User_Registry::intern(const ServerInfo_User &userInfo)
+{
+    // most calls find the same info again, so it is compared field by field before a record with its copies is built
+    const QString name = QString::fromStdString(userInfo.name());
+
+    QMutexLocker locker(&mutex);
+    const ServerInfo_User_Handle known = records.value(name).toStrongRef();
+    if (known && MessageDifferencer::Equals(known->getInfo(), userInfo))
+        return known;
+    locker.unlock();
+
+    ServerInfo_User_Handle candidate(new ServerInfo_User_Record(userInfo));
+
+    locker.relock();
+    auto existing = records.find(name);
+    if (existing != records.end()) {
+        // another thread may have interned the same info in the meantime
+        ServerInfo_User_Handle record = existing.value().toStrongRef();
+        if (record && MessageDifferencer::Equals(record->getInfo(), userInfo))
+            return record;
+        existing.value() = candidate;
+        return candidate;
+    }
+
+    records.insert(name, candidate);
+    if (records.size() >= sweepThreshold)
+        sweep();
+    return candidate;
+}
+
+void ServerInfo_User_Registry::sweep()
+{
+    // names of users that left stay in the map until here; sweeping when it doubled keeps this amortized
+    for (auto it = records.begin(); it != records.end();) {
+        if (it.value().isNull())
+            it = records.erase(it);
+        else
+            ++it;
+    }
+    sweepThreshold = qMax(1024, records.size() * 2);
+}
+
+int ServerInfo_User_Registry::liveRecordCount()
+{
+    QMutexLocker locker(&mutex);
+    int result = 0;
+    for (const auto &record : records)
+        if (!record.isNull())
+            ++result;
+    return result;
+}
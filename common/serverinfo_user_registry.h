@@ -0,0 +1,60 @@
+#ifndef SERVERINFO_USER_REGISTRY_H
+#define SERVERINFO_USER_REGISTRY_H
+
+#include "pb/serverinfo_user.pb.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+/**
+ * Immutable snapshot of one user's info. Next to the complete info it keeps the public variant that user lists,
+ * join events and game listings send to everybody, so those are copied as they are instead of being copied and
+ * stripped of the session, internal and avatar fields every time.
+ */
+class ServerInfo_User_Record
+{
+private:
+    ServerInfo_User info;
+    ServerInfo_User publicInfo;
+
+public:
+    explicit ServerInfo_User_Record(const ServerInfo_User &_info);
+
+    const ServerInfo_User &getInfo() const
+    {
+        return info;
+    }
+    const ServerInfo_User &getPublicInfo() const
+    {
+        return publicInfo;
+    }
+};
+
+typedef QSharedPointer<const ServerInfo_User_Record> ServerInfo_User_Handle;
+
+/**
+ * Hands out shared records, so that the session, its players, the rooms and the ISL copies of one user all point to
+ * the same record instead of each holding their own copy. Records are freed when the last handle goes away.
+ */
+class ServerInfo_User_Registry
+{
+private:
+    QMutex mutex;
+    QHash<QString, QWeakPointer<const ServerInfo_User_Record>> records;
+    int sweepThreshold;
+
+    ServerInfo_User_Registry();
+    void sweep();
+
+public:
+    static ServerInfo_User_Registry &instance();
+
+    /// Returns the record of userInfo's user if it holds the same info, or a new record that replaces it.
+    ServerInfo_User_Handle intern(const ServerInfo_User &userInfo);
+    /// Number of user names that currently have a live record.
+    int liveRecordCount();
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "stream_compression.h"
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+#ifdef HAS_ZLIB
+// small windows keep the per connection state at ~48KB for the compressor and ~8KB for the decompressor
+const int windowBits = 13;
+const int memLevel = 5;
+
+// every flushed message ends with an empty stored block; it is not sent and added back before inflating
+const char flushMarker[] = {'\x00', '\x00', '\xff', '\xff'};
+const int flushMarkerSize = 4;
+
+// Strings that recur in serialized messages: zone, counter and phase names, privilege levels, game types and common
+// card text. Deflate finds matches more cheaply at short distances, so the most frequent ones come last.
+const char dictionary[] = "CockatriceservatriceMain roomThe game has startedhas joined the gamehas left the game"
+                          "concededready to startnot ready to startrolls a d20sideboardLegendaryTokenPlaneswalker"
+                          "EnchantmentArtifactInstantSorceryCreatureLandBasicCommanderLegacyVintageModernPioneer"
+                          "StandardPauperSealedDraftStarting handMulligancolorlessstormenergypoisonwhitebluebla"
+                          "ckredgreenlifeDONATORVIPJUDGEADMINMODERATORNONEuntapsdrawsmovesputsdeckgraverfgsbstack"
+                          "handtable";
+#endif
+} // namespace
+
+StreamCompressor::StreamCompressor(int level) : stream(nullptr)
+{
+#ifdef HAS_ZLIB
+    stream = new z_stream;
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    // raw deflate: the frames carry the length, a zlib header and checksum would only add bytes
+    if (deflateInit2(stream, level, Z_DEFLATED, -windowBits, memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete stream;
+        stream = nullptr;
+        return;
+    }
+    deflateSetDictionary(stream, reinterpret_cast<const Bytef *>(dictionary), sizeof(dictionary) - 1);
+#else
+    Q_UNUSED(level);
+#endif
+}
+
+StreamCompressor::~StreamCompressor()
+{
+#ifdef HAS_ZLIB
+    if (stream) {
+        deflateEnd(stream);
+        delete stream;
+    }
+#endif
+}
+
+bool StreamCompressor::isAvailable()
+{
+#ifdef HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool StreamCompressor::compress(const char *data, int size, QByteArray &out)
+{
+#ifdef HAS_ZLIB
+    // an empty message would not produce a flushed block
+    if (!stream || size <= 0)
+        return false;
+
+    const int start = out.size();
+    int written = 0;
+    int capacity = static_cast<int>(deflateBound(stream, static_cast<uLong>(size))) + 16;
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream->avail_in = static_cast<uInt>(size);
+    do {
+        out.resize(start + capacity);
+        stream->next_out = reinterpret_cast<Bytef *>(out.data() + start + written);
+        stream->avail_out = static_cast<uInt>(capacity - written);
+        const int result = deflate(stream, Z_SYNC_FLUSH);
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            out.resize(start);
+            return false;
+        }
+        written = capacity - static_cast<int>(stream->avail_out);
+        capacity *= 2;
+    } while (stream->avail_out == 0);
+
+    out.resize(start + written - flushMarkerSize);
+    return true;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    Q_UNUSED(out);
+    return false;
+#endif
+}
+
+StreamDecompressor::StreamDecompressor() : stream(nullptr)
+{
+#ifdef HAS_ZLIB
+    stream = new z_stream;
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    stream->next_in = Z_NULL;
+    stream->avail_in = 0;
+    if (inflateInit2(stream, -windowBits) != Z_OK) {
+        delete stream;
+        stream = nullptr;
+        return;
+    }
+    inflateSetDictionary(stream, reinterpret_cast<const Bytef *>(dictionary), sizeof(dictionary) - 1);
+#endif
+}
+
+StreamDecompressor::~StreamDecompressor()
+{
+#ifdef HAS_ZLIB
+    if (stream) {
+        inflateEnd(stream);
+        delete stream;
+    }
+#endif
+}
+
+bool StreamDecompressor::decompress(const char *data, int size, QByteArray &out)
+{
+#ifdef HAS_ZLIB
+    if (!stream)
+        return false;
+
+    QByteArray input(data, size);
+    input.append(flushMarker, flushMarkerSize);
+    stream->next_in = reinterpret_cast<Bytef *>(input.data());
+    stream->avail_in = static_cast<uInt>(input.size());
+
+    const int start = out.size();
+    int written = 0;
+    int capacity = qMax(size * 4, 256);
+    do {
+        out.resize(start + capacity);
+        stream->next_out = reinterpret_cast<Bytef *>(out.data() + start + written);
+        stream->avail_out = static_cast<uInt>(capacity - written);
+        const int result = inflate(stream, Z_SYNC_FLUSH);
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            inflateEnd(stream);
+            delete stream;
+            stream = nullptr;
+            out.resize(start);
+            return false;
+        }
+        written = capacity - static_cast<int>(stream->avail_out);
+        capacity *= 2;
+    } while (stream->avail_out == 0);
+
+    out.resize(start + written);
+    return true;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    Q_UNUSED(out);
+    return false;
+#endif
+}
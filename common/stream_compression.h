@@ -0,0 +1,56 @@
+#ifndef STREAM_COMPRESSION_H
+#define STREAM_COMPRESSION_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+struct z_stream_s;
+
+/**
+ * Deflate compression of the server to client message stream.
+ *
+ * Compressed messages are sent in the usual length-prefixed frames with StreamCompressedFrameFlag set in the length.
+ * Both ends keep one deflate stream per connection, so every message is compressed with the history of the previous
+ * ones; the stream starts from a dictionary of strings that are frequent in serialized messages. Each message is
+ * flushed on its own and can be decoded as soon as its frame is complete.
+ *
+ * Compression is only available when built with zlib; see isAvailable().
+ */
+static const quint32 StreamCompressedFrameFlag = 0x80000000u;
+
+class StreamCompressor
+{
+public:
+    static const int DefaultLevel = 3;
+
+private:
+    z_stream_s *stream;
+
+public:
+    explicit StreamCompressor(int level = DefaultLevel);
+    ~StreamCompressor();
+    StreamCompressor(const StreamCompressor &) = delete;
+    StreamCompressor &operator=(const StreamCompressor &) = delete;
+
+    static bool isAvailable();
+
+    /** Appends the compressed form of one non-empty message to out; returns false if it can't be compressed. */
+    bool compress(const char *data, int size, QByteArray &out);
+};
+
+class StreamDecompressor
+{
+private:
+    z_stream_s *stream;
+
+public:
+    StreamDecompressor();
+    ~StreamDecompressor();
+    StreamDecompressor(const StreamDecompressor &) = delete;
+    StreamDecompressor &operator=(const StreamDecompressor &) = delete;
+
+    /** Appends one decompressed message to out; returns false on corrupt data, after which the stream is unusable. */
+    bool decompress(const char *data, int size, QByteArray &out);
+};
+
+#endif
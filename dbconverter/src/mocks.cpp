@@ -205,6 +205,18 @@ void SettingsCache::setPixmapCacheSize(const int /* _pixmapCacheSize */)
 void SettingsCache::setNetworkCacheSizeInMB(const int /* _networkCacheSize */)
 {
 }
+void SettingsCache::setThumbnailCacheSize(const int /* _thumbnailCacheSize */)
+{
+}
+void SettingsCache::setTablePictureCacheSize(const int /* _tablePictureCacheSize */)
+{
+}
+void SettingsCache::setFullPictureCacheSize(const int /* _fullPictureCacheSize */)
+{
+}
+void SettingsCache::setPictureDiskCacheSize(const int /* _pictureDiskCacheSize */)
+{
+}
 void SettingsCache::setClientID(const QString & /* _clientID */)
 {
 }
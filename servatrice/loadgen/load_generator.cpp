@@ -0,0 +1,158 @@
+#include "load_generator.h"
+
+#include <QTimer>
+#include <iostream>
+
+LoadGenerator::LoadGenerator(const LoadGenOptions &_options,
+                             int _clientCount,
+                             int _connectRate,
+                             int _durationSecs,
+                             int reportIntervalSecs,
+                             int lobbyPercent,
+                             int spectatorsPerGame,
+                             QObject *parent)
+    : QObject(parent), options(_options), clientCount(_clientCount), connectRate(qMax(_connectRate, 1)),
+      durationSecs(_durationSecs), clientsStarted(0), clientsLoggedIn(0), gamesRunning(0)
+{
+    const int tableSize = 2 + qMax(spectatorsPerGame, 0);
+    const int lobbyCount = clientCount * qBound(0, lobbyPercent, 100) / 100;
+    const int tableCount = (clientCount - lobbyCount) / tableSize;
+
+    for (int i = 0; i < clientCount; ++i) {
+        const int table = i / tableSize;
+        LoadGenClient::Role role = LoadGenClient::LobbyRole;
+        if (table < tableCount) {
+            const int seat = i % tableSize;
+            role = seat == 0 ? LoadGenClient::HostRole
+                             : (seat == 1 ? LoadGenClient::OpponentRole : LoadGenClient::SpectatorRole);
+        }
+
+        auto *client = new LoadGenClient(options, &stats, QString("loadgen%1").arg(i), role, this);
+        connect(client, SIGNAL(loggedInToRoom(LoadGenClient *)), this, SLOT(clientLoggedIn(LoadGenClient *)));
+        connect(client, SIGNAL(gameJoined(LoadGenClient *, int)), this, SLOT(clientJoinedGame(LoadGenClient *, int)));
+        connect(client, SIGNAL(gameFinished(LoadGenClient *)), this, SLOT(clientFinishedGame(LoadGenClient *)));
+        connect(client, SIGNAL(connectionLost(LoadGenClient *)), this, SLOT(clientLostConnection(LoadGenClient *)));
+        clients.append(client);
+
+        if (role != LoadGenClient::LobbyRole) {
+            if (tables.size() <= table)
+                tables.append(QList<LoadGenClient *>());
+            tables[table].append(client);
+            tableOfClient.insert(client, table);
+        }
+    }
+
+    connectTimer = new QTimer(this);
+    connectTimer->setInterval(100);
+    connect(connectTimer, SIGNAL(timeout()), this, SLOT(connectNextClients()));
+
+    reportTimer = new QTimer(this);
+    reportTimer->setInterval(qMax(reportIntervalSecs, 1) * 1000);
+    connect(reportTimer, SIGNAL(timeout()), this, SLOT(report()));
+}
+
+void LoadGenerator::start()
+{
+    std::cout << "Connecting " << clientCount << " clients to " << options.host.toStdString() << ":" << options.port
+              << " at " << connectRate << " per second, " << tables.size() << " tables" << std::endl;
+    connectNextClients();
+    connectTimer->start();
+    reportTimer->start();
+    if (durationSecs > 0)
+        QTimer::singleShot(durationSecs * 1000, this, SLOT(stop()));
+}
+
+void LoadGenerator::stop()
+{
+    connectTimer->stop();
+    reportTimer->stop();
+    std::cout << stats.finalReport().toStdString() << std::endl;
+
+    for (LoadGenClient *client : clients)
+        client->disconnectFromServer();
+    emit finished();
+}
+
+void LoadGenerator::connectNextClients()
+{
+    // the timer fires ten times a second
+    const int target = qMin(clientsStarted + (connectRate + 9) / 10, clientCount);
+    while (clientsStarted < target)
+        clients[clientsStarted++]->connectToServer();
+    if (clientsStarted == clientCount)
+        connectTimer->stop();
+}
+
+void LoadGenerator::report()
+{
+    std::cout << stats.intervalReport(clientsLoggedIn, gamesRunning).toStdString() << std::endl;
+}
+
+void LoadGenerator::seatTable(int table)
+{
+    const QList<LoadGenClient *> &members = tables[table];
+    if (members.isEmpty())
+        return;
+    for (LoadGenClient *member : members)
+        if (!member->isLoggedIn())
+            return;
+    members.first()->createGame();
+}
+
+void LoadGenerator::clientLoggedIn(LoadGenClient *client)
+{
+    ++clientsLoggedIn;
+    if (tableOfClient.contains(client))
+        seatTable(tableOfClient.value(client));
+}
+
+void LoadGenerator::clientJoinedGame(LoadGenClient *client, int gameId)
+{
+    if (client->getRole() != LoadGenClient::HostRole)
+        return;
+    const QList<LoadGenClient *> &members = tables[tableOfClient.value(client)];
+    if (members.isEmpty()) {
+        // somebody at the table was lost while the game was being created
+        client->leaveGame();
+        return;
+    }
+
+    ++gamesRunning;
+    for (LoadGenClient *member : members)
+        if (member != client)
+            member->joinGame(gameId);
+}
+
+void LoadGenerator::clientFinishedGame(LoadGenClient *client)
+{
+    const QList<LoadGenClient *> &members = tables[tableOfClient.value(client)];
+    if (members.isEmpty())
+        return;
+
+    --gamesRunning;
+    // the game is closed once both players are gone, which also sends the spectators away
+    for (LoadGenClient *member : members)
+        if (member->getRole() != LoadGenClient::SpectatorRole)
+            member->leaveGame();
+    client->createGame();
+}
+
+void LoadGenerator::clientLostConnection(LoadGenClient *client)
+{
+    stats.connectionLost();
+    if (client->isLoggedIn())
+        --clientsLoggedIn;
+
+    const int table = tableOfClient.value(client, -1);
+    if (table == -1 || tables[table].isEmpty())
+        return;
+
+    // the rest of the table stays in the room without playing
+    LoadGenClient *host = tables[table].first();
+    if (host->getGameId() != -1)
+        --gamesRunning;
+    for (LoadGenClient *member : tables[table])
+        if (member != client && member->getRole() != LoadGenClient::SpectatorRole)
+            member->leaveGame();
+    tables[table].clear();
+}
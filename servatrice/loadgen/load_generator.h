@@ -0,0 +1,63 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include "loadgen_client.h"
+#include "loadgen_stats.h"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class QTimer;
+
+/**
+ * Connects the simulated clients at a steady rate and seats them: a share of them stays in the room and chats, the
+ * others are split into tables of a host, an opponent and a number of spectators. When everybody at a table is in
+ * the room, the host creates a game, the others join it, and after the scripted number of turns the players leave
+ * and the host starts the next one. Prints the measurements every report interval and once more at the end.
+ */
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+private:
+    LoadGenOptions options;
+    LoadGenStats stats;
+    int clientCount, connectRate, durationSecs;
+
+    QList<LoadGenClient *> clients;
+    QList<QList<LoadGenClient *>> tables;
+    QHash<LoadGenClient *, int> tableOfClient;
+    int clientsStarted, clientsLoggedIn, gamesRunning;
+
+    QTimer *connectTimer, *reportTimer;
+
+    void seatTable(int table);
+
+private slots:
+    void connectNextClients();
+    void clientLoggedIn(LoadGenClient *client);
+    void clientJoinedGame(LoadGenClient *client, int gameId);
+    void clientFinishedGame(LoadGenClient *client);
+    void clientLostConnection(LoadGenClient *client);
+    void report();
+
+signals:
+    void finished();
+
+public:
+    LoadGenerator(const LoadGenOptions &_options,
+                  int _clientCount,
+                  int _connectRate,
+                  int _durationSecs,
+                  int reportIntervalSecs,
+                  int lobbyPercent,
+                  int spectatorsPerGame,
+                  QObject *parent = nullptr);
+
+    void start();
+
+public slots:
+    void stop();
+};
+
+#endif
@@ -0,0 +1,450 @@
+#include "loadgen_client.h"
+
+#include "loadgen_stats.h"
+#include "pb/command_deck_select.pb.h"
+#include "pb/command_draw_cards.pb.h"
+#include "pb/command_game_say.pb.h"
+#include "pb/command_leave_game.pb.h"
+#include "pb/command_move_card.pb.h"
+#include "pb/command_mulligan.pb.h"
+#include "pb/command_next_turn.pb.h"
+#include "pb/command_ready_start.pb.h"
+#include "pb/command_shuffle.pb.h"
+#include "pb/event_connection_closed.pb.h"
+#include "pb/event_draw_cards.pb.h"
+#include "pb/event_game_closed.pb.h"
+#include "pb/event_game_joined.pb.h"
+#include "pb/event_game_state_changed.pb.h"
+#include "pb/event_move_card.pb.h"
+#include "pb/event_server_identification.pb.h"
+#include "pb/event_set_active_player.pb.h"
+#include "pb/room_commands.pb.h"
+#include "pb/session_commands.pb.h"
+#include "stream_compression.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QTcpSocket>
+#include <QTimer>
+
+LoadGenClient::LoadGenClient(const LoadGenOptions &_options,
+                             LoadGenStats *_stats,
+                             const QString &_userName,
+                             Role _role,
+                             QObject *parent)
+    : QObject(parent), options(_options), stats(_stats), userName(_userName), role(_role), messageInProgress(false),
+      messageCompressed(false), messageLength(0), inputDecompressor(nullptr), serverOffersCompression(false),
+      nextCmdId(0), scriptedInFlight(0), loggedIn(false), dropped(false), ticks(0), gameId(-1), gamesPlayed(0)
+{
+    socket = new QTcpSocket(this);
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(socket, SIGNAL(connected()), this, SLOT(socketConnected()));
+    connect(socket, SIGNAL(readyRead()), this, SLOT(readData()));
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    connect(socket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this,
+            SLOT(socketError(QAbstractSocket::SocketError)));
+#else
+    connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(socketError(QAbstractSocket::SocketError)));
+#endif
+
+    actTimer = new QTimer(this);
+    actTimer->setInterval(options.thinkTimeMs);
+    connect(actTimer, SIGNAL(timeout()), this, SLOT(act()));
+
+    resetGame();
+}
+
+LoadGenClient::~LoadGenClient()
+{
+    delete inputDecompressor;
+}
+
+void LoadGenClient::connectToServer()
+{
+    socket->connectToHost(options.host, options.port);
+}
+
+void LoadGenClient::disconnectFromServer()
+{
+    dropped = true;
+    actTimer->stop();
+    loggedIn = false;
+    socket->disconnectFromHost();
+}
+
+void LoadGenClient::socketConnected()
+{
+    // the first container has no id and starts the session, like the desktop client does
+    CommandContainer handshake;
+    sendCommandContainer(handshake, QString(), false);
+}
+
+void LoadGenClient::dropConnection()
+{
+    if (dropped)
+        return;
+    dropped = true;
+    // reported while the client still looks logged in, so that the generator can tell what it lost
+    emit connectionLost(this);
+    disconnectFromServer();
+}
+
+void LoadGenClient::socketError(QAbstractSocket::SocketError /* error */)
+{
+    if (dropped)
+        return;
+    qWarning() << userName << "connection error:" << socket->errorString();
+    dropConnection();
+}
+
+void LoadGenClient::readData()
+{
+    const QByteArray data = socket->readAll();
+    stats->bytesReceived(data.size());
+    inputBuffer.append(data);
+
+    do {
+        if (!messageInProgress) {
+            if (inputBuffer.size() < 4)
+                return;
+            const quint32 frameHeader = (((quint32)(unsigned char)inputBuffer[0]) << 24) +
+                                        (((quint32)(unsigned char)inputBuffer[1]) << 16) +
+                                        (((quint32)(unsigned char)inputBuffer[2]) << 8) +
+                                        ((quint32)(unsigned char)inputBuffer[3]);
+            messageCompressed = frameHeader & StreamCompressedFrameFlag;
+            messageLength = static_cast<int>(frameHeader & ~StreamCompressedFrameFlag);
+            inputBuffer.remove(0, 4);
+            messageInProgress = true;
+        }
+        if (inputBuffer.size() < messageLength)
+            return;
+
+        ServerMessage message;
+        if (messageCompressed) {
+            if (!inputDecompressor)
+                inputDecompressor = new StreamDecompressor;
+            QByteArray decompressed;
+            if (!inputDecompressor->decompress(inputBuffer.constData(), messageLength, decompressed)) {
+                qWarning() << userName << "received a corrupt compressed message, disconnecting";
+                dropConnection();
+                return;
+            }
+            message.ParseFromArray(decompressed.constData(), decompressed.size());
+        } else {
+            message.ParseFromArray(inputBuffer.constData(), messageLength);
+        }
+        inputBuffer.remove(0, messageLength);
+        messageInProgress = false;
+
+        stats->messageReceived();
+        processServerMessage(message);
+    } while (!inputBuffer.isEmpty());
+}
+
+quint64 LoadGenClient::sendCommandContainer(CommandContainer &cont, const QString &type, bool scripted)
+{
+    if (!type.isEmpty()) {
+        cont.set_cmd_id(++nextCmdId);
+        pendingCommands.insert(nextCmdId, PendingCommand{type, stats->now(), scripted});
+        if (scripted)
+            ++scriptedInFlight;
+    }
+
+    const auto size = static_cast<unsigned int>(cont.ByteSizeLong());
+    QByteArray buf;
+    buf.resize(static_cast<int>(size) + 4);
+    cont.SerializeToArray(buf.data() + 4, static_cast<int>(size));
+    buf.data()[3] = (unsigned char)size;
+    buf.data()[2] = (unsigned char)(size >> 8);
+    buf.data()[1] = (unsigned char)(size >> 16);
+    buf.data()[0] = (unsigned char)(size >> 24);
+    socket->write(buf);
+    stats->bytesSent(buf.size());
+    return cont.cmd_id();
+}
+
+quint64 LoadGenClient::sendSessionCommand(const ::google::protobuf::Message &cmd, bool scripted)
+{
+    CommandContainer cont;
+    SessionCommand *c = cont.add_session_command();
+    c->GetReflection()->MutableMessage(c, cmd.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(cmd);
+    return sendCommandContainer(cont, QString::fromStdString(cmd.GetDescriptor()->name()), scripted);
+}
+
+quint64 LoadGenClient::sendRoomCommand(const ::google::protobuf::Message &cmd, bool scripted)
+{
+    CommandContainer cont;
+    cont.set_room_id(static_cast<google::protobuf::uint32>(options.roomId));
+    RoomCommand *c = cont.add_room_command();
+    c->GetReflection()->MutableMessage(c, cmd.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(cmd);
+    return sendCommandContainer(cont, QString::fromStdString(cmd.GetDescriptor()->name()), scripted);
+}
+
+quint64 LoadGenClient::sendGameCommand(const ::google::protobuf::Message &cmd, bool scripted)
+{
+    CommandContainer cont;
+    cont.set_game_id(static_cast<google::protobuf::uint32>(gameId));
+    GameCommand *c = cont.add_game_command();
+    c->GetReflection()->MutableMessage(c, cmd.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(cmd);
+    return sendCommandContainer(cont, QString::fromStdString(cmd.GetDescriptor()->name()), scripted);
+}
+
+void LoadGenClient::processServerMessage(const ServerMessage &message)
+{
+    switch (message.message_type()) {
+        case ServerMessage::RESPONSE:
+            processResponse(message.response());
+            break;
+        case ServerMessage::SESSION_EVENT:
+            processSessionEvent(message.session_event());
+            break;
+        case ServerMessage::GAME_EVENT_CONTAINER:
+            processGameEventContainer(message.game_event_container());
+            break;
+        case ServerMessage::ROOM_EVENT:
+            break;
+    }
+}
+
+void LoadGenClient::processResponse(const Response &response)
+{
+    const auto pending = pendingCommands.find(response.cmd_id());
+    if (pending == pendingCommands.end())
+        return;
+    const PendingCommand command = pending.value();
+    pendingCommands.erase(pending);
+
+    const bool ok = response.response_code() == Response::RespOk;
+    stats->commandAnswered(command.type, stats->now() - command.sentAt, ok);
+    if (command.scripted)
+        --scriptedInFlight;
+
+    if (command.type == "Command_Login") {
+        if (!ok) {
+            qWarning() << userName
+                       << "could not log in:" << Response::ResponseCode_Name(response.response_code()).c_str();
+            dropConnection();
+            return;
+        }
+        Command_JoinRoom cmd;
+        cmd.set_room_id(static_cast<google::protobuf::uint32>(options.roomId));
+        sendSessionCommand(cmd);
+    } else if (command.type == "Command_JoinRoom") {
+        if (!ok) {
+            qWarning() << userName << "could not join room" << options.roomId << ":"
+                       << Response::ResponseCode_Name(response.response_code()).c_str();
+            dropConnection();
+            return;
+        }
+        loggedIn = true;
+        // spread the clients over the think time so that they don't all act in the same event loop iteration
+        const int offset = static_cast<int>(qHash(userName) % static_cast<uint>(qMax(options.thinkTimeMs, 1)));
+        QTimer::singleShot(offset, actTimer, SLOT(start()));
+        emit loggedInToRoom(this);
+    } else if (!ok && (command.type == "Command_CreateGame" || command.type == "Command_JoinGame")) {
+        qWarning() << userName << command.type
+                   << "failed:" << Response::ResponseCode_Name(response.response_code()).c_str();
+    }
+}
+
+void LoadGenClient::processSessionEvent(const SessionEvent &event)
+{
+    if (event.HasExtension(Event_ServerIdentification::ext)) {
+        const Event_ServerIdentification &identification = event.GetExtension(Event_ServerIdentification::ext);
+        serverOffersCompression = StreamCompressor::isAvailable() &&
+                                  identification.stream_compression() ==
+                                      Event_ServerIdentification::DeflateStreamCompression;
+
+        Command_Login cmd;
+        cmd.set_user_name(userName.toStdString());
+        cmd.set_clientid(
+            QCryptographicHash::hash(userName.toUtf8(), QCryptographicHash::Sha1).toHex().left(15).toStdString());
+        cmd.set_clientver("servatrice_loadgen");
+        cmd.add_clientfeatures("client_id");
+        cmd.add_clientfeatures("client_ver");
+        if (options.compression && serverOffersCompression)
+            cmd.add_clientfeatures("stream_compression");
+        sendSessionCommand(cmd);
+    } else if (event.HasExtension(Event_ConnectionClosed::ext)) {
+        qWarning() << userName << "was disconnected by the server, reason"
+                   << event.GetExtension(Event_ConnectionClosed::ext).reason();
+        dropConnection();
+    } else if (event.HasExtension(Event_GameJoined::ext)) {
+        const Event_GameJoined &joined = event.GetExtension(Event_GameJoined::ext);
+        resetGame();
+        gameId = joined.game_info().game_id();
+        playerId = joined.player_id();
+        if (!joined.spectator()) {
+            Command_DeckSelect deckSelect;
+            deckSelect.set_deck(options.deck.toStdString());
+            sendGameCommand(deckSelect);
+            Command_ReadyStart readyStart;
+            readyStart.set_ready(true);
+            sendGameCommand(readyStart);
+        }
+        emit gameJoined(this, gameId);
+    }
+}
+
+void LoadGenClient::processGameEventContainer(const GameEventContainer &cont)
+{
+    if (static_cast<int>(cont.game_id()) != gameId)
+        return;
+
+    for (const GameEvent &event : cont.event_list()) {
+        if (event.HasExtension(Event_GameClosed::ext)) {
+            resetGame();
+            return;
+        } else if (event.HasExtension(Event_GameStateChanged::ext)) {
+            const Event_GameStateChanged &state = event.GetExtension(Event_GameStateChanged::ext);
+            if (state.game_started() && !gameStarted) {
+                gameStarted = true;
+                activePlayerId = state.active_player_id();
+                if (role != SpectatorRole) {
+                    Command_DrawCards draw;
+                    draw.set_number(7);
+                    sendGameCommand(draw, true);
+                    // every third game starts with a mulligan to six
+                    if (gamesPlayed % 3 == 0) {
+                        Command_Mulligan mulligan;
+                        mulligan.set_number(6);
+                        sendGameCommand(mulligan, true);
+                    }
+                }
+            }
+        } else if (event.HasExtension(Event_SetActivePlayer::ext)) {
+            activePlayerId = event.GetExtension(Event_SetActivePlayer::ext).active_player_id();
+            turnStep = 0;
+            if (++turnsPlayed == options.turnsPerGame && role == HostRole)
+                emit gameFinished(this);
+        } else if (event.player_id() == playerId && event.HasExtension(Event_DrawCards::ext)) {
+            for (const ServerInfo_Card &card : event.GetExtension(Event_DrawCards::ext).cards())
+                hand.append(card.id());
+        } else if (event.player_id() == playerId && event.HasExtension(Event_MoveCard::ext)) {
+            const Event_MoveCard &move = event.GetExtension(Event_MoveCard::ext);
+            if (move.start_player_id() == playerId) {
+                if (move.start_zone() == "hand")
+                    hand.removeAll(move.card_id());
+                else if (move.start_zone() == "table")
+                    table.removeAll(move.card_id());
+            }
+            if (move.target_player_id() == playerId) {
+                if (move.target_zone() == "hand")
+                    hand.append(move.new_card_id());
+                else if (move.target_zone() == "table")
+                    table.append(move.new_card_id());
+            }
+        }
+    }
+}
+
+void LoadGenClient::resetGame()
+{
+    if (gameId != -1)
+        ++gamesPlayed;
+    gameId = playerId = activePlayerId = -1;
+    gameStarted = false;
+    turnsPlayed = turnStep = 0;
+    hand.clear();
+    table.clear();
+}
+
+void LoadGenClient::createGame()
+{
+    Command_CreateGame cmd;
+    cmd.set_description(QString("load test game %1").arg(gamesPlayed).toStdString());
+    cmd.set_max_players(2);
+    cmd.set_spectators_allowed(true);
+    cmd.set_spectators_can_talk(false);
+    cmd.set_spectators_see_everything(false);
+    sendRoomCommand(cmd);
+}
+
+void LoadGenClient::joinGame(int _gameId)
+{
+    Command_JoinGame cmd;
+    cmd.set_game_id(_gameId);
+    cmd.set_spectator(role == SpectatorRole);
+    sendRoomCommand(cmd);
+}
+
+void LoadGenClient::leaveGame()
+{
+    if (gameId == -1)
+        return;
+    sendGameCommand(Command_LeaveGame());
+    resetGame();
+}
+
+void LoadGenClient::act()
+{
+    if (!loggedIn || scriptedInFlight > 0)
+        return;
+    ++ticks;
+
+    if (gameId == -1)
+        actInLobby();
+    else if (gameStarted && role != SpectatorRole && activePlayerId == playerId)
+        actInGame();
+}
+
+void LoadGenClient::actInLobby()
+{
+    if (options.chatEvery <= 0 || ticks % options.chatEvery != 0)
+        return;
+    Command_RoomSay cmd;
+    cmd.set_message(QString("load test message %1 from %2").arg(ticks).arg(userName).toStdString());
+    sendRoomCommand(cmd, true);
+}
+
+void LoadGenClient::sendMoveCard(int cardId, const QString &startZone, const QString &targetZone)
+{
+    Command_MoveCard cmd;
+    cmd.set_start_player_id(playerId);
+    cmd.set_start_zone(startZone.toStdString());
+    cmd.mutable_cards_to_move()->add_card()->set_card_id(cardId);
+    cmd.set_target_player_id(playerId);
+    cmd.set_target_zone(targetZone.toStdString());
+    cmd.set_x(static_cast<int>(table.size() % 12));
+    cmd.set_y(0);
+    sendGameCommand(cmd, true);
+}
+
+void LoadGenClient::actInGame()
+{
+    // one step of the active player's turn per tick; steps that don't apply right now are skipped
+    while (scriptedInFlight == 0) {
+        switch (turnStep++) {
+            case 0: {
+                Command_DrawCards cmd;
+                cmd.set_number(1);
+                sendGameCommand(cmd, true);
+                break;
+            }
+            case 1:
+                if (!hand.isEmpty())
+                    sendMoveCard(hand.first(), "hand", "table");
+                break;
+            case 2:
+                if (turnsPlayed % 3 == 0)
+                    sendGameCommand(Command_Shuffle(), true);
+                break;
+            case 3:
+                if (table.size() > 5)
+                    sendMoveCard(table.first(), "table", "grave");
+                break;
+            case 4:
+                if (options.chatEvery > 0 && turnsPlayed % options.chatEvery == 0) {
+                    Command_GameSay cmd;
+                    cmd.set_message(QString("turn %1").arg(turnsPlayed).toStdString());
+                    sendGameCommand(cmd, true);
+                }
+                break;
+            default:
+                sendGameCommand(Command_NextTurn(), true);
+                turnStep = 0;
+                return;
+        }
+    }
+}
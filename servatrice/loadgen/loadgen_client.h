@@ -0,0 +1,137 @@
+#ifndef LOADGEN_CLIENT_H
+#define LOADGEN_CLIENT_H
+
+#include "pb/commands.pb.h"
+#include "pb/server_message.pb.h"
+
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class LoadGenStats;
+class QTcpSocket;
+class QTimer;
+class StreamDecompressor;
+
+struct LoadGenOptions
+{
+    QString host = "127.0.0.1";
+    quint16 port = 4747;
+    int roomId = 0;
+    int thinkTimeMs = 1000;
+    int turnsPerGame = 20;
+    int chatEvery = 10;
+    bool compression = false;
+    QString deck;
+};
+
+/**
+ * One simulated user. It speaks the same length-prefixed protobuf stream as the desktop client, logs in without a
+ * password, joins the room and then acts once per think time: lobby users chat, players go through a scripted turn
+ * and spectators only watch. At most one scripted command is in flight, so a slow server slows the clients down
+ * like it would slow down people.
+ */
+class LoadGenClient : public QObject
+{
+    Q_OBJECT
+public:
+    enum Role
+    {
+        LobbyRole,
+        HostRole,
+        OpponentRole,
+        SpectatorRole
+    };
+
+private:
+    struct PendingCommand
+    {
+        QString type;
+        qint64 sentAt;
+        bool scripted;
+    };
+
+    const LoadGenOptions &options;
+    LoadGenStats *stats;
+    QString userName;
+    Role role;
+
+    QTcpSocket *socket;
+    QTimer *actTimer;
+    QByteArray inputBuffer;
+    bool messageInProgress, messageCompressed;
+    int messageLength;
+    StreamDecompressor *inputDecompressor;
+    bool serverOffersCompression;
+
+    quint64 nextCmdId;
+    QHash<quint64, PendingCommand> pendingCommands;
+    int scriptedInFlight;
+    bool loggedIn, dropped;
+    int ticks;
+
+    int gameId, playerId, activePlayerId;
+    bool gameStarted;
+    int turnsPlayed, turnStep, gamesPlayed;
+    QList<int> hand, table;
+
+    quint64 sendCommandContainer(CommandContainer &cont, const QString &type, bool scripted);
+    quint64 sendSessionCommand(const ::google::protobuf::Message &cmd, bool scripted = false);
+    quint64 sendRoomCommand(const ::google::protobuf::Message &cmd, bool scripted = false);
+    quint64 sendGameCommand(const ::google::protobuf::Message &cmd, bool scripted = false);
+
+    void processServerMessage(const ServerMessage &message);
+    void processResponse(const Response &response);
+    void processSessionEvent(const SessionEvent &event);
+    void processGameEventContainer(const GameEventContainer &cont);
+    void resetGame();
+    void dropConnection();
+
+    void actInLobby();
+    void actInGame();
+    void sendMoveCard(int cardId, const QString &startZone, const QString &targetZone);
+
+private slots:
+    void socketConnected();
+    void socketError(QAbstractSocket::SocketError error);
+    void readData();
+    void act();
+
+signals:
+    void loggedInToRoom(LoadGenClient *client);
+    void gameJoined(LoadGenClient *client, int gameId);
+    void gameFinished(LoadGenClient *client);
+    void connectionLost(LoadGenClient *client);
+
+public:
+    LoadGenClient(const LoadGenOptions &_options,
+                  LoadGenStats *_stats,
+                  const QString &_userName,
+                  Role _role,
+                  QObject *parent = nullptr);
+    ~LoadGenClient() override;
+
+    Role getRole() const
+    {
+        return role;
+    }
+    bool isLoggedIn() const
+    {
+        return loggedIn;
+    }
+    int getGameId() const
+    {
+        return gameId;
+    }
+
+    void connectToServer();
+    void disconnectFromServer();
+    void createGame();
+    void joinGame(int _gameId);
+    void leaveGame();
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "loadgen_stats.h"
+
+#include <QStringList>
+#include <algorithm>
+
+namespace
+{
+QString formatBytes(double bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return QString("%1 MiB").arg(bytes / (1024 * 1024), 0, 'f', 2);
+    if (bytes >= 1024)
+        return QString("%1 KiB").arg(bytes / 1024, 0, 'f', 1);
+    return QString("%1 B").arg(bytes, 0, 'f', 0);
+}
+
+QString formatMsecs(qint64 nsecs)
+{
+    return QString("%1").arg(nsecs / 1000000.0, 8, 'f', 2);
+}
+} // namespace
+
+LoadGenStats::LoadGenStats()
+    : bytesIn(0), bytesOut(0), commandsAnswered(0), messagesIn(0), connectionsLost(0), lastReportNsecs(0),
+      lastCommandsAnswered(0), lastBytesIn(0), lastBytesOut(0)
+{
+    clock.start();
+}
+
+void LoadGenStats::commandAnswered(const QString &commandType, qint64 latencyNsecs, bool ok)
+{
+    CommandTypeStats &stats = commandTypes[commandType];
+    stats.latencies.append(latencyNsecs);
+    if (!ok)
+        ++stats.errors;
+    ++commandsAnswered;
+}
+
+qint64 LoadGenStats::percentile(const QVector<qint64> &sorted, int percent)
+{
+    if (sorted.isEmpty())
+        return 0;
+    const int index = static_cast<int>((static_cast<qint64>(sorted.size()) * percent + 99) / 100) - 1;
+    return sorted[std::max(0, std::min(index, static_cast<int>(sorted.size()) - 1))];
+}
+
+QString LoadGenStats::intervalReport(int clientsLoggedIn, int gamesRunning)
+{
+    const qint64 nowNsecs = now();
+    const double secs = std::max<qint64>(nowNsecs - lastReportNsecs, 1) / 1e9;
+    const QString result = QString("%1 s: %2 clients logged in, %3 games, %4 commands/s, in %5/s, out %6/s")
+                               .arg(nowNsecs / 1000000000)
+                               .arg(clientsLoggedIn)
+                               .arg(gamesRunning)
+                               .arg((commandsAnswered - lastCommandsAnswered) / secs, 0, 'f', 1)
+                               .arg(formatBytes((bytesIn - lastBytesIn) / secs))
+                               .arg(formatBytes((bytesOut - lastBytesOut) / secs));
+    lastReportNsecs = nowNsecs;
+    lastCommandsAnswered = commandsAnswered;
+    lastBytesIn = bytesIn;
+    lastBytesOut = bytesOut;
+    return result;
+}
+
+QString LoadGenStats::finalReport() const
+{
+    const double secs = std::max<qint64>(now(), 1) / 1e9;
+    QStringList lines;
+    lines << QString("%1 commands answered in %2 s, %3 commands/s")
+                 .arg(commandsAnswered)
+                 .arg(secs, 0, 'f', 1)
+                 .arg(commandsAnswered / secs, 0, 'f', 1);
+    lines << QString("%1 messages received; in %2 (%3/s), out %4 (%5/s)")
+                 .arg(messagesIn)
+                 .arg(formatBytes(bytesIn))
+                 .arg(formatBytes(bytesIn / secs))
+                 .arg(formatBytes(bytesOut))
+                 .arg(formatBytes(bytesOut / secs));
+    if (connectionsLost)
+        lines << QString("%1 connections lost").arg(connectionsLost);
+
+    lines << QString("command").leftJustified(28) + "    count  errors      p50      p90      p99      max (ms)";
+    for (auto i = commandTypes.constBegin(); i != commandTypes.constEnd(); ++i) {
+        QVector<qint64> sorted = i.value().latencies;
+        std::sort(sorted.begin(), sorted.end());
+        lines << QString("%1 %2 %3 %4 %5 %6 %7")
+                     .arg(i.key(), -28)
+                     .arg(sorted.size(), 8)
+                     .arg(i.value().errors, 7)
+                     .arg(formatMsecs(percentile(sorted, 50)))
+                     .arg(formatMsecs(percentile(sorted, 90)))
+                     .arg(formatMsecs(percentile(sorted, 99)))
+                     .arg(formatMsecs(sorted.isEmpty() ? 0 : sorted.last()));
+    }
+    return lines.join("\n");
+}
@@ -0,0 +1,68 @@
+#ifndef LOADGEN_STATS_H
+#define LOADGEN_STATS_H
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+/**
+ * What the simulated clients measured: round trip times per command type, from writing the command container to
+ * parsing its response, and the bytes that went over the wire in both directions. All clients run on one thread
+ * and share one instance.
+ */
+class LoadGenStats
+{
+private:
+    struct CommandTypeStats
+    {
+        QVector<qint64> latencies;
+        int errors = 0;
+    };
+
+    QElapsedTimer clock;
+    QMap<QString, CommandTypeStats> commandTypes;
+    quint64 bytesIn, bytesOut;
+    quint64 commandsAnswered, messagesIn;
+    int connectionsLost;
+
+    // totals at the last interval report
+    qint64 lastReportNsecs;
+    quint64 lastCommandsAnswered, lastBytesIn, lastBytesOut;
+
+    static qint64 percentile(const QVector<qint64> &sorted, int percent);
+
+public:
+    LoadGenStats();
+
+    /** Nanoseconds since the run started; used to timestamp commands. */
+    qint64 now() const
+    {
+        return clock.nsecsElapsed();
+    }
+
+    void bytesSent(int bytes)
+    {
+        bytesOut += static_cast<quint64>(bytes);
+    }
+    void bytesReceived(int bytes)
+    {
+        bytesIn += static_cast<quint64>(bytes);
+    }
+    void messageReceived()
+    {
+        ++messagesIn;
+    }
+    void connectionLost()
+    {
+        ++connectionsLost;
+    }
+    void commandAnswered(const QString &commandType, qint64 latencyNsecs, bool ok);
+
+    /** One line with the rates since the previous call. */
+    QString intervalReport(int clientsLoggedIn, int gamesRunning);
+    /** The totals and a table of latency percentiles per command type. */
+    QString finalReport() const;
+};
+
+#endif
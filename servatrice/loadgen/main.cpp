@@ -0,0 +1,87 @@
+#include "decklist.h"
+#include "load_generator.h"
+#include "version_string.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include <iostream>
+
+/**
+ * servatrice_loadgen simulates a crowd of users against a running Servatrice, so that changes to the server can be
+ * measured under a realistic mix of chat, lobby traffic and games. The server should allow unauthenticated logins
+ * (authentication/method=none); for large runs or short think times its user limits and flood protection need to be
+ * raised, see the README.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Cockatrice");
+    QCoreApplication::setApplicationName("servatrice_loadgen");
+    QCoreApplication::setApplicationVersion(VERSION_STRING);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Simulates many clients against a Servatrice server and reports its throughput");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption hostOpt("host", "Server address (default 127.0.0.1)", "host", "127.0.0.1");
+    parser.addOption(hostOpt);
+    QCommandLineOption portOpt("port", "Server tcp port (default 4747)", "port", "4747");
+    parser.addOption(portOpt);
+    QCommandLineOption clientsOpt("clients", "Number of simulated clients (default 100)", "count", "100");
+    parser.addOption(clientsOpt);
+    QCommandLineOption connectRateOpt("connect-rate", "New connections per second (default 50)", "rate", "50");
+    parser.addOption(connectRateOpt);
+    QCommandLineOption durationOpt("duration", "Seconds to run, 0 to run until interrupted (default 60)", "seconds",
+                                   "60");
+    parser.addOption(durationOpt);
+    QCommandLineOption reportIntervalOpt("report-interval", "Seconds between progress reports (default 10)",
+                                         "seconds", "10");
+    parser.addOption(reportIntervalOpt);
+    QCommandLineOption roomOpt("room", "Id of the room to join (default 0)", "id", "0");
+    parser.addOption(roomOpt);
+    QCommandLineOption lobbyOpt("lobby", "Percentage of clients that only chat in the room (default 20)", "percent",
+                                "20");
+    parser.addOption(lobbyOpt);
+    QCommandLineOption spectatorsOpt("spectators", "Spectators per game (default 1)", "count", "1");
+    parser.addOption(spectatorsOpt);
+    QCommandLineOption thinkTimeOpt("think-time", "Milliseconds between two actions of a client (default 1000)", "ms",
+                                    "1000");
+    parser.addOption(thinkTimeOpt);
+    QCommandLineOption turnsOpt("turns", "Turns per game before the players start a new one (default 20)", "count",
+                                "20");
+    parser.addOption(turnsOpt);
+    QCommandLineOption chatEveryOpt("chat-every", "Chat once every this many actions, 0 to not chat (default 30)",
+                                    "count", "30");
+    parser.addOption(chatEveryOpt);
+    QCommandLineOption compressionOpt("compression", "Ask the server to compress the message stream");
+    parser.addOption(compressionOpt);
+
+    parser.process(app);
+
+    LoadGenOptions options;
+    options.host = parser.value(hostOpt);
+    options.port = static_cast<quint16>(parser.value(portOpt).toUInt());
+    options.roomId = parser.value(roomOpt).toInt();
+    options.thinkTimeMs = qMax(parser.value(thinkTimeOpt).toInt(), 1);
+    options.turnsPerGame = qMax(parser.value(turnsOpt).toInt(), 1);
+    options.chatEvery = parser.value(chatEveryOpt).toInt();
+    options.compression = parser.isSet(compressionOpt);
+
+    // every player brings the same sixty card deck
+    QString deckText("24 Forest\n4 Llanowar Elves\n4 Giant Growth\n4 Grizzly Bears\n4 Wild Growth\n4 Craw Wurm\n"
+                     "4 Scryb Sprites\n4 Regrowth\n4 Stream of Life\n4 Tranquility\n");
+    QTextStream deckStream(&deckText);
+    DeckList deck;
+    deck.loadFromStream_Plain(deckStream);
+    options.deck = deck.writeToString_Native();
+
+    LoadGenerator generator(options, parser.value(clientsOpt).toInt(), parser.value(connectRateOpt).toInt(),
+                            parser.value(durationOpt).toInt(), parser.value(reportIntervalOpt).toInt(),
+                            parser.value(lobbyOpt).toInt(), parser.value(spectatorsOpt).toInt());
+    QObject::connect(&generator, SIGNAL(finished()), &app, SLOT(quit()));
+    generator.start();
+
+    return QCoreApplication::exec();
+}
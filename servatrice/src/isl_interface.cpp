@@ -17,8 +17,10 @@
 #include "server_logger.h"
 #include "server_protocolhandler.h"
 #include "server_room.h"
+#include "stream_compression.h"
 
 #include <QSslSocket>
+#include <QTimer>
 #include <google/protobuf/descriptor.h>
 
 void IslInterface::sharedCtor(const QSslCertificate &cert, const QSslKey &privateKey)
@@ -30,14 +32,36 @@ void IslInterface::sharedCtor(const QSslCertificate &cert, const QSslKey &privat
     connect(socket, SIGNAL(readyRead()), this, SLOT(readClient()), Qt::QueuedConnection);
     connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this,
             SLOT(catchSocketError(QAbstractSocket::SocketError)));
-    connect(this, SIGNAL(outputBufferChanged()), this, SLOT(flushOutputBuffer()), Qt::QueuedConnection);
+    connect(socket, SIGNAL(connected()), this, SLOT(socketConnected()));
+    connect(socket, SIGNAL(encrypted()), this, SLOT(socketEncrypted()));
+
+    handshakeTimer = new QTimer(this);
+    handshakeTimer->setSingleShot(true);
+    handshakeTimer->setInterval(handshakeTimeout);
+    connect(handshakeTimer, SIGNAL(timeout()), this, SLOT(handshakeTimedOut()));
+
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setSingleShot(true);
+    connect(reconnectTimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+    connect(this, SIGNAL(outputBufferChanged()), this, SLOT(scheduleFlush()), Qt::QueuedConnection);
+
+    batchInterval = server->getISLBatchInterval();
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(batchInterval);
+    connect(flushTimer, SIGNAL(timeout()), this, SLOT(flushOutputBuffer()));
 }
 
 IslInterface::IslInterface(int _socketDescriptor,
                            const QSslCertificate &cert,
                            const QSslKey &privateKey,
                            Servatrice *_server)
-    : QObject(), socketDescriptor(_socketDescriptor), server(_server), messageInProgress(false)
+    : QObject(), serverId(-1), socketDescriptor(_socketDescriptor), outgoing(false), registered(false),
+      state(PeerDisconnected), reconnectDelay(minReconnectDelay), handshakeTimer(nullptr), reconnectTimer(nullptr),
+      linkFailures(0), server(_server), batchInterval(0), flushTimer(nullptr), batchFrames(false),
+      outputCompressor(nullptr), inputDecompressor(new StreamDecompressor), synchronizing(false),
+      messageInProgress(false), frameHeader(0), messageLength(0), messagesSent(0), framesSent(0), bytesSent(0),
+      messagesCoalesced(0), messagesReceived(0), framesReceived(0), bytesReceived(0)
 {
     sharedCtor(cert, privateKey);
 }
@@ -51,7 +75,12 @@ IslInterface::IslInterface(int _serverId,
                            const QSslKey &privateKey,
                            Servatrice *_server)
     : QObject(), serverId(_serverId), peerHostName(_peerHostName), peerAddress(_peerAddress), peerPort(_peerPort),
-      peerCert(_peerCert), server(_server), messageInProgress(false)
+      peerCert(_peerCert), outgoing(true), registered(false), state(PeerDisconnected),
+      reconnectDelay(minReconnectDelay), handshakeTimer(nullptr), reconnectTimer(nullptr), linkFailures(0),
+      server(_server), batchInterval(0), flushTimer(nullptr), batchFrames(false), outputCompressor(nullptr),
+      inputDecompressor(new StreamDecompressor), synchronizing(false), messageInProgress(false), frameHeader(0),
+      messageLength(0), messagesSent(0), framesSent(0), bytesSent(0), messagesCoalesced(0), messagesReceived(0),
+      framesReceived(0), bytesReceived(0)
 {
     sharedCtor(cert, privateKey);
 }
@@ -61,7 +90,15 @@ IslInterface::~IslInterface()
     logger->logMessage("[ISL] session ended", this);
 
     flushOutputBuffer();
+    delete outputCompressor;
+    delete inputDecompressor;
 
+    if (registered)
+        removeExternalUsers();
+}
+
+void IslInterface::removeExternalUsers()
+{
     // As these signals are connected with Qt::QueuedConnection implicitly,
     // we don't need to worry about them modifying the lists while we're iterating.
 
@@ -90,52 +127,136 @@ IslInterface::~IslInterface()
     server->clientsLock.unlock();
 }
 
+void IslInterface::setState(PeerState newState)
+{
+    static const char *const stateNames[] = {"disconnected",  "connecting", "encrypting",
+                                             "synchronizing", "connected",  "backing off"};
+    const int oldState = state.exchange(newState);
+    if (oldState != newState)
+        qDebug() << "[ISL] Link to #" << serverId << stateNames[oldState] << "->" << stateNames[newState];
+}
+
 void IslInterface::initServer()
 {
     socket->setSocketDescriptor(socketDescriptor);
 
     logger->logMessage(QString("[ISL] incoming connection: %1").arg(socket->peerAddress().toString()));
 
-    QList<ServerProperties> serverList = server->getServerList();
-    int listIndex = -1;
-    for (int i = 0; i < serverList.size(); ++i)
-        if (serverList[i].address == socket->peerAddress()) {
-            listIndex = i;
-            break;
-        }
+    const QList<ServerProperties> serverList = server->getServerList();
+    const int listIndex = indexOfServerAddress(serverList, socket->peerAddress());
     if (listIndex == -1) {
         logger->logMessage(
             QString("[ISL] address %1 unknown, terminating connection").arg(socket->peerAddress().toString()));
         deleteLater();
         return;
     }
+    serverId = serverList[listIndex].id;
+    peerHostName = serverList[listIndex].hostname;
+    peerCert = serverList[listIndex].cert;
 
+    // the handshake continues in socketEncrypted()
+    setState(PeerEncrypting);
+    handshakeTimer->start();
     socket->startServerEncryption();
-    if (!socket->waitForEncrypted(5000)) {
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
-        QList<QSslError> sslErrors(socket->sslHandshakeErrors());
-#else
-        QList<QSslError> sslErrors(socket->sslErrors());
-#endif
-        if (sslErrors.isEmpty())
-            qDebug() << "[ISL] SSL handshake timeout, terminating connection";
-        else
-            qDebug() << "[ISL] SSL errors:" << sslErrors;
-        deleteLater();
+}
+
+void IslInterface::initClient()
+{
+    reconnect();
+}
+
+void IslInterface::reconnect()
+{
+    server->islLock.lockForRead();
+    const bool linkExists = server->islConnectionExists(serverId);
+    server->islLock.unlock();
+    if (linkExists) {
+        // the peer connected to us first; only step in if that link goes away
+        setState(PeerBackingOff);
+        reconnectTimer->start(maxReconnectDelay);
         return;
     }
 
-    if (serverList[listIndex].cert == socket->peerCertificate())
-        logger->logMessage(QString("[ISL] Peer authenticated as " + serverList[listIndex].hostname));
-    else {
-        logger->logMessage(QString("[ISL] Authentication failed, terminating connection"));
-        deleteLater();
+    QList<QSslError> expectedErrors;
+    expectedErrors.append(QSslError(QSslError::SelfSignedCertificate, peerCert));
+    socket->ignoreSslErrors(expectedErrors);
+
+    qDebug() << "[ISL] Connecting to #" << serverId << ":" << peerAddress << ":" << peerPort;
+
+    setState(PeerConnecting);
+    handshakeTimer->start();
+    socket->connectToHostEncrypted(peerAddress, static_cast<quint16>(peerPort), peerHostName);
+}
+
+void IslInterface::socketConnected()
+{
+    setState(PeerEncrypting);
+}
+
+void IslInterface::socketEncrypted()
+{
+    handshakeTimer->stop();
+    socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+
+    if (!outgoing) {
+        if (peerCert != socket->peerCertificate()) {
+            logger->logMessage(QString("[ISL] Authentication failed, terminating connection"));
+            connectionLost();
+            return;
+        }
+        logger->logMessage(QString("[ISL] Peer authenticated as " + peerHostName));
+    }
+
+    if (!registerInterface()) {
+        qDebug() << "[ISL] Duplicate connection to #" << serverId << "terminating connection";
+        connectionLost();
         return;
     }
-    serverId = serverList[listIndex].id;
+
+    if (outgoing) {
+        reconnectDelay = minReconnectDelay;
+        setState(PeerConnected);
+    } else
+        synchronizePeer();
+}
+
+void IslInterface::handshakeTimedOut()
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    QList<QSslError> sslErrors(socket->sslHandshakeErrors());
+#else
+    QList<QSslError> sslErrors(socket->sslErrors());
+#endif
+    if (sslErrors.isEmpty())
+        qDebug() << "[ISL] Handshake with #" << serverId << "timed out";
+    else
+        qDebug() << "[ISL] SSL errors:" << sslErrors;
+    connectionLost();
+}
+
+bool IslInterface::registerInterface()
+{
+    QWriteLocker locker(&server->islLock);
+    if (server->islConnectionExists(serverId))
+        return false;
+
+    // the side that accepted the connection sends its complete list first, see synchronizePeer()
+    synchronizing = !outgoing;
+    server->addIslInterface(serverId, this);
+    registered = true;
+    return true;
+}
+
+void IslInterface::synchronizePeer()
+{
+    // The peer is registered before the snapshot is taken, so that no event happening while it is built can be
+    // missed. Everything queued for the peer in the meantime is held back and sent after the complete list; the peer
+    // applies it on top of the list, which is harmless for changes the list already contains.
+    setState(PeerSynchronizing);
 
     Event_ServerCompleteList event;
     event.set_server_id(server->getServerID());
+    event.set_isl_features(localFeatures());
 
     server->clientsLock.lockForRead();
     QMapIterator<QString, Server_ProtocolHandler *> userIterator(server->getUsers());
@@ -143,14 +264,16 @@ void IslInterface::initServer()
         event.add_user_list()->CopyFrom(userIterator.next().value()->copyUserInfo(true, true));
     server->clientsLock.unlock();
 
+    // Rooms are copied one at a time, so that a room is only blocked for as long as its own copy takes.
     server->roomsLock.lockForRead();
     QMapIterator<int, Server_Room *> roomIterator(server->getRooms());
     while (roomIterator.hasNext()) {
         Server_Room *room = roomIterator.next().value();
-        room->usersLock.lockForRead();
-        room->gamesLock.lockForRead();
+        QReadLocker usersLocker(&room->usersLock);
+        QReadLocker gamesLocker(&room->gamesLock);
         room->getInfo(*event.add_room_list(), true, true, false);
     }
+    server->roomsLock.unlock();
 
     IslMessage message;
     message.set_message_type(IslMessage::SESSION_EVENT);
@@ -159,70 +282,114 @@ void IslInterface::initServer()
         ->MutableMessage(sessionEvent, event.GetDescriptor()->FindExtensionByName("ext"))
         ->CopyFrom(event);
 
-    server->islLock.lockForWrite();
-    if (server->islConnectionExists(serverId)) {
-        qDebug() << "[ISL] Duplicate connection to #" << serverId << "terminating connection";
-        deleteLater();
-    } else {
-        transmitMessage(message);
-        server->addIslInterface(serverId, this);
-    }
-    server->islLock.unlock();
+    // the list goes out in a frame of its own, ahead of the batch that collected while it was built
+    IslMessageBatch listBatch;
+    listBatch.append(message);
+    outputBufferMutex.lock();
+    writeFrame(listBatch);
+    synchronizing = false;
+    outputBufferMutex.unlock();
+    emit outputBufferChanged();
 
-    roomIterator.toFront();
-    while (roomIterator.hasNext()) {
-        roomIterator.next();
-        roomIterator.value()->gamesLock.unlock();
-        roomIterator.value()->usersLock.unlock();
-    }
-    server->roomsLock.unlock();
+    setState(PeerConnected);
 }
 
-void IslInterface::initClient()
+void IslInterface::connectionLost()
 {
-    QList<QSslError> expectedErrors;
-    expectedErrors.append(QSslError(QSslError::SelfSignedCertificate, peerCert));
-    socket->ignoreSslErrors(expectedErrors);
-
-    qDebug() << "[ISL] Connecting to #" << serverId << ":" << peerAddress << ":" << peerPort;
-
-    socket->connectToHostEncrypted(peerAddress, peerPort, peerHostName);
-    if (!socket->waitForConnected(5000)) {
-        qDebug() << "[ISL] Socket error:" << socket->errorString();
-        deleteLater();
-        return;
+    handshakeTimer->stop();
+    flushTimer->stop();
+    ++linkFailures;
+
+    if (registered) {
+        server->islLock.lockForWrite();
+        server->removeIslInterface(serverId);
+        registered = false;
+        server->islLock.unlock();
+        removeExternalUsers();
     }
-    if (!socket->waitForEncrypted(5000)) {
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
-        QList<QSslError> sslErrors(socket->sslHandshakeErrors());
-#else
-        QList<QSslError> sslErrors(socket->sslErrors());
-#endif
-        if (sslErrors.isEmpty())
-            qDebug() << "[ISL] SSL handshake timeout, terminating connection";
-        else
-            qDebug() << "[ISL] SSL errors:" << sslErrors;
+
+    if (!outgoing) {
+        setState(PeerDisconnected);
         deleteLater();
         return;
     }
 
-    server->islLock.lockForWrite();
-    if (server->islConnectionExists(serverId)) {
-        qDebug() << "[ISL] Duplicate connection to #" << serverId << "terminating connection";
-        deleteLater();
-        return;
+    // set first, so that errors reported while aborting are ignored
+    setState(PeerBackingOff);
+
+    // the next connection starts with fresh compression streams and nothing left over from this one
+    socket->abort();
+    inputBuffer.clear();
+    messageInProgress = false;
+    delete inputDecompressor;
+    inputDecompressor = new StreamDecompressor;
+    outputBufferMutex.lock();
+    outputBuffer.clear();
+    outputBatch.clear();
+    synchronizing = false;
+    batchFrames = false;
+    delete outputCompressor;
+    outputCompressor = nullptr;
+    outputBufferMutex.unlock();
+
+    qDebug() << "[ISL] Reconnecting to #" << serverId << "in" << reconnectDelay << "ms";
+    reconnectTimer->start(reconnectDelay);
+    reconnectDelay = qMin(reconnectDelay * 2, maxReconnectDelay);
+}
+
+void IslInterface::scheduleFlush()
+{
+    if (batchInterval <= 0)
+        flushOutputBuffer();
+    else if (!flushTimer->isActive())
+        flushTimer->start();
+}
+
+void IslInterface::writeFrame(IslMessageBatch &batch)
+{
+    // Only call with outputBufferMutex locked
+    for (const IslMessage &item : batch.getMessages())
+        server->getServatriceMetrics()->islMessage(Servatrice_Metrics::IslSent, item.message_type());
+    messagesSent += static_cast<quint64>(batch.getMessages().size());
+    messagesCoalesced += static_cast<quint64>(batch.takeCoalescedCount());
+
+    const int start = outputBuffer.size();
+    bool compressionFailed;
+    const int frames = batch.writeFrames(outputBuffer, outputCompressor, batchFrames, compressionFailed);
+    if (compressionFailed) {
+        qDebug() << "[ISL] Compression failed, sending uncompressed frames to #" << serverId;
+        delete outputCompressor;
+        outputCompressor = nullptr;
     }
+    framesSent += static_cast<quint64>(frames);
+    server->getServatriceMetrics()->islFrame(Servatrice_Metrics::IslSent, outputBuffer.size() - start, frames);
+}
 
-    server->addIslInterface(serverId, this);
-    server->islLock.unlock();
+quint32 IslInterface::localFeatures()
+{
+    return IslFeatureBatch | (StreamCompressor::isAvailable() ? IslFeatureCompression : 0u);
+}
+
+void IslInterface::setPeerFeatures(quint32 features)
+{
+    QMutexLocker locker(&outputBufferMutex);
+    batchFrames = (features & IslFeatureBatch) != 0;
+    // the peer's decompressor starts with the first compressed frame, so the stream must not be restarted
+    if (!outputCompressor && (features & IslFeatureCompression) && server->getISLCompressionEnabled())
+        outputCompressor = new StreamCompressor;
 }
 
 void IslInterface::flushOutputBuffer()
 {
     QMutexLocker locker(&outputBufferMutex);
+    if (synchronizing)
+        return;
+    if (!outputBatch.isEmpty())
+        writeFrame(outputBatch);
     if (outputBuffer.isEmpty())
         return;
     server->incTxBytes(outputBuffer.size());
+    bytesSent += static_cast<quint64>(outputBuffer.size());
     socket->write(outputBuffer);
     socket->flush();
     outputBuffer.clear();
@@ -232,15 +399,17 @@ void IslInterface::readClient()
 {
     QByteArray data = socket->readAll();
     server->incRxBytes(data.size());
+    bytesReceived += static_cast<quint64>(data.size());
     inputBuffer.append(data);
 
     do {
         if (!messageInProgress) {
             if (inputBuffer.size() >= 4) {
-                messageLength = (((quint32)(unsigned char)inputBuffer[0]) << 24) +
-                                (((quint32)(unsigned char)inputBuffer[1]) << 16) +
-                                (((quint32)(unsigned char)inputBuffer[2]) << 8) +
-                                ((quint32)(unsigned char)inputBuffer[3]);
+                frameHeader = (((quint32)(unsigned char)inputBuffer[0]) << 24) +
+                              (((quint32)(unsigned char)inputBuffer[1]) << 16) +
+                              (((quint32)(unsigned char)inputBuffer[2]) << 8) +
+                              ((quint32)(unsigned char)inputBuffer[3]);
+                messageLength = static_cast<int>(frameHeader & IslFrameSizeMask);
                 inputBuffer.remove(0, 4);
                 messageInProgress = true;
             } else
@@ -249,67 +418,100 @@ void IslInterface::readClient()
         if (inputBuffer.size() < messageLength)
             return;
 
-        IslMessage newMessage;
-        newMessage.ParseFromArray(inputBuffer.data(), messageLength);
+        QList<IslMessage> messages;
+        const bool valid = IslMessageBatch::readFrame(frameHeader, inputBuffer.constData(), messageLength,
+                                                      inputDecompressor, messages);
         inputBuffer.remove(0, messageLength);
         messageInProgress = false;
+        ++framesReceived;
+        server->getServatriceMetrics()->islFrame(Servatrice_Metrics::IslReceived, messageLength + 4);
+        if (!valid) {
+            qDebug() << "[ISL] Corrupt frame from #" << serverId << ", terminating connection";
+            connectionLost();
+            return;
+        }
 
-        processMessage(newMessage);
+        messagesReceived += static_cast<quint64>(messages.size());
+        for (const IslMessage &newMessage : messages) {
+            server->getServatriceMetrics()->islMessage(Servatrice_Metrics::IslReceived, newMessage.message_type());
+            processMessage(newMessage);
+        }
     } while (!inputBuffer.isEmpty());
 }
 
 void IslInterface::catchSocketError(QAbstractSocket::SocketError socketError)
 {
-    qDebug() << "[ISL] Socket error:" << socketError;
-
-    server->islLock.lockForWrite();
-    server->removeIslInterface(serverId);
-    server->islLock.unlock();
+    // the connection may already have been dropped on purpose, which can still report an error
+    if (state == PeerBackingOff || state == PeerDisconnected)
+        return;
 
-    deleteLater();
+    qDebug() << "[ISL] Socket error:" << socketError << socket->errorString();
+    connectionLost();
 }
 
 void IslInterface::transmitMessage(const IslMessage &item)
 {
-    QByteArray buf;
-#if GOOGLE_PROTOBUF_VERSION > 3001000
-    unsigned int size = item.ByteSizeLong();
-#else
-    unsigned int size = item.ByteSize();
-#endif
-    buf.resize(size + 4);
-    item.SerializeToArray(buf.data() + 4, size);
-    buf.data()[3] = (unsigned char)size;
-    buf.data()[2] = (unsigned char)(size >> 8);
-    buf.data()[1] = (unsigned char)(size >> 16);
-    buf.data()[0] = (unsigned char)(size >> 24);
-
     outputBufferMutex.lock();
-    outputBuffer.append(buf);
+    const bool batchWasEmpty = outputBatch.isEmpty();
+    outputBatch.append(item);
     outputBufferMutex.unlock();
-    emit outputBufferChanged();
+
+    // a flush is already scheduled for a batch that has messages
+    if (batchWasEmpty)
+        emit outputBufferChanged();
+}
+
+IslPeerStats IslInterface::getStats() const
+{
+    IslPeerStats stats;
+    stats.serverId = serverId;
+    stats.state = state;
+    stats.linkFailures = linkFailures;
+    stats.messagesSent = messagesSent;
+    stats.framesSent = framesSent;
+    stats.bytesSent = bytesSent;
+    stats.messagesCoalesced = messagesCoalesced;
+    stats.messagesReceived = messagesReceived;
+    stats.framesReceived = framesReceived;
+    stats.bytesReceived = bytesReceived;
+    return stats;
 }
 
 void IslInterface::sessionEvent_ServerCompleteList(const Event_ServerCompleteList &event)
 {
-    for (int i = 0; i < event.user_list_size(); ++i) {
-        ServerInfo_User temp(event.user_list(i));
-        temp.set_server_id(serverId);
-        emit externalUserJoined(temp);
+    // the connecting side only sends a list to answer ours with the frames it can read
+    if (!outgoing) {
+        setPeerFeatures(event.isl_features());
+        return;
     }
-    for (int i = 0; i < event.room_list_size(); ++i) {
-        const ServerInfo_Room &room = event.room_list(i);
-        for (int j = 0; j < room.user_list_size(); ++j) {
-            ServerInfo_User userInfo(room.user_list(j));
-            userInfo.set_server_id(serverId);
-            emit externalRoomUserJoined(room.room_id(), userInfo);
-        }
-        for (int j = 0; j < room.game_list_size(); ++j) {
-            ServerInfo_Game gameInfo(room.game_list(j));
-            gameInfo.set_server_id(serverId);
-            emit externalRoomGameListChanged(room.room_id(), gameInfo);
-        }
+
+    // older servers send no flags and would not understand an answer
+    if (event.has_isl_features()) {
+        setPeerFeatures(event.isl_features());
+
+        Event_ServerCompleteList answer;
+        answer.set_server_id(server->getServerID());
+        answer.set_isl_features(localFeatures());
+        IslMessage message;
+        message.set_message_type(IslMessage::SESSION_EVENT);
+        SessionEvent *sessionEvent = message.mutable_session_event();
+        sessionEvent->GetReflection()
+            ->MutableMessage(sessionEvent, answer.GetDescriptor()->FindExtensionByName("ext"))
+            ->CopyFrom(answer);
+        transmitMessage(message);
+    }
+
+    Event_ServerCompleteList list(event);
+    for (int i = 0; i < list.user_list_size(); ++i)
+        list.mutable_user_list(i)->set_server_id(serverId);
+    for (int i = 0; i < list.room_list_size(); ++i) {
+        ServerInfo_Room *room = list.mutable_room_list(i);
+        for (int j = 0; j < room->user_list_size(); ++j)
+            room->mutable_user_list(j)->set_server_id(serverId);
+        for (int j = 0; j < room->game_list_size(); ++j)
+            room->mutable_game_list(j)->set_server_id(serverId);
     }
+    emit externalServerCompleteList(list);
 }
 
 void IslInterface::sessionEvent_UserJoined(const Event_UserJoined &event)
@@ -1,6 +1,8 @@
 #ifndef ISL_INTERFACE_H
 #define ISL_INTERFACE_H
 
+#include "isl_message_batch.h"
+#include "pb/event_server_complete_list.pb.h"
 #include "pb/serverinfo_game.pb.h"
 #include "pb/serverinfo_room.pb.h"
 #include "pb/serverinfo_user.pb.h"
@@ -8,13 +10,14 @@
 
 #include <QSslCertificate>
 #include <QWaitCondition>
+#include <atomic>
 
 class Servatrice;
 class QSslSocket;
+class QTimer;
 class QSslKey;
 class IslMessage;
 
-class Event_ServerCompleteList;
 class Event_UserMessage;
 class Event_UserJoined;
 class Event_UserLeft;
@@ -25,18 +28,52 @@ class Event_ListGames;
 class Event_RemoveMessages;
 class Command_JoinGame;
 
+struct IslPeerStats
+{
+    int serverId;
+    int state;
+    quint64 linkFailures;
+    quint64 messagesSent, framesSent, bytesSent, messagesCoalesced;
+    quint64 messagesReceived, framesReceived, bytesReceived;
+};
+
+/**
+ * Link to one other server of the network. Outgoing links are kept for the lifetime of the server: whenever the
+ * connection fails they wait, doubling the delay up to maxReconnectDelay, and connect again. Incoming links are
+ * deleted when their connection ends, since the peer reconnects on its own.
+ */
 class IslInterface : public QObject
 {
     Q_OBJECT
+public:
+    enum PeerState
+    {
+        PeerDisconnected,
+        PeerConnecting,
+        PeerEncrypting,
+        PeerSynchronizing,
+        PeerConnected,
+        PeerBackingOff
+    };
+    static const int handshakeTimeout = 5000;
+    static const int minReconnectDelay = 1000;
+    static const int maxReconnectDelay = 60000;
+
 private slots:
     void readClient();
     void catchSocketError(QAbstractSocket::SocketError socketError);
+    void socketConnected();
+    void socketEncrypted();
+    void handshakeTimedOut();
+    void reconnect();
+    void scheduleFlush();
     void flushOutputBuffer();
 signals:
     void outputBufferChanged();
 
     void externalUserJoined(ServerInfo_User userInfo);
     void externalUserLeft(QString userName);
+    void externalServerCompleteList(Event_ServerCompleteList event);
     void externalRoomUserJoined(int roomId, ServerInfo_User userInfo);
     void externalRoomUserLeft(int roomId, QString userName);
     void externalRoomSay(int roomId, QString userName, QString message);
@@ -53,15 +90,38 @@ private:
     QString peerHostName, peerAddress;
     int peerPort;
     QSslCertificate peerCert;
+    bool outgoing;
+    /// Set while this interface is the one registered with the server for serverId.
+    bool registered;
+    std::atomic<int> state;
+    int reconnectDelay;
+    QTimer *handshakeTimer, *reconnectTimer;
+    std::atomic<quint64> linkFailures;
 
     QMutex outputBufferMutex;
     Servatrice *server;
     QSslSocket *socket;
 
     QByteArray inputBuffer, outputBuffer;
+    /// Messages are collected for batchInterval msecs and then sent together in one frame.
+    IslMessageBatch outputBatch;
+    int batchInterval;
+    QTimer *flushTimer;
+    /// Set once the peer has said it reads batched frames; until then every message goes out in a plain frame.
+    bool batchFrames;
+    /// Only created once the peer has said it reads compressed frames, and compression is enabled.
+    StreamCompressor *outputCompressor;
+    StreamDecompressor *inputDecompressor;
+    /// Set while the complete list for a newly connected peer is being built; messages are held back until the list
+    /// has been put in front of them.
+    bool synchronizing;
     bool messageInProgress;
+    quint32 frameHeader;
     int messageLength;
 
+    std::atomic<quint64> messagesSent, framesSent, bytesSent, messagesCoalesced;
+    std::atomic<quint64> messagesReceived, framesReceived, bytesReceived;
+
     void sessionEvent_ServerCompleteList(const Event_ServerCompleteList &event);
     void sessionEvent_UserJoined(const Event_UserJoined &event);
     void sessionEvent_UserLeft(const Event_UserLeft &event);
@@ -79,7 +139,15 @@ private:
     void processRoomCommand(const CommandContainer &cont, qint64 sessionId);
 
     void processMessage(const IslMessage &item);
+    void writeFrame(IslMessageBatch &batch);
+    static quint32 localFeatures();
+    void setPeerFeatures(quint32 features);
     void sharedCtor(const QSslCertificate &cert, const QSslKey &privateKey);
+    void setState(PeerState newState);
+    bool registerInterface();
+    void synchronizePeer();
+    void removeExternalUsers();
+    void connectionLost();
 public slots:
     void initServer();
     void initClient();
@@ -97,6 +165,7 @@ public:
     ~IslInterface();
 
     void transmitMessage(const IslMessage &item);
+    IslPeerStats getStats() const;
 };
 
 #endif
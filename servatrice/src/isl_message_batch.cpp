@@ -0,0 +1,144 @@
+#include "isl_message_batch.h"
+
+#include "get_pb_extension.h"
+#include "pb/event_list_games.pb.h"
+#include "stream_compression.h"
+
+namespace
+{
+void appendLength(QByteArray &out, quint32 length)
+{
+    out.append(static_cast<char>(length >> 24));
+    out.append(static_cast<char>(length >> 16));
+    out.append(static_cast<char>(length >> 8));
+    out.append(static_cast<char>(length));
+}
+
+/** Appends payload as one frame; returns false if the compressor failed and the frame went out uncompressed. */
+bool appendFrame(QByteArray &out, const QByteArray &payload, quint32 flags, StreamCompressor *compressor)
+{
+    bool compressorUsable = true;
+    if (compressor && payload.size() >= IslMessageBatch::minCompressedSize) {
+        QByteArray compressed;
+        if (compressor->compress(payload.constData(), payload.size(), compressed)) {
+            appendLength(out, static_cast<quint32>(compressed.size()) | flags | StreamCompressedFrameFlag);
+            out.append(compressed);
+            return true;
+        }
+        compressorUsable = false;
+    }
+    appendLength(out, static_cast<quint32>(payload.size()) | flags);
+    out.append(payload);
+    return compressorUsable;
+}
+} // namespace
+
+void IslMessageBatch::append(const IslMessage &item)
+{
+    // only updates broadcast to the whole peer can be merged; ones for a single session are answers to a request
+    if (item.message_type() != IslMessage::ROOM_EVENT || item.has_session_id() ||
+        getPbExtension(item.room_event()) != RoomEvent::LIST_GAMES) {
+        messages.append(item);
+        return;
+    }
+    const Event_ListGames &event = item.room_event().GetExtension(Event_ListGames::ext);
+    if (event.game_list_size() != 1) {
+        messages.append(item);
+        return;
+    }
+
+    const QPair<int, int> key(item.room_event().room_id(), event.game_list(0).game_id());
+    auto existing = gameUpdates.constFind(key);
+    if (existing != gameUpdates.constEnd()) {
+        // keep the place of the old update, so that the game is not reported after events that followed it
+        messages[existing.value()] = item;
+        ++coalescedCount;
+        return;
+    }
+    gameUpdates.insert(key, messages.size());
+    messages.append(item);
+}
+
+int IslMessageBatch::takeCoalescedCount()
+{
+    const int result = coalescedCount;
+    coalescedCount = 0;
+    return result;
+}
+
+void IslMessageBatch::appendMessage(QByteArray &out, const IslMessage &item)
+{
+#if GOOGLE_PROTOBUF_VERSION > 3001000
+    unsigned int size = item.ByteSizeLong();
+#else
+    unsigned int size = item.ByteSize();
+#endif
+    appendLength(out, size);
+    const int start = out.size();
+    out.resize(start + static_cast<int>(size));
+    item.SerializeToArray(out.data() + start, static_cast<int>(size));
+}
+
+int IslMessageBatch::writeFrames(QByteArray &out, StreamCompressor *compressor, bool batched, bool &failed)
+{
+    failed = false;
+    int frames = 0;
+    if (batched && messages.size() > 1) {
+        QByteArray payload;
+        for (const IslMessage &item : messages)
+            appendMessage(payload, item);
+        failed = !appendFrame(out, payload, IslBatchFrameFlag, compressor);
+        frames = 1;
+    } else {
+        for (const IslMessage &item : messages) {
+            const QByteArray payload = QByteArray::fromStdString(item.SerializeAsString());
+            if (!appendFrame(out, payload, 0, failed ? nullptr : compressor))
+                failed = true;
+            ++frames;
+        }
+    }
+    messages.clear();
+    gameUpdates.clear();
+    return frames;
+}
+
+bool IslMessageBatch::readFrame(quint32 header,
+                                const char *data,
+                                int size,
+                                StreamDecompressor *decompressor,
+                                QList<IslMessage> &result)
+{
+    QByteArray decompressed;
+    if (header & StreamCompressedFrameFlag) {
+        if (!decompressor || !decompressor->decompress(data, size, decompressed))
+            return false;
+        data = decompressed.constData();
+        size = decompressed.size();
+    }
+
+    if (!(header & IslBatchFrameFlag)) {
+        IslMessage item;
+        if (!item.ParseFromArray(data, size))
+            return false;
+        result.append(item);
+        return true;
+    }
+
+    int position = 0;
+    while (position < size) {
+        if (size - position < 4)
+            return false;
+        const auto *bytes = reinterpret_cast<const unsigned char *>(data + position);
+        const quint32 length = (static_cast<quint32>(bytes[0]) << 24) | (static_cast<quint32>(bytes[1]) << 16) |
+                               (static_cast<quint32>(bytes[2]) << 8) | static_cast<quint32>(bytes[3]);
+        position += 4;
+        if (length > static_cast<quint32>(size - position))
+            return false;
+        IslMessage item;
+        if (!item.ParseFromArray(data + position, static_cast<int>(length)))
+            return false;
+        result.append(item);
+        position += static_cast<int>(length);
+    }
+    return true;
+}
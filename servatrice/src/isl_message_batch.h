@@ -0,0 +1,88 @@
+#ifndef ISL_MESSAGE_BATCH_H
+#define ISL_MESSAGE_BATCH_H
+
+#include "pb/isl_message.pb.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QPair>
+
+class StreamCompressor;
+class StreamDecompressor;
+
+/**
+ * ISL frames carry either a single IslMessage, like they always did, or with IslBatchFrameFlag set in the length a
+ * batch of length-prefixed messages. StreamCompressedFrameFlag marks a frame whose payload continues the link's
+ * deflate stream.
+ */
+static const quint32 IslBatchFrameFlag = 0x40000000u;
+static const quint32 IslFrameSizeMask = 0x3fffffffu;
+
+/**
+ * Frame kinds beyond the plain one that a server can read, exchanged in Event_ServerCompleteList::isl_features.
+ * Older servers send no flags and only ever get plain frames.
+ */
+enum IslFeature
+{
+    IslFeatureBatch = 0x1,
+    IslFeatureCompression = 0x2
+};
+
+/**
+ * Messages waiting to be sent to one peer. A game list update replaces any earlier one for the same game that is
+ * still waiting, in its place, since the peer only needs the latest state of each game.
+ */
+class IslMessageBatch
+{
+private:
+    QList<IslMessage> messages;
+    // (room id, game id) -> index in messages of the pending update of that game
+    QMap<QPair<int, int>, int> gameUpdates;
+    int coalescedCount;
+
+public:
+    static const int minCompressedSize = 64;
+
+    IslMessageBatch() : coalescedCount(0)
+    {
+    }
+
+    void append(const IslMessage &item);
+    bool isEmpty() const
+    {
+        return messages.isEmpty();
+    }
+    const QList<IslMessage> &getMessages() const
+    {
+        return messages;
+    }
+    void clear()
+    {
+        messages.clear();
+        gameUpdates.clear();
+    }
+    /** Returns how many messages were dropped because a newer one superseded them, and resets the count. */
+    int takeCoalescedCount();
+
+    /**
+     * Appends all pending messages to out, as one frame if batched is set and as a plain frame each otherwise,
+     * compressed if a compressor is given, and clears the batch. Returns the number of frames written; failed is set
+     * if the compressor failed, in which case the frames are written uncompressed and the compressor must not be used
+     * again.
+     */
+    int writeFrames(QByteArray &out, StreamCompressor *compressor, bool batched, bool &failed);
+
+    static void appendMessage(QByteArray &out, const IslMessage &item);
+    /**
+     * Decodes the payload of one frame whose length field was header. Returns false if the frame is corrupt or
+     * compressed without a decompressor.
+     */
+    static bool readFrame(quint32 header,
+                          const char *data,
+                          int size,
+                          StreamDecompressor *decompressor,
+                          QList<IslMessage> &result);
+};
+
+#endif
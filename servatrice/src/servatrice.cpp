@@ -28,11 +28,13 @@
 #include "pb/event_server_shutdown.pb.h"
 #include "servatrice_connection_pool.h"
 #include "servatrice_database_interface.h"
+#include "servatrice_maintenance.h"
 #include "server_logger.h"
 #include "server_room.h"
 #include "serversocketinterface.h"
 #include "settingscache.h"
 #include "smtpclient.h"
+#include "stream_compression.h"
 
 #include <QDateTime>
 #include <QDebug>
@@ -64,6 +66,7 @@ Servatrice_GameServer::Servatrice_GameServer(Servatrice *_server,
         newThread->start();
         QMetaObject::invokeMethod(newDatabaseInterface, "initDatabase", Qt::BlockingQueuedConnection,
                                   Q_ARG(QSqlDatabase, _sqlDatabase));
+        QMetaObject::invokeMethod(newPool, "startLoadMonitor", Qt::QueuedConnection);
 
         connectionPools.append(newPool);
     }
@@ -82,10 +85,9 @@ Servatrice_GameServer::~Servatrice_GameServer()
 
 void Servatrice_GameServer::incomingConnection(qintptr socketDescriptor)
 {
-    Servatrice_ConnectionPool *pool = findLeastUsedConnectionPool();
+    Servatrice_ConnectionPool *pool = Servatrice_ConnectionPool::findLeastLoaded(connectionPools);
 
-    auto ssi = new TcpServerSocketInterface(server, pool->getDatabaseInterface());
-    connect(ssi, SIGNAL(incTxBytes), this, SLOT(incTxBytes));
+    auto ssi = new TcpServerSocketInterface(server, pool);
     ssi->moveToThread(pool->thread());
     pool->addClient();
     connect(ssi, SIGNAL(destroyed()), pool, SLOT(removeClient()));
@@ -93,35 +95,20 @@ void Servatrice_GameServer::incomingConnection(qintptr socketDescriptor)
     QMetaObject::invokeMethod(ssi, "initConnection", Qt::QueuedConnection, Q_ARG(int, socketDescriptor));
 }
 
-Servatrice_ConnectionPool *Servatrice_GameServer::findLeastUsedConnectionPool()
-{
-    int minClientCount = -1;
-    int poolIndex = -1;
-    QStringList debugStr;
-    for (int i = 0; i < connectionPools.size(); ++i) {
-        const int clientCount = connectionPools[i]->getClientCount();
-        if ((poolIndex == -1) || (clientCount < minClientCount)) {
-            minClientCount = clientCount;
-            poolIndex = i;
-        }
-        debugStr.append(QString::number(clientCount));
-    }
-    qDebug().noquote() << "Pool utilisation:" << debugStr.join(", ");
-    return connectionPools[poolIndex];
-}
-
 #define WEBSOCKET_POOL_NUMBER 999
 
 Servatrice_WebsocketGameServer::Servatrice_WebsocketGameServer(Servatrice *_server,
                                                                int _numberPools,
                                                                const QSqlDatabase &_sqlDatabase,
                                                                QObject *parent)
-    : QWebSocketServer("Servatrice", QWebSocketServer::NonSecureMode, parent), server(_server)
+    : QTcpServer(parent), server(_server)
 {
     for (int i = 0; i < _numberPools; ++i) {
         int poolNumber = WEBSOCKET_POOL_NUMBER + i;
         auto newDatabaseInterface = new Servatrice_DatabaseInterface(poolNumber, server);
         auto newPool = new Servatrice_ConnectionPool(newDatabaseInterface);
+        // owned by the pool, so it moves to the pool thread with it
+        auto newAcceptor = new Servatrice_WebsocketPoolAcceptor(server, newPool, newPool);
 
         auto newThread = new QThread;
         newThread->setObjectName("pool_" + QString::number(poolNumber));
@@ -132,10 +119,10 @@ Servatrice_WebsocketGameServer::Servatrice_WebsocketGameServer(Servatrice *_serv
         newThread->start();
         QMetaObject::invokeMethod(newDatabaseInterface, "initDatabase", Qt::BlockingQueuedConnection,
                                   Q_ARG(QSqlDatabase, _sqlDatabase));
+        QMetaObject::invokeMethod(newPool, "startLoadMonitor", Qt::QueuedConnection);
 
         connectionPools.append(newPool);
-
-        connect(this, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+        acceptors.insert(newPool, newAcceptor);
     }
 }
 
@@ -150,38 +137,29 @@ Servatrice_WebsocketGameServer::~Servatrice_WebsocketGameServer()
     }
 }
 
-void Servatrice_WebsocketGameServer::onNewConnection()
+void Servatrice_WebsocketGameServer::incomingConnection(qintptr socketDescriptor)
 {
-    Servatrice_ConnectionPool *pool = findLeastUsedConnectionPool();
+    Servatrice_ConnectionPool *pool = Servatrice_ConnectionPool::findLeastLoaded(connectionPools);
 
-    auto ssi = new WebsocketServerSocketInterface(server, pool->getDatabaseInterface());
-    connect(ssi, SIGNAL(incTxBytes), this, SLOT(incTxBytes));
-    /*
-     * Due to a Qt limitation, websockets can't be moved to another thread.
-     * This will hopefully change in Qt6 if QtWebSocket will be integrated in QtNetwork
-     */
-    // ssi->moveToThread(pool->thread());
-    pool->addClient();
-    connect(ssi, SIGNAL(destroyed()), pool, SLOT(removeClient()));
+    // the handshake and all websocket traffic of this client are handled by the pool thread
+    QMetaObject::invokeMethod(acceptors.value(pool), "acceptConnection", Qt::QueuedConnection,
+                              Q_ARG(int, static_cast<int>(socketDescriptor)));
+}
 
-    QMetaObject::invokeMethod(ssi, "initConnection", Qt::QueuedConnection, Q_ARG(void *, nextPendingConnection()));
+Servatrice_WebsocketPoolAcceptor::Servatrice_WebsocketPoolAcceptor(Servatrice *_server,
+                                                                   Servatrice_ConnectionPool *_pool,
+                                                                   QObject *parent)
+    : Servatrice_WebsocketAcceptor(parent), server(_server), pool(_pool)
+{
 }
 
-Servatrice_ConnectionPool *Servatrice_WebsocketGameServer::findLeastUsedConnectionPool()
+void Servatrice_WebsocketPoolAcceptor::socketConnected(QWebSocket *socket)
 {
-    int minClientCount = -1;
-    int poolIndex = -1;
-    QStringList debugStr;
-    for (int i = 0; i < connectionPools.size(); ++i) {
-        const int clientCount = connectionPools[i]->getClientCount();
-        if ((poolIndex == -1) || (clientCount < minClientCount)) {
-            minClientCount = clientCount;
-            poolIndex = i;
-        }
-        debugStr.append(QString::number(clientCount));
-    }
-    qDebug().noquote() << "Pool utilisation:" << debugStr.join(", ");
-    return connectionPools[poolIndex];
+    auto ssi = new WebsocketServerSocketInterface(server, pool);
+    pool->addClient();
+    connect(ssi, SIGNAL(destroyed()), pool, SLOT(removeClient()));
+
+    ssi->initConnection(socket);
 }
 
 void Servatrice_IslServer::incomingConnection(qintptr socketDescriptor)
@@ -198,15 +176,16 @@ void Servatrice_IslServer::incomingConnection(qintptr socketDescriptor)
 }
 
 Servatrice::Servatrice(QObject *parent)
-    : Server(parent), authenticationMethod(AuthenticationNone), uptime(0), txBytes(0), rxBytes(0),
-      shutdownTimer(nullptr)
+    : Server(parent), authenticationMethod(AuthenticationNone), gameServer(nullptr), websocketGameServer(nullptr),
+      islServer(nullptr), metricsServer(nullptr), maintenance(nullptr), txBytes(0), rxBytes(0), shutdownTimer(nullptr)
 {
     qRegisterMetaType<QSqlDatabase>("QSqlDatabase");
 }
 
 Servatrice::~Servatrice()
 {
-    gameServer->close();
+    if (gameServer)
+        gameServer->close();
 
     // we are destroying the clients outside their thread!
     for (auto *client : clients) {
@@ -217,6 +196,13 @@ Servatrice::~Servatrice()
         shutdownTimer->deleteLater();
     }
 
+    if (maintenance) {
+        QThread *maintenanceThread = maintenance->thread();
+        maintenance->deleteLater(); // maintenance destructor calls thread()->quit()
+        maintenanceThread->wait();
+        maintenanceThread->deleteLater();
+    }
+
     servatriceDatabaseInterface->deleteLater();
     prepareDestroy();
 }
@@ -293,7 +279,8 @@ bool Servatrice::initServer()
     } else {
         databaseType = DatabaseNone;
     }
-    servatriceDatabaseInterface = new Servatrice_DatabaseInterface(-1, this);
+    servatriceDatabaseInterface =
+        new Servatrice_DatabaseInterface(Servatrice_DatabaseInterface::MainDatabaseInstance, this);
     setDatabaseInterface(servatriceDatabaseInterface);
 
     if (databaseType != DatabaseNone) {
@@ -304,20 +291,17 @@ bool Servatrice::initServer()
             qDebug() << "Failed to open database";
             return false;
         }
-        updateServerList();
+        updateServerList(servatriceDatabaseInterface);
         qDebug() << "Clearing previous sessions...";
         servatriceDatabaseInterface->clearSessionTables();
     }
 
     if (getRoomsMethodString() == "sql") {
-        QSqlQuery *query = servatriceDatabaseInterface->prepareQuery(
-            "select id, name, descr, permissionlevel, privlevel, auto_join, join_message, chat_history_size from "
-            "{prefix}_rooms where id_server = :id_server order by id asc");
+        QSqlQuery *query = servatriceDatabaseInterface->prepareQuery(SelectRooms);
         query->bindValue(":id_server", serverId);
         servatriceDatabaseInterface->execSqlQuery(query);
         while (query->next()) {
-            QSqlQuery *query2 = servatriceDatabaseInterface->prepareQuery(
-                "select name from {prefix}_rooms_gametypes where id_room = :id_room AND id_server = :id_server");
+            QSqlQuery *query2 = servatriceDatabaseInterface->prepareQuery(SelectRoomGameTypes);
             query2->bindValue(":id_server", serverId);
             query2->bindValue(":id_room", query->value(0).toInt());
             servatriceDatabaseInterface->execSqlQuery(query2);
@@ -382,14 +366,13 @@ bool Servatrice::initServer()
             if (key.isNull())
                 throw QString("Invalid private key.");
 
-            QMutableListIterator<ServerProperties> serverIterator(serverList);
-            while (serverIterator.hasNext()) {
-                const ServerProperties &prop = serverIterator.next();
-                if (prop.cert == cert) {
-                    serverIterator.remove();
-                    continue;
-                }
-
+            // the list was first read before the certificate was known
+            serverListMutex.lock();
+            islCert = cert;
+            serverList = withoutOwnServer(serverList, serverId, islCert);
+            const QList<ServerProperties> peers = serverList;
+            serverListMutex.unlock();
+            for (const ServerProperties &prop : peers) {
                 auto *thread = new QThread;
                 thread->setObjectName("isl_" + QString::number(prop.id));
                 connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
@@ -400,7 +383,8 @@ bool Servatrice::initServer()
                 connect(interface, SIGNAL(destroyed()), thread, SLOT(quit()));
 
                 thread->start();
-                QMetaObject::invokeMethod(interface, "initClient", Qt::BlockingQueuedConnection);
+                islClients.append(interface);
+                QMetaObject::invokeMethod(interface, "initClient", Qt::QueuedConnection);
             }
 
             qDebug() << "Starting ISL server on port" << getISLNetworkPort();
@@ -419,11 +403,35 @@ bool Servatrice::initServer()
     connect(pingClock, SIGNAL(timeout()), this, SIGNAL(pingClockTimeout()));
     pingClock->start(getClientKeepAlive() * 1000);
 
-    statusUpdateClock = new QTimer(this);
-    connect(statusUpdateClock, SIGNAL(timeout()), this, SLOT(statusUpdate()));
-    if (getServerStatusUpdateTime() != 0) {
-        qDebug() << "Starting status update clock, interval" << getServerStatusUpdateTime() << "ms";
-        statusUpdateClock->start(getServerStatusUpdateTime());
+    if (databaseType != DatabaseNone) {
+        auto maintenanceDatabaseInterface =
+            new Servatrice_DatabaseInterface(Servatrice_DatabaseInterface::MaintenanceDatabaseInstance, this);
+        maintenance = new Servatrice_Maintenance(this, maintenanceDatabaseInterface);
+
+        auto maintenanceThread = new QThread;
+        maintenanceThread->setObjectName("maintenance");
+        maintenance->moveToThread(maintenanceThread);
+        maintenanceDatabaseInterface->moveToThread(maintenanceThread);
+        // the mails are queued by the status update, so the smtp client has to live next to it
+        smtpClient->moveToThread(maintenanceThread);
+
+        maintenanceThread->start();
+        QMetaObject::invokeMethod(maintenanceDatabaseInterface, "initDatabase", Qt::QueuedConnection,
+                                  Q_ARG(QSqlDatabase, servatriceDatabaseInterface->getDatabase()));
+        if (getServerStatusUpdateTime() != 0) {
+            qDebug() << "Starting status update clock, interval" << getServerStatusUpdateTime() << "ms";
+            QMetaObject::invokeMethod(maintenance, "startStatusUpdates", Qt::QueuedConnection,
+                                      Q_ARG(int, getServerStatusUpdateTime()));
+        }
+    }
+
+    // the bans are queried on the maintenance thread; logins check them with sql until the first load arrives
+    if (maintenance && authenticationMethod == AuthenticationSql && getBanCacheRefreshInterval() > 0) {
+        qRegisterMetaType<QList<BanCacheEntry>>("QList<BanCacheEntry>");
+        connect(maintenance, &Servatrice_Maintenance::bansLoaded, this, &Servatrice::bansLoaded);
+        qDebug() << "Starting ban cache clock, interval" << getBanCacheRefreshInterval() << "s";
+        QMetaObject::invokeMethod(maintenance, "startBanCacheRefresh", Qt::QueuedConnection,
+                                  Q_ARG(int, getBanCacheRefreshInterval()), Q_ARG(int, getBanCacheReloadInterval()));
     }
 
     // SOCKET SERVER
@@ -457,6 +465,19 @@ bool Servatrice::initServer()
         }
     }
 
+    // METRICS SERVER
+    if (getMetricsPort() > 0) {
+        metricsServer = new Servatrice_MetricsServer(this, this);
+        QHostAddress metricsHost = getMetricsHost();
+        qDebug() << "Starting metrics server on host" << metricsHost.toString() << "port" << getMetricsPort();
+        if (metricsServer->listen(metricsHost, static_cast<quint16>(getMetricsPort())))
+            qDebug() << "Metrics server listening.";
+        else {
+            qDebug() << "metricsServer->listen(): Error:" << metricsServer->errorString();
+            return false;
+        }
+    }
+
     if (getIdleClientTimeout() > 0) {
         qDebug() << "Idle client timeout value:" << getIdleClientTimeout();
         if (getIdleClientTimeout() < 300)
@@ -475,21 +496,38 @@ void Servatrice::addDatabaseInterface(QThread *thread, Servatrice_DatabaseInterf
     databaseInterfaces.insert(thread, databaseInterface);
 }
 
-void Servatrice::updateServerList()
+void Servatrice::updateServerList(Servatrice_DatabaseInterface *databaseInterface)
 {
-    qDebug() << "Updating server list...";
+    // Called once at startup and then periodically from the maintenance thread. The query runs without holding
+    // serverListMutex, so ISL handshakes reading the list are never blocked on the database. The list only holds
+    // the peers: our own row is dropped on every reload.
+    QList<ServerProperties> newServerList;
+    QSqlQuery *query = databaseInterface->prepareQuery(SelectServers);
+    if (!databaseInterface->execSqlQuery(query))
+        return;
+    while (query->next()) {
+        newServerList.append(ServerProperties(query->value(0).toInt(),
+                                              QSslCertificate(query->value(1).toString().toUtf8()),
+                                              query->value(2).toString(), QHostAddress(query->value(3).toString()),
+                                              query->value(4).toInt(), query->value(5).toInt()));
+    }
 
-    serverListMutex.lock();
-    serverList.clear();
+    QMutexLocker locker(&serverListMutex);
+    newServerList = withoutOwnServer(newServerList, serverId, islCert);
+    bool changed = newServerList.size() != serverList.size();
+    for (int i = 0; !changed && i < newServerList.size(); ++i) {
+        const ServerProperties &a = newServerList[i], &b = serverList[i];
+        changed = a.id != b.id || a.cert != b.cert || a.hostname != b.hostname || a.address != b.address ||
+                  a.gamePort != b.gamePort || a.controlPort != b.controlPort;
+    }
+    serverList = newServerList;
+    locker.unlock();
 
-    QSqlQuery *query = servatriceDatabaseInterface->prepareQuery(
-        "select id, ssl_cert, hostname, address, game_port, control_port from {prefix}_servers order by id asc");
-    servatriceDatabaseInterface->execSqlQuery(query);
-    while (query->next()) {
-        ServerProperties prop(query->value(0).toInt(), QSslCertificate(query->value(1).toString().toUtf8()),
-                              query->value(2).toString(), QHostAddress(query->value(3).toString()),
-                              query->value(4).toInt(), query->value(5).toInt());
-        serverList.append(prop);
+    if (!changed)
+        return;
+
+    qDebug() << "Updated server list:";
+    for (const ServerProperties &prop : newServerList) {
         qDebug() << QString("#%1 CERT=%2 NAME=%3 IP=%4:%5 CPORT=%6")
                         .arg(prop.id)
                         .arg(QString(prop.cert.digest().toHex()))
@@ -498,8 +536,16 @@ void Servatrice::updateServerList()
                         .arg(prop.gamePort)
                         .arg(prop.controlPort);
     }
+}
 
-    serverListMutex.unlock();
+QList<Servatrice_ConnectionPool *> Servatrice::getConnectionPools() const
+{
+    QList<Servatrice_ConnectionPool *> result;
+    if (gameServer)
+        result.append(gameServer->getConnectionPools());
+    if (websocketGameServer)
+        result.append(websocketGameServer->getConnectionPools());
+    return result;
 }
 
 QList<ServerProperties> Servatrice::getServerList() const
@@ -537,8 +583,7 @@ void Servatrice::updateLoginMessage()
     if (!servatriceDatabaseInterface->checkSql())
         return;
 
-    QSqlQuery *query = servatriceDatabaseInterface->prepareQuery(
-        "select message from {prefix}_servermessages where id_server = :id_server order by timest desc limit 1");
+    QSqlQuery *query = servatriceDatabaseInterface->prepareQuery(SelectServerMessage);
     query->bindValue(":id_server", serverId);
     if (servatriceDatabaseInterface->execSqlQuery(query))
         if (query->next()) {
@@ -576,90 +621,13 @@ void Servatrice::setRequiredFeatures(const QString &featureList)
     qDebug() << "Set required client features to:" << serverRequiredFeatureList;
 }
 
-void Servatrice::statusUpdate()
+void Servatrice::bansLoaded(const QList<BanCacheEntry> &entries, bool replace)
 {
-    if (!servatriceDatabaseInterface->checkSql())
-        return;
-
-    const int uc = getUsersCount(); // for correct mutex locking order
-
-    const QStringList mods_info = getOnlineModeratorList();
-    const int mc = mods_info.size();
-    const QString ml = mods_info.join(", ");
-
-    const int gc = getGamesCount();
-
-    uptime += statusUpdateClock->interval() / 1000;
-
-    txBytesMutex.lock();
-    quint64 tx = txBytes;
-    txBytes = 0;
-    txBytesMutex.unlock();
-    rxBytesMutex.lock();
-    quint64 rx = rxBytes;
-    rxBytes = 0;
-    rxBytesMutex.unlock();
-
-    QSqlQuery *query = servatriceDatabaseInterface->prepareQuery(
-        "insert into {prefix}_uptime (id_server, timest, uptime, users_count, mods_count, mods_list, games_count, "
-        "tx_bytes, rx_bytes) values(:id, NOW(), :uptime, :users_count, :mods_count, :mods_list, :games_count, :tx, "
-        ":rx)");
-    query->bindValue(":id", serverId);
-    query->bindValue(":uptime", uptime);
-    query->bindValue(":users_count", uc);
-    query->bindValue(":mods_count", mc);
-    query->bindValue(":mods_list", ml);
-    query->bindValue(":games_count", gc);
-    query->bindValue(":tx", tx);
-    query->bindValue(":rx", rx);
-    servatriceDatabaseInterface->execSqlQuery(query);
-
-    if (getRegistrationEnabled() && getEnableInternalSMTPClient()) {
-        if (getRequireEmailActivationEnabled()) {
-            auto servDbSelQuery = servatriceDatabaseInterface->prepareQuery("select a.name, b.email, b.token from "
-                                                                            "{prefix}_activation_emails a left join "
-                                                                            "{prefix}_users b on a.name = b.name");
-            if (!servatriceDatabaseInterface->execSqlQuery(servDbSelQuery))
-                return;
-
-            auto *queryDelete =
-                servatriceDatabaseInterface->prepareQuery("delete from {prefix}_activation_emails where name = :name");
-
-            while (servDbSelQuery->next()) {
-                const QString userName = servDbSelQuery->value(0).toString();
-                const QString emailAddress = servDbSelQuery->value(1).toString();
-                const QString token = servDbSelQuery->value(2).toString();
-
-                if (smtpClient->enqueueActivationTokenMail(userName, emailAddress, token)) {
-                    queryDelete->bindValue(":name", userName);
-                    servatriceDatabaseInterface->execSqlQuery(queryDelete);
-                }
-            }
-        }
-
-        if (getEnableForgotPassword()) {
-            auto *forgotPwQuery = servatriceDatabaseInterface->prepareQuery(
-                "select a.name, b.email, b.token from {prefix}_forgot_password a left join {prefix}_users b on a.name "
-                "= b.name where a.emailed = 0");
-            if (!servatriceDatabaseInterface->execSqlQuery(forgotPwQuery))
-                return;
-
-            QSqlQuery *queryDelete = servatriceDatabaseInterface->prepareQuery(
-                "update {prefix}_forgot_password set emailed = 1 where name = :name");
-
-            while (forgotPwQuery->next()) {
-                const QString userName = forgotPwQuery->value(0).toString();
-                const QString emailAddress = forgotPwQuery->value(1).toString();
-                const QString token = forgotPwQuery->value(2).toString();
-
-                if (smtpClient->enqueueForgotPasswordTokenMail(userName, emailAddress, token)) {
-                    queryDelete->bindValue(":name", userName);
-                    servatriceDatabaseInterface->execSqlQuery(queryDelete);
-                }
-            }
-        }
-
-        smtpClient->sendAllEmails();
+    if (replace) {
+        banCache.replaceAll(entries);
+        qDebug() << "Ban cache reloaded," << entries.size() << "bans";
+    } else {
+        banCache.addBans(entries);
     }
 }
 
@@ -676,20 +644,6 @@ void Servatrice::scheduleShutdown(const QString &reason, int minutes)
     shutdownTimeout();
 }
 
-void Servatrice::incTxBytes(quint64 num)
-{
-    txBytesMutex.lock();
-    txBytes += num;
-    txBytesMutex.unlock();
-}
-
-void Servatrice::incRxBytes(quint64 num)
-{
-    rxBytesMutex.lock();
-    rxBytes += num;
-    rxBytesMutex.unlock();
-}
-
 void Servatrice::shutdownTimeout()
 {
     // Show every time counter cut in half & every minute for last 5 minutes
@@ -734,6 +688,8 @@ void Servatrice::addIslInterface(int serverId, IslInterface *interface)
     islInterfaces.insert(serverId, interface);
     connect(interface, SIGNAL(externalUserJoined(ServerInfo_User)), this, SLOT(externalUserJoined(ServerInfo_User)));
     connect(interface, SIGNAL(externalUserLeft(QString)), this, SLOT(externalUserLeft(QString)));
+    connect(interface, SIGNAL(externalServerCompleteList(Event_ServerCompleteList)), this,
+            SLOT(externalServerCompleteList(Event_ServerCompleteList)));
     connect(interface, SIGNAL(externalRoomUserJoined(int, ServerInfo_User)), this,
             SLOT(externalRoomUserJoined(int, ServerInfo_User)));
     connect(interface, SIGNAL(externalRoomUserLeft(int, QString)), this, SLOT(externalRoomUserLeft(int, QString)));
@@ -761,6 +717,21 @@ void Servatrice::removeIslInterface(int serverId)
     islInterfaces.remove(serverId);
 }
 
+QList<IslPeerStats> Servatrice::getIslPeerStats()
+{
+    QReadLocker locker(&islLock);
+    QList<IslPeerStats> result;
+    for (IslInterface *interface : islInterfaces)
+        result.append(interface->getStats());
+    // outgoing links are reported while they are down too, unless another link to the same peer is up
+    for (IslInterface *interface : islClients) {
+        const IslPeerStats stats = interface->getStats();
+        if (!islInterfaces.contains(stats.serverId))
+            result.append(stats);
+    }
+    return result;
+}
+
 void Servatrice::doSendIslMessage(const IslMessage &msg, int serverId)
 {
     QReadLocker locker(&islLock);
@@ -963,6 +934,16 @@ int Servatrice::getServerStatusUpdateTime() const
     return settingsCache->value("server/statusupdate", 15000).toInt();
 }
 
+int Servatrice::getBanCacheRefreshInterval() const
+{
+    return settingsCache->value("security/ban_cache_refresh_interval", 30).toInt();
+}
+
+int Servatrice::getBanCacheReloadInterval() const
+{
+    return settingsCache->value("security/ban_cache_reload_interval", 600).toInt();
+}
+
 int Servatrice::getNumberOfTCPPools() const
 {
     return settingsCache->value("server/number_pools", 1).toInt();
@@ -1001,6 +982,25 @@ QHostAddress Servatrice::getServerWebSocketHost() const
         return QHostAddress(host);
 }
 
+bool Servatrice::getStreamCompressionEnabled() const
+{
+    return StreamCompressor::isAvailable() && settingsCache->value("server/stream_compression", true).toBool();
+}
+
+int Servatrice::getMetricsPort() const
+{
+    return settingsCache->value("server/metrics_port", 0).toInt();
+}
+
+QHostAddress Servatrice::getMetricsHost() const
+{
+    QString host = settingsCache->value("server/metrics_host", "127.0.0.1").toString();
+    if (host == "any")
+        return QHostAddress::Any;
+    else
+        return QHostAddress(host);
+}
+
 int Servatrice::getServerWebSocketPort() const
 {
     if (QProcessEnvironment::systemEnvironment().contains("PORT")) {
@@ -1029,6 +1029,16 @@ int Servatrice::getISLNetworkPort() const
     return settingsCache->value("servernetwork/port", 14747).toInt();
 }
 
+int Servatrice::getISLBatchInterval() const
+{
+    return settingsCache->value("servernetwork/batch_interval", 20).toInt();
+}
+
+bool Servatrice::getISLCompressionEnabled() const
+{
+    return StreamCompressor::isAvailable() && settingsCache->value("servernetwork/compression", true).toBool();
+}
+
 int Servatrice::getIdleClientTimeout() const
 {
     return settingsCache->value("server/idleclienttimeout", 3600).toInt();
@@ -20,8 +20,13 @@
 #ifndef SERVATRICE_H
 #define SERVATRICE_H
 
+#include "servatrice_ban_cache.h"
+#include "servatrice_metrics.h"
+#include "servatrice_server_list.h"
+#include "servatrice_websocket_acceptor.h"
 #include "server.h"
 
+#include <QDateTime>
 #include <QHostAddress>
 #include <QMetaType>
 #include <QMutex>
@@ -30,7 +35,7 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QTcpServer>
-#include <QWebSocketServer>
+#include <atomic>
 #include <utility>
 
 Q_DECLARE_METATYPE(QSqlDatabase)
@@ -42,8 +47,10 @@ class GameReplay;
 class Servatrice;
 class Servatrice_ConnectionPool;
 class Servatrice_DatabaseInterface;
+class Servatrice_Maintenance;
 class AbstractServerSocketInterface;
 class IslInterface;
+struct IslPeerStats;
 class FeatureSet;
 
 class Servatrice_GameServer : public QTcpServer
@@ -59,18 +66,40 @@ public:
                           const QSqlDatabase &_sqlDatabase,
                           QObject *parent = nullptr);
     ~Servatrice_GameServer() override;
+    const QList<Servatrice_ConnectionPool *> &getConnectionPools() const
+    {
+        return connectionPools;
+    }
 
 protected:
     void incomingConnection(qintptr socketDescriptor) override;
-    Servatrice_ConnectionPool *findLeastUsedConnectionPool();
 };
 
-class Servatrice_WebsocketGameServer : public QWebSocketServer
+class Servatrice_WebsocketPoolAcceptor : public Servatrice_WebsocketAcceptor
+{
+    Q_OBJECT
+private:
+    Servatrice *server;
+    Servatrice_ConnectionPool *pool;
+
+protected:
+    void socketConnected(QWebSocket *socket) override;
+
+public:
+    Servatrice_WebsocketPoolAcceptor(Servatrice *_server, Servatrice_ConnectionPool *_pool, QObject *parent = nullptr);
+};
+
+/**
+ * Accepts websocket connections on the main thread and hands the raw sockets to the least loaded pool, whose
+ * acceptor performs the handshake there.
+ */
+class Servatrice_WebsocketGameServer : public QTcpServer
 {
     Q_OBJECT
 private:
     Servatrice *server;
     QList<Servatrice_ConnectionPool *> connectionPools;
+    QMap<Servatrice_ConnectionPool *, Servatrice_WebsocketPoolAcceptor *> acceptors;
 
 public:
     Servatrice_WebsocketGameServer(Servatrice *_server,
@@ -78,11 +107,13 @@ public:
                                    const QSqlDatabase &_sqlDatabase,
                                    QObject *parent = nullptr);
     ~Servatrice_WebsocketGameServer() override;
+    const QList<Servatrice_ConnectionPool *> &getConnectionPools() const
+    {
+        return connectionPools;
+    }
 
 protected:
-    Servatrice_ConnectionPool *findLeastUsedConnectionPool();
-protected slots:
-    void onNewConnection();
+    void incomingConnection(qintptr socketDescriptor) override;
 };
 
 class Servatrice_IslServer : public QTcpServer
@@ -106,28 +137,6 @@ protected:
     void incomingConnection(qintptr socketDescriptor) override;
 };
 
-class ServerProperties
-{
-public:
-    int id;
-    QSslCertificate cert;
-    QString hostname;
-    QHostAddress address;
-    int gamePort;
-    int controlPort;
-
-    ServerProperties(int _id,
-                     const QSslCertificate &_cert,
-                     QString _hostname,
-                     const QHostAddress &_address,
-                     int _gamePort,
-                     int _controlPort)
-        : id(_id), cert(_cert), hostname(std::move(_hostname)), address(_address), gamePort(_gamePort),
-          controlPort(_controlPort)
-    {
-    }
-};
-
 class Servatrice : public Server
 {
     Q_OBJECT
@@ -139,8 +148,8 @@ public:
         AuthenticationPassword
     };
 private slots:
-    void statusUpdate();
     void shutdownTimeout();
+    void bansLoaded(const QList<BanCacheEntry> &entries, bool replace);
 
 protected:
     void doSendIslMessage(const IslMessage &msg, int islServerId) override;
@@ -153,20 +162,23 @@ private:
     };
     AuthenticationMethod authenticationMethod;
     DatabaseType databaseType;
-    QTimer *pingClock, *statusUpdateClock;
+    QTimer *pingClock;
     Servatrice_GameServer *gameServer;
     Servatrice_WebsocketGameServer *websocketGameServer;
     Servatrice_IslServer *islServer;
+    Servatrice_MetricsServer *metricsServer;
+    Servatrice_Metrics servatriceMetrics;
     mutable QMutex loginMessageMutex;
     QString loginMessage;
     QString dbPrefix;
     QMap<QString, bool> serverRequiredFeatureList;
     QString officialWarnings;
     Servatrice_DatabaseInterface *servatriceDatabaseInterface;
+    Servatrice_Maintenance *maintenance;
     int serverId;
-    int uptime;
-    QMutex txBytesMutex, rxBytesMutex;
-    quint64 txBytes, rxBytes;
+    std::atomic<quint64> txBytes, rxBytes;
+
+    ServerBanCache banCache;
 
     QString shutdownReason;
     int shutdownMinutes;
@@ -175,9 +187,11 @@ private:
 
     mutable QMutex serverListMutex;
     QList<ServerProperties> serverList;
-    void updateServerList();
+    QSslCertificate islCert;
 
     QMap<int, IslInterface *> islInterfaces;
+    // links this server opens to its peers; they live as long as the server and reconnect on their own
+    QList<IslInterface *> islClients;
 
     QString getDBPrefixString() const;
     QString getDBHostNameString() const;
@@ -188,15 +202,21 @@ private:
     QString getISLNetworkSSLCertFile() const;
     QString getISLNetworkSSLKeyFile() const;
     int getServerStatusUpdateTime() const;
+    int getBanCacheRefreshInterval() const;
+    int getBanCacheReloadInterval() const;
     int getNumberOfTCPPools() const;
     int getServerTCPPort() const;
     int getNumberOfWebSocketPools() const;
     int getServerWebSocketPort() const;
     int getISLNetworkPort() const;
+    int getISLBatchInterval() const;
+    bool getISLCompressionEnabled() const;
     bool getISLNetworkEnabled() const;
-    bool getEnableInternalSMTPClient() const;
     QHostAddress getServerTCPHost() const;
     QHostAddress getServerWebSocketHost() const;
+    bool getStreamCompressionEnabled() const;
+    int getMetricsPort() const;
+    QHostAddress getMetricsHost() const;
 
 public slots:
     void scheduleShutdown(const QString &reason, int minutes);
@@ -230,6 +250,15 @@ public:
     {
         return authenticationMethod;
     }
+    ServerBanCache *getBanCache()
+    {
+        return &banCache;
+    }
+    Servatrice_Metrics *getServatriceMetrics()
+    {
+        return &servatriceMetrics;
+    }
+    QList<Servatrice_ConnectionPool *> getConnectionPools() const;
     bool permitUnregisteredUsers() const override
     {
         return authenticationMethod != AuthenticationNone;
@@ -251,6 +280,7 @@ public:
     bool getEnableAudit() const;
     bool getEnableRegistrationAudit() const;
     bool getEnableForgotPasswordAudit() const;
+    bool getEnableInternalSMTPClient() const;
     int getMinPasswordLength() const;
     int getIdleClientTimeout() const override;
     int getServerID() const override;
@@ -272,15 +302,32 @@ public:
     int getMaxAccountsPerEmail() const;
     int getForgotPasswordTokenLife() const;
     QList<AbstractServerSocketInterface *> getUsersWithAddressAsList(const QHostAddress &address) const;
-    void incTxBytes(quint64 num);
-    void incRxBytes(quint64 num);
+    void incTxBytes(quint64 num)
+    {
+        txBytes.fetch_add(num, std::memory_order_relaxed);
+    }
+    void incRxBytes(quint64 num)
+    {
+        rxBytes.fetch_add(num, std::memory_order_relaxed);
+    }
+    /** Returns the traffic counted since the previous call and resets the counter. */
+    quint64 takeTxBytes()
+    {
+        return txBytes.exchange(0, std::memory_order_relaxed);
+    }
+    quint64 takeRxBytes()
+    {
+        return rxBytes.exchange(0, std::memory_order_relaxed);
+    }
     void addDatabaseInterface(QThread *thread, Servatrice_DatabaseInterface *databaseInterface);
 
     bool islConnectionExists(int islServerId) const;
     void addIslInterface(int islServerId, IslInterface *interface);
     void removeIslInterface(int islServerId);
+    QList<IslPeerStats> getIslPeerStats();
     QReadWriteLock islLock;
 
+    void updateServerList(Servatrice_DatabaseInterface *databaseInterface);
     QList<ServerProperties> getServerList() const;
 };
 
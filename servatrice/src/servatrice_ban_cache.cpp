@@ -0,0 +1,123 @@
+#include "servatrice_ban_cache.h"
+
+#include <QDateTime>
+
+ServerBanCache::ServerBanCache() : loaded(false)
+{
+}
+
+void ServerBanCache::insert(Index &target, const BanCacheEntry &entry)
+{
+    const Ban ban{entry.expiresAt, entry.visibleReason};
+
+    // names and client ids are compared case insensitively by the database collation
+    if (!entry.userName.isEmpty())
+        target.byName.insert(entry.userName.toCaseFolded(), ban);
+    if (!entry.clientId.isEmpty())
+        target.byClientId.insert(entry.clientId.toCaseFolded(), ban);
+
+    if (entry.address.isEmpty())
+        return;
+    if (entry.address.contains('/')) {
+        const QPair<QHostAddress, int> subnet = QHostAddress::parseSubnet(entry.address);
+        if (!subnet.first.isNull())
+            target.bySubnet.insert(entry.address, qMakePair(subnet, ban));
+    } else {
+        target.byAddress.insert(entry.address, ban);
+    }
+}
+
+bool ServerBanCache::isActive(const Ban &ban, qint64 now, QString &banReason, int &banSecondsRemaining)
+{
+    const bool permanentBan = ban.expiresAt == 0;
+    if (!permanentBan && ban.expiresAt <= now)
+        return false;
+
+    banReason = ban.visibleReason;
+    banSecondsRemaining = permanentBan ? 0 : static_cast<int>((ban.expiresAt - now + 999) / 1000);
+    return true;
+}
+
+bool ServerBanCache::isLoaded() const
+{
+    QReadLocker locker(&lock);
+    return loaded;
+}
+
+int ServerBanCache::size() const
+{
+    QReadLocker locker(&lock);
+    return index.byAddress.size() + index.byName.size() + index.byClientId.size() + index.bySubnet.size();
+}
+
+void ServerBanCache::replaceAll(const QList<BanCacheEntry> &entries)
+{
+    // build the new index without holding the lock, so logins are not stalled during a reload
+    Index newIndex;
+    for (const BanCacheEntry &entry : entries)
+        insert(newIndex, entry);
+
+    QWriteLocker locker(&lock);
+    index = std::move(newIndex);
+    loaded = true;
+}
+
+void ServerBanCache::addBans(const QList<BanCacheEntry> &entries)
+{
+    QWriteLocker locker(&lock);
+    for (const BanCacheEntry &entry : entries)
+        insert(index, entry);
+}
+
+void ServerBanCache::addBan(const BanCacheEntry &entry)
+{
+    QWriteLocker locker(&lock);
+    insert(index, entry);
+}
+
+bool ServerBanCache::isAddressBanned(const QString &ipAddress, QString &banReason, int &banSecondsRemaining) const
+{
+    if (ipAddress.isEmpty())
+        return false;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QReadLocker locker(&lock);
+
+    auto it = index.byAddress.constFind(ipAddress);
+    if (it != index.byAddress.constEnd() && isActive(it.value(), now, banReason, banSecondsRemaining))
+        return true;
+
+    if (index.bySubnet.isEmpty())
+        return false;
+
+    const QHostAddress address(ipAddress);
+    for (const auto &subnetBan : index.bySubnet) {
+        if (address.isInSubnet(subnetBan.first) && isActive(subnetBan.second, now, banReason, banSecondsRemaining))
+            return true;
+    }
+    return false;
+}
+
+bool ServerBanCache::isNameBanned(const QString &userName, QString &banReason, int &banSecondsRemaining) const
+{
+    if (userName.isEmpty())
+        return false;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QReadLocker locker(&lock);
+
+    auto it = index.byName.constFind(userName.toCaseFolded());
+    return it != index.byName.constEnd() && isActive(it.value(), now, banReason, banSecondsRemaining);
+}
+
+bool ServerBanCache::isClientIdBanned(const QString &clientId, QString &banReason, int &banSecondsRemaining) const
+{
+    if (clientId.isEmpty())
+        return false;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QReadLocker locker(&lock);
+
+    auto it = index.byClientId.constFind(clientId.toCaseFolded());
+    return it != index.byClientId.constEnd() && isActive(it.value(), now, banReason, banSecondsRemaining);
+}
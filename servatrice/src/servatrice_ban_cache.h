@@ -0,0 +1,76 @@
+#ifndef SERVATRICE_BAN_CACHE_H
+#define SERVATRICE_BAN_CACHE_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QMetaType>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+
+/**
+ * A single row of the bans table, as far as login checks are concerned.
+ * expiresAt is in msecs since epoch; 0 means the ban is permanent.
+ */
+struct BanCacheEntry
+{
+    QString userName;
+    QString address;
+    QString clientId;
+    qint64 expiresAt;
+    QString visibleReason;
+};
+Q_DECLARE_METATYPE(BanCacheEntry)
+
+/**
+ * In-memory index of the bans table used by the login path, so that ban checks do not need to query the database.
+ *
+ * Like the sql queries it replaces, only the most recent ban for each name, address and client id is considered.
+ * Addresses may be given in CIDR notation (eg. "10.0.0.0/8") to ban a whole subnet.
+ * All methods are thread safe.
+ */
+class ServerBanCache
+{
+public:
+    struct Ban
+    {
+        qint64 expiresAt;
+        QString visibleReason;
+    };
+
+private:
+    struct Index
+    {
+        QHash<QString, Ban> byAddress;
+        QHash<QString, Ban> byName;
+        QHash<QString, Ban> byClientId;
+        QHash<QString, QPair<QPair<QHostAddress, int>, Ban>> bySubnet;
+    };
+
+    mutable QReadWriteLock lock;
+    Index index;
+    bool loaded;
+
+    static void insert(Index &target, const BanCacheEntry &entry);
+    static bool isActive(const Ban &ban, qint64 now, QString &banReason, int &banSecondsRemaining);
+
+public:
+    ServerBanCache();
+
+    /** True once the cache has been filled from the database at least once. */
+    bool isLoaded() const;
+    int size() const;
+
+    /** Drops the whole index and replaces it with the given bans, eg. after a full reload from the database. */
+    void replaceAll(const QList<BanCacheEntry> &entries);
+    /** Adds bans newer than every ban already in the cache. */
+    void addBans(const QList<BanCacheEntry> &entries);
+    void addBan(const BanCacheEntry &entry);
+
+    bool isAddressBanned(const QString &ipAddress, QString &banReason, int &banSecondsRemaining) const;
+    bool isNameBanned(const QString &userName, QString &banReason, int &banSecondsRemaining) const;
+    bool isClientIdBanned(const QString &clientId, QString &banReason, int &banSecondsRemaining) const;
+};
+
+#endif
@@ -3,9 +3,12 @@
 #include "servatrice_database_interface.h"
 
 #include <QThread>
+#include <QTimer>
+#include <QVector>
 
 Servatrice_ConnectionPool::Servatrice_ConnectionPool(Servatrice_DatabaseInterface *_databaseInterface)
-    : databaseInterface(_databaseInterface), threaded(false), clientCount(0)
+    : databaseInterface(_databaseInterface), threaded(false), clientCount(0), queuedMessages(0), commandCount(0),
+      commandsPerSecond(0), eventLoopLag(0), loadSampleTimer(nullptr), lastCommandCount(0)
 {
 }
 
@@ -14,3 +17,52 @@ Servatrice_ConnectionPool::~Servatrice_ConnectionPool()
     delete databaseInterface;
     thread()->quit();
 }
+
+void Servatrice_ConnectionPool::startLoadMonitor()
+{
+    // the timer has to be created in the pool thread so that its timeouts measure this thread's event loop
+    loadSampleTimer = new QTimer(this);
+    loadSampleTimer->setTimerType(Qt::PreciseTimer);
+    connect(loadSampleTimer, SIGNAL(timeout()), this, SLOT(sampleLoad()));
+    loadSampleClock.start();
+    loadSampleTimer->start(loadSampleInterval);
+}
+
+void Servatrice_ConnectionPool::sampleLoad()
+{
+    const qint64 elapsed = loadSampleClock.restart();
+    if (elapsed <= 0)
+        return;
+
+    // a busy event loop fires the timer late, the delay is how long events wait before this thread gets to them
+    const int lag = static_cast<int>(qMax<qint64>(0, elapsed - loadSampleInterval));
+    const int previousLag = eventLoopLag.load(std::memory_order_relaxed);
+    eventLoopLag.store((previousLag * 3 + lag) / 4, std::memory_order_relaxed);
+
+    const quint64 commands = commandCount.load(std::memory_order_relaxed);
+    const int rate = static_cast<int>((commands - lastCommandCount) * 1000 / static_cast<quint64>(elapsed));
+    lastCommandCount = commands;
+    const int previousRate = commandsPerSecond.load(std::memory_order_relaxed);
+    commandsPerSecond.store((previousRate + rate) / 2, std::memory_order_relaxed);
+}
+
+ServatricePoolLoad Servatrice_ConnectionPool::getLoad() const
+{
+    ServatricePoolLoad load;
+    load.clients = clientCount.load(std::memory_order_relaxed);
+    load.commandsPerSecond = commandsPerSecond.load(std::memory_order_relaxed);
+    load.queuedMessages = qMax(0, queuedMessages.load(std::memory_order_relaxed));
+    load.eventLoopLagMsecs = eventLoopLag.load(std::memory_order_relaxed);
+    return load;
+}
+
+Servatrice_ConnectionPool *Servatrice_ConnectionPool::findLeastLoaded(const QList<Servatrice_ConnectionPool *> &pools)
+{
+    QVector<ServatricePoolLoad> loads;
+    loads.reserve(pools.size());
+    for (Servatrice_ConnectionPool *pool : pools)
+        loads.append(pool->getLoad());
+
+    const int poolIndex = findLeastLoadedPool(loads);
+    return poolIndex == -1 ? nullptr : pools[poolIndex];
+}
@@ -1,20 +1,33 @@
 #ifndef SERVATRICE_CONNECTION_POOL_H
 #define SERVATRICE_CONNECTION_POOL_H
 
-#include <QMutex>
-#include <QMutexLocker>
+#include "servatrice_pool_load.h"
+
+#include <QElapsedTimer>
+#include <QList>
 #include <QObject>
+#include <atomic>
 
 class Servatrice_DatabaseInterface;
+class QTimer;
 
 class Servatrice_ConnectionPool : public QObject
 {
     Q_OBJECT
 private:
+    static const int loadSampleInterval = 500; // msecs
+
     Servatrice_DatabaseInterface *databaseInterface;
     bool threaded;
-    mutable QMutex clientCountMutex;
-    int clientCount;
+    std::atomic<int> clientCount;
+    std::atomic<int> queuedMessages;
+    std::atomic<quint64> commandCount;
+    std::atomic<int> commandsPerSecond;
+    std::atomic<int> eventLoopLag;
+
+    QTimer *loadSampleTimer;
+    QElapsedTimer loadSampleClock;
+    quint64 lastCommandCount;
 
 public:
     explicit Servatrice_ConnectionPool(Servatrice_DatabaseInterface *_databaseInterface);
@@ -27,20 +40,35 @@ public:
 
     int getClientCount() const
     {
-        QMutexLocker locker(&clientCountMutex);
-        return clientCount;
+        return clientCount.load(std::memory_order_relaxed);
     }
     void addClient()
     {
-        QMutexLocker locker(&clientCountMutex);
-        ++clientCount;
+        clientCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // called by the socket interfaces of this pool, from the pool thread
+    void commandReceived()
+    {
+        commandCount.fetch_add(1, std::memory_order_relaxed);
     }
+    void messagesQueued(int count)
+    {
+        queuedMessages.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    ServatricePoolLoad getLoad() const;
+    static Servatrice_ConnectionPool *findLeastLoaded(const QList<Servatrice_ConnectionPool *> &pools);
+
 public slots:
     void removeClient()
     {
-        QMutexLocker locker(&clientCountMutex);
-        --clientCount;
+        clientCount.fetch_sub(1, std::memory_order_relaxed);
     }
+    void startLoadMonitor();
+
+private slots:
+    void sampleLoad();
 };
 
 #endif
@@ -4,15 +4,237 @@
 #include "passwordhasher.h"
 #include "pb/game_replay.pb.h"
 #include "servatrice.h"
+#include "servatrice_ban_cache.h"
 #include "serversocketinterface.h"
 #include "settingscache.h"
 
 #include <QChar>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QSqlError>
 #include <QSqlQuery>
 
+namespace
+{
+struct DatabaseStatementText
+{
+    DatabaseStatement id;
+    const char *name;
+    const char *text;
+};
+
+constexpr DatabaseStatementText databaseStatementTexts[] = {
+    {SelectSchemaVersion, "SelectSchemaVersion", "select version from {prefix}_schema_version limit 1"},
+    {InsertUser, "InsertUser",
+     "insert into {prefix}_users (name, realname, password_sha512, email, country, registrationDate, active, token, "
+     "admin, avatar_bmp, clientid, privlevel, privlevelStartDate, privlevelEndDate) values (:userName, :realName, "
+     ":password_sha512, :email, :country, UTC_TIMESTAMP(), :active, :token, 0, '', '', 'NONE', UTC_TIMESTAMP(), "
+     "UTC_TIMESTAMP())"},
+    {SelectInactiveUser, "SelectInactiveUser",
+     "select name from {prefix}_users where active=0 and name=:username and token=:token"},
+    {UpdateUserActivate, "UpdateUserActivate", "update {prefix}_users set active=1 where name = :userName"},
+    {SelectUserPassword, "SelectUserPassword", "select password_sha512, active from {prefix}_users where name = :name"},
+    {SelectClientIdBan, "SelectClientIdBan",
+     "select timestampdiff(second, now(), date_add(b.time_from, interval b.minutes minute)), b.minutes <=> 0, "
+     "b.visible_reason from {prefix}_bans b where b.time_from = (select max(c.time_from) from {prefix}_bans c where "
+     "c.clientid = :id) and b.clientid = :id2"},
+    {SelectNameBan, "SelectNameBan",
+     "select timestampdiff(second, now(), date_add(b.time_from, interval b.minutes minute)), b.minutes <=> 0, "
+     "b.visible_reason from {prefix}_bans b where b.time_from = (select max(c.time_from) from {prefix}_bans c where "
+     "c.user_name = :name2) and b.user_name = :name1"},
+    {SelectAddressBan, "SelectAddressBan",
+     "select timestampdiff(second, now(), date_add(b.time_from, interval b.minutes minute)), b.minutes <=> 0, "
+     "b.visible_reason from {prefix}_bans b where b.time_from = (select max(c.time_from) from {prefix}_bans c where "
+     "c.ip_address = :address) and b.ip_address = :address2"},
+    {SelectBansSince, "SelectBansSince",
+     "select user_name, ip_address, clientid, timestampdiff(second, now(), date_add(time_from, interval minutes "
+     "minute)), minutes <=> 0, visible_reason, time_from from {prefix}_bans where time_from >= :since order by "
+     "time_from asc"},
+    {SelectAllBans, "SelectAllBans",
+     "select user_name, ip_address, clientid, timestampdiff(second, now(), date_add(time_from, interval minutes "
+     "minute)), minutes <=> 0, visible_reason, time_from from {prefix}_bans order by time_from asc"},
+    {SelectActiveUserExists, "SelectActiveUserExists",
+     "select 1 from {prefix}_users where name = :name and active = 1"},
+    {SelectUserExists, "SelectUserExists", "select 1 from {prefix}_users where name = :name"},
+    {SelectUserSalt, "SelectUserSalt",
+     "SELECT SUBSTRING(password_sha512, 1, 16) FROM {prefix}_users WHERE name = :name"},
+    {SelectActiveUserId, "SelectActiveUserId", "select id from {prefix}_users where name = :name and active = 1"},
+    {SelectBuddyListEntry, "SelectBuddyListEntry",
+     "select 1 from {prefix}_buddylist where id_user1 = :id_user1 and id_user2 = :id_user2"},
+    {SelectIgnoreListEntry, "SelectIgnoreListEntry",
+     "select 1 from {prefix}_ignorelist where id_user1 = :id_user1 and id_user2 = :id_user2"},
+    {SelectUserData, "SelectUserData",
+     "select id, name, admin, country, privlevel, realname, avatar_bmp, registrationDate, email, clientid from "
+     "{prefix}_users where name = :name and active = 1"},
+    {UpdateSessionsClear, "UpdateSessionsClear",
+     "update {prefix}_sessions set end_time=now() where end_time is null and id_server = :id_server"},
+    {LockSessionTables, "LockSessionTables", "lock tables {prefix}_sessions write, {prefix}_users read"},
+    {UnlockTables, "UnlockTables", "unlock tables"},
+    {SelectUserSession, "SelectUserSession",
+     "select 1 from {prefix}_sessions where user_name = :user_name and id_server = :id_server and end_time is null"},
+    {InsertSession, "InsertSession",
+     "insert into {prefix}_sessions (user_name, id_server, ip_address, start_time, clientid, connection_type) "
+     "values(:user_name, :id_server, :ip_address, NOW(), :client_id, :connection_type)"},
+    {LockSessionsTable, "LockSessionsTable", "lock tables {prefix}_sessions write"},
+    {UpdateSessionEnd, "UpdateSessionEnd", "update {prefix}_sessions set end_time=NOW() where id = :id_session"},
+    {SelectBuddyList, "SelectBuddyList",
+     "select a.id, a.name, a.admin, a.country, a.privlevel from {prefix}_users a left join {prefix}_buddylist b on "
+     "a.id = b.id_user2 left join {prefix}_users c on b.id_user1 = c.id where c.name = :name"},
+    {SelectIgnoreList, "SelectIgnoreList",
+     "select a.id, a.name, a.admin, a.country, a.privlevel from {prefix}_users a left join {prefix}_ignorelist b on "
+     "a.id = b.id_user2 left join {prefix}_users c on b.id_user1 = c.id where c.name = :name"},
+    {InsertGame, "InsertGame", "insert into {prefix}_games (time_started) values (now())"},
+    {InsertReplay, "InsertReplay", "insert into {prefix}_replays (id_game) values (NULL)"},
+    {UpdateGameInformation, "UpdateGameInformation",
+     "update {prefix}_games set room_name=:room_name, descr=:descr, creator_name=:creator_name, password=:password, "
+     "game_types=:game_types, player_count=:player_count, time_finished=now() where id=:id_game"},
+    {InsertGamePlayers, "InsertGamePlayers",
+     "insert into {prefix}_games_players (id_game, player_name) values (:id_game, :player_name)"},
+    {UpdateReplays, "UpdateReplays",
+     "update {prefix}_replays set id_game=:id_game, duration=:duration, replay=:replay where id=:id_replay"},
+    {InsertReplayAccess, "InsertReplayAccess",
+     "insert into {prefix}_replays_access (id_game, id_player, replay_name) values (:id_game, :id_player, "
+     ":replay_name)"},
+    {SelectDeckContent, "SelectDeckContent",
+     "select content from {prefix}_decklist_files where id = :id and id_user = :id_user"},
+    {InsertLogMessage, "InsertLogMessage",
+     "insert into {prefix}_log (log_time, sender_id, sender_name, sender_ip, log_message, target_type, target_id, "
+     "target_name) values (now(), :sender_id, :sender_name, :sender_ip, :log_message, :target_type, :target_id, "
+     ":target_name)"},
+    {UpdateUserPassword, "UpdateUserPassword",
+     "update {prefix}_users set password_sha512=:password, passwordLastChangedDate = NOW() where name = :name"},
+    {SelectUserPasswordHash, "SelectUserPasswordHash", "select password_sha512 from {prefix}_users where name = :name"},
+    {SelectActiveUserCount, "SelectActiveUserCount",
+     "select count(*) from {prefix}_sessions where id_server = :serverid AND end_time is NULL"},
+    {SelectActiveUserCountByType, "SelectActiveUserCountByType",
+     "select count(*) from {prefix}_sessions where id_server = :serverid AND end_time is NULL AND connection_type = "
+     ":connection_type"},
+    {UpdateUserClientId, "UpdateUserClientId", "update {prefix}_users set clientid = :clientid where name = :username"},
+    {SelectUserId, "SelectUserId", "select id from {prefix}_users where name = :user_name"},
+    {SelectUserAnalyticsCount, "SelectUserAnalyticsCount",
+     "select count(id) from {prefix}_user_analytics where id = :user_id"},
+    {InsertUserAnalytics, "InsertUserAnalytics",
+     "insert into {prefix}_user_analytics (id,client_ver,last_login) values (:user_id,:client_ver,NOW())"},
+    {UpdateUserAnalytics, "UpdateUserAnalytics",
+     "update {prefix}_user_analytics set last_login = NOW(), client_ver = :client_ver where id = :user_id"},
+    {SelectBanHistory, "SelectBanHistory",
+     "SELECT A.id_admin, A.time_from, A.minutes, A.reason, A.visible_reason, B.name AS name_admin FROM {prefix}_bans "
+     "A LEFT JOIN {prefix}_users B ON A.id_admin=B.id WHERE A.user_name = :user_name"},
+    {InsertWarning, "InsertWarning",
+     "insert into {prefix}_warnings (user_id,user_name,mod_name,reason,time_of,clientid) values "
+     "(:user_id,:user_name,:mod_name,:warn_reason,NOW(),:client_id)"},
+    {SelectWarnHistory, "SelectWarnHistory",
+     "SELECT user_name, mod_name, reason, time_of FROM {prefix}_warnings WHERE user_id = :user_id"},
+    {SelectEmailAccountCount, "SelectEmailAccountCount",
+     "SELECT count(email) FROM {prefix}_users WHERE email = :user_email"},
+    {InsertForgotPassword, "InsertForgotPassword",
+     "insert into {prefix}_forgot_password (name,requestDate) values (:username,NOW())"},
+    {DeleteForgotPassword, "DeleteForgotPassword", "delete from {prefix}_forgot_password where name = :username"},
+    {SelectForgotPasswordCount, "SelectForgotPasswordCount",
+     "select count(name) from {prefix}_forgot_password where name = :user_name AND requestDate > (now() - interval "
+     ":minutes minute)"},
+    {UpdateUserToken, "UpdateUserToken", "update {prefix}_users set token = :token where name = :user_name"},
+    {InsertAuditRecord, "InsertAuditRecord",
+     "insert into {prefix}_audit (id_server,name,ip_address,clientid,incidentDate,action,results,details) values "
+     "(:idserver,:username,:ipaddress,:clientid,NOW(),:action,:results,:details)"},
+    {SelectRooms, "SelectRooms",
+     "select id, name, descr, permissionlevel, privlevel, auto_join, join_message, chat_history_size from "
+     "{prefix}_rooms where id_server = :id_server order by id asc"},
+    {SelectRoomGameTypes, "SelectRoomGameTypes",
+     "select name from {prefix}_rooms_gametypes where id_room = :id_room AND id_server = :id_server"},
+    {SelectServers, "SelectServers",
+     "select id, ssl_cert, hostname, address, game_port, control_port from {prefix}_servers order by id asc"},
+    {SelectServerMessage, "SelectServerMessage",
+     "select message from {prefix}_servermessages where id_server = :id_server order by timest desc limit 1"},
+    {InsertUptime, "InsertUptime",
+     "insert into {prefix}_uptime (id_server, timest, uptime, users_count, mods_count, mods_list, games_count, "
+     "tx_bytes, rx_bytes) values(:id, NOW(), :uptime, :users_count, :mods_count, :mods_list, :games_count, :tx, :rx)"},
+    {SelectActivationEmails, "SelectActivationEmails",
+     "select a.name, b.email, b.token from {prefix}_activation_emails a left join {prefix}_users b on a.name = "
+     "b.name"},
+    {DeleteActivationEmail, "DeleteActivationEmail", "delete from {prefix}_activation_emails where name = :name"},
+    {SelectForgotPasswordEmails, "SelectForgotPasswordEmails",
+     "select a.name, b.email, b.token from {prefix}_forgot_password a left join {prefix}_users b on a.name = b.name "
+     "where a.emailed = 0"},
+    {UpdateForgotPasswordEmailed, "UpdateForgotPasswordEmailed",
+     "update {prefix}_forgot_password set emailed = 1 where name = :name"},
+    {InsertBuddyListEntry, "InsertBuddyListEntry",
+     "insert into {prefix}_buddylist (id_user1, id_user2) values(:id1, :id2)"},
+    {InsertIgnoreListEntry, "InsertIgnoreListEntry",
+     "insert into {prefix}_ignorelist (id_user1, id_user2) values(:id1, :id2)"},
+    {DeleteBuddyListEntry, "DeleteBuddyListEntry",
+     "delete from {prefix}_buddylist where id_user1 = :id1 and id_user2 = :id2"},
+    {DeleteIgnoreListEntry, "DeleteIgnoreListEntry",
+     "delete from {prefix}_ignorelist where id_user1 = :id1 and id_user2 = :id2"},
+    {SelectDeckFolderId, "SelectDeckFolderId",
+     "select id from {prefix}_decklist_folders where id_parent = :id_parent and name = :name and id_user = :id_user"},
+    {SelectDeckFolders, "SelectDeckFolders",
+     "select id, name from {prefix}_decklist_folders where id_parent = :id_parent and id_user = :id_user"},
+    {SelectDeckFiles, "SelectDeckFiles",
+     "select id, name, upload_time from {prefix}_decklist_files where id_folder = :id_folder and id_user = :id_user"},
+    {InsertDeckFolder, "InsertDeckFolder",
+     "insert into {prefix}_decklist_folders (id_parent, id_user, name) values(:id_parent, :id_user, :name)"},
+    {SelectDeckSubfolders, "SelectDeckSubfolders",
+     "select id from {prefix}_decklist_folders where id_parent = :id_parent"},
+    {DeleteDeckFolderFiles, "DeleteDeckFolderFiles",
+     "delete from {prefix}_decklist_files where id_folder = :id_folder"},
+    {DeleteDeckFolder, "DeleteDeckFolder", "delete from {prefix}_decklist_folders where id = :id"},
+    {SelectDeckFileId, "SelectDeckFileId",
+     "select id from {prefix}_decklist_files where id = :id and id_user = :id_user"},
+    {DeleteDeckFile, "DeleteDeckFile", "delete from {prefix}_decklist_files where id = :id"},
+    {InsertDeckFile, "InsertDeckFile",
+     "insert into {prefix}_decklist_files (id_folder, id_user, name, upload_time, content) values(:id_folder, "
+     ":id_user, :name, NOW(), :content)"},
+    {UpdateDeckFile, "UpdateDeckFile",
+     "update {prefix}_decklist_files set name=:name, upload_time=NOW(), content=:content where id = :id_deck and "
+     "id_user = :id_user"},
+    {SelectReplayMatches, "SelectReplayMatches",
+     "select a.id_game, a.replay_name, b.room_name, b.time_started, b.time_finished, b.descr, a.do_not_hide from "
+     "{prefix}_replays_access a left join {prefix}_games b on b.id = a.id_game where a.id_player = :id_player and "
+     "(a.do_not_hide = 1 or date_add(b.time_started, interval 7 day) > now())"},
+    {SelectGamePlayers, "SelectGamePlayers", "select player_name from {prefix}_games_players where id_game = :id_game"},
+    {SelectGameReplays, "SelectGameReplays", "select id, duration from {prefix}_replays where id_game = :id_game"},
+    {SelectReplayAccess, "SelectReplayAccess",
+     "select 1 from {prefix}_replays_access a left join {prefix}_replays b on a.id_game = b.id_game where b.id = "
+     ":id_replay and a.id_player = :id_player"},
+    {SelectReplay, "SelectReplay", "select replay from {prefix}_replays where id = :id_replay"},
+    {UpdateReplayAccessHidden, "UpdateReplayAccessHidden",
+     "update {prefix}_replays_access set do_not_hide=:do_not_hide where id_player = :id_player and id_game = "
+     ":id_game"},
+    {DeleteReplayAccess, "DeleteReplayAccess",
+     "delete from {prefix}_replays_access where id_player = :id_player and id_game = :id_game"},
+    {InsertBan, "InsertBan",
+     "insert into {prefix}_bans (user_name, ip_address, id_admin, time_from, minutes, reason, visible_reason, "
+     "clientid) values(:user_name, :ip_address, :id_admin, NOW(), :minutes, :reason, :visible_reason, :client_id)"},
+    {SelectUserNamesByClientId, "SelectUserNamesByClientId",
+     "select name from {prefix}_users where clientid = :client_id"},
+    {InsertActivationEmail, "InsertActivationEmail", "insert into {prefix}_activation_emails (name) values(:name)"},
+    {UpdateUserAvatar, "UpdateUserAvatar", "update {prefix}_users set avatar_bmp=:image where id=:id"},
+    {UpdateUserAdminFlagAdd, "UpdateUserAdminFlagAdd",
+     "update {prefix}_users set admin = (admin | :adminlevel) where name = :username"},
+    {UpdateUserAdminFlagRemove, "UpdateUserAdminFlagRemove",
+     "update {prefix}_users set admin = (admin & ~ :adminlevel) where name = :username"},
+};
+
+constexpr bool databaseStatementTextsAreOrdered()
+{
+    for (int i = 0; i < DatabaseStatementCount; ++i)
+        if (databaseStatementTexts[i].id != i)
+            return false;
+    return true;
+}
+
+static_assert(sizeof(databaseStatementTexts) / sizeof(databaseStatementTexts[0]) == DatabaseStatementCount,
+              "every DatabaseStatement needs a text");
+static_assert(databaseStatementTextsAreOrdered(), "databaseStatementTexts must follow the DatabaseStatement order");
+} // namespace
+
+const char *getDatabaseStatementName(DatabaseStatement statement)
+{
+    return databaseStatementTexts[statement].name;
+}
+
 Servatrice_DatabaseInterface::Servatrice_DatabaseInterface(int _instanceId, Servatrice *_server)
     : instanceId(_instanceId), sqlDatabase(QSqlDatabase()), server(_server)
 {
@@ -20,9 +242,7 @@ Servatrice_DatabaseInterface::Servatrice_DatabaseInterface(int _instanceId, Serv
 
 Servatrice_DatabaseInterface::~Servatrice_DatabaseInterface()
 {
-    // reset all prepared statements
-    qDeleteAll(preparedStatements);
-    preparedStatements.clear();
+    clearPreparedStatements();
 
     sqlDatabase.close();
 }
@@ -50,19 +270,39 @@ bool Servatrice_DatabaseInterface::initDatabase(const QString &type,
     return openDatabase();
 }
 
+int Servatrice_DatabaseInterface::getStatementId(const QSqlQuery *query) const
+{
+    return statementIds.value(query, DatabaseStatementCount);
+}
+
+QString Servatrice_DatabaseInterface::getPoolString() const
+{
+    switch (instanceId) {
+        case MainDatabaseInstance:
+            return QString("main");
+        case MaintenanceDatabaseInstance:
+            return QString("maintenance");
+        default:
+            return QString("pool %1").arg(instanceId);
+    }
+}
+
 bool Servatrice_DatabaseInterface::openDatabase()
 {
+    // prepared statements belong to the previous connection
+    clearPreparedStatements();
+
     if (sqlDatabase.isOpen())
         sqlDatabase.close();
 
-    const QString poolStr = instanceId == -1 ? QString("main") : QString("pool %1").arg(instanceId);
+    const QString poolStr = getPoolString();
     qDebug().noquote() << QString("[%1] Opening database...").arg(poolStr);
     if (!sqlDatabase.open()) {
         qCritical() << QString("[%1] Error opening database: %2").arg(poolStr).arg(sqlDatabase.lastError().text());
         return false;
     }
 
-    QSqlQuery *versionQuery = prepareQuery("select version from {prefix}_schema_version limit 1");
+    QSqlQuery *versionQuery = prepareQuery(SelectSchemaVersion);
     if (!execSqlQuery(versionQuery)) {
         qCritical() << QString("[%1] Error opening database: unable to load database schema version (hint: ensure the "
                                "cockatrice_schema_version exists)")
@@ -95,10 +335,44 @@ bool Servatrice_DatabaseInterface::openDatabase()
         return false;
     }
 
-    // reset all prepared statements
+    prepareStatements(poolStr);
+    return true;
+}
+
+void Servatrice_DatabaseInterface::clearPreparedStatements()
+{
+    for (QSqlQuery *&query : statements) {
+        delete query;
+        query = nullptr;
+    }
+    statementIds.clear();
     qDeleteAll(preparedStatements);
     preparedStatements.clear();
-    return true;
+}
+
+void Servatrice_DatabaseInterface::prepareStatements(const QString &poolStr)
+{
+    int failed = 0;
+    for (int i = 0; i < DatabaseStatementCount; ++i) {
+        if (statements[i])
+            continue;
+
+        createStatement(i);
+        if (statements[i]->lastError().isValid()) {
+            qCritical() << QString("[%1] Error preparing statement #%2 (%3): %4")
+                               .arg(poolStr)
+                               .arg(i)
+                               .arg(statements[i]->lastQuery())
+                               .arg(statements[i]->lastError().text());
+            ++failed;
+        }
+    }
+
+    if (failed)
+        qCritical() << QString("[%1] %2 of %3 statements failed to prepare")
+                           .arg(poolStr)
+                           .arg(failed)
+                           .arg(DatabaseStatementCount);
 }
 
 bool Servatrice_DatabaseInterface::checkSql()
@@ -111,26 +385,51 @@ bool Servatrice_DatabaseInterface::checkSql()
     return true;
 }
 
-QSqlQuery *Servatrice_DatabaseInterface::prepareQuery(const QString &queryText)
+QSqlQuery *Servatrice_DatabaseInterface::createQuery(const QString &queryText)
 {
-    if (preparedStatements.contains(queryText)) {
-        return preparedStatements.value(queryText);
-    }
-
     QString prefixedQueryText = queryText;
     prefixedQueryText.replace("{prefix}", server->getDbPrefix());
     auto *query = new QSqlQuery(sqlDatabase);
     query->prepare(prefixedQueryText);
+    return query;
+}
+
+QSqlQuery *Servatrice_DatabaseInterface::createStatement(int statement)
+{
+    statements[statement] = createQuery(databaseStatementTexts[statement].text);
+    statementIds.insert(statements[statement], statement);
+    return statements[statement];
+}
+
+QSqlQuery *Servatrice_DatabaseInterface::prepareQuery(DatabaseStatement statement)
+{
+    // statements are prepared in openDatabase(), this only happens if the database was never opened
+    if (!statements[statement])
+        createStatement(statement);
+
+    return statements[statement];
+}
+
+QSqlQuery *Servatrice_DatabaseInterface::prepareQuery(const QString &queryText)
+{
+    if (preparedStatements.contains(queryText)) {
+        return preparedStatements.value(queryText);
+    }
 
+    QSqlQuery *query = createQuery(queryText);
     preparedStatements.insert(queryText, query);
     return query;
 }
 
 bool Servatrice_DatabaseInterface::execSqlQuery(QSqlQuery *query)
 {
-    if (query->exec())
+    QElapsedTimer queryTimer;
+    queryTimer.start();
+    const bool success = query->exec();
+    server->getServatriceMetrics()->queryExecuted(getStatementId(query), queryTimer.nsecsElapsed());
+    if (success)
         return true;
-    const QString poolStr = instanceId == -1 ? QString("main") : QString("pool %1").arg(instanceId);
+    const QString poolStr = getPoolString();
     qCritical() << QString("[%1] Error executing query: %2").arg(poolStr).arg(query->lastError().text());
     return false;
 }
@@ -215,13 +514,7 @@ bool Servatrice_DatabaseInterface::registerUser(const QString &userName,
     }
     QString token = active ? QString() : PasswordHasher::generateActivationToken();
 
-    QSqlQuery *query =
-        prepareQuery("insert into {prefix}_users "
-                     "(name, realname, password_sha512, email, country, registrationDate, active, token, "
-                     "admin, avatar_bmp, clientid, privlevel, privlevelStartDate, privlevelEndDate) "
-                     "values "
-                     "(:userName, :realName, :password_sha512, :email, :country, UTC_TIMESTAMP(), :active, "
-                     ":token, 0, '', '', 'NONE', UTC_TIMESTAMP(), UTC_TIMESTAMP())");
+    QSqlQuery *query = prepareQuery(InsertUser);
     query->bindValue(":userName", userName);
     query->bindValue(":realName", realName);
     query->bindValue(":password_sha512", passwordSha512);
@@ -243,8 +536,7 @@ bool Servatrice_DatabaseInterface::activateUser(const QString &userName, const Q
     if (!checkSql())
         return false;
 
-    QSqlQuery *activateQuery =
-        prepareQuery("select name from {prefix}_users where active=0 and name=:username and token=:token");
+    QSqlQuery *activateQuery = prepareQuery(SelectInactiveUser);
 
     activateQuery->bindValue(":username", userName);
     activateQuery->bindValue(":token", token);
@@ -259,7 +551,7 @@ bool Servatrice_DatabaseInterface::activateUser(const QString &userName, const Q
         // redundant check
         if (name == userName) {
 
-            QSqlQuery *query = prepareQuery("update {prefix}_users set active=1 where name = :userName");
+            QSqlQuery *query = prepareQuery(UpdateUserActivate);
             query->bindValue(":userName", userName);
 
             if (!execSqlQuery(query)) {
@@ -301,8 +593,7 @@ AuthenticationResult Servatrice_DatabaseInterface::checkUserPassword(Server_Prot
             if (checkUserIsBanned(handler->getAddress(), user, clientId, reasonStr, banSecondsLeft))
                 return UserIsBanned;
 
-            QSqlQuery *passwordQuery =
-                prepareQuery("select password_sha512, active from {prefix}_users where name = :name");
+            QSqlQuery *passwordQuery = prepareQuery(SelectUserPassword);
             passwordQuery->bindValue(":name", user);
             if (!execSqlQuery(passwordQuery)) {
                 qDebug("Login denied: SQL error");
@@ -347,6 +638,23 @@ bool Servatrice_DatabaseInterface::checkUserIsBanned(const QString &ipAddress,
     if (server->getAuthenticationMethod() != Servatrice::AuthenticationSql)
         return false;
 
+    const ServerBanCache *banCache = server->getBanCache();
+    if (banCache->isLoaded()) {
+        if (banCache->isAddressBanned(ipAddress, banReason, banSecondsRemaining)) {
+            qDebug() << "User is banned by address" << ipAddress;
+            return true;
+        }
+        if (banCache->isNameBanned(userName, banReason, banSecondsRemaining)) {
+            qDebug() << "Username" << userName << "is banned by name";
+            return true;
+        }
+        if (banCache->isClientIdBanned(clientId, banReason, banSecondsRemaining)) {
+            qDebug() << "User is banned by client id" << clientId;
+            return true;
+        }
+        return false;
+    }
+
     if (!checkSql()) {
         qDebug("Failed to check if user is banned. Database invalid.");
         return false;
@@ -364,17 +672,7 @@ bool Servatrice_DatabaseInterface::checkUserIsIdBanned(const QString &clientId,
     if (clientId.isEmpty())
         return false;
 
-    QSqlQuery *idBanQuery =
-        prepareQuery("select"
-                     " timestampdiff(second, now(), date_add(b.time_from, interval b.minutes minute)),"
-                     " b.minutes <=> 0,"
-                     " b.visible_reason"
-                     " from {prefix}_bans b"
-                     " where"
-                     " b.time_from = (select max(c.time_from)"
-                     " from {prefix}_bans c"
-                     " where c.clientid = :id)"
-                     " and b.clientid = :id2");
+    QSqlQuery *idBanQuery = prepareQuery(SelectClientIdBan);
 
     idBanQuery->bindValue(":id", clientId);
     idBanQuery->bindValue(":id2", clientId);
@@ -400,10 +698,7 @@ bool Servatrice_DatabaseInterface::checkUserIsNameBanned(const QString &userName
                                                          QString &banReason,
                                                          int &banSecondsRemaining)
 {
-    QSqlQuery *nameBanQuery =
-        prepareQuery("select timestampdiff(second, now(), date_add(b.time_from, interval b.minutes minute)), b.minutes "
-                     "<=> 0, b.visible_reason from {prefix}_bans b where b.time_from = (select max(c.time_from) from "
-                     "{prefix}_bans c where c.user_name = :name2) and b.user_name = :name1");
+    QSqlQuery *nameBanQuery = prepareQuery(SelectNameBan);
     nameBanQuery->bindValue(":name1", userName);
     nameBanQuery->bindValue(":name2", userName);
     if (!execSqlQuery(nameBanQuery)) {
@@ -428,17 +723,7 @@ bool Servatrice_DatabaseInterface::checkUserIsIpBanned(const QString &ipAddress,
                                                        QString &banReason,
                                                        int &banSecondsRemaining)
 {
-    QSqlQuery *ipBanQuery =
-        prepareQuery("select"
-                     " timestampdiff(second, now(), date_add(b.time_from, interval b.minutes minute)),"
-                     " b.minutes <=> 0,"
-                     " b.visible_reason"
-                     " from {prefix}_bans b"
-                     " where"
-                     " b.time_from = (select max(c.time_from)"
-                     " from {prefix}_bans c"
-                     " where c.ip_address = :address)"
-                     " and b.ip_address = :address2");
+    QSqlQuery *ipBanQuery = prepareQuery(SelectAddressBan);
 
     ipBanQuery->bindValue(":address", ipAddress);
     ipBanQuery->bindValue(":address2", ipAddress);
@@ -460,12 +745,44 @@ bool Servatrice_DatabaseInterface::checkUserIsIpBanned(const QString &ipAddress,
     return false;
 }
 
+bool Servatrice_DatabaseInterface::loadBans(QList<BanCacheEntry> &entries,
+                                            QDateTime &lastBanTime,
+                                            const QDateTime &since)
+{
+    if (!checkSql())
+        return false;
+
+    QSqlQuery *query;
+    if (since.isValid()) {
+        query = prepareQuery(SelectBansSince);
+        query->bindValue(":since", since);
+    } else {
+        query = prepareQuery(SelectAllBans);
+    }
+
+    if (!execSqlQuery(query)) {
+        qDebug() << "Ban cache load failed: SQL error." << query->lastError();
+        return false;
+    }
+
+    // remaining time is computed by the database to stay consistent with its clock
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (query->next()) {
+        const bool permanentBan = query->value(4).toInt();
+        const qint64 secondsLeft = query->value(3).toLongLong();
+        entries.append({query->value(0).toString(), query->value(1).toString(), query->value(2).toString(),
+                        permanentBan ? 0 : now + secondsLeft * 1000, query->value(5).toString()});
+        lastBanTime = query->value(6).toDateTime();
+    }
+    return true;
+}
+
 bool Servatrice_DatabaseInterface::activeUserExists(const QString &user)
 {
     if (server->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
         checkSql();
 
-        QSqlQuery *query = prepareQuery("select 1 from {prefix}_users where name = :name and active = 1");
+        QSqlQuery *query = prepareQuery(SelectActiveUserExists);
         query->bindValue(":name", user);
         if (!execSqlQuery(query))
             return false;
@@ -479,7 +796,7 @@ bool Servatrice_DatabaseInterface::userExists(const QString &user)
     if (server->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
         checkSql();
 
-        QSqlQuery *query = prepareQuery("select 1 from {prefix}_users where name = :name");
+        QSqlQuery *query = prepareQuery(SelectUserExists);
         query->bindValue(":name", user);
         if (!execSqlQuery(query))
             return false;
@@ -493,8 +810,7 @@ QString Servatrice_DatabaseInterface::getUserSalt(const QString &user)
     if (server->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
         checkSql();
 
-        QSqlQuery *query =
-            prepareQuery("SELECT SUBSTRING(password_sha512, 1, 16) FROM {prefix}_users WHERE name = :name");
+        QSqlQuery *query = prepareQuery(SelectUserSalt);
 
         query->bindValue(":name", user);
         if (!execSqlQuery(query)) {
@@ -513,7 +829,7 @@ QString Servatrice_DatabaseInterface::getUserSalt(const QString &user)
 int Servatrice_DatabaseInterface::getUserIdInDB(const QString &name)
 {
     if (server->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
-        QSqlQuery *query = prepareQuery("select id from {prefix}_users where name = :name and active = 1");
+        QSqlQuery *query = prepareQuery(SelectActiveUserId);
         query->bindValue(":name", name);
         if (!execSqlQuery(query))
             return -1;
@@ -535,8 +851,7 @@ bool Servatrice_DatabaseInterface::isInBuddyList(const QString &whoseList, const
     int id1 = getUserIdInDB(whoseList);
     int id2 = getUserIdInDB(who);
 
-    QSqlQuery *query =
-        prepareQuery("select 1 from {prefix}_buddylist where id_user1 = :id_user1 and id_user2 = :id_user2");
+    QSqlQuery *query = prepareQuery(SelectBuddyListEntry);
     query->bindValue(":id_user1", id1);
     query->bindValue(":id_user2", id2);
     if (!execSqlQuery(query))
@@ -555,8 +870,7 @@ bool Servatrice_DatabaseInterface::isInIgnoreList(const QString &whoseList, cons
     int id1 = getUserIdInDB(whoseList);
     int id2 = getUserIdInDB(who);
 
-    QSqlQuery *query =
-        prepareQuery("select 1 from {prefix}_ignorelist where id_user1 = :id_user1 and id_user2 = :id_user2");
+    QSqlQuery *query = prepareQuery(SelectIgnoreListEntry);
     query->bindValue(":id_user1", id1);
     query->bindValue(":id_user2", id2);
     if (!execSqlQuery(query))
@@ -628,9 +942,7 @@ ServerInfo_User Servatrice_DatabaseInterface::getUserData(const QString &name, b
         if (!checkSql())
             return result;
 
-        QSqlQuery *query =
-            prepareQuery("select id, name, admin, country, privlevel, realname, avatar_bmp, registrationDate, "
-                         "email, clientid from {prefix}_users where name = :name and active = 1");
+        QSqlQuery *query = prepareQuery(SelectUserData);
         query->bindValue(":name", name);
         if (!execSqlQuery(query))
             return result;
@@ -646,8 +958,7 @@ ServerInfo_User Servatrice_DatabaseInterface::getUserData(const QString &name, b
 void Servatrice_DatabaseInterface::clearSessionTables()
 {
     lockSessionTables();
-    QSqlQuery *query =
-        prepareQuery("update {prefix}_sessions set end_time=now() where end_time is null and id_server = :id_server");
+    QSqlQuery *query = prepareQuery(UpdateSessionsClear);
     query->bindValue(":id_server", server->getServerID());
     execSqlQuery(query);
     unlockSessionTables();
@@ -655,13 +966,13 @@ void Servatrice_DatabaseInterface::clearSessionTables()
 
 void Servatrice_DatabaseInterface::lockSessionTables()
 {
-    QSqlQuery *query = prepareQuery("lock tables {prefix}_sessions write, {prefix}_users read");
+    QSqlQuery *query = prepareQuery(LockSessionTables);
     execSqlQuery(query);
 }
 
 void Servatrice_DatabaseInterface::unlockSessionTables()
 {
-    QSqlQuery *query = prepareQuery("unlock tables");
+    QSqlQuery *query = prepareQuery(UnlockTables);
     execSqlQuery(query);
 }
 
@@ -669,8 +980,7 @@ bool Servatrice_DatabaseInterface::userSessionExists(const QString &userName)
 {
     // Call only after lockSessionTables().
 
-    QSqlQuery *query = prepareQuery(
-        "select 1 from {prefix}_sessions where user_name = :user_name and id_server = :id_server and end_time is null");
+    QSqlQuery *query = prepareQuery(SelectUserSession);
     query->bindValue(":id_server", server->getServerID());
     query->bindValue(":user_name", userName);
     execSqlQuery(query);
@@ -688,9 +998,7 @@ qint64 Servatrice_DatabaseInterface::startSession(const QString &userName,
     if (!checkSql())
         return -1;
 
-    QSqlQuery *query = prepareQuery("insert into {prefix}_sessions (user_name, id_server, ip_address, start_time, "
-                                    "clientid, connection_type) values(:user_name, :id_server, :ip_address, NOW(), "
-                                    ":client_id, :connection_type)");
+    QSqlQuery *query = prepareQuery(InsertSession);
     query->bindValue(":user_name", userName);
     query->bindValue(":id_server", server->getServerID());
     query->bindValue(":ip_address", address);
@@ -709,14 +1017,14 @@ void Servatrice_DatabaseInterface::endSession(qint64 sessionId)
     if (!checkSql())
         return;
 
-    QSqlQuery *query = prepareQuery("lock tables {prefix}_sessions write");
+    QSqlQuery *query = prepareQuery(LockSessionsTable);
     execSqlQuery(query);
 
-    query = prepareQuery("update {prefix}_sessions set end_time=NOW() where id = :id_session");
+    query = prepareQuery(UpdateSessionEnd);
     query->bindValue(":id_session", sessionId);
     execSqlQuery(query);
 
-    query = prepareQuery("unlock tables");
+    query = prepareQuery(UnlockTables);
     execSqlQuery(query);
 }
 
@@ -727,9 +1035,7 @@ QMap<QString, ServerInfo_User> Servatrice_DatabaseInterface::getBuddyList(const
     if (server->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
         checkSql();
 
-        QSqlQuery *query = prepareQuery("select a.id, a.name, a.admin, a.country, a.privlevel from {prefix}_users a "
-                                        "left join {prefix}_buddylist b on a.id = b.id_user2 left join {prefix}_users "
-                                        "c on b.id_user1 = c.id where c.name = :name");
+        QSqlQuery *query = prepareQuery(SelectBuddyList);
         query->bindValue(":name", name);
         if (!execSqlQuery(query))
             return result;
@@ -749,9 +1055,7 @@ QMap<QString, ServerInfo_User> Servatrice_DatabaseInterface::getIgnoreList(const
     if (server->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
         checkSql();
 
-        QSqlQuery *query = prepareQuery("select a.id, a.name, a.admin, a.country, a.privlevel from {prefix}_users a "
-                                        "left join {prefix}_ignorelist b on a.id = b.id_user2 left join {prefix}_users "
-                                        "c on b.id_user1 = c.id where c.name = :name");
+        QSqlQuery *query = prepareQuery(SelectIgnoreList);
         query->bindValue(":name", name);
         if (!execSqlQuery(query))
             return result;
@@ -772,7 +1076,7 @@ int Servatrice_DatabaseInterface::getNextGameId()
     if (!checkSql())
         return -1;
 
-    QSqlQuery *query = prepareQuery("insert into {prefix}_games (time_started) values (now())");
+    QSqlQuery *query = prepareQuery(InsertGame);
     execSqlQuery(query);
 
     return query->lastInsertId().toInt();
@@ -783,7 +1087,7 @@ int Servatrice_DatabaseInterface::getNextReplayId()
     if (!checkSql())
         return -1;
 
-    QSqlQuery *query = prepareQuery("insert into {prefix}_replays (id_game) values (NULL)");
+    QSqlQuery *query = prepareQuery(InsertReplay);
     execSqlQuery(query);
 
     return query->lastInsertId().toInt();
@@ -838,9 +1142,7 @@ void Servatrice_DatabaseInterface::storeGameInformation(const QString &roomName,
     }
 
     {
-        QSqlQuery *query = prepareQuery("update {prefix}_games set room_name=:room_name, descr=:descr, "
-                                        "creator_name=:creator_name, password=:password, game_types=:game_types, "
-                                        "player_count=:player_count, time_finished=now() where id=:id_game");
+        QSqlQuery *query = prepareQuery(UpdateGameInformation);
         query->bindValue(":room_name", roomName);
         query->bindValue(":id_game", gameInfo.game_id());
         query->bindValue(":descr", QString::fromStdString(gameInfo.description()));
@@ -852,15 +1154,13 @@ void Servatrice_DatabaseInterface::storeGameInformation(const QString &roomName,
             return;
     }
     {
-        QSqlQuery *query =
-            prepareQuery("insert into {prefix}_games_players (id_game, player_name) values (:id_game, :player_name)");
+        QSqlQuery *query = prepareQuery(InsertGamePlayers);
         query->bindValue(":id_game", gameIds1);
         query->bindValue(":player_name", playerNames);
         query->execBatch();
     }
     {
-        QSqlQuery *query = prepareQuery(
-            "update {prefix}_replays set id_game=:id_game, duration=:duration, replay=:replay where id=:id_replay");
+        QSqlQuery *query = prepareQuery(UpdateReplays);
         query->bindValue(":id_replay", replayIds);
         query->bindValue(":id_game", replayGameIds);
         query->bindValue(":duration", replayDurations);
@@ -868,8 +1168,7 @@ void Servatrice_DatabaseInterface::storeGameInformation(const QString &roomName,
         query->execBatch();
     }
     {
-        QSqlQuery *query = prepareQuery("insert into {prefix}_replays_access (id_game, id_player, replay_name) values "
-                                        "(:id_game, :id_player, :replay_name)");
+        QSqlQuery *query = prepareQuery(InsertReplayAccess);
         query->bindValue(":id_game", gameIds2);
         query->bindValue(":id_player", userIds);
         query->bindValue(":replay_name", replayNames);
@@ -881,8 +1180,7 @@ DeckList *Servatrice_DatabaseInterface::getDeckFromDatabase(int deckId, int user
 {
     checkSql();
 
-    QSqlQuery *query =
-        prepareQuery("select content from {prefix}_decklist_files where id = :id and id_user = :id_user");
+    QSqlQuery *query = prepareQuery(SelectDeckContent);
     query->bindValue(":id", deckId);
     query->bindValue(":id_user", userId);
     execSqlQuery(query);
@@ -929,9 +1227,7 @@ void Servatrice_DatabaseInterface::logMessage(const int senderId,
             return;
     }
 
-    QSqlQuery *query = prepareQuery("insert into {prefix}_log (log_time, sender_id, sender_name, sender_ip, "
-                                    "log_message, target_type, target_id, target_name) values (now(), :sender_id, "
-                                    ":sender_name, :sender_ip, :log_message, :target_type, :target_id, :target_name)");
+    QSqlQuery *query = prepareQuery(InsertLogMessage);
     query->bindValue(":sender_id", senderId < 1 ? QVariant() : senderId);
     query->bindValue(":sender_name", senderName);
     query->bindValue(":sender_ip", senderIp);
@@ -951,8 +1247,7 @@ bool Servatrice_DatabaseInterface::changeUserPassword(const QString &user,
         passwordSha512 = PasswordHasher::computeHash(password, PasswordHasher::generateRandomSalt());
     }
 
-    QSqlQuery *passwordQuery = prepareQuery("update {prefix}_users set password_sha512=:password, "
-                                            "passwordLastChangedDate = NOW() where name = :name");
+    QSqlQuery *passwordQuery = prepareQuery(UpdateUserPassword);
     passwordQuery->bindValue(":password", passwordSha512);
     passwordQuery->bindValue(":name", user);
     if (execSqlQuery(passwordQuery))
@@ -977,7 +1272,7 @@ bool Servatrice_DatabaseInterface::changeUserPassword(const QString &user,
     if (!usernameIsValid(user, error))
         return false;
 
-    QSqlQuery *passwordQuery = prepareQuery("select password_sha512 from {prefix}_users where name = :name");
+    QSqlQuery *passwordQuery = prepareQuery(SelectUserPasswordHash);
     passwordQuery->bindValue(":name", user);
 
     if (!execSqlQuery(passwordQuery)) {
@@ -1007,10 +1302,7 @@ int Servatrice_DatabaseInterface::getActiveUserCount(QString connectionType)
     if (!checkSql())
         return userCount;
 
-    QString text = "select count(*) from {prefix}_sessions where id_server = :serverid AND end_time is NULL";
-    if (!connectionType.isEmpty())
-        text += " AND connection_type = :connection_type";
-    QSqlQuery *query = prepareQuery(text);
+    QSqlQuery *query = prepareQuery(connectionType.isEmpty() ? SelectActiveUserCount : SelectActiveUserCountByType);
 
     query->bindValue(":serverid", server->getServerID());
     if (!connectionType.isEmpty())
@@ -1031,7 +1323,7 @@ void Servatrice_DatabaseInterface::updateUsersClientID(const QString &userName,
     if (!checkSql())
         return;
 
-    QSqlQuery *query = prepareQuery("update {prefix}_users set clientid = :clientid where name = :username");
+    QSqlQuery *query = prepareQuery(UpdateUserClientId);
     query->bindValue(":clientid", userClientID);
     query->bindValue(":username", userName);
     execSqlQuery(query);
@@ -1045,7 +1337,7 @@ void Servatrice_DatabaseInterface::updateUsersLastLoginData(const QString &userN
 
     int usersID = 0;
 
-    QSqlQuery *query = prepareQuery("select id from {prefix}_users where name = :user_name");
+    QSqlQuery *query = prepareQuery(SelectUserId);
     query->bindValue(":user_name", userName);
     if (!execSqlQuery(query)) {
         qDebug("Failed to locate user id when updating users last login data: SQL Error");
@@ -1058,7 +1350,7 @@ void Servatrice_DatabaseInterface::updateUsersLastLoginData(const QString &userN
 
     if (usersID) {
         int userCount = 0;
-        query = prepareQuery("select count(id) from {prefix}_user_analytics where id = :user_id");
+        query = prepareQuery(SelectUserAnalyticsCount);
         query->bindValue(":user_id", usersID);
         if (!execSqlQuery(query))
             return;
@@ -1068,14 +1360,12 @@ void Servatrice_DatabaseInterface::updateUsersLastLoginData(const QString &userN
         }
 
         if (!userCount) {
-            query = prepareQuery(
-                "insert into {prefix}_user_analytics (id,client_ver,last_login) values (:user_id,:client_ver,NOW())");
+            query = prepareQuery(InsertUserAnalytics);
             query->bindValue(":user_id", usersID);
             query->bindValue(":client_ver", clientVersion);
             execSqlQuery(query);
         } else {
-            query = prepareQuery(
-                "update {prefix}_user_analytics set last_login = NOW(), client_ver = :client_ver where id = :user_id");
+            query = prepareQuery(UpdateUserAnalytics);
             query->bindValue(":client_ver", clientVersion);
             query->bindValue(":user_id", usersID);
             execSqlQuery(query);
@@ -1091,9 +1381,7 @@ QList<ServerInfo_Ban> Servatrice_DatabaseInterface::getUserBanHistory(const QStr
     if (!checkSql())
         return results;
 
-    QSqlQuery *query =
-        prepareQuery("SELECT A.id_admin, A.time_from, A.minutes, A.reason, A.visible_reason, B.name AS name_admin FROM "
-                     "{prefix}_bans A LEFT JOIN {prefix}_users B ON A.id_admin=B.id WHERE A.user_name = :user_name");
+    QSqlQuery *query = prepareQuery(SelectBanHistory);
     query->bindValue(":user_name", userName);
 
     if (!execSqlQuery(query)) {
@@ -1123,9 +1411,7 @@ bool Servatrice_DatabaseInterface::addWarning(const QString userName,
         return false;
 
     int userID = getUserIdInDB(userName);
-    QSqlQuery *query =
-        prepareQuery("insert into {prefix}_warnings (user_id,user_name,mod_name,reason,time_of,clientid) values "
-                     "(:user_id,:user_name,:mod_name,:warn_reason,NOW(),:client_id)");
+    QSqlQuery *query = prepareQuery(InsertWarning);
     query->bindValue(":user_id", userID);
     query->bindValue(":user_name", userName);
     query->bindValue(":mod_name", adminName);
@@ -1148,8 +1434,7 @@ QList<ServerInfo_Warning> Servatrice_DatabaseInterface::getUserWarnHistory(const
         return results;
 
     int userID = getUserIdInDB(userName);
-    QSqlQuery *query =
-        prepareQuery("SELECT user_name, mod_name, reason, time_of FROM {prefix}_warnings WHERE user_id = :user_id");
+    QSqlQuery *query = prepareQuery(SelectWarnHistory);
     query->bindValue(":user_id", userID);
 
     if (!execSqlQuery(query)) {
@@ -1279,7 +1564,7 @@ int Servatrice_DatabaseInterface::checkNumberOfUserAccounts(const QString &email
     if (!checkSql())
         return 0;
 
-    QSqlQuery *query = prepareQuery("SELECT count(email) FROM {prefix}_users WHERE email = :user_email");
+    QSqlQuery *query = prepareQuery(SelectEmailAccountCount);
     query->bindValue(":user_email", email);
 
     if (!execSqlQuery(query)) {
@@ -1301,7 +1586,7 @@ bool Servatrice_DatabaseInterface::addForgotPassword(const QString &user)
     if (!updateUserToken(PasswordHasher::generateActivationToken(), user))
         return false;
 
-    QSqlQuery *query = prepareQuery("insert into {prefix}_forgot_password (name,requestDate) values (:username,NOW())");
+    QSqlQuery *query = prepareQuery(InsertForgotPassword);
     query->bindValue(":username", user);
     if (execSqlQuery(query))
         return true;
@@ -1314,7 +1599,7 @@ bool Servatrice_DatabaseInterface::removeForgotPassword(const QString &user)
     if (!checkSql())
         return false;
 
-    QSqlQuery *query = prepareQuery("delete from {prefix}_forgot_password where name = :username");
+    QSqlQuery *query = prepareQuery(DeleteForgotPassword);
     query->bindValue(":username", user);
     if (execSqlQuery(query))
         return true;
@@ -1327,8 +1612,7 @@ bool Servatrice_DatabaseInterface::doesForgotPasswordExist(const QString &user)
     if (!checkSql())
         return false;
 
-    QSqlQuery *query = prepareQuery("select count(name) from {prefix}_forgot_password where name = :user_name AND "
-                                    "requestDate > (now() - interval :minutes minute)");
+    QSqlQuery *query = prepareQuery(SelectForgotPasswordCount);
     query->bindValue(":user_name", user);
     query->bindValue(":minutes", QString::number(server->getForgotPasswordTokenLife()));
 
@@ -1350,7 +1634,7 @@ bool Servatrice_DatabaseInterface::updateUserToken(const QString &token, const Q
     if (token.isEmpty() || user.isEmpty())
         return false;
 
-    QSqlQuery *query = prepareQuery("update {prefix}_users set token = :token where name = :user_name");
+    QSqlQuery *query = prepareQuery(UpdateUserToken);
     query->bindValue(":user_name", user);
     query->bindValue(":token", token);
 
@@ -1401,9 +1685,7 @@ void Servatrice_DatabaseInterface::addAuditRecord(const QString &user,
     if (user.isEmpty() || ipaddress.isEmpty() || clientid.isEmpty() || action.isEmpty())
         return;
 
-    QSqlQuery *query = prepareQuery("insert into {prefix}_audit "
-                                    "(id_server,name,ip_address,clientid,incidentDate,action,results,details) values "
-                                    "(:idserver,:username,:ipaddress,:clientid,NOW(),:action,:results,:details)");
+    QSqlQuery *query = prepareQuery(InsertAuditRecord);
     query->bindValue(":idserver", server->getServerID());
     query->bindValue(":username", user);
     query->bindValue(":ipaddress", ipaddress);
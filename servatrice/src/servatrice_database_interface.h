@@ -1,10 +1,12 @@
 #ifndef SERVATRICE_DATABASE_INTERFACE_H
 #define SERVATRICE_DATABASE_INTERFACE_H
 
+#include "servatrice_database_statements.h"
 #include "server.h"
 #include "server_database_interface.h"
 
 #include <QChar>
+#include <QDateTime>
 #include <QHash>
 #include <QObject>
 #include <QSqlDatabase>
@@ -12,6 +14,7 @@
 #define DATABASE_SCHEMA_VERSION 29
 
 class Servatrice;
+struct BanCacheEntry;
 
 class Servatrice_DatabaseInterface : public Server_DatabaseInterface
 {
@@ -19,8 +22,19 @@ class Servatrice_DatabaseInterface : public Server_DatabaseInterface
 private:
     int instanceId;
     QSqlDatabase sqlDatabase;
+    QSqlQuery *statements[DatabaseStatementCount] = {};
+    /** Maps the prepared statements back to their index for the per-statement metrics. */
+    QHash<const QSqlQuery *, int> statementIds;
+    /** Statements whose text is only known at runtime, keyed by their text. */
     QHash<QString, QSqlQuery *> preparedStatements;
     Servatrice *server;
+    QSqlQuery *createQuery(const QString &queryText);
+    QSqlQuery *createStatement(int statement);
+    void clearPreparedStatements();
+    void prepareStatements(const QString &poolStr);
+    QString getPoolString() const;
+    /** Returns DatabaseStatementCount for queries built at runtime. */
+    int getStatementId(const QSqlQuery *query) const;
     ServerInfo_User evalUserQueryResult(const QSqlQuery *query, bool complete, bool withId = false);
     /** Must be called after checkSql and server is known to be in auth mode. */
     bool checkUserIsIdBanned(const QString &clientId, QString &banReason, int &banSecondsRemaining);
@@ -42,6 +56,13 @@ public slots:
     void initDatabase(const QSqlDatabase &_sqlDatabase);
 
 public:
+    /** Instance ids of the connections that do not belong to a connection pool. */
+    enum InstanceId
+    {
+        MainDatabaseInstance = -1,
+        MaintenanceDatabaseInstance = -2
+    };
+
     explicit Servatrice_DatabaseInterface(int _instanceId, Servatrice *_server);
     ~Servatrice_DatabaseInterface() override;
     bool initDatabase(const QString &type,
@@ -51,6 +72,8 @@ public:
                       const QString &password);
     bool openDatabase();
     bool checkSql();
+    QSqlQuery *prepareQuery(DatabaseStatement statement);
+    /** Only for statements built at runtime; use the DatabaseStatement overload for everything else. */
     QSqlQuery *prepareQuery(const QString &queryText);
     bool execSqlQuery(QSqlQuery *query);
     const QSqlDatabase &getDatabase()
@@ -94,6 +117,11 @@ public:
                            const QString &clientId,
                            QString &banReason,
                            int &banSecondsRemaining) override;
+    /**
+     * Reads the bans table for the ban cache; if since is valid, only bans placed from that time on are returned.
+     * lastBanTime is updated with the time of the most recent ban read.
+     */
+    bool loadBans(QList<BanCacheEntry> &entries, QDateTime &lastBanTime, const QDateTime &since = QDateTime());
     int checkNumberOfUserAccounts(const QString &email) override;
     bool registerUser(const QString &userName,
                       const QString &realName,
@@ -0,0 +1,107 @@
+#ifndef SERVATRICE_DATABASE_STATEMENTS_H
+#define SERVATRICE_DATABASE_STATEMENTS_H
+
+/**
+ * Ids of the static sql statements used by servatrice.
+ * Each database connection prepares all of them when it is opened, so looking one up is an array access;
+ * the statement texts live in servatrice_database_interface.cpp and must be kept in the same order.
+ */
+enum DatabaseStatement
+{
+    SelectSchemaVersion,
+    InsertUser,
+    SelectInactiveUser,
+    UpdateUserActivate,
+    SelectUserPassword,
+    SelectClientIdBan,
+    SelectNameBan,
+    SelectAddressBan,
+    SelectBansSince,
+    SelectAllBans,
+    SelectActiveUserExists,
+    SelectUserExists,
+    SelectUserSalt,
+    SelectActiveUserId,
+    SelectBuddyListEntry,
+    SelectIgnoreListEntry,
+    SelectUserData,
+    UpdateSessionsClear,
+    LockSessionTables,
+    UnlockTables,
+    SelectUserSession,
+    InsertSession,
+    LockSessionsTable,
+    UpdateSessionEnd,
+    SelectBuddyList,
+    SelectIgnoreList,
+    InsertGame,
+    InsertReplay,
+    UpdateGameInformation,
+    InsertGamePlayers,
+    UpdateReplays,
+    InsertReplayAccess,
+    SelectDeckContent,
+    InsertLogMessage,
+    UpdateUserPassword,
+    SelectUserPasswordHash,
+    SelectActiveUserCount,
+    SelectActiveUserCountByType,
+    UpdateUserClientId,
+    SelectUserId,
+    SelectUserAnalyticsCount,
+    InsertUserAnalytics,
+    UpdateUserAnalytics,
+    SelectBanHistory,
+    InsertWarning,
+    SelectWarnHistory,
+    SelectEmailAccountCount,
+    InsertForgotPassword,
+    DeleteForgotPassword,
+    SelectForgotPasswordCount,
+    UpdateUserToken,
+    InsertAuditRecord,
+    SelectRooms,
+    SelectRoomGameTypes,
+    SelectServers,
+    SelectServerMessage,
+    InsertUptime,
+    SelectActivationEmails,
+    DeleteActivationEmail,
+    SelectForgotPasswordEmails,
+    UpdateForgotPasswordEmailed,
+    InsertBuddyListEntry,
+    InsertIgnoreListEntry,
+    DeleteBuddyListEntry,
+    DeleteIgnoreListEntry,
+    SelectDeckFolderId,
+    SelectDeckFolders,
+    SelectDeckFiles,
+    InsertDeckFolder,
+    SelectDeckSubfolders,
+    DeleteDeckFolderFiles,
+    DeleteDeckFolder,
+    SelectDeckFileId,
+    DeleteDeckFile,
+    InsertDeckFile,
+    UpdateDeckFile,
+    SelectReplayMatches,
+    SelectGamePlayers,
+    SelectGameReplays,
+    SelectReplayAccess,
+    SelectReplay,
+    UpdateReplayAccessHidden,
+    DeleteReplayAccess,
+    InsertBan,
+    SelectUserNamesByClientId,
+    InsertActivationEmail,
+    UpdateUserAvatar,
+    UpdateUserAdminFlagAdd,
+    UpdateUserAdminFlagRemove,
+
+    DatabaseStatementCount
+};
+
+/** Name of the statement id as written above, eg. for metrics labels. */
+const char *getDatabaseStatementName(DatabaseStatement statement);
+
+#endif
@@ -0,0 +1,141 @@
+#include "servatrice_maintenance.h"
+
+#include "main.h"
+#include "servatrice.h"
+#include "servatrice_database_interface.h"
+#include "smtpclient.h"
+
+#include <QCoreApplication>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimer>
+
+Servatrice_Maintenance::Servatrice_Maintenance(Servatrice *_server, Servatrice_DatabaseInterface *_databaseInterface)
+    : server(_server), databaseInterface(_databaseInterface), uptime(0), banCacheReloadInterval(0)
+{
+    statusUpdateClock = new QTimer(this);
+    connect(statusUpdateClock, SIGNAL(timeout()), this, SLOT(statusUpdate()));
+    banCacheClock = new QTimer(this);
+    connect(banCacheClock, SIGNAL(timeout()), this, SLOT(refreshBanCache()));
+}
+
+Servatrice_Maintenance::~Servatrice_Maintenance()
+{
+    // the mail client was lent to this thread, hand it back before the thread goes away
+    if (smtpClient && smtpClient->thread() == thread())
+        smtpClient->moveToThread(QCoreApplication::instance()->thread());
+
+    delete databaseInterface;
+    thread()->quit();
+}
+
+void Servatrice_Maintenance::startStatusUpdates(int interval)
+{
+    statusUpdateClock->start(interval);
+}
+
+void Servatrice_Maintenance::startBanCacheRefresh(int refreshInterval, int reloadInterval)
+{
+    banCacheReloadInterval = reloadInterval;
+    refreshBanCache();
+    banCacheClock->start(refreshInterval * 1000);
+}
+
+void Servatrice_Maintenance::refreshBanCache()
+{
+    // Bans placed by this server are added to the cache directly; polling picks up the ones placed by other servers
+    // or by hand, while the periodic full reload also takes care of bans that were lifted or edited.
+    QList<BanCacheEntry> entries;
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const bool fullReload = !lastBanCacheReload.isValid() || lastBanCacheReload.secsTo(now) >= banCacheReloadInterval;
+
+    if (fullReload) {
+        QDateTime newLastBanTime;
+        if (!databaseInterface->loadBans(entries, newLastBanTime))
+            return;
+        lastBanTime = newLastBanTime;
+        lastBanCacheReload = now;
+    } else {
+        if (!databaseInterface->loadBans(entries, lastBanTime, lastBanTime))
+            return;
+        if (entries.isEmpty())
+            return;
+    }
+    emit bansLoaded(entries, fullReload);
+}
+
+void Servatrice_Maintenance::statusUpdate()
+{
+    if (!databaseInterface->checkSql())
+        return;
+
+    const int uc = server->getUsersCount();
+    const int gc = server->getGamesCount();
+
+    server->clientsLock.lockForRead();
+    const QStringList mods_info = server->getOnlineModeratorList();
+    server->clientsLock.unlock();
+    const int mc = mods_info.size();
+    const QString ml = mods_info.join(", ");
+
+    uptime += statusUpdateClock->interval() / 1000;
+
+    QSqlQuery *query = databaseInterface->prepareQuery(InsertUptime);
+    query->bindValue(":id", server->getServerID());
+    query->bindValue(":uptime", uptime);
+    query->bindValue(":users_count", uc);
+    query->bindValue(":mods_count", mc);
+    query->bindValue(":mods_list", ml);
+    query->bindValue(":games_count", gc);
+    query->bindValue(":tx", server->takeTxBytes());
+    query->bindValue(":rx", server->takeRxBytes());
+    databaseInterface->execSqlQuery(query);
+
+    server->updateServerList(databaseInterface);
+
+    if (server->getRegistrationEnabled() && server->getEnableInternalSMTPClient())
+        sendQueuedEmails();
+}
+
+void Servatrice_Maintenance::sendQueuedEmails()
+{
+    if (server->getRequireEmailActivationEnabled()) {
+        auto servDbSelQuery = databaseInterface->prepareQuery(SelectActivationEmails);
+        if (!databaseInterface->execSqlQuery(servDbSelQuery))
+            return;
+
+        auto *queryDelete = databaseInterface->prepareQuery(DeleteActivationEmail);
+
+        while (servDbSelQuery->next()) {
+            const QString userName = servDbSelQuery->value(0).toString();
+            const QString emailAddress = servDbSelQuery->value(1).toString();
+            const QString token = servDbSelQuery->value(2).toString();
+
+            if (smtpClient->enqueueActivationTokenMail(userName, emailAddress, token)) {
+                queryDelete->bindValue(":name", userName);
+                databaseInterface->execSqlQuery(queryDelete);
+            }
+        }
+    }
+
+    if (server->getEnableForgotPassword()) {
+        auto *forgotPwQuery = databaseInterface->prepareQuery(SelectForgotPasswordEmails);
+        if (!databaseInterface->execSqlQuery(forgotPwQuery))
+            return;
+
+        QSqlQuery *queryDelete = databaseInterface->prepareQuery(UpdateForgotPasswordEmailed);
+
+        while (forgotPwQuery->next()) {
+            const QString userName = forgotPwQuery->value(0).toString();
+            const QString emailAddress = forgotPwQuery->value(1).toString();
+            const QString token = forgotPwQuery->value(2).toString();
+
+            if (smtpClient->enqueueForgotPasswordTokenMail(userName, emailAddress, token)) {
+                queryDelete->bindValue(":name", userName);
+                databaseInterface->execSqlQuery(queryDelete);
+            }
+        }
+    }
+
+    smtpClient->sendAllEmails();
+}
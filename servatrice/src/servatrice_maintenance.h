@@ -0,0 +1,59 @@
+#ifndef SERVATRICE_MAINTENANCE_H
+#define SERVATRICE_MAINTENANCE_H
+
+#include "servatrice_ban_cache.h"
+
+#include <QDateTime>
+#include <QObject>
+
+class QTimer;
+class Servatrice;
+class Servatrice_DatabaseInterface;
+
+/**
+ * Runs the periodic database housekeeping (uptime statistics, activation and password reset mails, server list
+ * and ban cache refresh) on its own thread and database connection, so that slow queries never stall the main event
+ * loop.
+ */
+class Servatrice_Maintenance : public QObject
+{
+    Q_OBJECT
+private:
+    Servatrice *server;
+    Servatrice_DatabaseInterface *databaseInterface;
+    QTimer *statusUpdateClock;
+    int uptime;
+    QTimer *banCacheClock;
+    int banCacheReloadInterval;
+    QDateTime lastBanTime;
+    QDateTime lastBanCacheReload;
+
+    void sendQueuedEmails();
+
+public:
+    Servatrice_Maintenance(Servatrice *_server, Servatrice_DatabaseInterface *_databaseInterface);
+    ~Servatrice_Maintenance() override;
+
+    Servatrice_DatabaseInterface *getDatabaseInterface() const
+    {
+        return databaseInterface;
+    }
+
+public slots:
+    void startStatusUpdates(int interval);
+    /**
+     * Loads the bans now and polls for new ones every refreshInterval seconds, reloading all of them every
+     * reloadInterval seconds.
+     */
+    void startBanCacheRefresh(int refreshInterval, int reloadInterval);
+
+private slots:
+    void statusUpdate();
+    void refreshBanCache();
+
+signals:
+    // handed to the main thread; all the bans when replace is set, otherwise only the ones new since the last poll
+    void bansLoaded(const QList<BanCacheEntry> &entries, bool replace);
+};
+
+#endif
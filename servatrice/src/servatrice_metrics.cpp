@@ -0,0 +1,259 @@
+#include "servatrice_metrics.h"
+
+#include "isl_interface.h"
+#include "pb/isl_message.pb.h"
+#include "servatrice.h"
+#include "servatrice_connection_pool.h"
+#include "server_room.h"
+
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+namespace
+{
+// a scrape sends a request line and a few headers; anything longer or slower is dropped
+const qint64 maxRequestSize = 8 * 1024;
+const int requestTimeoutMsecs = 5000;
+
+QByteArray escapeLabel(const QString &value)
+{
+    QByteArray result = value.toUtf8();
+    result.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return result;
+}
+
+void writeGauge(QByteArray &out, const QByteArray &name, const QByteArray &help, qint64 value)
+{
+    out += "# HELP " + name + " " + help + "\n# TYPE " + name + " gauge\n" + name + " " + QByteArray::number(value) +
+           "\n";
+}
+} // namespace
+
+Servatrice_Metrics::Servatrice_Metrics() : streamRawBytes(0), streamCompressedBytes(0)
+{
+    for (auto &direction : islMessages)
+        for (auto &messageCount : direction)
+            messageCount.store(0, std::memory_order_relaxed);
+    for (auto &frameCount : islFrames)
+        frameCount.store(0, std::memory_order_relaxed);
+    for (auto &byteCount : islBytes)
+        byteCount.store(0, std::memory_order_relaxed);
+}
+
+void Servatrice_Metrics::islMessage(IslDirection direction, int messageType)
+{
+    if (messageType < 0 || messageType >= IslMessageTypeSlots)
+        return;
+    islMessages[direction][messageType].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Servatrice_Metrics::write(QByteArray &out) const
+{
+    out += "# HELP servatrice_db_query_duration_seconds Time spent executing a database statement.\n"
+           "# TYPE servatrice_db_query_duration_seconds histogram\n";
+    for (int i = 0; i <= DatabaseStatementCount; ++i) {
+        if (queryLatency[i].getCount() == 0)
+            continue;
+        const char *name =
+            i == DatabaseStatementCount ? "dynamic" : getDatabaseStatementName(static_cast<DatabaseStatement>(i));
+        queryLatency[i].write(out, "servatrice_db_query_duration_seconds",
+                              QByteArray("statement=\"") + name + "\"");
+    }
+
+    const char *directionNames[IslDirectionCount] = {"sent", "received"};
+    out += "# HELP servatrice_isl_messages_total ISL messages exchanged with other servers.\n"
+           "# TYPE servatrice_isl_messages_total counter\n";
+    for (int direction = 0; direction < IslDirectionCount; ++direction) {
+        for (int type = 0; type < IslMessageTypeSlots; ++type) {
+            if (!IslMessage::MessageType_IsValid(type))
+                continue;
+            const QByteArray typeName =
+                QByteArray::fromStdString(IslMessage::MessageType_Name(static_cast<IslMessage::MessageType>(type)));
+            out += QByteArray("servatrice_isl_messages_total{direction=\"") + directionNames[direction] +
+                   "\",type=\"" + typeName.toLower() + "\"} " +
+                   QByteArray::number(islMessages[direction][type].load(std::memory_order_relaxed)) + "\n";
+        }
+    }
+    out += "# HELP servatrice_isl_frames_total ISL frames exchanged with other servers, each carrying one or more "
+           "messages.\n"
+           "# TYPE servatrice_isl_frames_total counter\n";
+    for (int direction = 0; direction < IslDirectionCount; ++direction)
+        out += QByteArray("servatrice_isl_frames_total{direction=\"") + directionNames[direction] + "\"} " +
+               QByteArray::number(islFrames[direction].load(std::memory_order_relaxed)) + "\n";
+    out += "# HELP servatrice_isl_bytes_total ISL bytes exchanged with other servers, after compression.\n"
+           "# TYPE servatrice_isl_bytes_total counter\n";
+    for (int direction = 0; direction < IslDirectionCount; ++direction)
+        out += QByteArray("servatrice_isl_bytes_total{direction=\"") + directionNames[direction] + "\"} " +
+               QByteArray::number(islBytes[direction].load(std::memory_order_relaxed)) + "\n";
+    out += "# HELP servatrice_stream_compression_bytes_total Client messages before and after stream compression.\n"
+           "# TYPE servatrice_stream_compression_bytes_total counter\n";
+    out += "servatrice_stream_compression_bytes_total{stage=\"raw\"} " +
+           QByteArray::number(streamRawBytes.load(std::memory_order_relaxed)) + "\n";
+    out += "servatrice_stream_compression_bytes_total{stage=\"compressed\"} " +
+           QByteArray::number(streamCompressedBytes.load(std::memory_order_relaxed)) + "\n";
+}
+
+Servatrice_MetricsServer::Servatrice_MetricsServer(Servatrice *_server, QObject *parent)
+    : QTcpServer(parent), server(_server)
+{
+}
+
+void Servatrice_MetricsServer::incomingConnection(qintptr socketDescriptor)
+{
+    auto socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+    // one byte over the limit is enough to tell that the request is too long
+    socket->setReadBufferSize(maxRequestSize + 1);
+    connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    QTimer::singleShot(requestTimeoutMsecs, socket, [socket] {
+        socket->abort();
+        socket->deleteLater();
+    });
+}
+
+void Servatrice_MetricsServer::readRequest()
+{
+    auto socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket)
+        return;
+
+    // the lines read so far plus the bytes still buffered make up the request
+    const qint64 requestSize = socket->property("readSize").toLongLong() + socket->bytesAvailable();
+    if (requestSize > maxRequestSize) {
+        socket->abort();
+        socket->deleteLater();
+        return;
+    }
+
+    // only the request line matters, the headers are read and ignored
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (!socket->property("requestLine").isValid()) {
+            socket->setProperty("requestLine", line);
+            continue;
+        }
+        if (!line.isEmpty())
+            continue;
+
+        const QList<QByteArray> request = socket->property("requestLine").toByteArray().split(' ');
+        QByteArray status = "200 OK", body;
+        if (request.size() < 2 || request[0] != "GET")
+            status = "405 Method Not Allowed";
+        else if (request[1] != "/metrics")
+            status = "404 Not Found";
+        else
+            body = renderMetrics();
+
+        socket->write("HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                      QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+        socket->disconnectFromHost();
+        return;
+    }
+    socket->setProperty("readSize", requestSize - socket->bytesAvailable());
+}
+
+QByteArray Servatrice_MetricsServer::renderMetrics() const
+{
+    QByteArray out;
+
+    writeGauge(out, "servatrice_users", "Users logged in to this server.", server->getUsersCount());
+    writeGauge(out, "servatrice_games", "Games hosted by this server.", server->getGamesCount());
+    writeGauge(out, "servatrice_tcp_connections", "Connected tcp clients.", server->getTCPUserCount());
+    writeGauge(out, "servatrice_websocket_connections", "Connected websocket clients.",
+               server->getWebSocketUserCount());
+
+    const QList<Servatrice_ConnectionPool *> pools = server->getConnectionPools();
+    QList<QByteArray> poolLabels;
+    QList<ServatricePoolLoad> poolLoads;
+    for (Servatrice_ConnectionPool *pool : pools) {
+        poolLabels.append("{pool=\"" + escapeLabel(pool->thread()->objectName()) + "\"} ");
+        poolLoads.append(pool->getLoad());
+    }
+    out += "# HELP servatrice_pool_clients Clients handled by each connection pool.\n"
+           "# TYPE servatrice_pool_clients gauge\n";
+    for (int i = 0; i < pools.size(); ++i)
+        out += "servatrice_pool_clients" + poolLabels[i] + QByteArray::number(poolLoads[i].clients) + "\n";
+    out += "# HELP servatrice_pool_commands_per_second Recent rate of commands received by each connection pool.\n"
+           "# TYPE servatrice_pool_commands_per_second gauge\n";
+    for (int i = 0; i < pools.size(); ++i)
+        out += "servatrice_pool_commands_per_second" + poolLabels[i] +
+               QByteArray::number(poolLoads[i].commandsPerSecond) + "\n";
+    out += "# HELP servatrice_pool_queued_messages Messages waiting in the output queues of each connection pool.\n"
+           "# TYPE servatrice_pool_queued_messages gauge\n";
+    for (int i = 0; i < pools.size(); ++i)
+        out += "servatrice_pool_queued_messages" + poolLabels[i] + QByteArray::number(poolLoads[i].queuedMessages) +
+               "\n";
+    out += "# HELP servatrice_pool_event_loop_lag_seconds Delay of the event loop of each connection pool.\n"
+           "# TYPE servatrice_pool_event_loop_lag_seconds gauge\n";
+    for (int i = 0; i < pools.size(); ++i)
+        out += "servatrice_pool_event_loop_lag_seconds" + poolLabels[i] +
+               QByteArray::number(poolLoads[i].eventLoopLagMsecs / 1000.0, 'f', 3) + "\n";
+    out += "# HELP servatrice_pool_load_score Score used to pick the connection pool for a new client.\n"
+           "# TYPE servatrice_pool_load_score gauge\n";
+    for (int i = 0; i < pools.size(); ++i)
+        out += "servatrice_pool_load_score" + poolLabels[i] + QByteArray::number(poolLoads[i].score()) + "\n";
+
+    const QList<IslPeerStats> peers = server->getIslPeerStats();
+    out += "# HELP servatrice_isl_peer_up Whether the link to each peer is established.\n"
+           "# TYPE servatrice_isl_peer_up gauge\n";
+    for (const IslPeerStats &peer : peers)
+        out += "servatrice_isl_peer_up{peer=\"" + QByteArray::number(peer.serverId) + "\"} " +
+               (peer.state == IslInterface::PeerConnected ? "1" : "0") + "\n";
+    out += "# HELP servatrice_isl_peer_link_failures_total Failed connection attempts and dropped links to each peer.\n"
+           "# TYPE servatrice_isl_peer_link_failures_total counter\n";
+    for (const IslPeerStats &peer : peers)
+        out += "servatrice_isl_peer_link_failures_total{peer=\"" + QByteArray::number(peer.serverId) + "\"} " +
+               QByteArray::number(peer.linkFailures) + "\n";
+    out += "# HELP servatrice_isl_peer_messages_total ISL messages exchanged with each peer.\n"
+           "# TYPE servatrice_isl_peer_messages_total counter\n";
+    for (const IslPeerStats &peer : peers) {
+        const QByteArray label = "{peer=\"" + QByteArray::number(peer.serverId) + "\",direction=";
+        out += "servatrice_isl_peer_messages_total" + label + "\"sent\"} " + QByteArray::number(peer.messagesSent) +
+               "\n";
+        out += "servatrice_isl_peer_messages_total" + label + "\"received\"} " +
+               QByteArray::number(peer.messagesReceived) + "\n";
+    }
+    out += "# HELP servatrice_isl_peer_frames_total ISL frames exchanged with each peer.\n"
+           "# TYPE servatrice_isl_peer_frames_total counter\n";
+    for (const IslPeerStats &peer : peers) {
+        const QByteArray label = "{peer=\"" + QByteArray::number(peer.serverId) + "\",direction=";
+        out += "servatrice_isl_peer_frames_total" + label + "\"sent\"} " + QByteArray::number(peer.framesSent) + "\n";
+        out += "servatrice_isl_peer_frames_total" + label + "\"received\"} " + QByteArray::number(peer.framesReceived) +
+               "\n";
+    }
+    out += "# HELP servatrice_isl_peer_bytes_total ISL bytes exchanged with each peer.\n"
+           "# TYPE servatrice_isl_peer_bytes_total counter\n";
+    for (const IslPeerStats &peer : peers) {
+        const QByteArray label = "{peer=\"" + QByteArray::number(peer.serverId) + "\",direction=";
+        out += "servatrice_isl_peer_bytes_total" + label + "\"sent\"} " + QByteArray::number(peer.bytesSent) + "\n";
+        out += "servatrice_isl_peer_bytes_total" + label + "\"received\"} " + QByteArray::number(peer.bytesReceived) +
+               "\n";
+    }
+    out += "# HELP servatrice_isl_peer_coalesced_messages_total Game list updates for each peer that were dropped "
+           "because a newer one replaced them before sending.\n"
+           "# TYPE servatrice_isl_peer_coalesced_messages_total counter\n";
+    for (const IslPeerStats &peer : peers)
+        out += "servatrice_isl_peer_coalesced_messages_total{peer=\"" + QByteArray::number(peer.serverId) + "\"} " +
+               QByteArray::number(peer.messagesCoalesced) + "\n";
+
+    out += "# HELP servatrice_room_games Games hosted by this server in each room.\n"
+           "# TYPE servatrice_room_games gauge\n";
+    server->roomsLock.lockForRead();
+    for (Server_Room *room : server->getRooms()) {
+        room->gamesLock.lockForRead();
+        const int gameCount = room->getGames().size();
+        room->gamesLock.unlock();
+        out += "servatrice_room_games{room_id=\"" + QByteArray::number(room->getId()) + "\",room=\"" +
+               escapeLabel(room->getName()) + "\"} " + QByteArray::number(gameCount) + "\n";
+    }
+    server->roomsLock.unlock();
+
+    server->getMetrics()->write(out);
+    server->getServatriceMetrics()->write(out);
+    return out;
+}
@@ -0,0 +1,83 @@
+#ifndef SERVATRICE_METRICS_H
+#define SERVATRICE_METRICS_H
+
+#include "servatrice_database_statements.h"
+#include "server_metrics.h"
+
+#include <QTcpServer>
+#include <atomic>
+
+class Servatrice;
+
+/**
+ * Servatrice specific counters (database, ISL traffic and stream compression), next to the ones kept by the server
+ * core in ServerMetrics.
+ * Like those, they are updated with atomics only.
+ */
+class Servatrice_Metrics
+{
+public:
+    enum IslDirection
+    {
+        IslSent,
+        IslReceived,
+        IslDirectionCount
+    };
+    static const int IslMessageTypeSlots = 16;
+
+private:
+    // the last histogram collects the queries that are built at runtime
+    MetricsHistogram queryLatency[DatabaseStatementCount + 1];
+    std::atomic<quint64> islMessages[IslDirectionCount][IslMessageTypeSlots];
+    std::atomic<quint64> islFrames[IslDirectionCount];
+    std::atomic<quint64> islBytes[IslDirectionCount];
+    std::atomic<quint64> streamRawBytes;
+    std::atomic<quint64> streamCompressedBytes;
+
+public:
+    Servatrice_Metrics();
+    Servatrice_Metrics(const Servatrice_Metrics &) = delete;
+    Servatrice_Metrics &operator=(const Servatrice_Metrics &) = delete;
+
+    void queryExecuted(int statement, qint64 nsecs)
+    {
+        queryLatency[statement].observe(static_cast<quint64>(nsecs / 1000));
+    }
+    void islMessage(IslDirection direction, int messageType);
+    void islFrame(IslDirection direction, int bytes, int frames = 1)
+    {
+        islFrames[direction].fetch_add(static_cast<quint64>(frames), std::memory_order_relaxed);
+        islBytes[direction].fetch_add(static_cast<quint64>(bytes), std::memory_order_relaxed);
+    }
+    void streamCompressed(unsigned int rawBytes, int compressedBytes)
+    {
+        streamRawBytes.fetch_add(rawBytes, std::memory_order_relaxed);
+        streamCompressedBytes.fetch_add(static_cast<quint64>(compressedBytes), std::memory_order_relaxed);
+    }
+
+    void write(QByteArray &out) const;
+};
+
+/**
+ * Minimal HTTP endpoint serving all metrics in the prometheus text format on GET /metrics.
+ * It lives on the main thread; a scrape reads the counters and briefly takes the room locks to count games.
+ * Requests over 8 KB, or not complete within five seconds, are dropped.
+ */
+class Servatrice_MetricsServer : public QTcpServer
+{
+    Q_OBJECT
+private:
+    Servatrice *server;
+    QByteArray renderMetrics() const;
+
+public:
+    explicit Servatrice_MetricsServer(Servatrice *_server, QObject *parent = nullptr);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private slots:
+    void readRequest();
+};
+
+#endif
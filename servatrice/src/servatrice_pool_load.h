@@ -0,0 +1,51 @@
+#ifndef SERVATRICE_POOL_LOAD_H
+#define SERVATRICE_POOL_LOAD_H
+
+#include <QtGlobal>
+
+/**
+ * Snapshot of how busy a connection pool thread is, as measured by the pool itself.
+ * The client count alone hides the difference between an idle client sitting in the lobby and one playing a game.
+ */
+struct ServatricePoolLoad
+{
+    int clients = 0;
+    int commandsPerSecond = 0;
+    int queuedMessages = 0;
+    int eventLoopLagMsecs = 0;
+
+    /**
+     * A connecting client costs little until it starts sending commands, so the client count is only part of the
+     * score. Commands per second are the main work of a pool; messages waiting in output queues and a late event loop
+     * show a pool that is already falling behind.
+     */
+    qint64 score() const
+    {
+        return static_cast<qint64>(clients) * 2 + static_cast<qint64>(commandsPerSecond) * 10 + queuedMessages +
+               static_cast<qint64>(eventLoopLagMsecs) * 20;
+    }
+};
+
+/**
+ * Returns the index of the least loaded pool, or -1 for an empty list. Ties go to the pool with fewer clients and then
+ * to the first one, so idle pools fill up evenly.
+ */
+template <typename Container> int findLeastLoadedPool(const Container &loads)
+{
+    int poolIndex = -1;
+    qint64 minScore = 0;
+    int minClients = 0;
+    int i = 0;
+    for (const ServatricePoolLoad &load : loads) {
+        const qint64 score = load.score();
+        if (poolIndex == -1 || score < minScore || (score == minScore && load.clients < minClients)) {
+            poolIndex = i;
+            minScore = score;
+            minClients = load.clients;
+        }
+        ++i;
+    }
+    return poolIndex;
+}
+
+#endif
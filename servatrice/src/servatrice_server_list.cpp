@@ -0,0 +1,21 @@
+#include "servatrice_server_list.h"
+
+QList<ServerProperties>
+withoutOwnServer(const QList<ServerProperties> &serverList, int ownId, const QSslCertificate &ownCert)
+{
+    QList<ServerProperties> peers;
+    for (const ServerProperties &prop : serverList) {
+        if (prop.id == ownId || (!ownCert.isNull() && prop.cert == ownCert))
+            continue;
+        peers.append(prop);
+    }
+    return peers;
+}
+
+int indexOfServerAddress(const QList<ServerProperties> &serverList, const QHostAddress &address)
+{
+    for (int i = 0; i < serverList.size(); ++i)
+        if (serverList[i].address == address)
+            return i;
+    return -1;
+}
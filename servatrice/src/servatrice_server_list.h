@@ -0,0 +1,45 @@
+#ifndef SERVATRICE_SERVER_LIST_H
+#define SERVATRICE_SERVER_LIST_H
+
+#include <QHostAddress>
+#include <QList>
+#include <QSslCertificate>
+#include <QString>
+#include <utility>
+
+class ServerProperties
+{
+public:
+    int id;
+    QSslCertificate cert;
+    QString hostname;
+    QHostAddress address;
+    int gamePort;
+    int controlPort;
+
+    ServerProperties(int _id,
+                     const QSslCertificate &_cert,
+                     QString _hostname,
+                     const QHostAddress &_address,
+                     int _gamePort,
+                     int _controlPort)
+        : id(_id), cert(_cert), hostname(std::move(_hostname)), address(_address), gamePort(_gamePort),
+          controlPort(_controlPort)
+    {
+    }
+};
+
+/**
+ * Returns the ISL peers in serverList, leaving out the entry of this server itself, which is recognised by its id or
+ * by its certificate. Peers are looked up by address, so our own entry must never be in the list when several
+ * servers share one address.
+ */
+QList<ServerProperties>
+withoutOwnServer(const QList<ServerProperties> &serverList, int ownId, const QSslCertificate &ownCert);
+
+/**
+ * Returns the index of the first server in serverList listening on address, or -1.
+ */
+int indexOfServerAddress(const QList<ServerProperties> &serverList, const QHostAddress &address);
+
+#endif
@@ -0,0 +1,31 @@
+#include "servatrice_websocket_acceptor.h"
+
+#include <QDebug>
+#include <QTcpSocket>
+#include <QWebSocket>
+#include <QWebSocketServer>
+
+Servatrice_WebsocketAcceptor::Servatrice_WebsocketAcceptor(QObject *parent) : QObject(parent)
+{
+    // this server never listens, it only upgrades the sockets handed over in acceptConnection()
+    webSocketServer = new QWebSocketServer("Servatrice", QWebSocketServer::NonSecureMode, this);
+    connect(webSocketServer, SIGNAL(newConnection()), this, SLOT(processPendingConnections()));
+}
+
+void Servatrice_WebsocketAcceptor::acceptConnection(int socketDescriptor)
+{
+    auto socket = new QTcpSocket;
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qDebug() << "Websocket acceptor: invalid socket descriptor:" << socket->errorString();
+        delete socket;
+        return;
+    }
+    // the websocket server takes ownership of the socket
+    webSocketServer->handleConnection(socket);
+}
+
+void Servatrice_WebsocketAcceptor::processPendingConnections()
+{
+    while (webSocketServer->hasPendingConnections())
+        socketConnected(webSocketServer->nextPendingConnection());
+}
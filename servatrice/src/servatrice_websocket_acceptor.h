@@ -0,0 +1,34 @@
+#ifndef SERVATRICE_WEBSOCKET_ACCEPTOR_H
+#define SERVATRICE_WEBSOCKET_ACCEPTOR_H
+
+#include <QObject>
+
+class QWebSocket;
+class QWebSocketServer;
+
+/**
+ * Performs the websocket handshake for connections accepted by a plain QTcpServer on another thread.
+ * The acceptor is moved to a pool thread, so the upgrade, the framing and everything done with the resulting
+ * QWebSocket happen on that thread instead of the one listening on the port.
+ */
+class Servatrice_WebsocketAcceptor : public QObject
+{
+    Q_OBJECT
+private:
+    QWebSocketServer *webSocketServer;
+
+protected:
+    // called on the acceptor's thread once the handshake is complete; takes ownership of the socket
+    virtual void socketConnected(QWebSocket *socket) = 0;
+
+public:
+    explicit Servatrice_WebsocketAcceptor(QObject *parent = nullptr);
+
+public slots:
+    void acceptConnection(int socketDescriptor);
+
+private slots:
+    void processPendingConnections();
+};
+
+#endif
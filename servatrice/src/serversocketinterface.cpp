@@ -58,12 +58,14 @@
 #include "pb/serverinfo_replay.pb.h"
 #include "pb/serverinfo_user.pb.h"
 #include "servatrice.h"
+#include "servatrice_connection_pool.h"
 #include "servatrice_database_interface.h"
 #include "server_logger.h"
 #include "server_player.h"
 #include "server_response_containers.h"
 #include "server_room.h"
 #include "settingscache.h"
+#include "stream_compression.h"
 #include "stringsizes.h"
 #include "version_string.h"
 
@@ -80,9 +82,9 @@
 static const int protocolVersion = 14;
 
 AbstractServerSocketInterface::AbstractServerSocketInterface(Servatrice *_server,
-                                                             Servatrice_DatabaseInterface *_databaseInterface,
+                                                             Servatrice_ConnectionPool *_pool,
                                                              QObject *parent)
-    : Server_ProtocolHandler(_server, _databaseInterface, parent), servatrice(_server),
+    : Server_ProtocolHandler(_server, _pool->getDatabaseInterface(), parent), servatrice(_server), pool(_pool),
       sqlInterface(reinterpret_cast<Servatrice_DatabaseInterface *>(databaseInterface))
 {
     // Never call flushOutputQueue directly from outputQueueChanged. In case of a socket error,
@@ -100,6 +102,9 @@ bool AbstractServerSocketInterface::initSession()
     if (servatrice->getAuthenticationMethod() == Servatrice::AuthenticationSql) {
         identEvent.set_server_options(Event_ServerIdentification::SupportsPasswordHash);
     }
+    if (offersStreamCompression()) {
+        identEvent.set_stream_compression(Event_ServerIdentification::DeflateStreamCompression);
+    }
     SessionEvent *identSe = prepareSessionEvent(identEvent);
     sendProtocolItem(*identSe);
     delete identSe;
@@ -138,8 +143,11 @@ void AbstractServerSocketInterface::transmitProtocolItem(const ServerMessage &it
 {
     outputQueueMutex.lock();
     outputQueue.append(item);
+    const int queueDepth = outputQueue.size();
     outputQueueMutex.unlock();
 
+    pool->messagesQueued(1);
+    server->getMetrics()->outputQueued(queueDepth);
     emit outputQueueChanged();
 }
 
@@ -270,8 +278,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdAddToList(const Command
     if (id1 == id2)
         return Response::RespContextError;
 
-    QSqlQuery *query =
-        sqlInterface->prepareQuery("insert into {prefix}_" + list + "list (id_user1, id_user2) values(:id1, :id2)");
+    QSqlQuery *query = sqlInterface->prepareQuery(list == "buddy" ? InsertBuddyListEntry : InsertIgnoreListEntry);
     query->bindValue(":id1", id1);
     query->bindValue(":id2", id2);
     if (!sqlInterface->execSqlQuery(query))
@@ -309,8 +316,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdRemoveFromList(const Co
     if (id2 < 0)
         return Response::RespNameNotFound;
 
-    QSqlQuery *query =
-        sqlInterface->prepareQuery("delete from {prefix}_" + list + "list where id_user1 = :id1 and id_user2 = :id2");
+    QSqlQuery *query = sqlInterface->prepareQuery(list == "buddy" ? DeleteBuddyListEntry : DeleteIgnoreListEntry);
     query->bindValue(":id1", id1);
     query->bindValue(":id2", id2);
     if (!sqlInterface->execSqlQuery(query))
@@ -331,8 +337,7 @@ int AbstractServerSocketInterface::getDeckPathId(int basePathId, QStringList pat
     if (path[0].isEmpty())
         return 0;
 
-    QSqlQuery *query = sqlInterface->prepareQuery("select id from {prefix}_decklist_folders where id_parent = "
-                                                  ":id_parent and name = :name and id_user = :id_user");
+    QSqlQuery *query = sqlInterface->prepareQuery(SelectDeckFolderId);
     query->bindValue(":id_parent", basePathId);
     query->bindValue(":name", path.takeFirst());
     query->bindValue(":id_user", userInfo->id());
@@ -354,8 +359,7 @@ int AbstractServerSocketInterface::getDeckPathId(const QString &path)
 
 bool AbstractServerSocketInterface::deckListHelper(int folderId, ServerInfo_DeckStorage_Folder *folder)
 {
-    QSqlQuery *query = sqlInterface->prepareQuery(
-        "select id, name from {prefix}_decklist_folders where id_parent = :id_parent and id_user = :id_user");
+    QSqlQuery *query = sqlInterface->prepareQuery(SelectDeckFolders);
     query->bindValue(":id_parent", folderId);
     query->bindValue(":id_user", userInfo->id());
     if (!sqlInterface->execSqlQuery(query))
@@ -374,8 +378,7 @@ bool AbstractServerSocketInterface::deckListHelper(int folderId, ServerInfo_Deck
             return false;
     }
 
-    query = sqlInterface->prepareQuery("select id, name, upload_time from {prefix}_decklist_files where id_folder = "
-                                       ":id_folder and id_user = :id_user");
+    query = sqlInterface->prepareQuery(SelectDeckFiles);
     query->bindValue(":id_folder", folderId);
     query->bindValue(":id_user", userInfo->id());
     if (!sqlInterface->execSqlQuery(query))
@@ -431,8 +434,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdDeckNewDir(const Comman
     if (path.length() + name.length() + 1 > MAX_NAME_LENGTH)
         return Response::RespContextError; // do not allow creation of paths that would be too long to delete
 
-    QSqlQuery *query = sqlInterface->prepareQuery(
-        "insert into {prefix}_decklist_folders (id_parent, id_user, name) values(:id_parent, :id_user, :name)");
+    QSqlQuery *query = sqlInterface->prepareQuery(InsertDeckFolder);
     query->bindValue(":id_parent", folderId);
     query->bindValue(":id_user", userInfo->id());
     query->bindValue(":name", name);
@@ -444,18 +446,17 @@ Response::ResponseCode AbstractServerSocketInterface::cmdDeckNewDir(const Comman
 void AbstractServerSocketInterface::deckDelDirHelper(int basePathId)
 {
     sqlInterface->checkSql();
-    QSqlQuery *query =
-        sqlInterface->prepareQuery("select id from {prefix}_decklist_folders where id_parent = :id_parent");
+    QSqlQuery *query = sqlInterface->prepareQuery(SelectDeckSubfolders);
     query->bindValue(":id_parent", basePathId);
     sqlInterface->execSqlQuery(query);
     while (query->next())
         deckDelDirHelper(query->value(0).toInt());
 
-    query = sqlInterface->prepareQuery("delete from {prefix}_decklist_files where id_folder = :id_folder");
+    query = sqlInterface->prepareQuery(DeleteDeckFolderFiles);
     query->bindValue(":id_folder", basePathId);
     sqlInterface->execSqlQuery(query);
 
-    query = sqlInterface->prepareQuery("delete from {prefix}_decklist_folders where id = :id");
+    query = sqlInterface->prepareQuery(DeleteDeckFolder);
     query->bindValue(":id", basePathId);
     sqlInterface->execSqlQuery(query);
 }
@@ -497,15 +498,14 @@ Response::ResponseCode AbstractServerSocketInterface::cmdDeckDel(const Command_D
         return Response::RespFunctionNotAllowed;
 
     sqlInterface->checkSql();
-    QSqlQuery *query =
-        sqlInterface->prepareQuery("select id from {prefix}_decklist_files where id = :id and id_user = :id_user");
+    QSqlQuery *query = sqlInterface->prepareQuery(SelectDeckFileId);
     query->bindValue(":id", cmd.deck_id());
     query->bindValue(":id_user", userInfo->id());
     sqlInterface->execSqlQuery(query);
     if (!query->next())
         return Response::RespNameNotFound;
 
-    query = sqlInterface->prepareQuery("delete from {prefix}_decklist_files where id = :id");
+    query = sqlInterface->prepareQuery(DeleteDeckFile);
     query->bindValue(":id", cmd.deck_id());
     sqlInterface->execSqlQuery(query);
 
@@ -537,9 +537,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdDeckUpload(const Comman
         if (folderId == -1)
             return Response::RespNameNotFound;
 
-        QSqlQuery *query =
-            sqlInterface->prepareQuery("insert into {prefix}_decklist_files (id_folder, id_user, name, upload_time, "
-                                       "content) values(:id_folder, :id_user, :name, NOW(), :content)");
+        QSqlQuery *query = sqlInterface->prepareQuery(InsertDeckFile);
         query->bindValue(":id_folder", folderId);
         query->bindValue(":id_user", userInfo->id());
         query->bindValue(":name", deckName);
@@ -553,9 +551,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdDeckUpload(const Comman
         fileInfo->mutable_file()->set_creation_time(QDateTime::currentDateTime().toSecsSinceEpoch());
         rc.setResponseExtension(re);
     } else if (cmd.has_deck_id()) {
-        QSqlQuery *query =
-            sqlInterface->prepareQuery("update {prefix}_decklist_files set name=:name, upload_time=NOW(), "
-                                       "content=:content where id = :id_deck and id_user = :id_user");
+        QSqlQuery *query = sqlInterface->prepareQuery(UpdateDeckFile);
         query->bindValue(":id_deck", cmd.deck_id());
         query->bindValue(":id_user", userInfo->id());
         query->bindValue(":name", deckName);
@@ -606,10 +602,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReplayList(const Comman
 
     Response_ReplayList *re = new Response_ReplayList;
 
-    QSqlQuery *query1 = sqlInterface->prepareQuery(
-        "select a.id_game, a.replay_name, b.room_name, b.time_started, b.time_finished, b.descr, a.do_not_hide from "
-        "{prefix}_replays_access a left join {prefix}_games b on b.id = a.id_game where a.id_player = :id_player and "
-        "(a.do_not_hide = 1 or date_add(b.time_started, interval 7 day) > now())");
+    QSqlQuery *query1 = sqlInterface->prepareQuery(SelectReplayMatches);
     query1->bindValue(":id_player", userInfo->id());
     sqlInterface->execSqlQuery(query1);
     while (query1->next()) {
@@ -627,16 +620,14 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReplayList(const Comman
         matchInfo->set_do_not_hide(query1->value(6).toBool());
 
         {
-            QSqlQuery *query2 =
-                sqlInterface->prepareQuery("select player_name from {prefix}_games_players where id_game = :id_game");
+            QSqlQuery *query2 = sqlInterface->prepareQuery(SelectGamePlayers);
             query2->bindValue(":id_game", gameId);
             sqlInterface->execSqlQuery(query2);
             while (query2->next())
                 matchInfo->add_player_names(query2->value(0).toString().toStdString());
         }
         {
-            QSqlQuery *query3 =
-                sqlInterface->prepareQuery("select id, duration from {prefix}_replays where id_game = :id_game");
+            QSqlQuery *query3 = sqlInterface->prepareQuery(SelectGameReplays);
             query3->bindValue(":id_game", gameId);
             sqlInterface->execSqlQuery(query3);
             while (query3->next()) {
@@ -659,9 +650,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReplayDownload(const Co
         return Response::RespFunctionNotAllowed;
 
     {
-        QSqlQuery *query =
-            sqlInterface->prepareQuery("select 1 from {prefix}_replays_access a left join {prefix}_replays b on "
-                                       "a.id_game = b.id_game where b.id = :id_replay and a.id_player = :id_player");
+        QSqlQuery *query = sqlInterface->prepareQuery(SelectReplayAccess);
         query->bindValue(":id_replay", cmd.replay_id());
         query->bindValue(":id_player", userInfo->id());
         if (!sqlInterface->execSqlQuery(query))
@@ -670,7 +659,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReplayDownload(const Co
             return Response::RespAccessDenied;
     }
 
-    QSqlQuery *query = sqlInterface->prepareQuery("select replay from {prefix}_replays where id = :id_replay");
+    QSqlQuery *query = sqlInterface->prepareQuery(SelectReplay);
     query->bindValue(":id_replay", cmd.replay_id());
     if (!sqlInterface->execSqlQuery(query))
         return Response::RespInternalError;
@@ -695,8 +684,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReplayModifyMatch(const
     if (!sqlInterface->checkSql())
         return Response::RespInternalError;
 
-    QSqlQuery *query = sqlInterface->prepareQuery("update {prefix}_replays_access set do_not_hide=:do_not_hide where "
-                                                  "id_player = :id_player and id_game = :id_game");
+    QSqlQuery *query = sqlInterface->prepareQuery(UpdateReplayAccessHidden);
     query->bindValue(":id_player", userInfo->id());
     query->bindValue(":id_game", cmd.game_id());
     query->bindValue(":do_not_hide", cmd.do_not_hide());
@@ -715,8 +703,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReplayDeleteMatch(const
     if (!sqlInterface->checkSql())
         return Response::RespInternalError;
 
-    QSqlQuery *query = sqlInterface->prepareQuery(
-        "delete from {prefix}_replays_access where id_player = :id_player and id_game = :id_game");
+    QSqlQuery *query = sqlInterface->prepareQuery(DeleteReplayAccess);
     query->bindValue(":id_player", userInfo->id());
     query->bindValue(":id_game", cmd.game_id());
 
@@ -928,9 +915,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdBanFromServer(const Com
     if (trustedSources.contains(address, Qt::CaseInsensitive))
         address = "";
 
-    QSqlQuery *query = sqlInterface->prepareQuery(
-        "insert into {prefix}_bans (user_name, ip_address, id_admin, time_from, minutes, reason, visible_reason, "
-        "clientid) values(:user_name, :ip_address, :id_admin, NOW(), :minutes, :reason, :visible_reason, :client_id)");
+    QSqlQuery *query = sqlInterface->prepareQuery(InsertBan);
     query->bindValue(":user_name", userName);
     query->bindValue(":ip_address", address);
     query->bindValue(":id_admin", userInfo->id());
@@ -938,7 +923,11 @@ Response::ResponseCode AbstractServerSocketInterface::cmdBanFromServer(const Com
     query->bindValue(":reason", textFromStdString(cmd.reason()));
     query->bindValue(":visible_reason", visibleReason);
     query->bindValue(":client_id", nameFromStdString(cmd.clientid()));
-    sqlInterface->execSqlQuery(query);
+    if (sqlInterface->execSqlQuery(query)) {
+        const qint64 expiresAt = minutes ? QDateTime::currentMSecsSinceEpoch() + minutes * 60000LL : 0;
+        servatrice->getBanCache()->addBan(
+            {userName, address, nameFromStdString(cmd.clientid()), expiresAt, visibleReason});
+    }
 
     servatrice->clientsLock.lockForRead();
     QList<QString> moderatorList = server->getOnlineModeratorList();
@@ -952,8 +941,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdBanFromServer(const Com
     }
 
     if (userName.isEmpty() && address.isEmpty() && (!clientId.isEmpty())) {
-        QSqlQuery *clientIdQuery =
-            sqlInterface->prepareQuery("select name from {prefix}_users where clientid = :client_id");
+        QSqlQuery *clientIdQuery = sqlInterface->prepareQuery(SelectUserNamesByClientId);
         clientIdQuery->bindValue(":client_id", nameFromStdString(cmd.clientid()));
         sqlInterface->execSqlQuery(clientIdQuery);
         if (!sqlInterface->execSqlQuery(clientIdQuery)) {
@@ -1190,8 +1178,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdRegisterAccount(const C
     if (regSucceeded) {
         qDebug() << "Accepted register command for user:" << userName;
         if (requireEmailActivation) {
-            QSqlQuery *query =
-                sqlInterface->prepareQuery("insert into {prefix}_activation_emails (name) values(:name)");
+            QSqlQuery *query = sqlInterface->prepareQuery(InsertActivationEmail);
             query->bindValue(":name", userName);
             if (!sqlInterface->execSqlQuery(query))
                 return Response::RespRegistrationFailed;
@@ -1322,15 +1309,17 @@ Response::ResponseCode AbstractServerSocketInterface::cmdAccountEdit(const Comma
     if (!sqlInterface->execSqlQuery(query))
         return Response::RespInternalError;
 
+    ServerInfo_User newUserInfo(*userInfo);
     if (cmd.has_real_name()) {
-        userInfo->set_real_name(realName.toStdString());
+        newUserInfo.set_real_name(realName.toStdString());
     }
     if (cmd.has_email()) {
-        userInfo->set_email(emailAddress.toStdString());
+        newUserInfo.set_email(emailAddress.toStdString());
     }
     if (cmd.has_country()) {
-        userInfo->set_country(country.toStdString());
+        newUserInfo.set_country(country.toStdString());
     }
+    updateUserInfo(newUserInfo);
 
     return Response::RespOk;
 }
@@ -1345,13 +1334,15 @@ Response::ResponseCode AbstractServerSocketInterface::cmdAccountImage(const Comm
     QByteArray image(cmd.image().c_str(), length);
     int id = userInfo->id();
 
-    QSqlQuery *query = sqlInterface->prepareQuery("update {prefix}_users set avatar_bmp=:image where id=:id");
+    QSqlQuery *query = sqlInterface->prepareQuery(UpdateUserAvatar);
     query->bindValue(":image", image);
     query->bindValue(":id", id);
     if (!sqlInterface->execSqlQuery(query))
         return Response::RespInternalError;
 
-    userInfo->set_avatar_bmp(cmd.image().c_str(), length);
+    ServerInfo_User newUserInfo(*userInfo);
+    newUserInfo.set_avatar_bmp(cmd.image().c_str(), length);
+    updateUserInfo(newUserInfo);
     return Response::RespOk;
 }
 
@@ -1609,8 +1600,7 @@ Response::ResponseCode AbstractServerSocketInterface::cmdReloadConfig(const Comm
 
 bool AbstractServerSocketInterface::addAdminFlagToUser(const QString &userName, int flag)
 {
-    QSqlQuery *query =
-        sqlInterface->prepareQuery("update {prefix}_users set admin = (admin | :adminlevel) where name = :username");
+    QSqlQuery *query = sqlInterface->prepareQuery(UpdateUserAdminFlagAdd);
     query->bindValue(":adminlevel", flag);
     query->bindValue(":username", userName);
     if (!sqlInterface->execSqlQuery(query)) {
@@ -1633,8 +1623,7 @@ bool AbstractServerSocketInterface::addAdminFlagToUser(const QString &userName,
 
 bool AbstractServerSocketInterface::removeAdminFlagFromUser(const QString &userName, int flag)
 {
-    QSqlQuery *query =
-        sqlInterface->prepareQuery("update {prefix}_users set admin = (admin & ~ :adminlevel) where name = :username");
+    QSqlQuery *query = sqlInterface->prepareQuery(UpdateUserAdminFlagRemove);
     query->bindValue(":adminlevel", flag);
     query->bindValue(":username", userName);
     if (!sqlInterface->execSqlQuery(query)) {
@@ -1693,10 +1682,10 @@ Response::ResponseCode AbstractServerSocketInterface::cmdAdjustMod(const Command
 }
 
 TcpServerSocketInterface::TcpServerSocketInterface(Servatrice *_server,
-                                                   Servatrice_DatabaseInterface *_databaseInterface,
+                                                   Servatrice_ConnectionPool *_pool,
                                                    QObject *parent)
-    : AbstractServerSocketInterface(_server, _databaseInterface, parent), messageInProgress(false),
-      handshakeStarted(false)
+    : AbstractServerSocketInterface(_server, _pool, parent), messageInProgress(false),
+      handshakeStarted(false), outputCompressor(nullptr)
 {
     socket = new QTcpSocket(this);
     socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
@@ -1711,6 +1700,21 @@ TcpServerSocketInterface::~TcpServerSocketInterface()
     logger->logMessage("TcpServerSocketInterface destructor", this);
 
     flushOutputQueue();
+    delete outputCompressor;
+}
+
+bool TcpServerSocketInterface::offersStreamCompression() const
+{
+    return servatrice->getStreamCompressionEnabled();
+}
+
+void TcpServerSocketInterface::clientFeaturesNegotiated(const QMap<QString, bool> &clientFeatures)
+{
+    if (outputCompressor || !clientFeatures.contains("stream_compression") || !offersStreamCompression())
+        return;
+
+    // the client decompresses every frame flagged as compressed, so compression can start with the next message
+    outputCompressor = new StreamCompressor;
 }
 
 void TcpServerSocketInterface::initConnection(int socketDescriptor)
@@ -1741,8 +1745,10 @@ void TcpServerSocketInterface::flushOutputQueue()
         return;
 
     int totalBytes = 0;
+    int sentMessages = 0;
     while (!outputQueue.isEmpty()) {
         ServerMessage item = outputQueue.takeFirst();
+        ++sentMessages;
         locker.unlock();
 
         QByteArray buf;
@@ -1753,10 +1759,25 @@ void TcpServerSocketInterface::flushOutputQueue()
 #endif
         buf.resize(size + 4);
         item.SerializeToArray(buf.data() + 4, size);
-        buf.data()[3] = (unsigned char)size;
-        buf.data()[2] = (unsigned char)(size >> 8);
-        buf.data()[1] = (unsigned char)(size >> 16);
-        buf.data()[0] = (unsigned char)(size >> 24);
+        quint32 frameHeader = size;
+        if (outputCompressor && size >= minCompressedMessageSize) {
+            // once compressed, a message is part of the stream history and must be sent compressed
+            QByteArray compressed(4, '\0');
+            if (outputCompressor->compress(buf.constData() + 4, static_cast<int>(size), compressed)) {
+                servatrice->getServatriceMetrics()->streamCompressed(size, compressed.size() - 4);
+                buf = compressed;
+                size = static_cast<unsigned int>(buf.size() - 4);
+                frameHeader = size | StreamCompressedFrameFlag;
+            } else {
+                logDebugMessage("Stream compression failed, sending uncompressed messages from now on");
+                delete outputCompressor;
+                outputCompressor = nullptr;
+            }
+        }
+        buf.data()[3] = (unsigned char)frameHeader;
+        buf.data()[2] = (unsigned char)(frameHeader >> 8);
+        buf.data()[1] = (unsigned char)(frameHeader >> 16);
+        buf.data()[0] = (unsigned char)(frameHeader >> 24);
         // In case socket->write() calls catchSocketError(), the mutex must not be locked during this call.
         writeToSocket(buf);
 
@@ -1764,7 +1785,8 @@ void TcpServerSocketInterface::flushOutputQueue()
         locker.relock();
     }
     locker.unlock();
-    emit incTxBytes(totalBytes);
+    pool->messagesQueued(-sentMessages);
+    servatrice->incTxBytes(totalBytes);
     // see above wrt mutex
     flushSocket();
 }
@@ -1818,9 +1840,10 @@ void TcpServerSocketInterface::readClient()
         messageInProgress = false;
 
         // dirty hack to make v13 client display the correct error message
-        if (handshakeStarted)
+        if (handshakeStarted) {
+            pool->commandReceived();
             processCommandContainer(newCommandContainer);
-        else if (!newCommandContainer.has_cmd_id()) {
+        } else if (!newCommandContainer.has_cmd_id()) {
             handshakeStarted = true;
             if (!initTcpSession())
                 prepareDestroy();
@@ -1856,9 +1879,9 @@ bool TcpServerSocketInterface::initTcpSession()
 }
 
 WebsocketServerSocketInterface::WebsocketServerSocketInterface(Servatrice *_server,
-                                                               Servatrice_DatabaseInterface *_databaseInterface,
+                                                               Servatrice_ConnectionPool *_pool,
                                                                QObject *parent)
-    : AbstractServerSocketInterface(_server, _databaseInterface, parent), socket(nullptr)
+    : AbstractServerSocketInterface(_server, _pool, parent), socket(nullptr)
 {
 }
 
@@ -1944,8 +1967,10 @@ void WebsocketServerSocketInterface::flushOutputQueue()
         return;
 
     qint64 totalBytes = 0;
+    int sentMessages = 0;
     while (!outputQueue.isEmpty()) {
         ServerMessage item = outputQueue.takeFirst();
+        ++sentMessages;
         locker.unlock();
 
         QByteArray buf;
@@ -1963,7 +1988,8 @@ void WebsocketServerSocketInterface::flushOutputQueue()
         locker.relock();
     }
     locker.unlock();
-    emit incTxBytes(totalBytes);
+    pool->messagesQueued(-sentMessages);
+    servatrice->incTxBytes(totalBytes);
     // see above wrt mutex
     flushSocket();
 }
@@ -1996,6 +2022,7 @@ void WebsocketServerSocketInterface::binaryMessageReceived(const QByteArray &mes
         qDebug() << "Message coming from:" << getAddress();
     }
 
+    pool->commandReceived();
     processCommandContainer(newCommandContainer);
 }
 
@@ -28,6 +28,8 @@
 #include <QWebSocket>
 
 class Servatrice;
+class Servatrice_ConnectionPool;
+class StreamCompressor;
 class Servatrice_DatabaseInterface;
 class DeckList;
 class ServerInfo_DeckStorage_Folder;
@@ -63,7 +65,6 @@ protected slots:
     virtual void flushOutputQueue() = 0;
 signals:
     void outputQueueChanged();
-    void incTxBytes(qint64 amount);
 
 protected:
     void logDebugMessage(const QString &message);
@@ -71,8 +72,13 @@ protected:
 
     virtual void writeToSocket(QByteArray &data) = 0;
     virtual void flushSocket() = 0;
+    virtual bool offersStreamCompression() const
+    {
+        return false;
+    }
 
     Servatrice *servatrice;
+    Servatrice_ConnectionPool *pool;
     QList<ServerMessage> outputQueue;
     QMutex outputQueueMutex;
 
@@ -136,7 +142,7 @@ private:
 
 public:
     AbstractServerSocketInterface(Servatrice *_server,
-                                  Servatrice_DatabaseInterface *_databaseInterface,
+                                  Servatrice_ConnectionPool *_pool,
                                   QObject *parent = 0);
     ~AbstractServerSocketInterface(){};
     bool initSession();
@@ -152,7 +158,7 @@ class TcpServerSocketInterface : public AbstractServerSocketInterface
     Q_OBJECT
 public:
     TcpServerSocketInterface(Servatrice *_server,
-                             Servatrice_DatabaseInterface *_databaseInterface,
+                             Servatrice_ConnectionPool *_pool,
                              QObject *parent = 0);
     ~TcpServerSocketInterface();
 
@@ -170,11 +176,17 @@ public:
     };
 
 private:
+    // smaller messages are not worth a compressed frame
+    static const unsigned int minCompressedMessageSize = 64;
+
     QTcpSocket *socket;
     QByteArray inputBuffer;
     bool messageInProgress;
     bool handshakeStarted;
     int messageLength;
+    StreamCompressor *outputCompressor;
+
+    void clientFeaturesNegotiated(const QMap<QString, bool> &clientFeatures) override;
 
 protected:
     void writeToSocket(QByteArray &data)
@@ -185,6 +197,7 @@ protected:
     {
         socket->flush();
     };
+    bool offersStreamCompression() const override;
     void initSessionDeprecated();
     bool initTcpSession();
 protected slots:
@@ -199,7 +212,7 @@ class WebsocketServerSocketInterface : public AbstractServerSocketInterface
     Q_OBJECT
 public:
     WebsocketServerSocketInterface(Servatrice *_server,
-                                   Servatrice_DatabaseInterface *_databaseInterface,
+                                   Servatrice_ConnectionPool *_pool,
                                    QObject *parent = nullptr);
     ~WebsocketServerSocketInterface();
 
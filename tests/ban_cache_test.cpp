@@ -0,0 +1,112 @@
+#include "../servatrice/src/servatrice_ban_cache.h"
+
+#include "gtest/gtest.h"
+#include <QDateTime>
+
+namespace
+{
+BanCacheEntry ban(const QString &userName,
+                  const QString &address,
+                  const QString &clientId,
+                  qint64 secondsLeft,
+                  const QString &reason = QString())
+{
+    qint64 expiresAt = secondsLeft ? QDateTime::currentMSecsSinceEpoch() + secondsLeft * 1000 : 0;
+    return {userName, address, clientId, expiresAt, reason};
+}
+
+TEST(BanCacheTest, NotLoadedUntilFilled)
+{
+    ServerBanCache cache;
+    ASSERT_FALSE(cache.isLoaded());
+    cache.replaceAll({});
+    ASSERT_TRUE(cache.isLoaded());
+}
+
+TEST(BanCacheTest, MatchesNameAddressAndClientId)
+{
+    ServerBanCache cache;
+    cache.replaceAll({ban("Spammer", "", "", 0, "spam"), ban("", "192.0.2.1", "", 600), ban("", "", "ABCDEF", 0)});
+
+    QString reason;
+    int secondsLeft = -1;
+    ASSERT_TRUE(cache.isNameBanned("spammer", reason, secondsLeft)) << "Names are matched case insensitively";
+    ASSERT_EQ(reason, "spam");
+    ASSERT_EQ(secondsLeft, 0) << "Permanent bans report no remaining time";
+
+    ASSERT_TRUE(cache.isAddressBanned("192.0.2.1", reason, secondsLeft));
+    ASSERT_GT(secondsLeft, 590);
+    ASSERT_FALSE(cache.isAddressBanned("192.0.2.2", reason, secondsLeft));
+
+    ASSERT_TRUE(cache.isClientIdBanned("abcdef", reason, secondsLeft));
+    ASSERT_FALSE(cache.isClientIdBanned("", reason, secondsLeft));
+    ASSERT_FALSE(cache.isNameBanned("", reason, secondsLeft)) << "Bans without a name must not match empty names";
+}
+
+TEST(BanCacheTest, LatestBanWins)
+{
+    ServerBanCache cache;
+    cache.replaceAll({ban("Player", "", "", 0)});
+    cache.addBan(ban("Player", "", "", -60));
+
+    QString reason;
+    int secondsLeft;
+    ASSERT_FALSE(cache.isNameBanned("Player", reason, secondsLeft)) << "An expired newer ban lifts an older one";
+}
+
+TEST(BanCacheTest, SubnetBans)
+{
+    ServerBanCache cache;
+    cache.replaceAll({ban("", "198.51.100.0/24", "", 0), ban("", "2001:db8::/32", "", 0)});
+
+    QString reason;
+    int secondsLeft;
+    ASSERT_TRUE(cache.isAddressBanned("198.51.100.77", reason, secondsLeft));
+    ASSERT_FALSE(cache.isAddressBanned("198.51.101.77", reason, secondsLeft));
+    ASSERT_TRUE(cache.isAddressBanned("2001:db8::1", reason, secondsLeft));
+}
+
+TEST(BanCacheTest, ReplaceAllDropsLiftedBans)
+{
+    ServerBanCache cache;
+    cache.replaceAll({ban("Player", "", "", 0)});
+    cache.replaceAll({});
+
+    QString reason;
+    int secondsLeft;
+    ASSERT_FALSE(cache.isNameBanned("Player", reason, secondsLeft));
+}
+
+TEST(BanCacheTest, ManyBans)
+{
+    const int banCount = 5000;
+    QList<BanCacheEntry> entries;
+    for (int i = 0; i < banCount; ++i) {
+        const QString address = QString("10.%1.%2.%3").arg((i >> 16) & 255).arg((i >> 8) & 255).arg(i & 255);
+        entries.append(ban(QString("user%1").arg(i), address, QString("CID%1").arg(i), i % 2 ? 3600 : 0));
+    }
+    ServerBanCache cache;
+    cache.replaceAll(entries);
+
+    const int attempts = 2 * banCount;
+    int banned = 0;
+    QString reason;
+    int secondsLeft;
+    for (int i = 0; i < attempts; ++i) {
+        // half of the attempts come from banned users, the other half are clean and go through all three checks
+        const int id = i % 2 ? i % banCount : banCount + i;
+        const QString address = QString("172.16.%1.%2").arg((id >> 8) & 255).arg(id & 255);
+        if (cache.isAddressBanned(address, reason, secondsLeft) ||
+            cache.isNameBanned(QString("user%1").arg(id), reason, secondsLeft) ||
+            cache.isClientIdBanned(QString("CID%1").arg(id), reason, secondsLeft))
+            ++banned;
+    }
+    ASSERT_EQ(banned, attempts / 2);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,57 @@
+#include "../../servatrice/src/servatrice_ban_cache.h"
+
+#include <QDateTime>
+#include <benchmark/benchmark.h>
+
+namespace
+{
+QList<BanCacheEntry> manyBans(int count)
+{
+    const qint64 inAnHour = QDateTime::currentMSecsSinceEpoch() + 3600 * 1000;
+    QList<BanCacheEntry> entries;
+    entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QString address = QString("10.%1.%2.%3").arg((i >> 16) & 255).arg((i >> 8) & 255).arg(i & 255);
+        entries.append({QString("user%1").arg(i), address, QString("CID%1").arg(i), i % 2 ? inAnHour : 0, QString()});
+    }
+    return entries;
+}
+
+void BM_LoadBans(benchmark::State &state)
+{
+    const QList<BanCacheEntry> entries = manyBans(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        ServerBanCache cache;
+        cache.replaceAll(entries);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadBans)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+/**
+ * The ban checks of one login against range(0) bans. Half of the logins come from banned users, the other half are
+ * clean and go through all three checks.
+ */
+void BM_LoginCheck(benchmark::State &state)
+{
+    const int banCount = static_cast<int>(state.range(0));
+    ServerBanCache cache;
+    cache.replaceAll(manyBans(banCount));
+
+    QString reason;
+    int secondsLeft;
+    int i = 0;
+    for (auto _ : state) {
+        const int id = i % 2 ? i % banCount : banCount + i;
+        ++i;
+        const QString address = QString("172.16.%1.%2").arg((id >> 8) & 255).arg(id & 255);
+        const bool banned = cache.isAddressBanned(address, reason, secondsLeft) ||
+                            cache.isNameBanned(QString("user%1").arg(id), reason, secondsLeft) ||
+                            cache.isClientIdBanned(QString("CID%1").arg(id), reason, secondsLeft);
+        benchmark::DoNotOptimize(banned);
+    }
+}
+BENCHMARK(BM_LoginCheck)->Arg(1000)->Arg(100000);
+} // namespace
+
+BENCHMARK_MAIN();
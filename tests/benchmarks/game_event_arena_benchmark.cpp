@@ -0,0 +1,33 @@
+#include "../../common/rng_abstract.h"
+#include "../command_events.h"
+
+#include <benchmark/benchmark.h>
+
+// GameEventStorage::sendToGame links in the game logic, which draws from the global generator; no game is run here
+RNG_Abstract *rng;
+
+using namespace command_events;
+
+namespace
+{
+// two players and two spectators
+const int othersRecipients = 3;
+
+void BM_CommandOnHeap(benchmark::State &state)
+{
+    int step = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sendCommandOnHeap(step++, othersRecipients));
+}
+BENCHMARK(BM_CommandOnHeap);
+
+void BM_CommandOnArena(benchmark::State &state)
+{
+    int step = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sendCommandOnArena(step++, othersRecipients));
+}
+BENCHMARK(BM_CommandOnArena);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,49 @@
+#include "../../common/stream_compression.h"
+#include "../../servatrice/src/isl_message_batch.h"
+#include "../isl_traffic.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace isl_traffic;
+
+namespace
+{
+/**
+ * Writes a busy room's traffic for one peer in frames of range(0) messages, batched into one frame each if range(1)
+ * is set and compressed if range(2) is set. A batch of one message is the plain frame every server understands.
+ */
+void BM_WriteIslFrames(benchmark::State &state)
+{
+    const bool compressed = state.range(2) != 0;
+    if (compressed && !StreamCompressor::isAvailable()) {
+        state.SkipWithError("built without zlib");
+        return;
+    }
+    const QList<IslMessage> traffic = busyRoomTraffic();
+    const int messagesPerBatch = static_cast<int>(state.range(0));
+    int wireBytes = 0, frames = 0, coalesced = 0;
+    for (auto _ : state) {
+        StreamCompressor compressor;
+        IslMessageBatch batch;
+        QByteArray out;
+        frames = coalesced = 0;
+        for (int i = 0; i < traffic.size(); ++i) {
+            batch.append(traffic[i]);
+            if ((i + 1) % messagesPerBatch == 0 || i + 1 == traffic.size()) {
+                coalesced += batch.takeCoalescedCount();
+                bool failed;
+                frames += batch.writeFrames(out, compressed ? &compressor : nullptr, state.range(1) != 0, failed);
+            }
+        }
+        wireBytes = out.size();
+    }
+    state.SetItemsProcessed(state.iterations() * traffic.size());
+    state.counters["bytes"] = wireBytes;
+    state.counters["frames"] = frames;
+    state.counters["coalesced"] = coalesced;
+}
+// single frames, then one batch every 20ms of the second the traffic spans
+BENCHMARK(BM_WriteIslFrames)->Args({1, 0, 0})->Args({40, 0, 0})->Args({40, 1, 0})->Args({40, 1, 1});
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,216 @@
+#include "../../common/rng_sfmt.h"
+#include "../server_core_client.h"
+#include "pb/command_create_arrow.pb.h"
+#include "pb/command_delete_arrow.pb.h"
+#include "pb/command_mulligan.pb.h"
+#include "pb/command_next_turn.pb.h"
+#include "pb/command_shuffle.pb.h"
+
+#include <QCoreApplication>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+RNG_Abstract *rng;
+
+using namespace server_core;
+
+namespace
+{
+/** Stops the benchmark with an error if a command was refused; the timings would not mean anything. */
+bool ok(benchmark::State &state, Response::ResponseCode code)
+{
+    if (code == Response::RespOk)
+        return true;
+    state.SkipWithError("command refused");
+    return false;
+}
+
+void BM_CreateJoinAndLeaveGame(benchmark::State &state)
+{
+    LocalServer server;
+    CoreClient host(server, nextUserName()), opponent(server, nextUserName());
+    for (auto _ : state) {
+        if (!ok(state, host.createGame()) || !ok(state, opponent.joinGame(host.gameId)) ||
+            !ok(state, opponent.leaveGame()) || !ok(state, host.leaveGame()))
+            break;
+        settle();
+    }
+}
+BENCHMARK(BM_CreateJoinAndLeaveGame);
+
+void BM_DeckSelectAndStart(benchmark::State &state)
+{
+    LocalServer server;
+    CoreClient host(server, nextUserName()), opponent(server, nextUserName());
+    for (auto _ : state) {
+        state.PauseTiming();
+        const bool joined = ok(state, host.createGame()) && ok(state, opponent.joinGame(host.gameId));
+        state.ResumeTiming();
+        if (!joined || !ok(state, host.selectDeckAndReady(standardDeck())) ||
+            !ok(state, opponent.selectDeckAndReady(standardDeck())))
+            break;
+        settle();
+
+        state.PauseTiming();
+        const bool left = ok(state, opponent.leaveGame()) && ok(state, host.leaveGame());
+        settle();
+        state.ResumeTiming();
+        if (!left)
+            break;
+    }
+}
+BENCHMARK(BM_DeckSelectAndStart);
+
+void BM_Mulligan(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server);
+    Command_Mulligan mulligan;
+    mulligan.set_number(7);
+    for (auto _ : state)
+        if (!ok(state, table.host.game(mulligan)))
+            break;
+}
+BENCHMARK(BM_Mulligan);
+
+void BM_ShuffleLibrary(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server);
+    for (auto _ : state)
+        if (!ok(state, table.host.game(Command_Shuffle())))
+            break;
+}
+BENCHMARK(BM_ShuffleLibrary);
+
+/** One turn of a long game: draw, play a land, bin the oldest one once the table is full, shuffle now and then. */
+void BM_Turn(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server, largeDeck());
+    int turn = 0;
+    for (auto _ : state) {
+        CoreClient &player = table.active();
+        if (!ok(state, player.draw(1)) || !ok(state, player.move("hand", {player.zones["hand"].first()}, "table")))
+            break;
+        if (player.zones["table"].size() > 20 &&
+            !ok(state, player.move("table", {player.zones["table"].first()}, "grave")))
+            break;
+        if (turn++ % 10 == 0 && !ok(state, player.game(Command_Shuffle())))
+            break;
+        if (!ok(state, player.game(Command_NextTurn())))
+            break;
+    }
+}
+// the large deck lasts each player a thousand draws
+BENCHMARK(BM_Turn)->Iterations(1000);
+
+/** Moves a whole hand of range(0) cards to the table, the graveyard and back into the library, then draws it. */
+void BM_MassMove(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server);
+    CoreClient &player = table.host;
+    const int cards = static_cast<int>(state.range(0));
+    if (!ok(state, player.draw(cards - 7)))
+        return;
+    for (auto _ : state) {
+        if (!ok(state, player.move("hand", player.zones["hand"], "table")) ||
+            !ok(state, player.move("table", player.zones["table"], "grave")) ||
+            !ok(state, player.move("grave", player.zones["grave"], "deck")) || !ok(state, player.draw(cards)))
+            break;
+    }
+    state.SetItemsProcessed(state.iterations() * cards * 3);
+}
+BENCHMARK(BM_MassMove)->Arg(10)->Arg(40);
+
+/** Draws an arrow from each of range(0) cards of the host to each as many cards of the opponent, then deletes them. */
+void BM_Arrows(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server);
+    const int cards = static_cast<int>(state.range(0));
+    for (CoreClient *player : {&table.host, &table.opponent})
+        if (!ok(state, player->draw(cards - 7)) || !ok(state, player->move("hand", player->zones["hand"], "table")))
+            return;
+
+    for (auto _ : state) {
+        for (int start : table.host.zones["table"]) {
+            for (int target : table.opponent.zones["table"]) {
+                Command_CreateArrow cmd;
+                cmd.set_start_player_id(table.host.playerId);
+                cmd.set_start_zone("table");
+                cmd.set_start_card_id(start);
+                cmd.set_target_player_id(table.opponent.playerId);
+                cmd.set_target_zone("table");
+                cmd.set_target_card_id(target);
+                if (!ok(state, table.host.game(cmd)))
+                    return;
+            }
+        }
+        for (int id : QList<int>(table.host.arrows)) {
+            Command_DeleteArrow cmd;
+            cmd.set_arrow_id(id);
+            if (!ok(state, table.host.game(cmd)))
+                return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * cards * cards);
+}
+BENCHMARK(BM_Arrows)->Arg(30);
+
+/** Each iteration adds another spectator to the same game, so the later joins show what the earlier ones cost. */
+void BM_SpectatorJoin(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server);
+    for (CoreClient *player : {&table.host, &table.opponent})
+        if (!ok(state, player->draw(20)) || !ok(state, player->move("hand", player->zones["hand"].mid(0, 20), "table")))
+            return;
+
+    std::vector<std::unique_ptr<CoreClient>> watching;
+    for (auto _ : state) {
+        state.PauseTiming();
+        watching.emplace_back(new CoreClient(server, nextUserName()));
+        state.ResumeTiming();
+        if (!ok(state, watching.back()->joinGame(table.host.gameId, true)))
+            break;
+    }
+}
+BENCHMARK(BM_SpectatorJoin)->Iterations(200);
+
+/** One turn of a game watched by range(0) spectators. */
+void BM_WatchedTurn(benchmark::State &state)
+{
+    LocalServer server;
+    Table table(server, largeDeck());
+    std::vector<std::unique_ptr<CoreClient>> watching;
+    for (int i = 0; i < state.range(0); ++i) {
+        watching.emplace_back(new CoreClient(server, nextUserName()));
+        if (!ok(state, watching.back()->joinGame(table.host.gameId, true)))
+            return;
+    }
+    settle();
+
+    for (auto _ : state) {
+        CoreClient &player = table.active();
+        if (!ok(state, player.draw(1)) || !ok(state, player.move("hand", {player.zones["hand"].first()}, "table")) ||
+            !ok(state, player.game(Command_NextTurn())))
+            break;
+    }
+}
+BENCHMARK(BM_WatchedTurn)->Arg(0)->Arg(200)->Iterations(500);
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMessageHandler(quietMessageOutput);
+    rng = new RNG_SFMT;
+
+    ::benchmark::Initialize(&argc, argv);
+    ::benchmark::RunSpecifiedBenchmarks();
+    delete rng;
+    return 0;
+}
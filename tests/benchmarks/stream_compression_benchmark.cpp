@@ -0,0 +1,67 @@
+#include "../../common/stream_compression.h"
+#include "../sample_session.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace sample_session;
+
+namespace
+{
+std::vector<std::string> serializedSession()
+{
+    std::vector<std::string> result;
+    for (const ServerMessage &message : sampleSession())
+        result.push_back(message.SerializeAsString());
+    return result;
+}
+
+/** Compresses a sample session on one stream, as servatrice does per connection, at level range(0). */
+void BM_CompressSession(benchmark::State &state)
+{
+    if (!StreamCompressor::isAvailable()) {
+        state.SkipWithError("built without zlib");
+        return;
+    }
+    const std::vector<std::string> session = serializedSession();
+    quint64 rawBytes = 0, wireBytes = 0;
+    for (auto _ : state) {
+        StreamCompressor compressor(static_cast<int>(state.range(0)));
+        rawBytes = wireBytes = 0;
+        for (const std::string &raw : session) {
+            QByteArray compressed;
+            compressor.compress(raw.data(), static_cast<int>(raw.size()), compressed);
+            rawBytes += raw.size() + 4;
+            wireBytes += static_cast<quint64>(compressed.size()) + 4;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(session.size()));
+    state.counters["wire_ratio"] = static_cast<double>(wireBytes) / static_cast<double>(rawBytes);
+}
+BENCHMARK(BM_CompressSession)->Arg(1)->Arg(StreamCompressor::DefaultLevel)->Arg(6);
+
+void BM_DecompressSession(benchmark::State &state)
+{
+    if (!StreamCompressor::isAvailable()) {
+        state.SkipWithError("built without zlib");
+        return;
+    }
+    std::vector<QByteArray> session;
+    StreamCompressor compressor(static_cast<int>(state.range(0)));
+    for (const std::string &raw : serializedSession()) {
+        session.emplace_back();
+        compressor.compress(raw.data(), static_cast<int>(raw.size()), session.back());
+    }
+    for (auto _ : state) {
+        StreamDecompressor decompressor;
+        for (const QByteArray &compressed : session) {
+            QByteArray decompressed;
+            decompressor.decompress(compressed.constData(), compressed.size(), decompressed);
+            benchmark::DoNotOptimize(decompressed.constData());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(session.size()));
+}
+BENCHMARK(BM_DecompressSession)->Arg(1)->Arg(StreamCompressor::DefaultLevel)->Arg(6);
+} // namespace
+
+BENCHMARK_MAIN();
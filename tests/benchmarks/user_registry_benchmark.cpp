@@ -0,0 +1,49 @@
+#include "../../common/serverinfo_user_container.h"
+#include "../sample_users.h"
+#include "pb/response_list_users.pb.h"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace sample_users;
+
+namespace
+{
+std::vector<ServerInfo_User_Container> manyUsers(int count)
+{
+    std::vector<ServerInfo_User_Container> users;
+    for (int i = 0; i < count; ++i)
+        users.emplace_back(user(i));
+    return users;
+}
+
+/** A user list of range(0) users built the way it was before the registry: copying and stripping every user. */
+void BM_UserListFromStrippedCopies(benchmark::State &state)
+{
+    const std::vector<ServerInfo_User_Container> users = manyUsers(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        Response_ListUsers list;
+        for (const auto &container : users)
+            list.add_user_list()->CopyFrom(strippedCopy(*container.getUserInfo()));
+        benchmark::DoNotOptimize(list.user_list_size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UserListFromStrippedCopies)->Arg(20000)->Unit(benchmark::kMillisecond);
+
+/** The same list built from the shared public records. */
+void BM_UserListFromSharedRecords(benchmark::State &state)
+{
+    const std::vector<ServerInfo_User_Container> users = manyUsers(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        Response_ListUsers list;
+        for (const auto &container : users)
+            container.copyUserInfo(*list.add_user_list(), false);
+        benchmark::DoNotOptimize(list.user_list_size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UserListFromSharedRecords)->Arg(20000)->Unit(benchmark::kMillisecond);
+} // namespace
+
+BENCHMARK_MAIN();
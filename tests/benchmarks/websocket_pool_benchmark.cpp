@@ -0,0 +1,32 @@
+#include "../websocket_echo_server.h"
+
+#include <QCoreApplication>
+#include <benchmark/benchmark.h>
+
+using namespace websocket_load;
+
+namespace
+{
+/** 16 web clients sending 200 messages each, one at a time, to connections spread over range(0) pool threads. */
+void BM_WebsocketPools(benchmark::State &state)
+{
+    const int clientCount = 16;
+    const int messagesPerClient = 200;
+    for (auto _ : state) {
+        if (!exchangeMessages(static_cast<int>(state.range(0)), clientCount, messagesPerClient)) {
+            state.SkipWithError("not all messages were answered");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * clientCount * messagesPerClient);
+}
+BENCHMARK(BM_WebsocketPools)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::benchmark::Initialize(&argc, argv);
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
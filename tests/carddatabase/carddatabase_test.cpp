@@ -1,10 +1,62 @@
+#include "../../cockatrice/src/carddatabasecache.h"
 #include "mocks.h"
 
 #include "gtest/gtest.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <iostream>
 
 namespace
 {
 
+// resident set size of this process in kB, -1 where /proc is not available
+qint64 residentKb()
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly))
+        return -1;
+    for (const QByteArray &line : status.readAll().split('\n'))
+        if (line.startsWith("VmRSS:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    return -1;
+}
+
+// writes a card database shaped like a full import: many sets, printings with attributes, long rules texts
+void writeLargeDatabase(const QString &path, int cardCount, int setCount)
+{
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    QTextStream out(&file);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<cockatrice_carddatabase version=\"4\">\n<sets>\n";
+    for (int s = 0; s < setCount; ++s)
+        out << QString("<set><name>S%1</name><longname>Set number %1</longname><settype>Expansion</settype>"
+                       "<releasedate>2001-01-%2</releasedate></set>\n")
+                   .arg(s)
+                   .arg(s % 28 + 1, 2, 10, QChar('0'));
+    out << "</sets>\n<cards>\n";
+    const QStringList colors = {"W", "U", "B", "R", "G"};
+    for (int c = 0; c < cardCount; ++c) {
+        const QString &color = colors.at(c % colors.size());
+        out << "<card><name>Card " << c << "</name><text>When Card " << c
+            << " enters the battlefield, draw a card. At the beginning of your upkeep, you may pay {" << (c % 7)
+            << "}. If you don't, sacrifice Card " << c << ".</text><prop><colors>" << color
+            << "</colors><manacost>" << (c % 6) << color << "</manacost><cmc>" << (c % 6 + 1)
+            << "</cmc><type>Creature - Elf Druid</type><maintype>Creature</maintype><pt>" << (c % 5) << "/"
+            << (c % 4) << "</pt><layout>normal</layout><side>front</side></prop>";
+        for (int p = 0; p < 1 + c % 3; ++p)
+            out << "<set rarity=\"common\" uuid=\"" << c << "-" << p << "\" num=\"" << c % 300 << "\" muid=\""
+                << c * 3 + p << "\">S" << (c + p * 7) % setCount << "</set>";
+        if (c % 10 == 0)
+            out << "<related count=\"2\">Card " << (c + 1) % cardCount << "</related>";
+        out << "<tablerow>2</tablerow></card>\n";
+    }
+    out << "</cards>\n</cockatrice_carddatabase>\n";
+}
+
 TEST(CardDatabaseTest, LoadXml)
 {
     settingsCache = new SettingsCache;
@@ -30,6 +82,220 @@ TEST(CardDatabaseTest, LoadXml)
     ASSERT_EQ(0, db->getAllMainCardTypes().size()) << "Types not empty after clear";
     ASSERT_EQ(NotLoaded, db->getLoadStatus()) << "Incorrect status after clear";
 }
+
+TEST(CardDatabaseTest, LoadXmlSharesSets)
+{
+    settingsCache = new SettingsCache;
+    CardDatabase *db = new CardDatabase;
+    ASSERT_EQ(Ok, db->loadCardDatabases());
+
+    // the files are parsed separately, yet a set used by several of them must end up as one
+    for (const CardInfoPtr &card : db->getCardList()) {
+        for (const CardInfoPerSet &set : card->getSets()) {
+            CardSetPtr known = db->getSet(set.getPtr()->getShortName());
+            ASSERT_EQ(known, set.getPtr()) << "Card " << card->getName().toStdString() << " not in the shared set";
+            ASSERT_TRUE(known->contains(card)) << "Set does not list " << card->getName().toStdString();
+        }
+    }
+    ASSERT_EQ(3, db->getSetList().size()) << "Wrong sets count after load";
+
+    delete db;
+}
+
+TEST(CardDatabaseTest, CacheMatchesXml)
+{
+    settingsCache = new SettingsCache;
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    CardDatabase *xmlDb = new CardDatabase;
+    xmlDb->setCacheFilePath(dir.filePath("cards.cache"));
+    ASSERT_EQ(Ok, xmlDb->loadCardDatabases());
+    ASSERT_TRUE(QFile::exists(dir.filePath("cards.cache"))) << "Cache not written after a successful load";
+
+    CardDatabase *cachedDb = new CardDatabase;
+    cachedDb->setCacheFilePath(dir.filePath("cards.cache"));
+    ASSERT_EQ(Ok, cachedDb->loadCardDatabases());
+    ASSERT_EQ(xmlDb->getCardList().size(), cachedDb->getCardList().size()) << "Wrong card count from cache";
+    ASSERT_EQ(xmlDb->getSetList().size(), cachedDb->getSetList().size()) << "Wrong sets count from cache";
+    ASSERT_EQ(xmlDb->getAllMainCardTypes().size(), cachedDb->getAllMainCardTypes().size());
+
+    for (const CardInfoPtr &card : xmlDb->getCardList()) {
+        CardInfoPtr cached = cachedDb->getCard(card->getName());
+        ASSERT_TRUE(cached) << "Card missing from cache: " << card->getName().toStdString();
+        ASSERT_EQ(card->getText(), cached->getText());
+        ASSERT_EQ(card->getIsToken(), cached->getIsToken());
+        ASSERT_EQ(card->getTableRow(), cached->getTableRow());
+        ASSERT_EQ(card->getSetsNames(), cached->getSetsNames());
+        ASSERT_EQ(card->getRelatedCards().size(), cached->getRelatedCards().size());
+        ASSERT_EQ(card->getReverseRelatedCards2Me().size(), cached->getReverseRelatedCards2Me().size());
+        for (const QString &property : card->getProperties())
+            ASSERT_EQ(card->getProperty(property), cached->getProperty(property));
+        for (const CardInfoPerSet &set : card->getSets())
+            for (const QString &property : set.getProperties())
+                ASSERT_EQ(set.getProperty(property),
+                          cached->getSetProperty(set.getPtr()->getShortName(), property));
+    }
+
+    delete cachedDb;
+    delete xmlDb;
+}
+
+TEST(CardDatabaseTest, CacheDetectsChangedSources)
+{
+    settingsCache = new SettingsCache;
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString source = dir.filePath("cards.xml");
+    ASSERT_TRUE(QFile::copy(QString("%1/cards.xml").arg(CARDDB_DATADIR), source));
+    const QStringList sources = {source};
+
+    CardDatabase *db = new CardDatabase;
+    ASSERT_EQ(Ok, db->loadFromFile(source));
+    CardDatabaseCache cache(dir.filePath("cards.cache"));
+    ASSERT_TRUE(cache.save(CardDatabaseCache::inspectSources(sources), db->getSetList(), db->getCardList()));
+
+    QList<CardSetPtr> sets;
+    QList<CardInfoPtr> cards;
+    ASSERT_TRUE(cache.load(sources, sets, cards)) << "Fresh cache rejected";
+    ASSERT_EQ(db->getCardList().size(), cards.size());
+    ASSERT_FALSE(cache.load(QStringList() << source << source, sets, cards)) << "Cache used for other sources";
+
+    // same content with another modification time is still good
+    QFile file(source);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    const QByteArray content = file.readAll();
+    file.setFileTime(QDateTime::currentDateTime().addDays(-1), QFileDevice::FileModificationTime);
+    file.close();
+    ASSERT_TRUE(cache.load(sources, sets, cards)) << "Cache rejected after a touch";
+
+    // same size, different content
+    QByteArray changed = content;
+    changed.replace("Meow!", "Purr!");
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(changed);
+    file.setFileTime(QDateTime::currentDateTime().addDays(-2), QFileDevice::FileModificationTime);
+    file.close();
+    ASSERT_FALSE(cache.load(sources, sets, cards)) << "Cache used after the source changed";
+    ASSERT_TRUE(sets.isEmpty() && cards.isEmpty());
+
+    // damaged cache
+    QFile cacheFile(cache.getFileName());
+    ASSERT_TRUE(cacheFile.open(QIODevice::ReadWrite));
+    cacheFile.resize(cacheFile.size() / 2);
+    cacheFile.close();
+    ASSERT_FALSE(cache.load(sources, sets, cards)) << "Truncated cache accepted";
+
+    delete db;
+}
+
+TEST(CardDatabaseTest, CacheStartupBenchmark)
+{
+    settingsCache = new SettingsCache;
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString source = dir.filePath("cards.xml");
+    writeLargeDatabase(source, 30000, 400);
+    const QStringList sources = {source};
+    CardDatabaseCache cache(dir.filePath("cards.cache"));
+
+    // cold start: parse the xml, then write the cache like loadCardDatabases does
+    qint64 rssBefore = residentKb();
+    QElapsedTimer timer;
+    timer.start();
+    auto *coldDb = new CardDatabase;
+    const QList<CardDatabaseCache::SourceFile> sourceFiles = CardDatabaseCache::inspectSources(sources);
+    ASSERT_EQ(Ok, coldDb->loadFromFile(source));
+    const qint64 parseMs = timer.elapsed();
+    ASSERT_TRUE(cache.save(sourceFiles, coldDb->getSetList(), coldDb->getCardList()));
+    const qint64 coldMs = timer.elapsed();
+    const qint64 coldRss = residentKb() - rssBefore;
+    const int cardCount = coldDb->getCardList().size();
+    delete coldDb;
+
+    // warm start: validate and map the cache
+    rssBefore = residentKb();
+    timer.restart();
+    auto *warmDb = new CardDatabase;
+    QList<CardSetPtr> sets;
+    QList<CardInfoPtr> cards;
+    ASSERT_TRUE(cache.load(sources, sets, cards));
+    for (const CardSetPtr &set : sets)
+        warmDb->addSet(set);
+    for (const CardInfoPtr &card : cards)
+        warmDb->addCard(card);
+    const qint64 warmMs = timer.elapsed();
+    const qint64 warmRss = residentKb() - rssBefore;
+    ASSERT_EQ(cardCount, warmDb->getCardList().size());
+
+    std::cout << "[ BENCH    ] " << cardCount << " cards, xml " << QFileInfo(source).size() / 1024 << " kB, cache "
+              << QFileInfo(cache.getFileName()).size() / 1024 << " kB" << std::endl;
+    std::cout << "[ BENCH    ] cold start " << coldMs << " ms (parse " << parseMs << " ms), resident +" << coldRss
+              << " kB" << std::endl;
+    std::cout << "[ BENCH    ] warm start " << warmMs << " ms, resident +" << warmRss << " kB" << std::endl;
+
+    sets.clear();
+    cards.clear();
+    delete warmDb;
+}
+
+TEST(CardDatabaseTest, PropertyStorageMemoryReport)
+{
+    settingsCache = new SettingsCache;
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString source = dir.filePath("cards.xml");
+    writeLargeDatabase(source, 30000, 400);
+
+    auto *db = new CardDatabase;
+    ASSERT_EQ(Ok, db->loadFromFile(source));
+    const QList<CardInfoPtr> cards = db->getCardList();
+
+    // the same properties the way they used to be kept: a QVariantHash per card and printing, with a fresh copy of
+    // every key and value
+    auto deepCopy = [](const QString &string) { return QString(string.constData(), string.size()); };
+    qint64 rssBefore = residentKb();
+    QVector<QVariantHash> hashes;
+    int propertyCount = 0;
+    for (const CardInfoPtr &card : cards) {
+        QVariantHash cardProperties;
+        for (const QString &key : card->getProperties())
+            cardProperties.insert(deepCopy(key), deepCopy(card->getProperty(key)));
+        propertyCount += cardProperties.size();
+        hashes << cardProperties;
+        for (const CardInfoPerSet &set : card->getSets()) {
+            QVariantHash setProperties;
+            for (const QString &key : set.getProperties())
+                setProperties.insert(deepCopy(key), deepCopy(set.getProperty(key)));
+            propertyCount += setProperties.size();
+            hashes << setProperties;
+        }
+    }
+    const qint64 hashRss = residentKb() - rssBefore;
+
+    // and again in the compact form, also from fresh copies of the values
+    rssBefore = residentKb();
+    QVector<CardProperties> compact;
+    for (const QVariantHash &properties : hashes) {
+        CardProperties cardProperties;
+        for (auto it = properties.constBegin(); it != properties.constEnd(); ++it)
+            cardProperties.insert(it.key(), deepCopy(it.value().toString()));
+        compact << cardProperties;
+    }
+    const qint64 compactRss = residentKb() - rssBefore;
+
+    for (int i = 0; i < 100; ++i)
+        for (auto it = hashes.at(i).constBegin(); it != hashes.at(i).constEnd(); ++it)
+            ASSERT_EQ(it.value().toString(), compact.at(i).value(it.key()));
+
+    std::cout << "[ BENCH    ] " << cards.size() << " cards, " << hashes.size() << " property maps, " << propertyCount
+              << " properties, " << CardProperties::internedKeyCount() << " names, "
+              << CardProperties::internedValueCount() << " interned values" << std::endl;
+    std::cout << "[ BENCH    ] QVariantHash per card: resident +" << hashRss << " kB" << std::endl;
+    std::cout << "[ BENCH    ] CardProperties: resident +" << compactRss << " kB" << std::endl;
+
+    delete db;
+}
 } // namespace
 
 int main(int argc, char **argv)
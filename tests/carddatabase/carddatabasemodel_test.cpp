@@ -0,0 +1,149 @@
+#include "../../cockatrice/src/carddatabasemodel.h"
+#include "mocks.h"
+
+#include "gtest/gtest.h"
+#include <QCollator>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+
+// shows all rows at once instead of fetching them in batches like the views do
+class FullDisplayModel : public CardDatabaseDisplayModel
+{
+public:
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return QSortFilterProxyModel::rowCount(parent);
+    }
+};
+
+const QStringList powToughs = {"3/3", "10/2", "*/*", "2/1+*", "1/1", "0/10"};
+
+void addCards(CardDatabase *db, int cardCount)
+{
+    const QStringList names = {"Æther Card", "aether Card", "Zombie Card", "éclair Card", "Elf Card", "angel Card"};
+    const QStringList colors = {"W", "U", "B", "R", "G"};
+    CardSetPtr set = CardSet::newInstance("S0");
+    for (int c = 0; c < cardCount; ++c) {
+        QVariantHash properties{{"colors", colors.at(c % colors.size())},
+                                {"type", c % 4 == 0 ? "Instant" : "Creature - Elf Druid"},
+                                {"cmc", QString::number(c % 7)},
+                                {"manacost", QString("%1%2").arg(c % 7).arg(colors.at(c % colors.size()))},
+                                {"pt", powToughs.at(c % powToughs.size())}};
+        CardInfoPtr card = CardInfo::newInstance(QString("%1 %2").arg(names.at(c % names.size())).arg(c),
+                                                 QString(), false, properties);
+        card->addToSet(set, CardInfoPerSet(set));
+        db->addCard(card);
+    }
+}
+
+QString sortData(const QAbstractItemModel &model, int row, int column)
+{
+    return model.data(model.index(row, column), CardDatabaseModel::SortRole).toString();
+}
+
+void expectSortKeysMatchRows(const CardDatabaseModel &model, int column)
+{
+    const CardDatabaseModel::SortColumn &keys = model.getSortColumn(column);
+    ASSERT_EQ(model.rowCount(), keys.values.size());
+    ASSERT_EQ(static_cast<size_t>(model.rowCount()), keys.collated.size());
+    for (int row = 0; row < model.rowCount(); ++row)
+        ASSERT_EQ(sortData(model, row, column), keys.values.at(row)) << "Stale sort key in row " << row;
+}
+
+TEST(CardDatabaseModelTest, SortsByCollation)
+{
+    CardDatabase db;
+    CardDatabaseModel model(&db, false);
+    addCards(&db, 500);
+    FullDisplayModel display;
+    display.setSourceModel(&model);
+
+    QCollator collator;
+    for (int column : {CardDatabaseModel::NameColumn, CardDatabaseModel::ManaCostColumn,
+                       CardDatabaseModel::CardTypeColumn}) {
+        display.sort(column);
+        ASSERT_EQ(500, display.rowCount());
+        for (int row = 1; row < display.rowCount(); ++row)
+            ASSERT_LE(collator.compare(sortData(display, row - 1, column), sortData(display, row, column)), 0)
+                << "Column " << column << " out of order at row " << row;
+    }
+
+    // numeric by power then toughness, the ones that do not start with a number last
+    display.sort(CardDatabaseModel::PTColumn);
+    QStringList order;
+    for (int row = 0; row < display.rowCount(); ++row)
+        if (order.isEmpty() || order.last() != sortData(display, row, CardDatabaseModel::PTColumn))
+            order.append(sortData(display, row, CardDatabaseModel::PTColumn));
+    ASSERT_EQ(QStringList({"0/10", "1/1", "2/1+*", "3/3", "10/2", "*/*"}), order);
+}
+
+TEST(CardDatabaseModelTest, SortKeysFollowRowChanges)
+{
+    CardDatabase db;
+    CardDatabaseModel model(&db, false);
+    addCards(&db, 50);
+    FullDisplayModel display;
+    display.setSourceModel(&model);
+    display.sort(CardDatabaseModel::NameColumn);
+    expectSortKeysMatchRows(model, CardDatabaseModel::NameColumn);
+
+    CardInfoPtr first = CardInfo::newInstance("AAA first");
+    CardSetPtr set = CardSet::newInstance("S1");
+    first->addToSet(set, CardInfoPerSet(set));
+    db.addCard(first);
+    expectSortKeysMatchRows(model, CardDatabaseModel::NameColumn);
+    ASSERT_EQ(QString("AAA first"), sortData(display, 0, CardDatabaseModel::NameColumn)) << "New card not sorted in";
+
+    db.removeCard(model.getCard(10));
+    expectSortKeysMatchRows(model, CardDatabaseModel::NameColumn);
+    ASSERT_EQ(50, display.rowCount());
+}
+
+TEST(CardDatabaseModelTest, ResortBenchmark)
+{
+    CardDatabase db;
+    CardDatabaseModel model(&db, false);
+    addCards(&db, 30000);
+    FullDisplayModel display;
+    display.setSourceModel(&model);
+    QElapsedTimer timer;
+
+    // what every comparison used to do: fetch both SortRole variants, convert and compare them
+    QVector<int> rows(model.rowCount());
+    std::iota(rows.begin(), rows.end(), 0);
+    timer.start();
+    std::sort(rows.begin(), rows.end(), [&](int left, int right) {
+        return QString::localeAwareCompare(sortData(model, left, CardDatabaseModel::NameColumn),
+                                           sortData(model, right, CardDatabaseModel::NameColumn)) < 0;
+    });
+    const qint64 uncachedMs = timer.elapsed();
+
+    std::cout << "[ BENCH    ] " << model.rowCount() << " cards, by name without sort keys " << uncachedMs << " ms"
+              << std::endl;
+    for (int column : {CardDatabaseModel::NameColumn, CardDatabaseModel::ManaCostColumn,
+                       CardDatabaseModel::PTColumn}) {
+        timer.restart();
+        display.sort(column);
+        const qint64 firstMs = timer.elapsed();
+        timer.restart();
+        display.sort(column, Qt::DescendingOrder);
+        const qint64 resortMs = timer.elapsed();
+        std::cout << "[ BENCH    ] column " << column << ": first sort " << firstMs
+                  << " ms including sort keys, re-sort " << resortMs << " ms" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    settingsCache = new SettingsCache;
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
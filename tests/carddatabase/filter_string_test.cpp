@@ -2,6 +2,8 @@
 #include "mocks.h"
 
 #include "gtest/gtest.h"
+#include <QElapsedTimer>
+#include <iostream>
 
 CardDatabase *db;
 
@@ -54,6 +56,122 @@ QUERY(Color2, cat, "c:gw", true)
 QUERY(Color3, cat, "c!g", true)
 QUERY(Color4, cat, "c!gw", false)
 
+// cards shaped like a full import: a few types and colors shared by many cards, up to three printings each
+QList<CardInfoPtr> makeLargeCardList(int cardCount, int setCount)
+{
+    QList<CardSetPtr> sets;
+    for (int s = 0; s < setCount; ++s)
+        sets.append(CardSet::newInstance(QString("S%1").arg(s)));
+
+    const QStringList colors = {"W", "U", "B", "R", "G"};
+    QList<CardInfoPtr> cards;
+    for (int c = 0; c < cardCount; ++c) {
+        QVariantHash properties{{"colors", colors.at(c % colors.size())},
+                                {"type", c % 4 == 0 ? "Instant" : "Creature - Elf Druid"},
+                                {"cmc", QString::number(c % 6 + 1)},
+                                {"pt", QString("%1/%2").arg(c % 5).arg(c % 4)}};
+        CardInfoPtr card = CardInfo::newInstance(
+            QString("Card %1").arg(c), QString("When Card %1 enters the battlefield, draw a card.").arg(c), false,
+            properties);
+        for (int p = 0; p < 1 + c % 3; ++p) {
+            const CardSetPtr &set = sets.at((c + p * 7) % setCount);
+            CardInfoPerSet printing(set);
+            printing.setProperty("rarity", p == 0 ? "common" : "rare");
+            card->addToSet(set, printing);
+        }
+        cards.append(card);
+    }
+    return cards;
+}
+
+TEST(FilterProgramTest, MatchAgreesWithCheck)
+{
+    const QList<CardInfoPtr> cards = db->getCardList();
+    CardColumns columns(cards);
+    for (const QString &query : QStringList{"", "t:creature", "not t:creature", "c:g", "c!gw", "ci:g", "cmc>1",
+                                            "e:CAT", "r:common", "pow>1 or tou<2", "(t:creature or t:sorcery) -c:w",
+                                            "pt:\"3/3\"", "f:modern", "o:draw", "o:\"ThE bAt\"", "a",
+                                            "cat", "xyzzy"}) {
+        FilterString filter(query);
+        const QVector<char> matches = filter.match(columns);
+        ASSERT_EQ(cards.size(), matches.size()) << query.toStdString();
+        for (int row = 0; row < cards.size(); ++row)
+            ASSERT_EQ(filter.check(cards.at(row)), matches.at(row) != 0)
+                << query.toStdString() << " on " << cards.at(row)->getName().toStdString();
+    }
+}
+
+TEST(FilterProgramTest, TrigramCandidates)
+{
+    CardColumns columns(makeLargeCardList(2000, 40));
+    const FilterColumn names(FilterColumn::Name);
+    const QStringList &values = columns.column(names).values;
+
+    for (const QString &substring : QStringList{"card 12", "ARD 1", "d 19", "ca", "zzz"}) {
+        const QVector<int> candidates = columns.candidates(names, substring);
+        for (int id = 0; id < values.size(); ++id)
+            if (values.at(id).contains(substring, Qt::CaseInsensitive))
+                ASSERT_TRUE(candidates.contains(id)) << substring.toStdString() << " misses " << id;
+        if (substring.size() < 3)
+            ASSERT_EQ(values.size(), candidates.size()) << "Short substrings must not narrow down";
+    }
+    ASSERT_LT(columns.candidates(names, "card 12").size(), values.size() / 10) << "Index does not narrow down";
+    ASSERT_TRUE(columns.candidates(names, "zzz").isEmpty());
+}
+
+TEST(FilterProgramTest, QueryBenchmark)
+{
+    const QList<CardInfoPtr> cards = makeLargeCardList(30000, 400);
+    const QStringList queries = {"t:creature",   "c:g cmc>2", "(pow>=2 or tou<1) -t:instant",
+                                 "e:S17 r:rare", "o:draw",    "card 12",
+                                 "o:\"card 2999 enters\""};
+    const int rounds = 5;
+    QElapsedTimer timer;
+
+    // the first search extracts the columns
+    CardColumns columns(cards);
+    timer.start();
+    for (const QString &query : queries)
+        FilterString(query).match(columns);
+    const qint64 extractMs = timer.elapsed();
+
+    int compiledAccepted = 0;
+    timer.restart();
+    for (int round = 0; round < rounds; ++round)
+        for (const QString &query : queries)
+            compiledAccepted += FilterString(query).match(columns).count(char(1));
+    const qint64 compiledMs = timer.elapsed();
+
+    int checkedAccepted = 0;
+    timer.restart();
+    for (int round = 0; round < rounds; ++round) {
+        for (const QString &query : queries) {
+            FilterString filter(query);
+            for (const CardInfoPtr &card : cards)
+                if (filter.check(card))
+                    ++checkedAccepted;
+        }
+    }
+    const qint64 checkedMs = timer.elapsed();
+    ASSERT_EQ(checkedAccepted, compiledAccepted) << "Compiled and per card results differ";
+
+    const int queryCount = rounds * queries.size();
+    std::cout << "[ BENCH    ] " << cards.size() << " cards, first searches " << extractMs
+              << " ms including column extraction" << std::endl;
+    std::cout << "[ BENCH    ] compiled: " << queryCount * 1000.0 / qMax<qint64>(1, compiledMs) << " queries/s"
+              << std::endl;
+    std::cout << "[ BENCH    ] per card: " << queryCount * 1000.0 / qMax<qint64>(1, checkedMs) << " queries/s"
+              << std::endl;
+
+    // typing a name, one search per keystroke, like the deck editor search box without a filter string
+    const QString typed = "card 2999";
+    timer.restart();
+    for (int length = 1; length <= typed.size(); ++length)
+        FilterProgram::substringLeaf(FilterColumn(FilterColumn::Name), typed.left(length)).match(columns);
+    std::cout << "[ BENCH    ] name search as typed: " << timer.nsecsElapsed() / 1000 / typed.size()
+              << " us per keystroke" << std::endl;
+}
+
 } // namespace
 
 int main(int argc, char **argv)
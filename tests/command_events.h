@@ -0,0 +1,100 @@
+#ifndef COMMAND_EVENTS_H
+#define COMMAND_EVENTS_H
+
+/** The game events of typical commands, shared by game_event_arena_test and the game event arena benchmark. */
+
+#include "../common/server_response_containers.h"
+#include "pb/context_move_card.pb.h"
+#include "pb/event_draw_cards.pb.h"
+#include "pb/event_move_card.pb.h"
+#include "pb/event_set_card_attr.pb.h"
+
+#include <cstddef>
+
+namespace command_events
+{
+const char *const cardNames[] = {"Island", "Swamp", "Forest", "Mountain", "Plains", "Lightning Bolt", "Counterspell",
+                                 "Llanowar Elves", "Dark Ritual", "Swords to Plowshares", "Brainstorm", "Giant Growth"};
+
+// what one turn step of a typical game queues: a card drawn, a card played and tapped
+inline void enqueueCommandEvents(GameEventStorage &ges, int step)
+{
+    const int playerId = step % 2;
+
+    Event_DrawCards drawOthers;
+    drawOthers.set_number(1);
+    Event_DrawCards drawPrivate(drawOthers);
+    ServerInfo_Card *card = drawPrivate.add_cards();
+    card->set_id(step);
+    card->set_name(cardNames[step % 12]);
+    ges.enqueueGameEvent(drawPrivate, playerId, GameEventStorageItem::SendToPrivate, playerId);
+    ges.enqueueGameEvent(drawOthers, playerId, GameEventStorageItem::SendToOthers);
+
+    Event_MoveCard move;
+    move.set_card_id(step);
+    move.set_card_name(cardNames[step % 12]);
+    move.set_start_player_id(playerId);
+    move.set_start_zone("hand");
+    move.set_target_player_id(playerId);
+    move.set_target_zone("table");
+    move.set_x(step % 10);
+    move.set_y(0);
+    ges.enqueueGameEvent(move, playerId);
+
+    Event_SetCardAttr tap;
+    tap.set_zone_name("table");
+    tap.set_card_id(step);
+    tap.set_attribute(AttrTapped);
+    tap.set_attr_value("1");
+    ges.enqueueGameEvent(tap, playerId);
+    ges.setGameEventContext(Context_MoveCard());
+}
+
+/**
+ * Sends the events of one command to the player and othersRecipients others with every message on the heap and a
+ * copy of the container per recipient, as before the arenas. Returns the bytes sent.
+ */
+inline size_t sendCommandOnHeap(int step, int othersRecipients)
+{
+    ResponseContainer rc(step);
+    GameEventStorage ges;
+    enqueueCommandEvents(ges, step);
+    GameEventContainer *contPrivate, *contOthers;
+    int privateId;
+    ges.takeGameEventContainers(contPrivate, contOthers, privateId);
+    size_t bytes = 0;
+    for (int recipient = 0; recipient <= othersRecipients; ++recipient) {
+        ServerMessage message;
+        message.set_message_type(ServerMessage::GAME_EVENT_CONTAINER);
+        message.mutable_game_event_container()->CopyFrom(recipient == 0 ? *contPrivate : *contOthers);
+        bytes += message.SerializeAsString().size();
+    }
+    delete contPrivate;
+    delete contOthers;
+    return bytes;
+}
+
+/** The same with one arena per command container and one message shared by all recipients. */
+inline size_t sendCommandOnArena(int step, int othersRecipients)
+{
+    CommandArena arena;
+    ResponseContainer rc(step, arena.get());
+    GameEventStorage ges(rc.getArena());
+    enqueueCommandEvents(ges, step);
+    GameEventContainer *containers[2];
+    int privateId;
+    ges.takeGameEventContainers(containers[0], containers[1], privateId);
+    size_t bytes = 0;
+    for (GameEventContainer *cont : containers) {
+        ServerMessage *message = rc.createItem<ServerMessage>();
+        message->set_message_type(ServerMessage::GAME_EVENT_CONTAINER);
+        message->set_allocated_game_event_container(cont);
+        const int recipients = cont == containers[0] ? 1 : othersRecipients;
+        for (int recipient = 0; recipient < recipients; ++recipient)
+            bytes += message->SerializeAsString().size();
+    }
+    return bytes;
+}
+} // namespace command_events
+
+#endif
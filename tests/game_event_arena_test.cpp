@@ -0,0 +1,82 @@
+#include "../common/rng_abstract.h"
+#include "command_events.h"
+
+#include "gtest/gtest.h"
+
+// GameEventStorage::sendToGame links in the game logic, which draws from the global generator; no game is run here
+RNG_Abstract *rng;
+
+using namespace command_events;
+
+namespace
+{
+TEST(GameEventArenaTest, EventsAreSplitByRecipient)
+{
+    for (bool withArena : {false, true}) {
+        CommandArena arena;
+        GameEventStorage ges(withArena ? arena.get() : nullptr);
+        enqueueCommandEvents(ges, 3);
+
+        GameEventContainer *contPrivate, *contOthers;
+        int privateId = -1;
+        ASSERT_TRUE(ges.takeGameEventContainers(contPrivate, contOthers, privateId));
+        ASSERT_EQ(privateId, 1);
+        ASSERT_EQ(contPrivate->event_list_size(), 3);
+        ASSERT_EQ(contOthers->event_list_size(), 3);
+        ASSERT_EQ(contPrivate->event_list(0).GetExtension(Event_DrawCards::ext).cards_size(), 1);
+        ASSERT_EQ(contOthers->event_list(0).GetExtension(Event_DrawCards::ext).cards_size(), 0);
+        ASSERT_EQ(contPrivate->event_list(1).SerializeAsString(), contOthers->event_list(1).SerializeAsString());
+        ASSERT_TRUE(contPrivate->has_context());
+        ASSERT_TRUE(contOthers->has_context());
+        ASSERT_EQ(contPrivate->GetArena(), withArena ? arena.get() : nullptr);
+
+        GameEventContainer *unused;
+        ASSERT_FALSE(ges.takeGameEventContainers(unused, unused, privateId)) << "The storage is empty afterwards";
+        if (!withArena) {
+            delete contPrivate;
+            delete contOthers;
+        }
+    }
+}
+
+TEST(GameEventArenaTest, NestedArenasDoNotShareTheThreadBlock)
+{
+    CommandArena outer;
+    ServerMessage *first = ::google::protobuf::Arena::CreateMessage<ServerMessage>(outer.get());
+    first->mutable_response()->set_cmd_id(1);
+    {
+        CommandArena inner;
+        ServerMessage *second = ::google::protobuf::Arena::CreateMessage<ServerMessage>(inner.get());
+        second->mutable_response()->set_cmd_id(2);
+    }
+    ASSERT_EQ(first->response().cmd_id(), 1u);
+}
+
+TEST(GameEventArenaTest, HeapItemsAreOwnedByTheResponseContainer)
+{
+    CommandArena arena;
+    ResponseContainer rc(1, arena.get());
+    rc.enqueuePostResponseItem(ServerMessage::SESSION_EVENT, new SessionEvent);
+    rc.enqueuePostResponseItem(ServerMessage::SESSION_EVENT, rc.createItem<SessionEvent>());
+    ASSERT_EQ(rc.getPostResponseQueue()[0].second->GetArena(), nullptr);
+    ASSERT_EQ(rc.getPostResponseQueue()[1].second->GetArena(), arena.get());
+}
+
+TEST(GameEventArenaTest, ArenaStreamSendsTheSameBytes)
+{
+    // two players and two spectators
+    const int othersRecipients = 3;
+    size_t heapBytes = 0, arenaBytes = 0;
+    for (int step = 0; step < 100; ++step) {
+        heapBytes += sendCommandOnHeap(step, othersRecipients);
+        arenaBytes += sendCommandOnArena(step, othersRecipients);
+    }
+    ASSERT_EQ(arenaBytes, heapBytes);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,166 @@
+#include "../common/stream_compression.h"
+#include "../servatrice/src/isl_message_batch.h"
+#include "isl_traffic.h"
+
+#include "gtest/gtest.h"
+
+using namespace isl_traffic;
+
+namespace
+{
+/** Splits a stream of frames back into messages, as IslInterface::readClient does. */
+bool readFrames(const QByteArray &stream, StreamDecompressor *decompressor, QList<IslMessage> &result)
+{
+    int position = 0;
+    while (position < stream.size()) {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(stream.constData() + position);
+        const quint32 header = (static_cast<quint32>(bytes[0]) << 24) | (static_cast<quint32>(bytes[1]) << 16) |
+                               (static_cast<quint32>(bytes[2]) << 8) | static_cast<quint32>(bytes[3]);
+        const int length = static_cast<int>(header & IslFrameSizeMask);
+        position += 4;
+        if (!IslMessageBatch::readFrame(header, stream.constData() + position, length, decompressor, result))
+            return false;
+        position += length;
+    }
+    return true;
+}
+
+TEST(IslBatchTest, NewerGameUpdatesReplaceOlderOnes)
+{
+    IslMessageBatch batch;
+    batch.append(gameUpdate(10, 1));
+    batch.append(say(0));
+    batch.append(gameUpdate(11, 1));
+    batch.append(gameUpdate(10, 2));
+    batch.append(gameUpdate(10, 3));
+
+    ASSERT_EQ(batch.getMessages().size(), 3);
+    ASSERT_EQ(batch.takeCoalescedCount(), 2);
+    ASSERT_EQ(batch.takeCoalescedCount(), 0);
+    const IslMessage &first = batch.getMessages().first();
+    const Event_ListGames &event = first.room_event().GetExtension(Event_ListGames::ext);
+    ASSERT_EQ(event.game_list(0).game_id(), 10);
+    ASSERT_EQ(event.game_list(0).player_count(), 3) << "The latest state is kept, in the place of the first one";
+    ASSERT_TRUE(batch.getMessages()[1].room_event().HasExtension(Event_RoomSay::ext));
+}
+
+TEST(IslBatchTest, UpdatesForOneSessionAreKept)
+{
+    IslMessageBatch batch;
+    IslMessage answer = gameUpdate(10, 1);
+    answer.set_session_id(5);
+    batch.append(answer);
+    batch.append(answer);
+    ASSERT_EQ(batch.getMessages().size(), 2);
+}
+
+TEST(IslBatchTest, SingleMessagesUseThePlainFrame)
+{
+    IslMessageBatch batch;
+    const IslMessage message = say(1);
+    batch.append(message);
+    QByteArray frame;
+    bool failed;
+    ASSERT_EQ(batch.writeFrames(frame, nullptr, true, failed), 1);
+    ASSERT_FALSE(failed);
+    ASSERT_TRUE(batch.isEmpty());
+
+    QByteArray plain;
+    IslMessageBatch::appendMessage(plain, message);
+    ASSERT_EQ(frame, plain) << "Peers without batching must still understand a single message";
+}
+
+TEST(IslBatchTest, PeersWithoutBatchingGetPlainFrames)
+{
+    IslMessageBatch batch;
+    QByteArray plain;
+    for (int i = 0; i < 3; ++i) {
+        batch.append(say(i));
+        IslMessageBatch::appendMessage(plain, say(i));
+    }
+    QByteArray frames;
+    bool failed;
+    ASSERT_EQ(batch.writeFrames(frames, nullptr, false, failed), 3);
+    ASSERT_EQ(frames, plain) << "Older servers read the batch flag as part of the frame length";
+}
+
+TEST(IslBatchTest, BatchesSurviveTheRoundTrip)
+{
+    for (bool compressed : {false, true}) {
+        if (compressed && !StreamCompressor::isAvailable())
+            continue;
+        StreamCompressor compressor;
+        StreamDecompressor decompressor;
+        QByteArray stream;
+        QList<IslMessage> sent;
+        for (int frame = 0; frame < 20; ++frame) {
+            IslMessageBatch batch;
+            for (int i = 0; i < frame % 5 + 1; ++i) {
+                sent.append(say(frame * 5 + i));
+                batch.append(sent.last());
+            }
+            bool failed;
+            batch.writeFrames(stream, compressed ? &compressor : nullptr, frame % 2 == 0, failed);
+            ASSERT_FALSE(failed);
+        }
+
+        QList<IslMessage> received;
+        ASSERT_TRUE(readFrames(stream, &decompressor, received));
+        ASSERT_EQ(received.size(), sent.size());
+        for (int i = 0; i < sent.size(); ++i)
+            ASSERT_EQ(received[i].SerializeAsString(), sent[i].SerializeAsString());
+    }
+}
+
+TEST(IslBatchTest, TruncatedBatchesAreRejected)
+{
+    IslMessageBatch batch;
+    batch.append(say(1));
+    batch.append(say(2));
+    QByteArray frame;
+    bool failed;
+    batch.writeFrames(frame, nullptr, true, failed);
+    frame.chop(3);
+
+    QList<IslMessage> received;
+    const quint32 header = IslBatchFrameFlag | static_cast<quint32>(frame.size() - 4);
+    ASSERT_FALSE(IslMessageBatch::readFrame(header, frame.constData() + 4, frame.size() - 4, nullptr, received));
+}
+
+TEST(IslBatchTest, BatchingSavesBytes)
+{
+    const QList<IslMessage> traffic = busyRoomTraffic();
+    // one batch every 20ms
+    const int messagesPerBatch = static_cast<int>(traffic.size()) / 50;
+
+    QByteArray single;
+    for (const IslMessage &message : traffic) {
+        IslMessageBatch batch;
+        batch.append(message);
+        bool failed;
+        batch.writeFrames(single, nullptr, true, failed);
+    }
+
+    for (bool compressed : {false, true}) {
+        if (compressed && !StreamCompressor::isAvailable())
+            continue;
+        StreamCompressor compressor;
+        QByteArray batched;
+        IslMessageBatch batch;
+        for (int i = 0; i < traffic.size(); ++i) {
+            batch.append(traffic[i]);
+            if ((i + 1) % messagesPerBatch == 0 || i + 1 == traffic.size()) {
+                bool failed;
+                batch.writeFrames(batched, compressed ? &compressor : nullptr, true, failed);
+            }
+        }
+        ASSERT_LT(batched.size(), single.size()) << (compressed ? "compressed" : "uncompressed");
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,68 @@
+#ifndef ISL_TRAFFIC_H
+#define ISL_TRAFFIC_H
+
+/** Sample messages between servers, shared by isl_batch_test and the ISL batch benchmark. */
+
+#include "pb/event_join_room.pb.h"
+#include "pb/event_list_games.pb.h"
+#include "pb/event_room_say.pb.h"
+#include "pb/isl_message.pb.h"
+#include "pb/room_event.pb.h"
+
+#include <QList>
+#include <string>
+
+namespace isl_traffic
+{
+inline IslMessage roomEvent(const ::google::protobuf::Message &event)
+{
+    IslMessage message;
+    message.set_message_type(IslMessage::ROOM_EVENT);
+    RoomEvent *roomEvent = message.mutable_room_event();
+    roomEvent->set_room_id(1);
+    roomEvent->GetReflection()
+        ->MutableMessage(roomEvent, event.GetDescriptor()->FindExtensionByName("ext"))
+        ->CopyFrom(event);
+    return message;
+}
+
+inline IslMessage gameUpdate(int gameId, int playerCount)
+{
+    Event_ListGames event;
+    ServerInfo_Game *game = event.add_game_list();
+    game->set_room_id(1);
+    game->set_game_id(gameId);
+    game->set_description("Commander 4 players");
+    game->set_max_players(4);
+    game->set_player_count(playerCount);
+    game->mutable_creator_info()->set_name("TokenCollector");
+    return roomEvent(event);
+}
+
+inline IslMessage say(int i)
+{
+    Event_RoomSay event;
+    event.set_name("counterspell" + std::to_string(i % 7));
+    event.set_message(i % 3 ? "anyone up for a game of modern?" : "gg wp");
+    return roomEvent(event);
+}
+
+// a busy room's traffic to one peer over one second: chat, joins and game list updates for forty games
+inline QList<IslMessage> busyRoomTraffic()
+{
+    QList<IslMessage> traffic;
+    for (int i = 0; i < 2000; ++i) {
+        if (i % 4 == 0)
+            traffic.append(gameUpdate(100 + i % 40, 1 + i % 3));
+        else if (i % 25 == 1) {
+            Event_JoinRoom event;
+            event.mutable_user_info()->set_name("limited_larry" + std::to_string(i));
+            traffic.append(roomEvent(event));
+        } else
+            traffic.append(say(i));
+    }
+    return traffic;
+}
+} // namespace isl_traffic
+
+#endif
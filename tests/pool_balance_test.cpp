@@ -0,0 +1,136 @@
+#include "../servatrice/src/servatrice_pool_load.h"
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+TEST(PoolBalanceTest, EmptyListHasNoPool)
+{
+    std::vector<ServatricePoolLoad> loads;
+    ASSERT_EQ(findLeastLoadedPool(loads), -1);
+}
+
+TEST(PoolBalanceTest, BusyPoolIsAvoided)
+{
+    std::vector<ServatricePoolLoad> loads(2);
+    loads[0].clients = 10;
+    loads[0].commandsPerSecond = 40;
+    loads[1].clients = 20;
+    loads[1].commandsPerSecond = 4;
+    ASSERT_EQ(findLeastLoadedPool(loads), 1) << "Twenty idle clients cost less than ten playing ones";
+
+    loads[1].eventLoopLagMsecs = 50;
+    ASSERT_EQ(findLeastLoadedPool(loads), 0) << "A lagging event loop outweighs the command rate";
+}
+
+TEST(PoolBalanceTest, TiesGoToFewerClients)
+{
+    std::vector<ServatricePoolLoad> loads(3);
+    loads[0].clients = 5;
+    loads[0].commandsPerSecond = 0;
+    loads[1].clients = 0;
+    loads[1].commandsPerSecond = 1;
+    loads[2].clients = 0;
+    loads[2].commandsPerSecond = 1;
+    ASSERT_EQ(loads[0].score(), loads[1].score());
+    ASSERT_EQ(findLeastLoadedPool(loads), 1);
+}
+
+/**
+ * Simulation: clients join, idle in the lobby, start and leave games and disconnect. Clients in a game send
+ * commands far more often than idle ones, so pools that got the same number of clients can do very different amounts
+ * of work. Both strategies see the same sequence of clients; the result is the average ratio of the busiest pool's
+ * work to the mean work of all pools (1.0 is a perfect balance).
+ */
+struct SimulatedClient
+{
+    int pool;
+    bool inGame;
+};
+
+double simulate(bool useLoadScore)
+{
+    const int poolCount = 4;
+    const int steps = 10000;
+    const double idleRate = 0.2;
+    const double inGameRate = 4.0;
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::vector<SimulatedClient> clients;
+    double imbalanceSum = 0;
+    int measuredSteps = 0;
+
+    for (int step = 0; step < steps; ++step) {
+        std::vector<double> work(poolCount, 0.0);
+        std::vector<int> clientCount(poolCount, 0);
+        for (const SimulatedClient &client : clients) {
+            work[client.pool] += client.inGame ? inGameRate : idleRate;
+            ++clientCount[client.pool];
+        }
+
+        // new connections, bursty like a lobby after a server restart
+        const int arrivals = chance(random) < 0.3 ? 3 : 1;
+        for (int i = 0; i < arrivals; ++i) {
+            std::vector<ServatricePoolLoad> loads(poolCount);
+            for (int pool = 0; pool < poolCount; ++pool) {
+                loads[pool].clients = clientCount[pool];
+                if (useLoadScore) {
+                    loads[pool].commandsPerSecond = static_cast<int>(work[pool]);
+                    // a pool doing more than it can keep up with starts to lag
+                    loads[pool].eventLoopLagMsecs = work[pool] > 600 ? static_cast<int>(work[pool] - 600) / 10 : 0;
+                }
+            }
+            const int pool = findLeastLoadedPool(loads);
+            // players usually reconnect straight into their game
+            const bool inGame = chance(random) < 0.25;
+            clients.push_back({pool, inGame});
+            work[pool] += inGame ? inGameRate : idleRate;
+            ++clientCount[pool];
+        }
+
+        // state changes and disconnects
+        for (size_t i = 0; i < clients.size();) {
+            const double roll = chance(random);
+            if (roll < 0.0015) {
+                clients[i] = clients.back();
+                clients.pop_back();
+                continue;
+            }
+            if (roll < 0.01)
+                clients[i].inGame = !clients[i].inGame;
+            ++i;
+        }
+
+        if (step < steps / 10)
+            continue;
+        double total = 0, busiest = 0;
+        for (double poolWork : work) {
+            total += poolWork;
+            busiest = std::max(busiest, poolWork);
+        }
+        if (total > 0) {
+            imbalanceSum += busiest / (total / poolCount);
+            ++measuredSteps;
+        }
+    }
+    return imbalanceSum / measuredSteps;
+}
+
+TEST(PoolBalanceTest, LoadScoreBalancesMixedClients)
+{
+    const double byClientCount = simulate(false);
+    const double byLoadScore = simulate(true);
+    ASSERT_LE(byLoadScore, byClientCount) << "busiest pool / mean pool work, by client count: " << byClientCount
+                                          << ", by load score: " << byLoadScore;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+#ifndef SAMPLE_SESSION_H
+#define SAMPLE_SESSION_H
+
+/** The server messages of a client session, shared by stream_compression_test and the stream compression benchmark. */
+
+#include "pb/event_game_state_changed.pb.h"
+#include "pb/event_room_say.pb.h"
+#include "pb/game_event_container.pb.h"
+#include "pb/response.pb.h"
+#include "pb/response_join_room.pb.h"
+#include "pb/response_list_users.pb.h"
+#include "pb/room_event.pb.h"
+#include "pb/server_message.pb.h"
+#include "pb/serverinfo_player.pb.h"
+
+#include <string>
+#include <vector>
+
+namespace sample_session
+{
+const char *const userNames[] = {"Gandalf", "jace_beleren", "xXLifeGainXx", "ponder_bot", "KarnLiberated",
+                                 "Momir", "counterspell99", "Teferi", "limited_larry", "TokenCollector"};
+const char *const cardNames[] = {"Island", "Swamp", "Forest", "Mountain", "Plains", "Lightning Bolt", "Counterspell",
+                                 "Llanowar Elves", "Dark Ritual", "Swords to Plowshares", "Brainstorm", "Giant Growth"};
+const char *const zoneNames[] = {"deck", "hand", "table", "grave", "rfg", "sb", "stack"};
+
+inline void fillUser(ServerInfo_User *user, int i)
+{
+    user->set_name(std::string(userNames[i % 10]) + std::to_string(i));
+    user->set_user_level(ServerInfo_User::IsUser | ServerInfo_User::IsRegistered);
+    user->set_country(i % 3 ? "us" : "de");
+    user->set_privlevel(i % 17 ? "NONE" : "VIP");
+    user->set_accountage_secs(86400ull * static_cast<unsigned>(i * 7));
+}
+
+inline ServerMessage responseMessage(int cmdId)
+{
+    ServerMessage message;
+    message.set_message_type(ServerMessage::RESPONSE);
+    message.mutable_response()->set_cmd_id(static_cast<quint64>(cmdId));
+    message.mutable_response()->set_response_code(Response::RespOk);
+    return message;
+}
+
+// what a client receives in the first seconds of a session on a busy server
+inline std::vector<ServerMessage> sampleSession()
+{
+    std::vector<ServerMessage> messages;
+
+    ServerMessage listUsers = responseMessage(1);
+    auto users = listUsers.mutable_response()->MutableExtension(Response_ListUsers::ext);
+    for (int i = 0; i < 500; ++i)
+        fillUser(users->add_user_list(), i);
+    messages.push_back(listUsers);
+
+    ServerMessage joinRoom = responseMessage(2);
+    auto room = joinRoom.mutable_response()->MutableExtension(Response_JoinRoom::ext)->mutable_room_info();
+    room->set_room_id(1);
+    room->set_name("Main room");
+    room->set_description("Play anything");
+    for (int i = 0; i < 80; ++i) {
+        ServerInfo_Game *game = room->add_game_list();
+        game->set_room_id(1);
+        game->set_game_id(1000 + i);
+        game->set_description(i % 2 ? "Modern, no proxies" : "Commander 4 players");
+        game->set_max_players(i % 2 ? 2 : 4);
+        game->set_player_count(1 + i % 2);
+        game->add_game_types(i % 4);
+        fillUser(game->mutable_creator_info(), i);
+        game->set_spectators_allowed(true);
+        game->set_start_time(1700000000u + static_cast<unsigned>(i));
+    }
+    for (int i = 0; i < 300; ++i)
+        fillUser(room->add_user_list(), i);
+    messages.push_back(joinRoom);
+
+    for (int i = 0; i < 200; ++i) {
+        ServerMessage say;
+        say.set_message_type(ServerMessage::ROOM_EVENT);
+        say.mutable_room_event()->set_room_id(1);
+        auto event = say.mutable_room_event()->MutableExtension(Event_RoomSay::ext);
+        event->set_name(userNames[i % 10]);
+        event->set_message(i % 3 ? "anyone up for a game of modern?" : "gg wp");
+        messages.push_back(say);
+    }
+
+    for (int i = 0; i < 20; ++i) {
+        ServerMessage state;
+        state.set_message_type(ServerMessage::GAME_EVENT_CONTAINER);
+        auto container = state.mutable_game_event_container();
+        container->set_game_id(1000);
+        auto event = container->add_event_list()->MutableExtension(Event_GameStateChanged::ext);
+        event->set_game_started(true);
+        for (int player = 0; player < 2; ++player) {
+            ServerInfo_Player *info = event->add_player_list();
+            info->mutable_properties()->set_player_id(player);
+            for (const char *zoneName : zoneNames) {
+                ServerInfo_Zone *zone = info->add_zone_list();
+                zone->set_name(zoneName);
+                zone->set_type(ServerInfo_Zone::PublicZone);
+                for (int card = 0; card < 8; ++card) {
+                    ServerInfo_Card *cardInfo = zone->add_card_list();
+                    cardInfo->set_id(card + 100 * player);
+                    cardInfo->set_name(cardNames[(card + i) % 12]);
+                    cardInfo->set_x(card * 20);
+                    cardInfo->set_y(0);
+                }
+            }
+        }
+        messages.push_back(state);
+    }
+    return messages;
+}
+} // namespace sample_session
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SAMPLE_USERS_H
+#define SAMPLE_USERS_H
+
+/** Complete user info as a session holds it, shared by user_registry_test and the user registry benchmark. */
+
+#include "pb/serverinfo_user.pb.h"
+
+#include <string>
+
+namespace sample_users
+{
+inline ServerInfo_User user(int i)
+{
+    ServerInfo_User result;
+    result.set_name("counterspell" + std::to_string(i));
+    result.set_user_level(ServerInfo_User::IsUser | ServerInfo_User::IsRegistered);
+    result.set_country(i % 3 ? "us" : "de");
+    result.set_real_name("Jace Beleren");
+    result.set_privlevel("NONE");
+    result.set_session_id(static_cast<google::protobuf::uint64>(1000 + i));
+    result.set_address("192.0.2.1");
+    result.set_clientid("0123456789abcdef");
+    result.set_id(i);
+    result.set_email("jace@example.com");
+    result.set_avatar_bmp(std::string(2048, 'x'));
+    return result;
+}
+
+// what copyUserInfo(false) did for every user in every list before the public info was kept in the record
+inline ServerInfo_User strippedCopy(const ServerInfo_User &info)
+{
+    ServerInfo_User result;
+    result.CopyFrom(info);
+    result.clear_session_id();
+    result.clear_address();
+    result.clear_clientid();
+    result.clear_id();
+    result.clear_email();
+    result.clear_avatar_bmp();
+    return result;
+}
+} // namespace sample_users
+
+#endif
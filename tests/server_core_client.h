@@ -0,0 +1,295 @@
+#ifndef SERVER_CORE_CLIENT_H
+#define SERVER_CORE_CLIENT_H
+
+/**
+ * Drives the game logic in common/server_*.cpp in-process through LocalServer, like a local game in the client,
+ * without sockets or a database in the way. Shared by server_core_test and the server core benchmarks.
+ */
+
+#include "../common/decklist.h"
+#include "localserver.h"
+#include "localserverinterface.h"
+#include "pb/command_deck_select.pb.h"
+#include "pb/command_draw_cards.pb.h"
+#include "pb/command_leave_game.pb.h"
+#include "pb/command_move_card.pb.h"
+#include "pb/command_ready_start.pb.h"
+#include "pb/event_create_arrow.pb.h"
+#include "pb/event_delete_arrow.pb.h"
+#include "pb/event_draw_cards.pb.h"
+#include "pb/event_game_joined.pb.h"
+#include "pb/event_game_state_changed.pb.h"
+#include "pb/event_join_room.pb.h"
+#include "pb/event_move_card.pb.h"
+#include "pb/event_set_active_player.pb.h"
+#include "pb/response_list_users.pb.h"
+#include "pb/room_commands.pb.h"
+#include "pb/session_commands.pb.h"
+
+#include <QCoreApplication>
+#include <QList>
+#include <QMap>
+#include <QTextStream>
+#include <iostream>
+
+namespace server_core
+{
+inline QString nativeDeck(const QString &plainText)
+{
+    QString text(plainText);
+    QTextStream stream(&text);
+    DeckList deck;
+    deck.loadFromStream_Plain(stream);
+    return deck.writeToString_Native();
+}
+
+inline const QString &standardDeck()
+{
+    static const QString deck = nativeDeck("24 Forest\n4 Llanowar Elves\n4 Giant Growth\n4 Grizzly Bears\n"
+                                           "4 Wild Growth\n4 Craw Wurm\n4 Scryb Sprites\n4 Regrowth\n"
+                                           "4 Stream of Life\n4 Tranquility\n");
+    return deck;
+}
+
+// enough cards for each player to draw once per turn in a thousand turn game
+inline const QString &largeDeck()
+{
+    static const QString deck = nativeDeck("300 Forest\n300 Island\n");
+    return deck;
+}
+
+/**
+ * A user connected to the in-process server the way the desktop client is for local games. Commands are processed
+ * synchronously, so every send returns the response code and the events it caused have been seen by then. Keeps
+ * track of the card ids in its own public zones and hand, and of its arrows. inRoom tells whether the login and the
+ * join of the first room succeeded.
+ */
+class CoreClient
+{
+private:
+    LocalServerInterface *lsi;
+    quint64 nextCmdId = 0;
+    Response::ResponseCode lastResponse = Response::RespNothing;
+
+    Response::ResponseCode send(CommandContainer &cont)
+    {
+        cont.set_cmd_id(++nextCmdId);
+        lastResponse = Response::RespNothing;
+        lsi->itemFromClient(cont);
+        return lastResponse;
+    }
+
+    void receive(const ServerMessage &message)
+    {
+        ++messagesReceived;
+        if (message.message_type() == ServerMessage::RESPONSE) {
+            if (message.response().cmd_id() == nextCmdId) {
+                lastResponse = message.response().response_code();
+                if (message.response().HasExtension(Response_ListUsers::ext))
+                    userList = message.response().GetExtension(Response_ListUsers::ext);
+            }
+        } else if (message.message_type() == ServerMessage::SESSION_EVENT) {
+            if (message.session_event().HasExtension(Event_GameJoined::ext)) {
+                const Event_GameJoined &joined = message.session_event().GetExtension(Event_GameJoined::ext);
+                gameId = joined.game_info().game_id();
+                playerId = joined.player_id();
+                gameStarted = false;
+                zones.clear();
+                arrows.clear();
+            }
+        } else if (message.message_type() == ServerMessage::ROOM_EVENT) {
+            if (message.room_event().HasExtension(Event_JoinRoom::ext))
+                ++roomJoins;
+        } else if (message.message_type() == ServerMessage::GAME_EVENT_CONTAINER) {
+            for (const GameEvent &event : message.game_event_container().event_list())
+                processGameEvent(event);
+        }
+    }
+
+    void processGameEvent(const GameEvent &event)
+    {
+        if (event.HasExtension(Event_GameStateChanged::ext)) {
+            const Event_GameStateChanged &state = event.GetExtension(Event_GameStateChanged::ext);
+            if (state.game_started()) {
+                gameStarted = true;
+                activePlayerId = state.active_player_id();
+            }
+        } else if (event.HasExtension(Event_SetActivePlayer::ext)) {
+            activePlayerId = event.GetExtension(Event_SetActivePlayer::ext).active_player_id();
+        }
+        if (event.player_id() != playerId)
+            return;
+
+        if (event.HasExtension(Event_DrawCards::ext)) {
+            for (const ServerInfo_Card &card : event.GetExtension(Event_DrawCards::ext).cards())
+                zones["hand"].append(card.id());
+        } else if (event.HasExtension(Event_MoveCard::ext)) {
+            const Event_MoveCard &move = event.GetExtension(Event_MoveCard::ext);
+            const QString startZone = QString::fromStdString(move.start_zone());
+            // the target zone is left out when a card moves within its zone
+            const QString targetZone = move.has_target_zone() ? QString::fromStdString(move.target_zone()) : startZone;
+            if (move.start_player_id() == playerId)
+                zones[startZone].removeAll(move.card_id());
+            if (move.target_player_id() == playerId && targetZone != "deck")
+                zones[targetZone].append(move.new_card_id());
+        } else if (event.HasExtension(Event_CreateArrow::ext)) {
+            arrows.append(event.GetExtension(Event_CreateArrow::ext).arrow_info().id());
+        } else if (event.HasExtension(Event_DeleteArrow::ext)) {
+            arrows.removeAll(event.GetExtension(Event_DeleteArrow::ext).arrow_id());
+        }
+    }
+
+public:
+    int gameId = -1, playerId = -1, activePlayerId = -1;
+    bool gameStarted = false;
+    QMap<QString, QList<int>> zones;
+    QList<int> arrows;
+    int messagesReceived = 0;
+    int roomJoins = 0;
+    // the answer to the last Command_ListUsers
+    Response_ListUsers userList;
+    bool inRoom = false;
+
+    CoreClient(LocalServer &server, const QString &name) : lsi(server.newConnection())
+    {
+        QObject::connect(lsi, &LocalServerInterface::itemToClient, [this](const ServerMessage &message) {
+            receive(message);
+        });
+
+        Command_Login login;
+        login.set_user_name(name.toStdString());
+        login.set_clientid("0123456789abcde");
+        Command_JoinRoom joinRoom;
+        joinRoom.set_room_id(0);
+        inRoom = session(login) == Response::RespOk && session(joinRoom) == Response::RespOk;
+    }
+
+    Response::ResponseCode session(const ::google::protobuf::Message &cmd)
+    {
+        CommandContainer cont;
+        SessionCommand *c = cont.add_session_command();
+        c->GetReflection()->MutableMessage(c, cmd.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(cmd);
+        return send(cont);
+    }
+
+    Response::ResponseCode room(const ::google::protobuf::Message &cmd)
+    {
+        CommandContainer cont;
+        cont.set_room_id(0);
+        RoomCommand *c = cont.add_room_command();
+        c->GetReflection()->MutableMessage(c, cmd.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(cmd);
+        return send(cont);
+    }
+
+    Response::ResponseCode game(const ::google::protobuf::Message &cmd)
+    {
+        CommandContainer cont;
+        cont.set_game_id(static_cast<google::protobuf::uint32>(gameId));
+        GameCommand *c = cont.add_game_command();
+        c->GetReflection()->MutableMessage(c, cmd.GetDescriptor()->FindExtensionByName("ext"))->CopyFrom(cmd);
+        return send(cont);
+    }
+
+    Response::ResponseCode createGame()
+    {
+        Command_CreateGame cmd;
+        cmd.set_description("benchmark");
+        cmd.set_max_players(2);
+        cmd.set_spectators_allowed(true);
+        return room(cmd);
+    }
+
+    Response::ResponseCode joinGame(int id, bool spectator = false)
+    {
+        Command_JoinGame cmd;
+        cmd.set_game_id(id);
+        cmd.set_spectator(spectator);
+        return room(cmd);
+    }
+
+    Response::ResponseCode selectDeckAndReady(const QString &deck)
+    {
+        Command_DeckSelect deckSelect;
+        deckSelect.set_deck(deck.toStdString());
+        const Response::ResponseCode result = game(deckSelect);
+        if (result != Response::RespOk)
+            return result;
+        Command_ReadyStart ready;
+        ready.set_ready(true);
+        return game(ready);
+    }
+
+    Response::ResponseCode draw(int number)
+    {
+        Command_DrawCards cmd;
+        cmd.set_number(static_cast<google::protobuf::uint32>(number));
+        return game(cmd);
+    }
+
+    Response::ResponseCode move(const QString &startZone, const QList<int> &cardIds, const QString &targetZone)
+    {
+        Command_MoveCard cmd;
+        cmd.set_start_player_id(playerId);
+        cmd.set_start_zone(startZone.toStdString());
+        for (int id : cardIds)
+            cmd.mutable_cards_to_move()->add_card()->set_card_id(id);
+        cmd.set_target_player_id(playerId);
+        cmd.set_target_zone(targetZone.toStdString());
+        cmd.set_x(0);
+        cmd.set_y(0);
+        return game(cmd);
+    }
+
+    Response::ResponseCode leaveGame()
+    {
+        const Response::ResponseCode result = game(Command_LeaveGame());
+        gameId = -1;
+        return result;
+    }
+};
+
+inline QString nextUserName()
+{
+    static int users = 0;
+    return QString("bench%1").arg(++users);
+}
+
+// the server starts games and broadcasts game list changes through queued signals
+inline void settle()
+{
+    QCoreApplication::processEvents();
+}
+
+/** Two players in a started game, each with an opening hand; ready is false if any step of that failed. */
+struct Table
+{
+    CoreClient host, opponent;
+    bool ready;
+
+    Table(LocalServer &server, const QString &deck = standardDeck())
+        : host(server, nextUserName()), opponent(server, nextUserName())
+    {
+        ready = host.inRoom && opponent.inRoom && host.createGame() == Response::RespOk &&
+                opponent.joinGame(host.gameId) == Response::RespOk &&
+                host.selectDeckAndReady(deck) == Response::RespOk &&
+                opponent.selectDeckAndReady(deck) == Response::RespOk;
+        settle();
+        ready = ready && host.gameStarted && host.draw(7) == Response::RespOk &&
+                opponent.draw(7) == Response::RespOk;
+    }
+
+    CoreClient &active()
+    {
+        return host.activePlayerId == host.playerId ? host : opponent;
+    }
+};
+
+inline void quietMessageOutput(QtMsgType type, const QMessageLogContext &, const QString &msg)
+{
+    // the server logs every room and game change
+    if (type != QtDebugMsg && type != QtInfoMsg)
+        std::cerr << msg.toStdString() << std::endl;
+}
+} // namespace server_core
+
+#endif
@@ -0,0 +1,362 @@
+#include "../common/rng_sfmt.h"
+#include "pb/command_create_arrow.pb.h"
+#include "pb/command_delete_arrow.pb.h"
+#include "pb/command_mulligan.pb.h"
+#include "pb/command_next_turn.pb.h"
+#include "pb/command_shuffle.pb.h"
+#include "pb/response_list_users.pb.h"
+#include "pb/serverinfo_room.pb.h"
+#include "server_core_client.h"
+#include "server_room.h"
+
+#include "gtest/gtest.h"
+#include <QCoreApplication>
+#include <QStringList>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+RNG_Abstract *rng;
+
+using namespace server_core;
+
+namespace
+{
+/**
+ * The game logic in common/server_*.cpp, run in-process through LocalServer. The timings of the same operations at
+ * scale are in tests/benchmarks/server_core_benchmark.cpp.
+ */
+TEST(ServerCoreTest, GameCreationAndJoin)
+{
+    LocalServer server;
+    CoreClient host(server, nextUserName()), opponent(server, nextUserName());
+    ASSERT_TRUE(host.inRoom && opponent.inRoom);
+
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(host.createGame(), Response::RespOk);
+        ASSERT_EQ(opponent.joinGame(host.gameId), Response::RespOk);
+        ASSERT_EQ(opponent.gameId, host.gameId);
+        ASSERT_EQ(opponent.leaveGame(), Response::RespOk);
+        ASSERT_EQ(host.leaveGame(), Response::RespOk);
+        settle();
+    }
+}
+
+TEST(ServerCoreTest, GamesStartOnceBothAreReady)
+{
+    LocalServer server;
+    CoreClient host(server, nextUserName()), opponent(server, nextUserName());
+    ASSERT_EQ(host.createGame(), Response::RespOk);
+    ASSERT_EQ(opponent.joinGame(host.gameId), Response::RespOk);
+
+    ASSERT_EQ(host.selectDeckAndReady(standardDeck()), Response::RespOk);
+    settle();
+    ASSERT_FALSE(host.gameStarted);
+    ASSERT_EQ(opponent.selectDeckAndReady(standardDeck()), Response::RespOk);
+    settle();
+    ASSERT_TRUE(host.gameStarted);
+    ASSERT_TRUE(opponent.gameStarted);
+}
+
+TEST(ServerCoreTest, MulliganAndShuffle)
+{
+    LocalServer server;
+    Table table(server);
+    ASSERT_TRUE(table.ready);
+
+    Command_Mulligan mulligan;
+    mulligan.set_number(6);
+    ASSERT_EQ(table.host.game(mulligan), Response::RespOk);
+    ASSERT_EQ(table.host.zones["hand"].size(), 6);
+    ASSERT_EQ(table.host.game(Command_Shuffle()), Response::RespOk);
+    ASSERT_EQ(table.host.zones["hand"].size(), 6);
+}
+
+TEST(ServerCoreTest, TurnsPass)
+{
+    LocalServer server;
+    Table table(server);
+    ASSERT_TRUE(table.ready);
+
+    for (int turn = 0; turn < 4; ++turn) {
+        CoreClient &player = table.active();
+        const int playerId = player.playerId;
+        ASSERT_EQ(player.draw(1), Response::RespOk);
+        ASSERT_EQ(player.move("hand", {player.zones["hand"].first()}, "table"), Response::RespOk);
+        ASSERT_EQ(player.game(Command_NextTurn()), Response::RespOk);
+        ASSERT_NE(table.active().playerId, playerId);
+    }
+    ASSERT_EQ(table.host.zones["table"].size(), 2);
+    ASSERT_EQ(table.opponent.zones["table"].size(), 2);
+}
+
+TEST(ServerCoreTest, MassMoves)
+{
+    LocalServer server;
+    Table table(server);
+    ASSERT_TRUE(table.ready);
+    CoreClient &player = table.host;
+    const int cards = 40;
+    ASSERT_EQ(player.draw(cards - 7), Response::RespOk);
+
+    ASSERT_EQ(player.move("hand", player.zones["hand"], "table"), Response::RespOk);
+    ASSERT_EQ(player.zones["table"].size(), cards);
+    ASSERT_EQ(player.move("table", player.zones["table"], "grave"), Response::RespOk);
+    ASSERT_EQ(player.zones["grave"].size(), cards);
+    ASSERT_EQ(player.move("grave", player.zones["grave"], "deck"), Response::RespOk);
+    ASSERT_TRUE(player.zones["grave"].isEmpty());
+    ASSERT_EQ(player.draw(cards), Response::RespOk);
+    ASSERT_EQ(player.zones["hand"].size(), cards);
+}
+
+TEST(ServerCoreTest, Arrows)
+{
+    LocalServer server;
+    Table table(server);
+    ASSERT_TRUE(table.ready);
+    const int cards = 3;
+    for (CoreClient *player : {&table.host, &table.opponent})
+        ASSERT_EQ(player->move("hand", player->zones["hand"].mid(0, cards), "table"), Response::RespOk);
+
+    for (int start : table.host.zones["table"]) {
+        for (int target : table.opponent.zones["table"]) {
+            Command_CreateArrow cmd;
+            cmd.set_start_player_id(table.host.playerId);
+            cmd.set_start_zone("table");
+            cmd.set_start_card_id(start);
+            cmd.set_target_player_id(table.opponent.playerId);
+            cmd.set_target_zone("table");
+            cmd.set_target_card_id(target);
+            ASSERT_EQ(table.host.game(cmd), Response::RespOk);
+        }
+    }
+    ASSERT_EQ(table.host.arrows.size(), cards * cards);
+
+    for (int id : QList<int>(table.host.arrows)) {
+        Command_DeleteArrow cmd;
+        cmd.set_arrow_id(id);
+        ASSERT_EQ(table.host.game(cmd), Response::RespOk);
+    }
+    ASSERT_TRUE(table.host.arrows.isEmpty());
+}
+
+TEST(ServerCoreTest, SpectatorsSeeTheGame)
+{
+    LocalServer server;
+    Table table(server);
+    ASSERT_TRUE(table.ready);
+
+    std::vector<std::unique_ptr<CoreClient>> watching;
+    for (int i = 0; i < 3; ++i) {
+        watching.emplace_back(new CoreClient(server, nextUserName()));
+        ASSERT_EQ(watching.back()->joinGame(table.host.gameId, true), Response::RespOk);
+    }
+    settle();
+
+    std::vector<int> before;
+    for (const auto &spectator : watching)
+        before.push_back(spectator->messagesReceived);
+    CoreClient &player = table.active();
+    ASSERT_EQ(player.draw(1), Response::RespOk);
+    ASSERT_EQ(player.move("hand", {player.zones["hand"].first()}, "table"), Response::RespOk);
+    ASSERT_EQ(player.game(Command_NextTurn()), Response::RespOk);
+    for (size_t i = 0; i < watching.size(); ++i)
+        ASSERT_GE(watching[i]->messagesReceived - before[i], 3);
+}
+
+TEST(ServerCoreTest, ExternalUserResync)
+{
+    LocalServer server;
+    CoreClient watcher(server, nextUserName());
+    Server_Room *room = server.getRooms().value(0);
+    ASSERT_NE(room, nullptr);
+
+    ServerInfo_Room externalRoom;
+    externalRoom.set_room_id(0);
+    externalRoom.add_user_list()->set_name("peer_user1");
+    externalRoom.add_user_list()->set_name("peer_user2");
+
+    QReadLocker locker(&server.roomsLock);
+    const int joinsBefore = watcher.roomJoins;
+    room->addExternalContents(externalRoom);
+    ASSERT_EQ(watcher.roomJoins - joinsBefore, 2);
+
+    // a peer resyncing after a reconnect reports the same users again
+    room->addExternalContents(externalRoom);
+    ServerInfo_User known;
+    known.set_name("peer_user1");
+    room->addExternalUser(known);
+    ASSERT_EQ(watcher.roomJoins - joinsBefore, 2) << "Users already in the room are not announced again";
+    ASSERT_EQ(room->getExternalUsers().size(), 2);
+
+    externalRoom.add_user_list()->set_name("peer_user3");
+    room->addExternalContents(externalRoom);
+    ASSERT_EQ(watcher.roomJoins - joinsBefore, 3);
+    ASSERT_EQ(room->getExternalUsers().size(), 3);
+}
+
+// the slots the links to other servers are connected to, for adding users of a peer without a link
+class PeeredServer : public LocalServer
+{
+public:
+    using Server::externalUserJoined;
+    using Server::externalUserLeft;
+};
+
+ServerInfo_User externalUser(const std::string &name, int sessionId)
+{
+    ServerInfo_User user;
+    user.set_name(name);
+    user.set_session_id(static_cast<google::protobuf::uint64>(sessionId));
+    user.set_server_id(2);
+    return user;
+}
+
+Response_ListUsers listUsers(CoreClient &client, const Command_ListUsers &cmd)
+{
+    EXPECT_EQ(client.session(cmd), Response::RespOk);
+    return client.userList;
+}
+
+QStringList userNames(const Response_ListUsers &list)
+{
+    QStringList result;
+    for (const ServerInfo_User &user : list.user_list())
+        result.append(QString::fromStdString(user.name()));
+    return result;
+}
+
+TEST(ServerCoreTest, UserListPagesMergeLocalAndExternalUsers)
+{
+    PeeredServer server;
+    CoreClient first(server, nextUserName()), second(server, nextUserName());
+    int sessionId = 1000;
+    // before, between and after the local users
+    for (const char *name : {"a_peer", "bench_peer", "zz_peer"})
+        server.externalUserJoined(externalUser(name, ++sessionId));
+    QStringList expected = server.getUsers().keys() + server.getExternalUsers().keys();
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected.size(), 5);
+
+    QStringList seen;
+    Command_ListUsers cmd;
+    cmd.set_page_size(2);
+    for (int page = 0; page < expected.size(); ++page) {
+        const Response_ListUsers list = listUsers(first, cmd);
+        ASSERT_FALSE(list.is_diff());
+        seen += userNames(list);
+        if (!list.has_next_cursor())
+            break;
+        ASSERT_EQ(list.user_list_size(), 2) << "Only the last page is short";
+        ASSERT_EQ(QString::fromStdString(list.next_cursor()), seen.last());
+        cmd.set_cursor(list.next_cursor());
+    }
+    ASSERT_EQ(seen, expected) << "Every user is listed once, in order";
+}
+
+TEST(ServerCoreTest, UserListCursorEndsWithTheLastUser)
+{
+    PeeredServer server;
+    CoreClient first(server, nextUserName()), second(server, nextUserName());
+    server.externalUserJoined(externalUser("zz_peer", 1000));
+
+    Command_ListUsers cmd;
+    cmd.set_page_size(3);
+    const Response_ListUsers full = listUsers(first, cmd);
+    ASSERT_EQ(full.user_list_size(), 3);
+    ASSERT_FALSE(full.has_next_cursor()) << "A page that ends with the last user has no cursor";
+
+    cmd.set_cursor("zz_peer");
+    const Response_ListUsers past = listUsers(first, cmd);
+    ASSERT_EQ(past.user_list_size(), 0);
+    ASSERT_FALSE(past.has_next_cursor());
+}
+
+TEST(ServerCoreTest, UserListDiffsHoldJoinsChangesAndLeaves)
+{
+    PeeredServer server;
+    CoreClient watcher(server, nextUserName());
+    const quint64 start = listUsers(watcher, Command_ListUsers()).version();
+
+    Command_ListUsers since;
+    since.set_since_version(start);
+    Response_ListUsers diff = listUsers(watcher, since);
+    ASSERT_TRUE(diff.is_diff());
+    ASSERT_EQ(diff.version(), start);
+    ASSERT_EQ(diff.user_list_size(), 0);
+
+    const QString joinerName = nextUserName();
+    CoreClient joiner(server, joinerName);
+    server.externalUserJoined(externalUser("peer_user", 1000));
+    diff = listUsers(watcher, since);
+    ASSERT_TRUE(diff.is_diff());
+    ASSERT_EQ(diff.version(), start + 2);
+    QStringList joined = userNames(diff);
+    joined.sort();
+    ASSERT_EQ(joined, QStringList({joinerName, "peer_user"}));
+    ASSERT_EQ(diff.removed_user_list_size(), 0);
+
+    // an account edit on the session of the new user
+    Server_ProtocolHandler *session = server.getUsers().value(joinerName);
+    ASSERT_NE(session, nullptr);
+    ServerInfo_User changed(session->copyUserInfo(true, true, true));
+    changed.set_country("nl");
+    session->updateUserInfo(changed);
+    since.set_since_version(diff.version());
+    diff = listUsers(watcher, since);
+    ASSERT_EQ(diff.version(), start + 3);
+    ASSERT_EQ(diff.user_list_size(), 1);
+    ASSERT_EQ(diff.user_list(0).name(), changed.name());
+    ASSERT_EQ(diff.user_list(0).country(), "nl");
+
+    server.externalUserLeft("peer_user");
+    since.set_since_version(diff.version());
+    diff = listUsers(watcher, since);
+    ASSERT_TRUE(diff.is_diff());
+    ASSERT_EQ(diff.user_list_size(), 0);
+    ASSERT_EQ(diff.removed_user_list_size(), 1);
+    ASSERT_EQ(diff.removed_user_list(0), "peer_user");
+}
+
+TEST(ServerCoreTest, UserListDiffsOnlyGoBackAsFarAsTheServerRemembers)
+{
+    PeeredServer server;
+    CoreClient watcher(server, nextUserName());
+    const quint64 start = listUsers(watcher, Command_ListUsers()).version();
+
+    // one change more than the server remembers, ending with the peer user in the list
+    for (int i = 0; i <= Server::maxUserListChanges; ++i) {
+        if (i % 2 == 0)
+            server.externalUserJoined(externalUser("peer_user", 1000 + i));
+        else
+            server.externalUserLeft("peer_user");
+    }
+
+    Command_ListUsers since;
+    since.set_since_version(start + 1);
+    Response_ListUsers list = listUsers(watcher, since);
+    ASSERT_TRUE(list.is_diff()) << "The oldest change the server remembers is the one right after start + 1";
+    ASSERT_EQ(list.version(), start + Server::maxUserListChanges + 1);
+    ASSERT_EQ(userNames(list), QStringList({"peer_user"}));
+
+    since.set_since_version(start);
+    list = listUsers(watcher, since);
+    ASSERT_FALSE(list.is_diff()) << "The change right after start is forgotten";
+    ASSERT_EQ(list.user_list_size(), 2);
+
+    since.set_since_version(list.version() + 1);
+    ASSERT_FALSE(listUsers(watcher, since).is_diff()) << "A version from the future gets the whole list";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMessageHandler(quietMessageOutput);
+    rng = new RNG_SFMT;
+
+    ::testing::InitGoogleTest(&argc, argv);
+    const int result = RUN_ALL_TESTS();
+    delete rng;
+    return result;
+}
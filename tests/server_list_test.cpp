@@ -0,0 +1,54 @@
+#include "../servatrice/src/servatrice_server_list.h"
+
+#include "gtest/gtest.h"
+
+namespace
+{
+ServerProperties server(int id, const QString &hostname, const QString &address)
+{
+    return ServerProperties(id, QSslCertificate(), hostname, QHostAddress(address), 4747, 14747);
+}
+
+TEST(ServerListTest, DropsOwnServerById)
+{
+    const QList<ServerProperties> peers =
+        withoutOwnServer({server(1, "self", "192.0.2.1"), server(2, "peer", "192.0.2.2")}, 1, QSslCertificate());
+    ASSERT_EQ(peers.size(), 1);
+    ASSERT_EQ(peers.first().id, 2);
+}
+
+TEST(ServerListTest, PeerSharingOurAddressIsFound)
+{
+    // two servers behind one address: an incoming connection from there must resolve to the peer, not to ourselves
+    const QList<ServerProperties> serverList = {server(1, "self", "192.0.2.1"), server(2, "peer", "192.0.2.1")};
+    ASSERT_EQ(indexOfServerAddress(serverList, QHostAddress("192.0.2.1")), 0);
+
+    const QList<ServerProperties> peers = withoutOwnServer(serverList, 1, QSslCertificate());
+    const int index = indexOfServerAddress(peers, QHostAddress("192.0.2.1"));
+    ASSERT_EQ(index, 0);
+    ASSERT_EQ(peers[index].id, 2);
+    ASSERT_EQ(peers[index].hostname, "peer");
+}
+
+TEST(ServerListTest, ReloadsStayFiltered)
+{
+    const QList<ServerProperties> fromDatabase = {server(1, "self", "192.0.2.1"), server(2, "peer", "192.0.2.1")};
+    QList<ServerProperties> serverList;
+    for (int reload = 0; reload < 3; ++reload) {
+        serverList = withoutOwnServer(fromDatabase, 1, QSslCertificate());
+        ASSERT_EQ(serverList.size(), 1);
+        ASSERT_EQ(serverList.first().id, 2);
+    }
+}
+
+TEST(ServerListTest, UnknownAddress)
+{
+    ASSERT_EQ(indexOfServerAddress({server(2, "peer", "192.0.2.2")}, QHostAddress("198.51.100.1")), -1);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,74 @@
+#include "../common/server_metrics.h"
+
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+namespace
+{
+TEST(ServerMetricsTest, HistogramBucketsAreCumulative)
+{
+    MetricsHistogram histogram(MetricsHistogram::SizeBuckets);
+    histogram.observe(0);
+    histogram.observe(3);
+    histogram.observe(1000000);
+
+    QByteArray out;
+    histogram.write(out, "test", "scope=\"room\"");
+    ASSERT_TRUE(out.contains("test_bucket{scope=\"room\",le=\"0\"} 1\n"));
+    ASSERT_TRUE(out.contains("test_bucket{scope=\"room\",le=\"5\"} 2\n"));
+    ASSERT_TRUE(out.contains("test_bucket{scope=\"room\",le=\"50000\"} 2\n"));
+    ASSERT_TRUE(out.contains("test_bucket{scope=\"room\",le=\"+Inf\"} 3\n"));
+    ASSERT_TRUE(out.contains("test_sum{scope=\"room\"} 1000003\n"));
+    ASSERT_TRUE(out.contains("test_count{scope=\"room\"} 3\n"));
+}
+
+TEST(ServerMetricsTest, LatencyIsExportedInSeconds)
+{
+    MetricsHistogram histogram;
+    histogram.observe(1500);
+
+    QByteArray out;
+    histogram.write(out, "latency", QByteArray());
+    ASSERT_TRUE(out.contains("latency_bucket{le=\"0.001\"} 0\n"));
+    ASSERT_TRUE(out.contains("latency_bucket{le=\"0.0025\"} 1\n"));
+    ASSERT_TRUE(out.contains("latency_sum 0.001500\n"));
+}
+
+TEST(ServerMetricsTest, CommandsAreLabelledByType)
+{
+    ServerMetrics metrics;
+    metrics.commandProcessed(ServerMetrics::SessionCommandCategory, 1001, 20000);
+    metrics.commandProcessed(ServerMetrics::GameCommandCategory, 99999, 20000);
+
+    QByteArray out;
+    metrics.write(out);
+    ASSERT_TRUE(out.contains("servatrice_command_duration_seconds_count{category=\"session\",type=\"login\"} 1"));
+    ASSERT_TRUE(out.contains("servatrice_command_duration_seconds_count{category=\"game\",type=\"other\"} 1"));
+    ASSERT_FALSE(out.contains("type=\"ping\"")) << "Commands that were never seen are not exported";
+}
+
+TEST(ServerMetricsTest, ConcurrentUpdatesAreNotLost)
+{
+    const int threadCount = 8;
+    const int updatesPerThread = 100000;
+    MetricsHistogram histogram(MetricsHistogram::SizeBuckets);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+        threads.emplace_back([&histogram, i] {
+            for (int j = 0; j < updatesPerThread; ++j)
+                histogram.observe(static_cast<quint64>(i));
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    ASSERT_EQ(histogram.getCount(), static_cast<quint64>(threadCount * updatesPerThread));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,70 @@
+#include "../common/stream_compression.h"
+#include "sample_session.h"
+
+#include "gtest/gtest.h"
+
+using namespace sample_session;
+
+namespace
+{
+TEST(StreamCompressionTest, MessagesSurviveTheRoundTrip)
+{
+    if (!StreamCompressor::isAvailable())
+        GTEST_SKIP() << "Built without zlib";
+
+    StreamCompressor compressor;
+    StreamDecompressor decompressor;
+    for (const ServerMessage &message : sampleSession()) {
+        const std::string raw = message.SerializeAsString();
+        QByteArray compressed, decompressed;
+        ASSERT_TRUE(compressor.compress(raw.data(), static_cast<int>(raw.size()), compressed));
+        ASSERT_TRUE(decompressor.decompress(compressed.constData(), compressed.size(), decompressed));
+        ASSERT_EQ(std::string(decompressed.constData(), static_cast<size_t>(decompressed.size())), raw);
+    }
+}
+
+TEST(StreamCompressionTest, CorruptDataIsRejected)
+{
+    if (!StreamCompressor::isAvailable())
+        GTEST_SKIP() << "Built without zlib";
+
+    StreamDecompressor decompressor;
+    const QByteArray garbage(64, '\xff');
+    QByteArray out;
+    ASSERT_FALSE(decompressor.decompress(garbage.constData(), garbage.size(), out));
+    ASSERT_FALSE(decompressor.decompress(garbage.constData(), garbage.size(), out)) << "The stream stays broken";
+}
+
+TEST(StreamCompressionTest, EmptyMessagesAreNotCompressed)
+{
+    StreamCompressor compressor;
+    QByteArray out;
+    ASSERT_FALSE(compressor.compress("", 0, out));
+    ASSERT_TRUE(out.isEmpty());
+}
+
+TEST(StreamCompressionTest, SessionShrinksByHalf)
+{
+    if (!StreamCompressor::isAvailable())
+        GTEST_SKIP() << "Built without zlib";
+
+    for (int level : {1, StreamCompressor::DefaultLevel, 6}) {
+        StreamCompressor compressor(level);
+        quint64 rawBytes = 0, wireBytes = 0;
+        for (const ServerMessage &message : sampleSession()) {
+            const std::string raw = message.SerializeAsString();
+            QByteArray compressed;
+            compressor.compress(raw.data(), static_cast<int>(raw.size()), compressed);
+            rawBytes += raw.size() + 4;
+            wireBytes += static_cast<quint64>(compressed.size()) + 4;
+        }
+        ASSERT_LT(wireBytes, rawBytes / 2) << "level " << level;
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include "../common/serverinfo_user_container.h"
+#include "pb/response_list_users.pb.h"
+#include "sample_users.h"
+
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace sample_users;
+
+namespace
+{
+TEST(UserRegistryTest, EqualInfoSharesOneRecord)
+{
+    ServerInfo_User_Container session(user(1));
+    ServerInfo_User_Container player(session.copyUserInfo(true, true, true));
+    ServerInfo_User_Container copy(session);
+    ASSERT_EQ(session.getUserInfoRecord(), player.getUserInfoRecord());
+    ASSERT_EQ(session.getUserInfo().get(), copy.getUserInfo().get());
+}
+
+TEST(UserRegistryTest, ChangedInfoGetsANewRecord)
+{
+    ServerInfo_User_Container session(user(2));
+    ServerInfo_User_Container game(session);
+
+    ServerInfo_User changed(*session.getUserInfo());
+    changed.set_country("nl");
+    session.setUserInfo(changed);
+    ASSERT_NE(session.getUserInfoRecord(), game.getUserInfoRecord());
+    ASSERT_EQ(session.getUserInfo()->country(), "nl");
+    ASSERT_EQ(game.getUserInfo()->country(), "de") << "Holders of the old record keep their snapshot";
+}
+
+TEST(UserRegistryTest, ReadersKeepTheInfoTheyGotWhileItIsReplaced)
+{
+    ServerInfo_User_Container session(user(6));
+    const ServerInfo_User_Ptr reader = session.getUserInfo();
+
+    ServerInfo_User changed(*reader);
+    changed.set_country("nl");
+    session.setUserInfo(changed);
+    session.setUserInfo(user(6));
+    session.setUserInfo(changed);
+    ASSERT_EQ(reader->country(), "de") << "The record a reader holds is not freed when the session replaces it";
+    ASSERT_EQ(session.getUserInfo()->country(), "nl");
+}
+
+TEST(UserRegistryTest, PublicInfoMatchesCopyUserInfo)
+{
+    ServerInfo_User_Container session(user(3));
+    const ServerInfo_User &publicInfo = session.getUserInfoRecord()->getPublicInfo();
+    ASSERT_EQ(publicInfo.SerializeAsString(), session.copyUserInfo(false).SerializeAsString());
+    ASSERT_FALSE(publicInfo.has_avatar_bmp());
+    ASSERT_FALSE(publicInfo.has_email());
+    ASSERT_FALSE(publicInfo.has_session_id());
+    ASSERT_TRUE(session.copyUserInfo(true).has_avatar_bmp());
+}
+
+TEST(UserRegistryTest, AssignmentDoesNotShareOwnership)
+{
+    ServerInfo_User_Container first(user(4));
+    {
+        ServerInfo_User_Container second(user(5));
+        first = second;
+    }
+    ASSERT_EQ(first.getUserInfo()->name(), "counterspell5");
+}
+
+TEST(UserRegistryTest, UserListFromSharedRecordsMatchesStrippedCopies)
+{
+    std::vector<ServerInfo_User_Container> users;
+    for (int i = 0; i < 200; ++i)
+        users.emplace_back(user(i));
+
+    Response_ListUsers stripped, shared;
+    for (const auto &container : users) {
+        stripped.add_user_list()->CopyFrom(strippedCopy(*container.getUserInfo()));
+        container.copyUserInfo(*shared.add_user_list(), false);
+    }
+    ASSERT_EQ(shared.SerializeAsString(), stripped.SerializeAsString());
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
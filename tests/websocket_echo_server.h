@@ -0,0 +1,124 @@
+#ifndef WEBSOCKET_ECHO_SERVER_H
+#define WEBSOCKET_ECHO_SERVER_H
+
+/**
+ * A websocket server whose connections are spread over pool threads like servatrice's, answering every message with
+ * a digest of it, and the web clients that load it. Shared by websocket_pool_load_test and the websocket pool
+ * benchmark.
+ */
+
+#include "../servatrice/src/servatrice_websocket_acceptor.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QEventLoop>
+#include <QTcpServer>
+#include <QThread>
+#include <QTimer>
+#include <QWebSocket>
+#include <atomic>
+#include <vector>
+
+namespace websocket_load
+{
+// stands in for the protobuf parsing and command processing a pool does for every message
+class EchoAcceptor : public Servatrice_WebsocketAcceptor
+{
+public:
+    static inline std::atomic<int> socketsOnMainThread{0};
+
+protected:
+    void socketConnected(QWebSocket *socket) override
+    {
+        if (QThread::currentThread() == QCoreApplication::instance()->thread())
+            ++socketsOnMainThread;
+        socket->setParent(this);
+        QObject::connect(socket, &QWebSocket::binaryMessageReceived, socket, [socket](const QByteArray &message) {
+            QByteArray digest = message;
+            for (int i = 0; i < 200; ++i)
+                digest = QCryptographicHash::hash(digest + message, QCryptographicHash::Sha256);
+            socket->sendBinaryMessage(digest);
+        });
+    }
+};
+
+class Dispatcher : public QTcpServer
+{
+private:
+    const std::vector<EchoAcceptor *> &acceptors;
+    size_t next;
+
+public:
+    explicit Dispatcher(const std::vector<EchoAcceptor *> &_acceptors) : acceptors(_acceptors), next(0)
+    {
+    }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override
+    {
+        QMetaObject::invokeMethod(acceptors[next++ % acceptors.size()], "acceptConnection", Qt::QueuedConnection,
+                                  Q_ARG(int, static_cast<int>(socketDescriptor)));
+    }
+};
+
+/**
+ * clientCount web clients each send messagesPerClient messages, one at a time, to a server whose connections are
+ * spread over poolCount pool threads. Returns whether every message was answered within a minute.
+ */
+inline bool exchangeMessages(int poolCount, int clientCount, int messagesPerClient)
+{
+    std::vector<QThread *> threads;
+    std::vector<EchoAcceptor *> acceptors;
+    for (int i = 0; i < poolCount; ++i) {
+        auto thread = new QThread;
+        auto acceptor = new EchoAcceptor;
+        acceptor->moveToThread(thread);
+        QObject::connect(thread, &QThread::finished, acceptor, &QObject::deleteLater);
+        thread->start();
+        threads.push_back(thread);
+        acceptors.push_back(acceptor);
+    }
+
+    Dispatcher dispatcher(acceptors);
+    int remaining = clientCount * messagesPerClient;
+    std::vector<QWebSocket *> clients;
+    if (dispatcher.listen(QHostAddress::LocalHost, 0)) {
+        const QUrl url(QString("ws://127.0.0.1:%1").arg(dispatcher.serverPort()));
+        QEventLoop loop;
+        QTimer::singleShot(60000, &loop, &QEventLoop::quit);
+        const QByteArray payload(256, 'x');
+        std::vector<int> sent(static_cast<size_t>(clientCount), 0);
+
+        for (int i = 0; i < clientCount; ++i) {
+            auto client = new QWebSocket;
+            clients.push_back(client);
+            QObject::connect(client, &QWebSocket::connected, [client, &sent, i, &payload] {
+                ++sent[i];
+                client->sendBinaryMessage(payload);
+            });
+            QObject::connect(client, &QWebSocket::binaryMessageReceived,
+                             [client, &sent, i, &payload, &remaining, &loop, messagesPerClient](const QByteArray &) {
+                                 if (--remaining == 0)
+                                     loop.quit();
+                                 else if (sent[i] < messagesPerClient) {
+                                     ++sent[i];
+                                     client->sendBinaryMessage(payload);
+                                 }
+                             });
+            client->open(url);
+        }
+        loop.exec();
+    }
+
+    for (QWebSocket *client : clients)
+        delete client;
+    for (QThread *thread : threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    return remaining == 0;
+}
+} // namespace websocket_load
+
+#endif
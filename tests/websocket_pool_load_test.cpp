@@ -0,0 +1,26 @@
+#include "websocket_echo_server.h"
+
+#include "gtest/gtest.h"
+#include <QCoreApplication>
+
+using namespace websocket_load;
+
+namespace
+{
+/**
+ * Web clients spread over several pool threads all get their answers, and the websocket handshakes run on the pools.
+ * How the throughput scales with the number of pools is measured by tests/benchmarks/websocket_pool_benchmark.cpp.
+ */
+TEST(WebsocketPoolLoadTest, ClientsAreServedOnThePoolThreads)
+{
+    ASSERT_TRUE(exchangeMessages(2, 8, 20)) << "Not all messages were answered";
+    ASSERT_EQ(EchoAcceptor::socketsOnMainThread.load(), 0) << "Websocket handshakes must run on the pool threads";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}